@@ -130,6 +130,10 @@ int  sentence_link_cost(Sentence sent, int i);
 Linkage linkage_create(int index, Sentence sent, Parse_Options opts);
 void linkage_delete(Linkage linkage);
 
+Linkage_iter sentence_linkage_iter_new(Sentence sent, Parse_Options opts);
+Linkage sentence_linkage_iter_next(Linkage_iter iter);
+void sentence_linkage_iter_free(Linkage_iter iter);
+
 %typemap(newfree) char * {
    linkage_free_diagram($1);
 }
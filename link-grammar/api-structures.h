@@ -93,6 +93,12 @@ struct Parse_Options_s
 	                          no longer than this.  Default = 6 */
 	bool all_short;        /* If true, there can be no connectors that are exempt */
 	bool repeatable_rand;  /* Reset rand number gen after every parse. */
+	bool reuse_parse_memory; /* Keep the parse tables for the next
+	                          sentence parsed by the same thread. */
+	int threads;           /* Number of threads for parse counting */
+	bool count_histograms; /* Maintain parse cost histograms */
+	bool best_linkage_only; /* Look for the best linkage first */
+	bool kbest_linkages;   /* Extract the linkages in cost order */
 
 	/* Options governing post-processing */
 	bool perform_pp_prune; /* Perform post-processing-based pruning */
@@ -127,6 +133,20 @@ struct Sentence_s
 	size_t gword_node_num;       /* Debug - for differentiating between
 	                                wordgraph nodes with identical subwords. */
 
+	/* Disjunct statistics, set by pp_and_power_prune(). */
+	size_t num_disjuncts;       /* Number of disjuncts after pruning */
+	size_t num_connectors;      /* Number of connectors after pruning */
+
+	/* The disjuncts of the words, set by prepare_to_parse(). */
+	Disjunct_store *disjunct_store;
+
+	/* The disjuncts before pruning, see save_disjuncts(). */
+	struct disjuncts_snapshot_s *disjuncts_snapshot;
+
+	/* The originating gword sets of the connectors, indexed by their
+	 * gword_set_id, see gword_record_in_connector(). */
+	const gword_set **gword_sets;
+
 	/* Parse results */
 	int    num_linkages_found;  /* Total number before postprocessing.  This
 	                               is returned by the do_count() function */
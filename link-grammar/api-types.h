@@ -28,7 +28,9 @@ typedef struct Resources_s * Resources;
 
 /* Some of the more obscure typedefs */
 typedef struct Connector_set_s Connector_set;
+typedef struct Connector_table_s Connector_table;
 typedef struct Disjunct_struct Disjunct;
+typedef struct Disjunct_store_s Disjunct_store;
 typedef struct Link_s Link;
 typedef struct String_set_s String_set;
 typedef struct Word_struct Word;
@@ -38,6 +40,7 @@ typedef struct gword_set gword_set;
 /* Post-processing structures */
 typedef struct pp_knowledge_s pp_knowledge;
 typedef struct pp_linkset_s pp_linkset;
+typedef struct pp_prune_rules_s pp_prune_rules;
 typedef struct PP_domains_s PP_domains;
 
 typedef struct corpus_s Corpus;
@@ -151,6 +151,11 @@ Parse_Options parse_options_create(void)
 	po->perform_pp_prune = true;
 	po->twopass_length = 30;
 	po->repeatable_rand = true;
+	po->reuse_parse_memory = false;
+	po->threads = 1;
+	po->count_histograms = false;
+	po->best_linkage_only = false;
+	po->kbest_linkages = false;
 	po->resources = resources_create();
 	po->use_cluster_disjuncts = false;
 	po->display_morphology = false;
@@ -395,6 +400,83 @@ bool parse_options_get_repeatable_rand(Parse_Options opts) {
 	return opts->repeatable_rand;
 }
 
+/**
+ * True means keep the memory of the parse tables (count table, fast
+ * matcher) after parsing, and reuse it for the next sentence that is
+ * parsed by the same thread. This saves allocating and clearing them
+ * for each sentence. The kept memory is freed when a sentence is parsed
+ * by that thread with this option set to false, or when that thread
+ * calls dictionary_delete(). This option has no effect if the library
+ * is built without thread-local storage.
+ */
+void parse_options_set_reuse_parse_memory(Parse_Options opts, bool val) {
+	opts->reuse_parse_memory = val;
+}
+
+bool parse_options_get_reuse_parse_memory(Parse_Options opts) {
+	return opts->reuse_parse_memory;
+}
+
+/**
+ * The number of threads to use for pruning and for counting the parses
+ * of long sentences, and for extracting and post-processing the linkages
+ * when many are wanted (see parse_options_set_linkage_limit()).
+ * The results don't depend on it. Only values greater than 1
+ * have an effect, and only if the library was built with POSIX threads.
+ */
+void parse_options_set_threads(Parse_Options opts, int val) {
+	opts->threads = (val < 1) ? 1 : val;
+}
+
+int parse_options_get_threads(Parse_Options opts) {
+	return opts->threads;
+}
+
+/**
+ * True means maintain a histogram of the parse costs while counting the
+ * parses. It is currently only printed at a high verbosity level. The
+ * counting is faster without it, so it is off by default.
+ */
+void parse_options_set_count_histograms(Parse_Options opts, bool val) {
+	opts->count_histograms = val;
+}
+
+bool parse_options_get_count_histograms(Parse_Options opts) {
+	return opts->count_histograms;
+}
+
+/**
+ * True means find the best (least cost) linkage directly, instead of
+ * extracting up to linkage_limit linkages (at random if there are more)
+ * and sorting them. Only if the best linkage turns out to be invalid
+ * (due to its morphology or a post-processing violation), are the
+ * linkages extracted as usual. So this is for users that need only the
+ * first linkage, which is then usually the only one that is returned.
+ */
+void parse_options_set_best_linkage_only(Parse_Options opts, bool val) {
+	opts->best_linkage_only = val;
+}
+
+bool parse_options_get_best_linkage_only(Parse_Options opts) {
+	return opts->best_linkage_only;
+}
+
+/**
+ * True means extract the linkages in the order of their cost, the
+ * best ones first, up to linkage_limit of them. Without it, if there
+ * are more linkages than linkage_limit, a random subset of them is
+ * extracted. So linkage_create(k, ...) returns one of the k+1 best
+ * linkages even if the number of linkages overflows; it may be a
+ * different one than the k'th best only due to post-processing.
+ */
+void parse_options_set_kbest_linkages(Parse_Options opts, bool val) {
+	opts->kbest_linkages = val;
+}
+
+bool parse_options_get_kbest_linkages(Parse_Options opts) {
+	return opts->kbest_linkages;
+}
+
 void parse_options_set_max_parse_time(Parse_Options opts, int dummy) {
 	opts->resources->max_parse_time = dummy;
 }
@@ -514,14 +596,34 @@ int sentence_split(Sentence sent, Parse_Options opts)
 	return 0;
 }
 
+static void free_sentence_disjuncts(Sentence sent)
+{
+	size_t i;
+
+	if (NULL != sent->disjunct_store)
+	{
+		disjunct_store_delete(sent->disjunct_store);
+		sent->disjunct_store = NULL;
+		for (i = 0; i < sent->length; ++i)
+			sent->word[i].d = NULL;
+		return;
+	}
+
+	for (i = 0; i < sent->length; ++i)
+	{
+		free_disjuncts(sent->word[i].d);
+		sent->word[i].d = NULL;
+	}
+}
+
 static void free_sentence_words(Sentence sent)
 {
 	size_t i;
 
+	free_sentence_disjuncts(sent);
 	for (i = 0; i < sent->length; i++)
 	{
 		free_X_nodes(sent->word[i].x);
-		free_disjuncts(sent->word[i].d);
 		free(sent->word[i].alternatives);
 	}
 	free((void *) sent->word);
@@ -538,6 +640,7 @@ void sentence_delete(Sentence sent)
 	free_linkages(sent);
 	post_process_free(sent->postprocessor);
 	post_process_free(sent->constituent_pp);
+	free(sent->gword_sets);
 
 	global_rand_state = sent->rand_state;
 	free(sent);
@@ -602,18 +705,11 @@ int sentence_link_cost(Sentence sent, LinkageIdx i)
 	return sent->lnkages[i].lifo.link_cost;
 }
 
-static void free_sentence_disjuncts(Sentence sent)
-{
-	size_t i;
-
-	for (i = 0; i < sent->length; ++i)
-	{
-		free_disjuncts(sent->word[i].d);
-		sent->word[i].d = NULL;
-	}
-}
-
-int sentence_parse(Sentence sent, Parse_Options opts)
+/**
+ * What has to be done before parsing a sentence, by sentence_parse()
+ * and sentence_linkage_iter_new(). Return 0 on success.
+ */
+static int sentence_parse_prepare(Sentence sent, Parse_Options opts)
 {
 	int rc;
 
@@ -647,8 +743,17 @@ int sentence_parse(Sentence sent, Parse_Options opts)
 	/* Expressions were set up during the tokenize stage.
 	 * Prune them, and then parse.
 	 */
-	expression_prune(sent);
+	expression_prune(sent, opts);
 	print_time(opts, "Finished expression pruning");
+
+	return 0;
+}
+
+int sentence_parse(Sentence sent, Parse_Options opts)
+{
+	int rc = sentence_parse_prepare(sent, opts);
+	if (rc) return rc;
+
 	if (opts->use_sat_solver)
 	{
 		sat_parse(sent, opts);
@@ -669,3 +774,48 @@ int sentence_parse(Sentence sent, Parse_Options opts)
 	}
 	return sent->num_valid_linkages;
 }
+
+/**
+ * Parse the sentence, and return an iterator over its valid linkages,
+ * to be used instead of sentence_parse() and linkage_create() when not
+ * all the linkages are needed, or to save memory.
+ *
+ * Each call to sentence_linkage_iter_next() extracts, checks and
+ * post-processes linkages until it finds a valid one (i.e. one with no
+ * P.P. violations), and returns it. It returns NULL when there are no
+ * more. The returned linkage belongs to the iterator, and it is valid
+ * only until the next call. The linkages are not sorted; to get them
+ * in cost order, use parse_options_set_kbest_linkages().
+ *
+ * As with sentence_parse(), up to opts->linkage_limit linkages are
+ * considered with the smallest null count in the allowed range that has
+ * valid linkages; sentence_null_count() and
+ * sentence_num_linkages_found() are for the current null count.
+ * The sentence must not be parsed again until the iterator is freed
+ * with sentence_linkage_iter_free().
+ *
+ * Return NULL on error, or with the SAT solver, which is not supported.
+ */
+Linkage_iter sentence_linkage_iter_new(Sentence sent, Parse_Options opts)
+{
+	if (opts->use_sat_solver)
+	{
+		prt_error("Error: The linkage iterator cannot be used with the SAT solver\n");
+		return NULL;
+	}
+
+	if (0 != sentence_parse_prepare(sent, opts)) return NULL;
+
+	return linkage_iter_new(sent, opts);
+}
+
+Linkage sentence_linkage_iter_next(Linkage_iter iter)
+{
+	if (NULL == iter) return NULL;
+	return linkage_iter_next(iter);
+}
+
+void sentence_linkage_iter_free(Linkage_iter iter)
+{
+	linkage_iter_free(iter);
+}
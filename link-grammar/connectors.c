@@ -15,36 +15,25 @@
  */
 
 #include <math.h>
+#include <string.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #include "dict-common/dict-utils.h" // for size_of_expression()
 #include "connectors.h"
+#include "memory-pool.h"
 
 /**
- * free_connectors() -- free the list of connectors pointed to by e
- * (does not free any strings)
+ * Return a single (stand-alone) connector. The connectors of the
+ * disjuncts are allocated by disjunct_alloc_connectors().
  */
-void free_connectors(Connector *e)
-{
-	Connector * n;
-	for (; e != NULL; e = n)
-	{
-		n = e->next;
-		xfree((char *)e, sizeof(Connector));
-	}
-}
-
 Connector * connector_new(void)
 {
 	Connector *c = (Connector *) xalloc(sizeof(Connector));
 	init_connector(c);
-	c->nearest_word = 0;
-	c->multi = false;
-	c->lc_start = 0;
-	c->uc_length = 0;
-	c->uc_start = 0;
-	c->next = NULL;
-	c->string = "";
-	c->tableNext = NULL;
 	return c;
 }
 
@@ -73,11 +62,11 @@ static unsigned int connector_set_hash(Connector_set *conset, const char * s, in
 static void build_connector_set_from_expression(Connector_set * conset, Exp * e)
 {
 	E_list * l;
-	Connector * c;
+	conset_entry * c;
 	unsigned int h;
 	if (e->type == CONNECTOR_type)
 	{
-		c = connector_new();
+		c = (conset_entry *) xalloc(sizeof(conset_entry));
 		c->string = e->u.string;
 		h = connector_set_hash(conset, c->string, e->dir);
 		c->next = conset->hash_table[h];
@@ -97,7 +86,7 @@ Connector_set * connector_set_create(Exp *e)
 	conset = (Connector_set *) xalloc(sizeof(Connector_set));
 	conset->table_size = next_power_of_two_up(size_of_expression(e));
 	conset->hash_table =
-	  (Connector **) xalloc(conset->table_size * sizeof(Connector *));
+	  (conset_entry **) xalloc(conset->table_size * sizeof(conset_entry *));
 	for (i=0; i<conset->table_size; i++) conset->hash_table[i] = NULL;
 	build_connector_set_from_expression(conset, e);
 	return conset;
@@ -107,8 +96,16 @@ void connector_set_delete(Connector_set * conset)
 {
 	unsigned int i;
 	if (conset == NULL) return;
-	for (i=0; i<conset->table_size; i++) free_connectors(conset->hash_table[i]);
-	xfree(conset->hash_table, conset->table_size * sizeof(Connector *));
+	for (i=0; i<conset->table_size; i++)
+	{
+		conset_entry *c, *cn;
+		for (c = conset->hash_table[i]; c != NULL; c = cn)
+		{
+			cn = c->next;
+			xfree(c, sizeof(conset_entry));
+		}
+	}
+	xfree(conset->hash_table, conset->table_size * sizeof(conset_entry *));
 	xfree(conset, sizeof(Connector_set));
 }
 
@@ -121,12 +118,13 @@ void connector_set_delete(Connector_set * conset)
 bool match_in_connector_set(Connector_set *conset, Connector * c)
 {
 	unsigned int h;
-	Connector * c1;
+	conset_entry * c1;
+	const char *s = connector_get_string(c);
 	if (conset == NULL) return false;
-	h = connector_set_hash(conset, c->string, '+');
+	h = connector_set_hash(conset, s, '+');
 	for (c1 = conset->hash_table[h]; c1 != NULL; c1 = c1->next)
 	{
-		if (easy_match(c1->string, c->string)) return true;
+		if (easy_match(c1->string, s)) return true;
 	}
 	return false;
 }
@@ -134,71 +132,332 @@ bool match_in_connector_set(Connector_set *conset, Connector * c)
 /* ======================================================== */
 
 /**
- * This hash function only looks at the leading upper case letters of
- * the connector string, and the label fields.  This ensures that if two
- * strings match (formally), then they must hash to the same place.
+ * Connector enumeration.
+ *
+ * Each connector name of the dictionary gets a condesc_t, in which the
+ * upper-case part is enumerated with a dense number (uc_num), and the
+ * head-dependent indicator and the lower-case part are encoded so that
+ * connector matching (see easy_match_connectors()) can be done without
+ * looking at the connector strings.
+ *
+ * The descriptors are looked up by the address of the connector string
+ * (all the connector names are in the dictionary string-set), and the
+ * upper-case parts are looked up by their value.  Both tables use open
+ * addressing and are doubled when they get half full.  The descriptor
+ * table holds only pointers; the descriptors themselves are allocated
+ * from a memory pool, so they never move.  This is needed because the
+ * connectors point to their descriptors, and a connector name may be
+ * added while a sentence is being prepared or parsed.
+ *
+ * The connectors of a file-backed dictionary are enumerated when it is
+ * read (see dictionary_setup_defines()), so after that the table is
+ * only read. Connector names that are added later (by the SQL-backed
+ * dictionary, which builds its expressions on demand) are enumerated
+ * on their first use.
  */
-int calculate_connector_hash(Connector * c)
+
+#define CONDESC_TABLE_SIZE_INIT 256
+#define UC_TABLE_SIZE_INIT 128
+
+typedef struct
 {
-	const char *s;
-	unsigned int i;
+	const char *uc;       /* The upper-case part; not NUL-terminated */
+	size_t length;
+	int uc_num;
+} uc_desc_t;
 
-	/* For most situations, all three hashes are very nearly equal;
-	 * as to which is faster depends on the parsed text.
-	 * For both English and Russian, there are about 100 pre-defined
-	 * connectors, and another 2K-4K autogen'ed ones (the IDxxx idiom
-	 * connectors, and the LLxxx suffix connectors for Russian).
-	 * Turns out the cost of setting up the hash table dominates the
-	 * cost of collisions. */
-#ifdef USE_DJB2
-	/* djb2 hash */
-	i = 5381;
-	s = c->string;
-	if (islower((int) *s)) s++; /* ignore head-dependent indicator */
-	while (isupper((int) *s)) /* connector tables cannot contain UTF8, yet */
-	{
-		i = ((i << 5) + i) + *s;
-		s++;
-	}
-	i += i>>14;
-#endif /* USE_DJB2 */
-
-#define USE_JENKINS
-#ifdef USE_JENKINS
-	/* Jenkins one-at-a-time hash */
-	i = 0;
-	s = c->string;
-	if (islower((int) *s)) s++; /* ignore head-dependent indicator */
-	c->uc_start = s - c->string;
-	while (isupper((int) *s)) /* connector tables cannot contain UTF8, yet */
+struct Connector_table_s
+{
+	condesc_t **desc;     /* Keyed by the connector string address */
+	size_t size;
+	size_t num_con;
+	Pool_desc *desc_pool; /* The descriptors */
+	uc_desc_t *uc;        /* Keyed by the upper-case part */
+	size_t uc_size;
+	size_t num_uc;
+};
+
+Connector_table * connector_table_new(void)
+{
+	Connector_table *ct = (Connector_table *) xalloc(sizeof(Connector_table));
+
+	ct->size = CONDESC_TABLE_SIZE_INIT;
+	ct->desc = (condesc_t **) xalloc(ct->size * sizeof(condesc_t *));
+	memset(ct->desc, 0, ct->size * sizeof(condesc_t *));
+	ct->num_con = 0;
+	ct->desc_pool = pool_new("condesc_t", CONDESC_TABLE_SIZE_INIT,
+	                         sizeof(condesc_t), /*zero_out*/true);
+
+	ct->uc_size = UC_TABLE_SIZE_INIT;
+	ct->uc = (uc_desc_t *) xalloc(ct->uc_size * sizeof(uc_desc_t));
+	memset(ct->uc, 0, ct->uc_size * sizeof(uc_desc_t));
+	ct->num_uc = 0;
+
+	return ct;
+}
+
+void connector_table_delete(Connector_table *ct)
+{
+	if (NULL == ct) return;
+	xfree(ct->desc, ct->size * sizeof(condesc_t *));
+	pool_delete(ct->desc_pool);
+	xfree(ct->uc, ct->uc_size * sizeof(uc_desc_t));
+	xfree(ct, sizeof(Connector_table));
+}
+
+static size_t condesc_hash(const char *s)
+{
+	uintptr_t i = (uintptr_t) s;
+
+	/* The low bits of the addresses are mostly the same. */
+	i ^= i >> 4;
+	i ^= i >> 12;
+	return (size_t) i;
+}
+
+/**
+ * Jenkins one-at-a-time hash of the upper-case part.
+ */
+static size_t uc_hash(const char *uc, size_t length)
+{
+	unsigned int i = 0;
+
+	for (const char *s = uc; s < uc + length; s++)
 	{
 		i += *s;
 		i += (i<<10);
 		i ^= (i>>6);
-		s++;
 	}
 	i += (i << 3);
 	i ^= (i >> 11);
 	i += (i << 15);
-#endif /* USE_JENKINS */
-
-#ifdef USE_SDBM
-	/* sdbm hash */
-	i = 0;
-	s = c->string;
-	if (islower((int) *s)) s++; /* ignore head-dependent indicator */
-	c->uc_start = s - c->string;
-	while (isupper((int) *s))
+	return i;
+}
+
+static uc_desc_t *uc_lookup(uc_desc_t *t, size_t size, const char *uc,
+                            size_t length)
+{
+	size_t h = uc_hash(uc, length) & (size-1);
+
+	while (NULL != t[h].uc)
 	{
-		i = *s + (i << 6) + (i << 16) - i;
+		if ((t[h].length == length) && (0 == strncmp(t[h].uc, uc, length)))
+			break;
+		h = (h + 1) & (size-1);
+	}
+	return &t[h];
+}
+
+static condesc_t **condesc_lookup(condesc_t **t, size_t size, const char *s)
+{
+	size_t h = condesc_hash(s) & (size-1);
+
+	while ((NULL != t[h]) && (t[h]->string != s))
+		h = (h + 1) & (size-1);
+	return &t[h];
+}
+
+static void uc_table_grow(Connector_table *ct)
+{
+	size_t old_size = ct->uc_size;
+	uc_desc_t *old = ct->uc;
+
+	ct->uc_size *= 2;
+	ct->uc = (uc_desc_t *) xalloc(ct->uc_size * sizeof(uc_desc_t));
+	memset(ct->uc, 0, ct->uc_size * sizeof(uc_desc_t));
+	for (size_t i = 0; i < old_size; i++)
+	{
+		if (NULL == old[i].uc) continue;
+		*uc_lookup(ct->uc, ct->uc_size, old[i].uc, old[i].length) = old[i];
+	}
+	xfree(old, old_size * sizeof(uc_desc_t));
+}
+
+static void condesc_table_grow(Connector_table *ct)
+{
+	size_t old_size = ct->size;
+	condesc_t **old = ct->desc;
+
+	ct->size *= 2;
+	ct->desc = (condesc_t **) xalloc(ct->size * sizeof(condesc_t *));
+	memset(ct->desc, 0, ct->size * sizeof(condesc_t *));
+	for (size_t i = 0; i < old_size; i++)
+	{
+		if (NULL == old[i]) continue;
+		*condesc_lookup(ct->desc, ct->size, old[i]->string) = old[i];
+	}
+	xfree(old, old_size * sizeof(condesc_t *));
+}
+
+/**
+ * Set the fields of desc according to its connector string.
+ */
+static void condesc_encode(Connector_table *ct, condesc_t *desc)
+{
+	const char *s = desc->string;
+
+	desc->head_dependent = '\0';
+	if (islower((int) *s)) desc->head_dependent = *s++;
+
+	const char *uc = s;
+	while (isupper((int) *s)) /* connector tables cannot contain UTF8, yet */
 		s++;
+
+	uc_desc_t *ucd = uc_lookup(ct->uc, ct->uc_size, uc, s - uc);
+	if (NULL == ucd->uc)
+	{
+		ucd->uc = uc;
+		ucd->length = s - uc;
+		ucd->uc_num = ct->num_uc++;
+		if (2 * ct->num_uc > ct->uc_size)
+		{
+			uc_table_grow(ct);
+			ucd = uc_lookup(ct->uc, ct->uc_size, uc, s - uc);
+		}
 	}
-#endif /* USE_SDBM */
+	desc->uc_num = ucd->uc_num;
 
-	c->lc_start = ('\0' == *s) ? 0 : s - c->string;
-	c->uc_length = s - c->string - c->uc_start;
-	c->hash = i;
-	return i;
+	desc->lc_letters = 0;
+	for (size_t i = 0; '\0' != s[i]; i++)
+	{
+		if (i == sizeof(lc_enc_t))
+		{
+			desc->lc_letters = LC_UNENCODED;
+			break;
+		}
+		if ('*' == s[i]) continue;
+		desc->lc_letters |= ((lc_enc_t) (unsigned char) s[i]) << (8 * i);
+	}
+}
+
+/**
+ * Return the descriptor of the connector name s, enumerating it if
+ * it is not already in the table. The descriptor stays valid until
+ * the table is deleted.
+ */
+const condesc_t * condesc_add(Connector_table *ct, const char *s)
+{
+	condesc_t **slot = condesc_lookup(ct->desc, ct->size, s);
+
+	if (NULL != *slot) return *slot;
+
+	condesc_t *desc = pool_alloc(ct->desc_pool);
+	*slot = desc;
+	desc->string = s;
+	condesc_encode(ct, desc);
+	desc->con_num = ct->num_con++;
+
+	if (2 * ct->num_con > ct->size) condesc_table_grow(ct);
+	return desc;
+}
+
+size_t connector_table_num_con(const Connector_table *ct)
+{
+	return ct->num_con;
+}
+
+size_t connector_table_num_uc(const Connector_table *ct)
+{
+	return ct->num_uc;
+}
+
+/**
+ * Put the descriptors of the table into the array desc, which should
+ * have connector_table_num_con() elements, indexed by their con_num.
+ */
+void connector_table_get_desc(const Connector_table *ct, const condesc_t **desc)
+{
+	for (size_t i = 0; i < ct->size; i++)
+	{
+		if (NULL == ct->desc[i]) continue;
+		desc[ct->desc[i]->con_num] = ct->desc[i];
+	}
+}
+
+/**
+ * Return the uc_num of the given upper-case part, or -1 if no
+ * connector name in the table has it.
+ */
+int connector_table_uc_num(const Connector_table *ct, const char *uc,
+                           size_t length)
+{
+	const uc_desc_t *ucd = uc_lookup(ct->uc, ct->uc_size, uc, length);
+
+	return (NULL == ucd->uc) ? -1 : ucd->uc_num;
+}
+
+/* ======================================================== */
+/* Batch connector matching */
+
+/**
+ * Batch version of lc_easy_match(): test the lower-case part of c
+ * against n lower-case parts given by their encodings lc[] and their
+ * lc_nonzero_mask() values mask[], and set match[i] to 1 if they match
+ * and to 0 otherwise. The upper-case parts are assumed to be the same.
+ *
+ * The entries of unencoded connectors (whose mask should be 0), and all
+ * of them if c is unencoded, are reported as matching; the caller then
+ * needs to check them with lc_easy_match().
+ *
+ * Two (SSE2) or four (AVX2) entries are tested at a time when the
+ * compiler targets these instruction sets.
+ */
+void lc_easy_match_batch(const lc_enc_t *lc, const lc_enc_t *mask, size_t n,
+                         const Connector *c, uint8_t *match)
+{
+	lc_enc_t cl = c->desc->lc_letters;
+	lc_enc_t cm = lc_nonzero_mask(cl);
+	size_t i = 0;
+
+	if (LC_UNENCODED == cl)
+	{
+		memset(match, 1, n);
+		return;
+	}
+
+#if defined(__AVX2__)
+	const __m256i vcl4 = _mm256_set1_epi64x((long long)cl);
+	const __m256i vcm4 = _mm256_set1_epi64x((long long)cm);
+	const __m256i zero4 = _mm256_setzero_si256();
+
+	for (; i + 4 <= n; i += 4)
+	{
+		__m256i x = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)&lc[i]), vcl4);
+		x = _mm256_and_si256(x, _mm256_loadu_si256((const __m256i *)&mask[i]));
+		x = _mm256_and_si256(x, vcm4);
+		int bits = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(x, zero4)));
+
+		match[i] = bits & 1;
+		match[i+1] = (bits >> 1) & 1;
+		match[i+2] = (bits >> 2) & 1;
+		match[i+3] = (bits >> 3) & 1;
+	}
+#endif /* __AVX2__ */
+
+#if defined(__SSE2__)
+	const __m128i vcl = _mm_set1_epi64x((long long)cl);
+	const __m128i vcm = _mm_set1_epi64x((long long)cm);
+	const __m128i zero = _mm_setzero_si128();
+
+	for (; i + 2 <= n; i += 2)
+	{
+		__m128i x = _mm_xor_si128(_mm_loadu_si128((const __m128i *)&lc[i]), vcl);
+		x = _mm_and_si128(x, _mm_loadu_si128((const __m128i *)&mask[i]));
+		x = _mm_and_si128(x, vcm);
+
+		/* SSE2 has no 64-bit compare: a 64-bit lane is zero iff both of
+		 * its 32-bit halves are. */
+		__m128i z = _mm_cmpeq_epi32(x, zero);
+		z = _mm_and_si128(z, _mm_shuffle_epi32(z, _MM_SHUFFLE(2, 3, 0, 1)));
+		int bits = _mm_movemask_pd(_mm_castsi128_pd(z));
+
+		match[i] = bits & 1;
+		match[i+1] = (bits >> 1) & 1;
+	}
+#endif /* __SSE2__ */
+
+	for (; i < n; i++)
+		match[i] = 0 == ((lc[i] ^ cl) & mask[i] & cm);
 }
 
 /* ========================= END OF FILE ============================== */
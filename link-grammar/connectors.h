@@ -16,6 +16,7 @@
 
 #include <ctype.h>   // for islower()
 #include <stdbool.h>
+#include <stddef.h>  // for size_t
 #include <stdint.h>  // for uint8_t
 
 #include "api-types.h"
@@ -27,12 +28,39 @@
  */
 #define MAX_SENTENCE 254        /* Maximum number of words in a sentence */
 
-/* On a 64-bit machine, this struct should be exactly 4*8=32 bytes long.
+/**
+ * The lower-case part of a connector name, one character per byte,
+ * starting at the least significant byte.  Wildcards ('*') and the
+ * missing characters of a short lower-case part are encoded as 0, so
+ * two lower-case parts match iff they are equal in all the bytes that
+ * are nonzero in both.  Lower-case parts that are too long to be
+ * encoded are marked by LC_UNENCODED, and are matched as strings.
+ */
+typedef uint64_t lc_enc_t;
+#define LC_UNENCODED ((lc_enc_t)-1)
+
+/**
+ * The dictionary-wide enumeration of a connector name (see
+ * condesc_add()).  The uc_num is a dense number of the upper-case
+ * part, so two connectors can match only if their uc_num is the same.
+ * The con_num is a dense number of the connector name.
+ */
+typedef struct
+{
+	const char *string;   /* The connector name w/o the direction mark */
+	lc_enc_t lc_letters;  /* The lower-case part */
+	int uc_num;           /* The upper-case part number */
+	unsigned int con_num; /* The connector name number */
+	char head_dependent;  /* The head-dependent indicator, or '\0' */
+} condesc_t;
+
+/* On a 64-bit machine, this struct should be exactly 2*8=16 bytes long.
  * Lets try to keep it that way.
+ * The connectors of a disjunct are kept in one array (left ones first),
+ * so they don't need a next pointer - see connector_next().
  */
 struct Connector_struct
 {
-	int16_t hash;
 	uint8_t length_limit;
 	             /* If this is a length limited connector, this
 	                gives the limit of the length of the link
@@ -45,47 +73,60 @@ struct Connector_struct
 	                this could ever connect to.  Computed by
 	                setup_connectors() */
 	bool multi;  /* TRUE if this is a multi-connector */
-	uint8_t lc_start;     /* lc start position (or 0) - for match speedup. */
-	uint8_t uc_length;    /* uc part length - for match speedup. */
-	uint8_t uc_start;     /* uc start position - for match speedup. */
-	Connector * next;
-	const char * string; /* The connector name w/o the direction mark, e.g. AB */
-
-	/* Hash table next pointer, used only during pruning. */
-	union
-	{
-		Connector * tableNext;
-		const gword_set *originating_gword;
-	};
+	bool last;   /* TRUE if this is the last (deepest) one in its list */
+	uint32_t gword_set_id;
+	             /* The set of the originating gwords, as an index
+	                into sent->gword_sets (set by
+	                gword_record_in_connector()). */
+	const condesc_t *desc; /* The connector name and its enumeration */
+};
+
+typedef struct conset_entry_s conset_entry;
+struct conset_entry_s
+{
+	conset_entry *next;
+	const char *string;
 };
 
 struct Connector_set_s
 {
-	Connector ** hash_table;
+	conset_entry ** hash_table;
 	unsigned int table_size;
 };
 
-static inline void connector_set_string(Connector *c, const char *s)
+static inline void connector_set_desc(Connector *c, const condesc_t *desc)
+{
+	c->desc = desc;
+}
+
+static inline const char * connector_get_string(const Connector *c)
 {
-	c->string = s;
-	c->hash = -1;
+	return c->desc->string;
 }
-static inline const char * connector_get_string(Connector *c)
+
+/**
+ * Return the next (deeper) connector in the list of c, or NULL if c is
+ * the last one.
+ */
+static inline Connector * connector_next(const Connector *c)
 {
-	return c->string;
+	return c->last ? NULL : (Connector *)(c + 1);
 }
 
 /* Connector utilities ... */
 Connector * connector_new(void);
-void free_connectors(Connector *);
 
 /* Length-limits for how far connectors can reach out. */
 #define UNLIMITED_LEN 255
 
 static inline Connector * init_connector(Connector *c)
 {
-	c->hash = -1;
 	c->length_limit = UNLIMITED_LEN;
+	c->nearest_word = 0;
+	c->multi = false;
+	c->last = true;
+	c->gword_set_id = 0;
+	c->desc = NULL;
 	return c;
 }
 
@@ -94,6 +135,15 @@ Connector_set * connector_set_create(Exp *e);
 void connector_set_delete(Connector_set * conset);
 bool match_in_connector_set(Connector_set*, Connector*);
 
+/* Connector enumeration ... */
+Connector_table * connector_table_new(void);
+void connector_table_delete(Connector_table *);
+const condesc_t * condesc_add(Connector_table *, const char *);
+size_t connector_table_num_con(const Connector_table *);
+size_t connector_table_num_uc(const Connector_table *);
+void connector_table_get_desc(const Connector_table *, const condesc_t **);
+int connector_table_uc_num(const Connector_table *, const char *, size_t);
+
 
 /**
  * Returns TRUE if s and t match according to the connector matching
@@ -142,6 +192,60 @@ static inline bool easy_match(const char * s, const char * t)
 }
 
 
+/**
+ * Return a mask that has all the bits set in the nonzero bytes of lc.
+ */
+static inline lc_enc_t lc_nonzero_mask(lc_enc_t lc)
+{
+	const lc_enc_t low7 = 0x7f7f7f7f7f7f7f7fULL;
+
+	lc_enc_t high = (((lc & low7) + low7) | lc) & ~low7;
+	return (high >> 7) * 0xff;
+}
+
+/**
+ * Like easy_match(), for the lower-case parts of two enumerated
+ * connector names. The upper-case parts are assumed to be the same.
+ */
+static inline bool lc_easy_match(const condesc_t *c1, const condesc_t *c2)
+{
+	lc_enc_t a = c1->lc_letters;
+	lc_enc_t b = c2->lc_letters;
+
+	if ((LC_UNENCODED == a) || (LC_UNENCODED == b))
+		return easy_match(c1->string, c2->string);
+
+	return 0 == ((a ^ b) & lc_nonzero_mask(a) & lc_nonzero_mask(b));
+}
+
+/**
+ * Like easy_match(), for the head-dependent indicators of two
+ * enumerated connector names.
+ */
+static inline bool hd_easy_match(const condesc_t *c1, const condesc_t *c2)
+{
+	return ('\0' == c1->head_dependent) ||
+	       (c1->head_dependent != c2->head_dependent);
+}
+
+/**
+ * Returns TRUE if the enumerated connector names a and b match
+ * according to the connector matching rules. The same as easy_match()
+ * on their strings, but without looking at the strings.
+ */
+static inline bool easy_match_desc(const condesc_t *a, const condesc_t *b)
+{
+	return (a->uc_num == b->uc_num) && hd_easy_match(a, b) && lc_easy_match(a, b);
+}
+
+static inline bool easy_match_connectors(const Connector *c1, const Connector *c2)
+{
+	return easy_match_desc(c1->desc, c2->desc);
+}
+
+void lc_easy_match_batch(const lc_enc_t *, const lc_enc_t *, size_t,
+                         const Connector *, uint8_t *);
+
 static inline int string_hash(const char *s)
 {
 	unsigned int i;
@@ -156,12 +260,13 @@ static inline int string_hash(const char *s)
 	return i;
 }
 
-int calculate_connector_hash(Connector *);
-
-static inline int connector_hash(Connector * c)
+/**
+ * The upper-case part number is a perfect hash of the upper-case part,
+ * and connectors can match only if it is the same.
+ */
+static inline int connector_hash(const Connector * c)
 {
-	if (-1 != c->hash) return c->hash;
-	return calculate_connector_hash(c);
+	return c->desc->uc_num;
 }
 
 /**
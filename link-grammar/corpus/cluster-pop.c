@@ -21,10 +21,11 @@
 #include "../read-dict.h"
 #include "../structures.h"
 
-static Disjunct * build_disjuncts_for_dict_node(Dict_node *dn)
+static Disjunct * build_disjuncts_for_dict_node(Dict_node *dn, Dictionary dict)
 {
    Disjunct *dj;
-   dj = build_disjuncts_for_exp(dn->exp, dn->string, MAX_CONNECTOR_COST);
+   dj = build_disjuncts_for_exp(NULL, dn->exp, dn->string, dict->contable,
+                                MAX_CONNECTOR_COST);
    /* print_disjunct_list(dj); */
    return dj;
 }
@@ -138,7 +139,7 @@ int main (int argc, char * argv[])
 			Dict_node *dn = dictionary_lookup_list(dict, cluword);
 			if (NULL == dn) continue;
 
-			Disjunct *dj = build_disjuncts_for_dict_node(dn);
+			Disjunct *dj = build_disjuncts_for_dict_node(dn, dict);
 			if (strcmp(dj->string, cluword))
 			{
 				if (strncmp(dj->string, cluword, strlen(cluword)))
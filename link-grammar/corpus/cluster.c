@@ -14,9 +14,13 @@
 #include <sqlite3.h>
 #include "cluster.h"
 
-#include "build-disjuncts.h"
+#include "api-structures.h"
+#include "dict-common/dict-common.h" // for Dictionary_s
+#include "dict-common/dict-structures.h"
+#include "dict-common/file-utils.h"
 #include "disjunct-utils.h"
-#include "structures.h"
+#include "prepare/build-disjuncts.h"
+#include "string-set.h"
 #include "utilities.h"
 
 struct cluster_s
@@ -147,7 +151,7 @@ void lg_cluster_delete(Cluster *c)
 
 /* ========================================================= */
 
-static Exp * make_exp(const char *djstr, double cost)
+static Exp * make_exp(const char *djstr, double cost, String_set *ss)
 {
 	char * tmp;
 	Exp *p1, *p2;
@@ -167,7 +171,9 @@ static Exp * make_exp(const char *djstr, double cost)
 		if ('@' == djstr[0]) { e->multi = 1; djstr++; }
 		len = strlen(djstr) - 1;
 		if (sp) len--;
-		e->u.string = strndup(djstr, len);
+		tmp = strndup(djstr, len);
+		e->u.string = string_set_add(tmp, ss);
+		free(tmp);
 		e->dir = djstr[len];
 		return e;
 	}
@@ -175,9 +181,9 @@ static Exp * make_exp(const char *djstr, double cost)
 	/* If there are multiple connectors, and them together */
 	len = sp - djstr;
 	tmp = strndup(djstr, len);
-	p1 = make_exp(tmp, 0.0);
+	p1 = make_exp(tmp, 0.0, ss);
 	free (tmp);
-	p2 = make_exp(sp+1, 0.0);
+	p2 = make_exp(sp+1, 0.0, ss);
 
 	l = (E_list *) malloc(sizeof(E_list));
 	l->next = lhead;
@@ -239,11 +245,12 @@ static void free_exp(Exp *e)
 		return;
 	}
 
-	free((char *) e->u.string);
+	/* The connector string belongs to the dictionary string set. */
 	free(e);
 }
 
-Disjunct * lg_cluster_get_disjuncts(Cluster *c, const char * wrd)
+Disjunct * lg_cluster_get_disjuncts(Cluster *c, const char * wrd,
+                                    Dictionary dict)
 {
 	Disjunct *djl = NULL;
 	int rc;
@@ -276,8 +283,9 @@ Disjunct * lg_cluster_get_disjuncts(Cluster *c, const char * wrd)
 		if (cost < 0.0) cost = 0.0;
 
 		/* Building expressions */
-		e = make_exp(djs, cost);
-		dj = build_disjuncts_for_exp(e, wrd, MAX_CONNECTOR_COST);
+		e = make_exp(djs, cost, dict->string_set);
+		dj = build_disjuncts_for_exp(NULL, e, wrd, dict->contable,
+		                             MAX_CONNECTOR_COST);
 		djl = catenate_disjuncts(dj, djl);
 		free_exp(e);
 	}
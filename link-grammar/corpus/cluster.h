@@ -22,13 +22,13 @@
 Cluster * lg_cluster_new(void);
 void lg_cluster_delete(Cluster *);
 
-Disjunct * lg_cluster_get_disjuncts(Cluster *, const char * wrd);
+Disjunct * lg_cluster_get_disjuncts(Cluster *, const char * wrd, Dictionary);
 
 #else /* USE_CORPUS */
 
 static inline Cluster * lg_cluster_new(void) { return NULL; }
 static inline void lg_cluster_delete(Cluster *c) {}
-static inline Disjunct * lg_cluster_get_disjuncts(Cluster *c, const char * wrd) { return NULL; }
+static inline Disjunct * lg_cluster_get_disjuncts(Cluster *c, const char * wrd, Dictionary dict) { return NULL; }
 
 #endif /* USE_CORPUS */
 
@@ -17,6 +17,8 @@
 #include "dict-common.h"
 #include "dict-defines.h"
 #include "file-utils.h"
+#include "parse/parse.h"
+#include "parse/prune.h"
 #include "post-process/pp_knowledge.h" // Needed only for pp_close !!??
 #include "regex-morph.h"
 #include "string-set.h"
@@ -320,6 +322,8 @@ void dictionary_delete(Dictionary dict)
 	}
 
 	connector_set_delete(dict->unlimited_connector_set);
+	connector_table_delete(dict->contable);
+	pp_prune_rules_delete(dict->pp_prune_rules);
 
 	if (dict->close) dict->close(dict);
 
@@ -331,6 +335,7 @@ void dictionary_delete(Dictionary dict)
 	free_dictionary(dict);
 	free(dict);
 	object_open(NULL, NULL, NULL); /* Free the directory path cache */
+	free_saved_parse_contexts();   /* Free the kept parse memory */
 }
 
 /* ======================================================================== */
@@ -22,6 +22,7 @@
 #include "dict-impl.h"
 #include "regex-morph.h"
 #include "dict-structures.h"
+#include "parse/prune.h"
 #include "string-set.h"
 #include "utilities.h"
 
@@ -352,6 +353,23 @@ void dictionary_setup_defines(Dictionary dict)
 		dict->unlimited_connector_set = connector_set_create(dict_node->exp);
 
 	dict->free_lookup(dict, dict_node);
+
+	/* Enumerate the connectors, so that the sentences don't have to. */
+	dict->contable = connector_table_new();
+	for (Exp *e = dict->exp_list.exp_list; e != NULL; e = e->next)
+	{
+		if (CONNECTOR_type == e->type)
+			condesc_add(dict->contable, e->u.string);
+	}
+	condesc_add(dict->contable,
+	            string_set_add(EMPTY_CONNECTOR, dict->string_set));
+
+	/* Compile the post-processing rules that are used for pruning. */
+	if (NULL != dict->base_knowledge)
+	{
+		dict->pp_prune_rules =
+			pp_prune_rules_new(dict->base_knowledge, dict->contable);
+	}
 }
 
 /* ======================================================================= */
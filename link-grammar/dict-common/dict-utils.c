@@ -211,8 +211,8 @@ bool word_has_connector(Dict_node * dn, const char * cs, char direction)
 	for (; d != NULL; d = d->next) {
 		if (direction == '+') c2 = d->right;
 		if (direction == '-') c2 = d->left;
-		for (; c2 != NULL; c2 = c2->next) {
-			if (easy_match(c2->string, cs)) {
+		for (; c2 != NULL; c2 = connector_next(c2)) {
+			if (easy_match(connector_get_string(c2), cs)) {
 				free_disjuncts(d0);
 				return true;
 			}
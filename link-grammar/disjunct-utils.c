@@ -20,6 +20,48 @@
 
 /* Disjunct utilities ... */
 
+static unsigned int connector_list_length(const Connector *c)
+{
+	unsigned int n = 0;
+	for (; c != NULL; c = connector_next(c)) n++;
+	return n;
+}
+
+/**
+ * Allocate the connectors of the disjunct d, nl left ones followed by
+ * nr right ones, in one array. The caller sets their fields, except
+ * for "last", which is set here.
+ */
+void disjunct_alloc_connectors(Disjunct *d, unsigned int nl, unsigned int nr)
+{
+	unsigned int n = nl + nr;
+	Connector *c = NULL;
+
+	if (0 < n)
+	{
+		c = (Connector *) xalloc(n * sizeof(Connector));
+		for (unsigned int i = 0; i < n; i++)
+		{
+			init_connector(&c[i]);
+			c[i].last = false;
+		}
+	}
+
+	if (0 < nl) c[nl-1].last = true;
+	if (0 < nr) c[n-1].last = true;
+	d->left = (0 < nl) ? c : NULL;
+	d->right = (0 < nr) ? c + nl : NULL;
+}
+
+static void free_disjunct_connectors(Disjunct *d)
+{
+	unsigned int n = connector_list_length(d->left) +
+	                 connector_list_length(d->right);
+
+	if (0 == n) return;
+	xfree((NULL != d->left) ? d->left : d->right, n * sizeof(Connector));
+}
+
 /**
  * free_disjuncts() -- free the list of disjuncts pointed to by c
  * (does not free any strings)
@@ -29,8 +71,7 @@ void free_disjuncts(Disjunct *c)
 	Disjunct *c1;
 	for (;c != NULL; c = c1) {
 		c1 = c->next;
-		free_connectors(c->left);
-		free_connectors(c->right);
+		free_disjunct_connectors(c);
 		xfree((char *)c, sizeof(Disjunct));
 	}
 }
@@ -82,11 +123,11 @@ static inline unsigned int old_hash_disjunct(disjunct_dup_table *dt, Disjunct *
 	Connector *e;
 	unsigned int i;
 	i = 0;
-	for (e = d->left ; e != NULL; e = e->next) {
-		i += string_hash(e->string);
+	for (e = d->left ; e != NULL; e = connector_next(e)) {
+		i += string_hash(connector_get_string(e));
 	}
-	for (e = d->right ; e != NULL; e = e->next) {
-		i += string_hash(e->string);
+	for (e = d->right ; e != NULL; e = connector_next(e)) {
+		i += string_hash(connector_get_string(e));
 	}
 	i += string_hash(d->word_string);
 	i += (i>>10);
@@ -100,7 +141,8 @@ static inline unsigned int old_hash_disjunct(disjunct_dup_table *dt, Disjunct *
  */
 static bool connectors_equal_prune(Connector *c1, Connector *c2)
 {
-	return string_set_cmp(c1->string, c2->string) && (c1->multi == c2->multi);
+	/* The same name has the same descriptor. */
+	return (c1->desc == c2->desc) && (c1->multi == c2->multi);
 }
 
 /** returns TRUE if the disjuncts are exactly the same */
@@ -112,8 +154,8 @@ static bool disjuncts_equal(Disjunct * d1, Disjunct * d2)
 	e2 = d2->left;
 	while ((e1 != NULL) && (e2 != NULL)) {
 		if (!connectors_equal_prune(e1, e2)) return false;
-		e1 = e1->next;
-		e2 = e2->next;
+		e1 = connector_next(e1);
+		e2 = connector_next(e2);
 	}
 	if ((e1 != NULL) || (e2 != NULL)) return false;
 
@@ -121,8 +163,8 @@ static bool disjuncts_equal(Disjunct * d1, Disjunct * d2)
 	e2 = d2->right;
 	while ((e1 != NULL) && (e2 != NULL)) {
 		if (!connectors_equal_prune(e1, e2)) return false;
-		e1 = e1->next;
-		e2 = e2->next;
+		e1 = connector_next(e1);
+		e2 = connector_next(e2);
 	}
 	if ((e1 != NULL) || (e2 != NULL)) return false;
 
@@ -133,30 +175,6 @@ static bool disjuncts_equal(Disjunct * d1, Disjunct * d2)
 	return (strcmp(d1->word_string, d2->word_string) == 0);
 }
 
-/**
- * Duplicate the given connector chain.
- * If the argument is NULL, return NULL.
- */
-static Connector *connectors_dup(Connector *origc)
-{
-	Connector head;
-	Connector *prevc = &head;
-	Connector *newc = &head;
-	Connector *t;
-
-	for (t = origc; t != NULL;  t = t->next)
-	{
-		newc = connector_new();
-		*newc = *t;
-
-		prevc->next = newc;
-		prevc = newc;
-	}
-	newc->next = NULL;
-
-	return head.next;
-}
-
 /**
  * Duplicate the given disjunct chain.
  * If the argument is NULL, return NULL.
@@ -173,8 +191,12 @@ Disjunct *disjuncts_dup(Disjunct *origd)
 		newd = (Disjunct *)xalloc(sizeof(Disjunct));
 		newd->word_string = t->word_string;
 		newd->cost = t->cost;
-		newd->left = connectors_dup(t->left);
-		newd->right = connectors_dup(t->right);
+
+		unsigned int nl = connector_list_length(t->left);
+		unsigned int nr = connector_list_length(t->right);
+		disjunct_alloc_connectors(newd, nl, nr);
+		if (0 < nl) memcpy(newd->left, t->left, nl * sizeof(Connector));
+		if (0 < nr) memcpy(newd->right, t->right, nr * sizeof(Connector));
 		newd->originating_gword = t->originating_gword;
 		prevd->next = newd;
 		prevd = newd;
@@ -349,15 +371,15 @@ Disjunct * eliminate_duplicate_disjuncts(Disjunct * d)
 static void prt_con(Connector *c, dyn_str * p, char dir)
 {
 	if (NULL == c) return;
-	prt_con (c->next, p, dir);
+	prt_con (connector_next(c), p, dir);
 
 	if (c->multi)
 	{
-		append_string(p, "@%s%c ", c->string, dir);
+		append_string(p, "@%s%c ", connector_get_string(c), dir);
 	}
 	else
 	{
-		append_string(p, "%s%c ", c->string, dir);
+		append_string(p, "%s%c ", connector_get_string(c), dir);
 	}
 }
 
@@ -378,26 +400,127 @@ char * print_one_disjunct(Disjunct *dj)
  */
 int left_connector_count(Disjunct * d)
 {
-	Connector *c;
 	int i=0;
 	for (;d!=NULL; d=d->next) {
-		for (c = d->left; c!=NULL; c = c->next) i++;
+		i += connector_list_length(d->left);
 	}
 	return i;
 }
 
 int right_connector_count(Disjunct * d)
 {
-	Connector *c;
 	int i=0;
 	for (;d!=NULL; d=d->next) {
-	  for (c = d->right; c!=NULL; c = c->next) i++;
+		i += connector_list_length(d->right);
 	}
 	return i;
 }
 
 /* ============================================================= */
 
+/**
+ * Move the disjuncts of the given num_words lists, along with their
+ * connectors, to a new disjunct store. The disjunct lists are freed,
+ * and dlist[w] is set to the list of the moved disjuncts of word w,
+ * which keeps their order.
+ */
+Disjunct_store * disjunct_store_new(Disjunct **dlist, size_t num_words)
+{
+	Disjunct_store *ds = xalloc(sizeof(Disjunct_store));
+	size_t dcnt = 0, ccnt = 0;
+
+	for (size_t w = 0; w < num_words; w++)
+	{
+		for (Disjunct *d = dlist[w]; d != NULL; d = d->next)
+		{
+			dcnt++;
+			ccnt += connector_list_length(d->left);
+			ccnt += connector_list_length(d->right);
+		}
+	}
+
+	ds->num_disjuncts = dcnt;
+	ds->num_connectors = ccnt;
+	ds->num_words = num_words;
+	ds->disjunct = xalloc(dcnt * sizeof(Disjunct));
+	ds->connector = xalloc(ccnt * sizeof(Connector));
+	ds->word_start = xalloc(2 * num_words * sizeof(size_t));
+	ds->word_count = ds->word_start + num_words;
+
+	dcnt = ccnt = 0;
+	for (size_t w = 0; w < num_words; w++)
+	{
+		ds->word_start[w] = dcnt;
+		for (Disjunct *d = dlist[w]; d != NULL; d = d->next)
+		{
+			Disjunct *nd = &ds->disjunct[dcnt++];
+			unsigned int nl = connector_list_length(d->left);
+			unsigned int nr = connector_list_length(d->right);
+
+			*nd = *d;
+			nd->left = (0 < nl) ? &ds->connector[ccnt] : NULL;
+			if (0 < nl) memcpy(nd->left, d->left, nl * sizeof(Connector));
+			ccnt += nl;
+			nd->right = (0 < nr) ? &ds->connector[ccnt] : NULL;
+			if (0 < nr) memcpy(nd->right, d->right, nr * sizeof(Connector));
+			ccnt += nr;
+		}
+		ds->word_count[w] = dcnt - ds->word_start[w];
+
+		free_disjuncts(dlist[w]);
+		dlist[w] = disjunct_store_relink(ds, w);
+	}
+
+	return ds;
+}
+
+void disjunct_store_delete(Disjunct_store *ds)
+{
+	if (NULL == ds) return;
+	xfree(ds->disjunct, ds->num_disjuncts * sizeof(Disjunct));
+	xfree(ds->connector, ds->num_connectors * sizeof(Connector));
+	xfree(ds->word_start, 2 * ds->num_words * sizeof(size_t));
+	xfree(ds, sizeof(Disjunct_store));
+}
+
+/**
+ * Link the disjuncts of word w in their store order.
+ * Return the head of the list (NULL if the word has no disjuncts).
+ */
+Disjunct * disjunct_store_relink(Disjunct_store *ds, size_t w)
+{
+	size_t n = ds->word_count[w];
+	Disjunct *d = &ds->disjunct[ds->word_start[w]];
+
+	if (0 == n) return NULL;
+	for (size_t i = 0; i < n-1; i++)
+		d[i].next = &d[i+1];
+	d[n-1].next = NULL;
+
+	return d;
+}
+
+/**
+ * Reverse the order of the disjuncts of word w in the store, and
+ * relink them. Return the head of the list.
+ */
+Disjunct * disjunct_store_reverse(Disjunct_store *ds, size_t w)
+{
+	Disjunct *d = &ds->disjunct[ds->word_start[w]];
+	size_t n = ds->word_count[w];
+
+	for (size_t i = 0; i < n/2; i++)
+	{
+		Disjunct t = d[i];
+		d[i] = d[n-1-i];
+		d[n-1-i] = t;
+	}
+
+	return disjunct_store_relink(ds, w);
+}
+
+/* ============================================================= */
+
 /**
  * Record the wordgraph word to which the X-node belongs, in each of its
  * disjuncts.
@@ -14,6 +14,7 @@
 #define _LINK_GRAMMAR_DISJUNCT_UTILS_H_
 
 #include <stdbool.h>
+#include <stddef.h>
 
 #include "api-types.h"
 
@@ -25,20 +26,35 @@ struct Disjunct_struct
 	Disjunct *next;
 	Connector *left, *right;
 	double cost;
-	bool marked;               /* unmarked disjuncts get deleted */
 
-	/* match_left, right used only during parsing, for the match list. */
-	bool match_left, match_right;
-
-#ifdef VERIFY_MATCH_LIST
-	int match_id;              /* verify the match list integrity */
-#endif
 	gword_set *originating_gword; /* Set of originating gwords */
 	const char * word_string;     /* subscripted dictionary word */
 };
 
+/**
+ * The disjuncts of a sentence, in one contiguous array, word by word.
+ * The disjuncts of word w are disjunct[word_start[w]] to
+ * disjunct[word_start[w] + word_count[w] - 1]. Pruning just moves the
+ * remaining disjuncts of each word to the start of its range, so the
+ * index of a disjunct in the array can be used for per-disjunct side
+ * arrays. The disjuncts of each word are also linked by their "next"
+ * field, for the code that handles them as lists (see
+ * disjunct_store_relink()). Their connectors are kept in one array too.
+ */
+struct Disjunct_store_s
+{
+	Disjunct *disjunct;
+	size_t num_disjuncts;
+	Connector *connector;
+	size_t num_connectors;
+	size_t *word_start;
+	size_t *word_count;
+	size_t num_words;
+};
+
 /* Disjunct utilities ... */
 void free_disjuncts(Disjunct *);
+void disjunct_alloc_connectors(Disjunct *, unsigned int, unsigned int);
 unsigned int count_disjuncts(Disjunct *);
 Disjunct * catenate_disjuncts(Disjunct *, Disjunct *);
 Disjunct * eliminate_duplicate_disjuncts(Disjunct * );
@@ -48,4 +64,9 @@ Disjunct * disjuncts_dup(Disjunct *origd);
 int left_connector_count(Disjunct *);
 int right_connector_count(Disjunct *);
 
+Disjunct_store * disjunct_store_new(Disjunct **, size_t);
+void disjunct_store_delete(Disjunct_store *);
+Disjunct * disjunct_store_relink(Disjunct_store *, size_t);
+Disjunct * disjunct_store_reverse(Disjunct_store *, size_t);
+
 #endif /* _LINK_GRAMMAR_DISJUNCT_UTILS_H_ */
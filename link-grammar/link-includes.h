@@ -211,6 +211,26 @@ link_public_api(void)
      parse_options_set_repeatable_rand(Parse_Options opts, bool val);
 link_public_api(bool)
      parse_options_get_repeatable_rand(Parse_Options opts);
+link_public_api(void)
+     parse_options_set_reuse_parse_memory(Parse_Options opts, bool val);
+link_public_api(bool)
+     parse_options_get_reuse_parse_memory(Parse_Options opts);
+link_public_api(void)
+     parse_options_set_threads(Parse_Options opts, int val);
+link_public_api(int)
+     parse_options_get_threads(Parse_Options opts);
+link_public_api(void)
+     parse_options_set_count_histograms(Parse_Options opts, bool val);
+link_public_api(bool)
+     parse_options_get_count_histograms(Parse_Options opts);
+link_public_api(void)
+     parse_options_set_best_linkage_only(Parse_Options opts, bool val);
+link_public_api(bool)
+     parse_options_get_best_linkage_only(Parse_Options opts);
+link_public_api(void)
+     parse_options_set_kbest_linkages(Parse_Options opts, bool val);
+link_public_api(bool)
+     parse_options_get_kbest_linkages(Parse_Options opts);
 link_public_api(void)
      parse_options_reset_resources(Parse_Options opts);
 
@@ -292,6 +312,18 @@ link_public_api(Linkage)
      linkage_create(LinkageIdx linkage_num, Sentence sent, Parse_Options opts);
 link_public_api(void)
      linkage_delete(Linkage linkage);
+
+/* Streaming access to the valid linkages of a sentence, which are
+ * extracted and post-processed one at a time, on demand. */
+typedef struct Linkage_iter_s * Linkage_iter;
+
+link_public_api(Linkage_iter)
+     sentence_linkage_iter_new(Sentence sent, Parse_Options opts);
+link_public_api(Linkage)
+     sentence_linkage_iter_next(Linkage_iter iter);
+link_public_api(void)
+     sentence_linkage_iter_free(Linkage_iter iter);
+
 link_public_api(size_t)
      linkage_get_num_words(const Linkage linkage);
 link_public_api(size_t)
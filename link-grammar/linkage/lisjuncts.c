@@ -39,14 +39,14 @@ static char * reversed_conlist_str(Connector* c, char dir, char* buf, size_t sz)
 	size_t len = 0;
 
 	if (NULL == c) return buf;
-	p = reversed_conlist_str(c->next, dir, buf, sz);
+	p = reversed_conlist_str(connector_next(c), dir, buf, sz);
 
 	sz -= (p-buf);
 
 	if (c->multi)
 		p[len++] = '@';
 
-	len += lg_strlcpy(p+len, c->string, sz-len);
+	len += lg_strlcpy(p+len, connector_get_string(c), sz-len);
 	if (3 < sz-len)
 	{
 		p[len++] = dir;
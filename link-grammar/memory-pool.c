@@ -0,0 +1,195 @@
+/*************************************************************************/
+/* Copyright (c) 2018                                                    */
+/* All rights reserved                                                   */
+/*                                                                       */
+/* Use of the link grammar parsing system is subject to the terms of the */
+/* license set forth in the LICENSE file included with this software.    */
+/* This license allows free redistribution and use in source and binary  */
+/* forms, with or without modification, subject to certain conditions.   */
+/*                                                                       */
+/*************************************************************************/
+
+#include <string.h>
+
+#include "error.h"
+#include "memory-pool.h"
+#include "utilities.h"
+
+/**
+ * A simple memory pool (a.k.a. "slab" or "bump" allocator) for
+ * fixed-size elements.
+ *
+ * The intended usage is for data structures that are built element
+ * by element during a parse, and are then thrown away all at once,
+ * e.g. the entries of the do_count() memoization table.  Elements
+ * cannot be freed individually. Instead, the whole pool is either
+ * deleted (pool_delete()) or recycled (pool_reuse()), both in time
+ * proportional to the number of blocks, not the number of elements.
+ *
+ * Elements are issued sequentially from blocks of num_elements
+ * elements each, so elements that are allocated close in time are
+ * also close in memory.  For a depth-first search, such as do_count(),
+ * this means that the table entries of neighboring sub-problems tend
+ * to share cache lines and pages.
+ */
+
+typedef struct Pool_block_s Pool_block;
+struct Pool_block_s
+{
+	Pool_block *next;
+	/* The elements follow here. The union ensures their alignment. */
+	union { double d; void *p; long long ll; } data[];
+};
+
+struct Pool_desc_s
+{
+	const char *name;          /* For debug/stats messages */
+	size_t element_size;       /* Aligned element size */
+	size_t num_elements;       /* Elements per block */
+	size_t block_size;         /* Data size of each block, in bytes */
+	bool zero_out;             /* Zero-out elements on allocation */
+
+	Pool_block *chain;         /* The first block */
+	Pool_block *current;       /* The block elements are issued from */
+	char *alloc_next;          /* Next element to issue */
+	char *alloc_end;           /* End of the current block */
+
+	/* Statistics. */
+	size_t num_blocks;         /* Number of allocated blocks */
+	size_t curr_elements;      /* Elements issued since the last reuse */
+	size_t max_elements;       /* Max. elements issued between reuses */
+};
+
+#define ALIGN(size, alignment) (((size)+(alignment-1))&~(alignment-1))
+
+/**
+ * Create a new memory pool.
+ * @param name Used in debug and statistics messages only.
+ * @param num_elements Number of elements in each allocation block.
+ * @param element_size Element size in bytes.
+ * @param zero_out Zero-out each element when it is issued.
+ */
+Pool_desc *pool_new(const char *name, size_t num_elements,
+                    size_t element_size, bool zero_out)
+{
+	Pool_desc *mp = xalloc(sizeof(Pool_desc));
+	memset(mp, 0, sizeof(Pool_desc));
+
+	assert(0 < num_elements, "pool_new(%s): No elements", name);
+
+	mp->name = name;
+	mp->element_size = ALIGN(element_size, MIN_ALIGNMENT);
+	mp->num_elements = num_elements;
+	mp->block_size = mp->element_size * num_elements;
+	mp->zero_out = zero_out;
+
+	return mp;
+}
+
+static void pool_new_block(Pool_desc *mp)
+{
+	Pool_block *blk = xalloc(sizeof(Pool_block) + mp->block_size);
+
+	blk->next = NULL;
+	if (NULL == mp->chain)
+		mp->chain = blk;
+	else
+		mp->current->next = blk;
+
+	mp->num_blocks++;
+	mp->current = blk;
+}
+
+/**
+ * Issue a new element. Its content is undefined unless the pool
+ * was created with zero_out.
+ */
+void *pool_alloc(Pool_desc *mp)
+{
+	if (mp->alloc_next == mp->alloc_end)
+	{
+		/* The current block is exhausted (or there is no block yet).
+		 * Use the next block, if there is one from before pool_reuse(),
+		 * else allocate a new one. */
+		if ((NULL != mp->current) && (NULL != mp->current->next))
+			mp->current = mp->current->next;
+		else if ((NULL == mp->current) && (NULL != mp->chain))
+			mp->current = mp->chain;
+		else
+			pool_new_block(mp);
+
+		mp->alloc_next = (char *)mp->current->data;
+		mp->alloc_end = mp->alloc_next + mp->block_size;
+	}
+
+	void *e = mp->alloc_next;
+	mp->alloc_next += mp->element_size;
+	mp->curr_elements++;
+
+	if (mp->zero_out) memset(e, 0, mp->element_size);
+	return e;
+}
+
+/**
+ * Reclaim all the elements at once, keeping the allocated blocks for
+ * further allocations. All the previously issued elements become
+ * invalid.
+ */
+void pool_reuse(Pool_desc *mp)
+{
+	if (mp->max_elements < mp->curr_elements)
+		mp->max_elements = mp->curr_elements;
+	mp->curr_elements = 0;
+
+	mp->current = NULL;
+	mp->alloc_next = mp->alloc_end = NULL;
+}
+
+/**
+ * Free the pool, including all the elements issued from it.
+ */
+void pool_delete(Pool_desc *mp)
+{
+	if (NULL == mp) return;
+
+	Pool_block *next;
+	for (Pool_block *blk = mp->chain; NULL != blk; blk = next)
+	{
+		next = blk->next;
+		xfree(blk, sizeof(Pool_block) + mp->block_size);
+	}
+
+	xfree(mp, sizeof(Pool_desc));
+}
+
+/* ============================================================= */
+/* Statistics */
+
+size_t pool_num_elements_issued(const Pool_desc *mp)
+{
+	return mp->curr_elements;
+}
+
+size_t pool_num_blocks(const Pool_desc *mp)
+{
+	return mp->num_blocks;
+}
+
+size_t pool_bytes_allocated(const Pool_desc *mp)
+{
+	return mp->num_blocks * (sizeof(Pool_block) + mp->block_size);
+}
+
+/**
+ * Print the pool statistics. The caller is responsible for checking
+ * the verbosity level.
+ */
+void pool_print_stats(const Pool_desc *mp, const char *caller)
+{
+	size_t max_elements = MAX(mp->max_elements, mp->curr_elements);
+
+	err_msg(lg_Debug, "%s: Pool %s: %zu elements (max %zu) of %zu bytes, "
+	        "%zu blocks, %zu bytes\n", caller, mp->name, mp->curr_elements,
+	        max_elements, mp->element_size, mp->num_blocks,
+	        pool_bytes_allocated(mp));
+}
@@ -0,0 +1,34 @@
+/*************************************************************************/
+/* Copyright (c) 2018                                                    */
+/* All rights reserved                                                   */
+/*                                                                       */
+/* Use of the link grammar parsing system is subject to the terms of the */
+/* license set forth in the LICENSE file included with this software.    */
+/* This license allows free redistribution and use in source and binary  */
+/* forms, with or without modification, subject to certain conditions.   */
+/*                                                                       */
+/*************************************************************************/
+
+#ifndef _MEMORY_POOL_H
+#define _MEMORY_POOL_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#define MIN_ALIGNMENT sizeof(void *)  /* Minimum element alignment */
+
+typedef struct Pool_desc_s Pool_desc;
+
+/* See the source file for documentation. */
+Pool_desc *pool_new(const char *name, size_t num_elements,
+                    size_t element_size, bool zero_out);
+void *pool_alloc(Pool_desc *);
+void pool_reuse(Pool_desc *);
+void pool_delete(Pool_desc *);
+
+size_t pool_num_elements_issued(const Pool_desc *);
+size_t pool_num_blocks(const Pool_desc *);
+size_t pool_bytes_allocated(const Pool_desc *);
+void pool_print_stats(const Pool_desc *, const char *caller);
+
+#endif /* _MEMORY_POOL_H */
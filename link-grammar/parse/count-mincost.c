@@ -0,0 +1,18 @@
+/*************************************************************************/
+/* Copyright (c) 2018                                                    */
+/* All rights reserved                                                   */
+/*                                                                       */
+/* Use of the link grammar parsing system is subject to the terms of the */
+/* license set forth in the LICENSE file included with this software.    */
+/* This license allows free redistribution and use in source and binary  */
+/* forms, with or without modification, subject to certain conditions.   */
+/*                                                                       */
+/*************************************************************************/
+
+/* The instance of the parse counting code that also finds the cost of
+ * the best parse of each subproblem, so that the best linkage can be
+ * extracted directly. See the comments at the start of count.c and at
+ * do_parse_best(). */
+
+#define PERFORM_MIN_COST 1
+#include "count.c"
@@ -0,0 +1,17 @@
+/*************************************************************************/
+/* Copyright (c) 2018                                                    */
+/* All rights reserved                                                   */
+/*                                                                       */
+/* Use of the link grammar parsing system is subject to the terms of the */
+/* license set forth in the LICENSE file included with this software.    */
+/* This license allows free redistribution and use in source and binary  */
+/* forms, with or without modification, subject to certain conditions.   */
+/*                                                                       */
+/*************************************************************************/
+
+/* The instance of the parse counting code that counts the parses with
+ * all the null counts at once. See the comments at the start of count.c
+ * and at do_parse(). */
+
+#define PERFORM_NULL_COUNT_VECTORS 1
+#include "count.c"
@@ -12,6 +12,7 @@
 /*************************************************************************/
 
 #include <limits.h>
+#include <math.h>
 
 #include "link-includes.h"
 #include "api-structures.h"
@@ -19,12 +20,87 @@
 #include "count.h"
 #include "disjunct-utils.h"
 #include "fast-match.h"
+#include "memory-pool.h"
 #include "resources.h"
 #include "tokenize/word-structures.h" // for Word_struct
 
-/* This file contains the exhaustive search algorithm. */
+/* This file contains the exhaustive search algorithm.
+ *
+ * It is compiled four times, with a different Count_bin type (see
+ * histogram.h) each time:
+ * - By itself, for plain parse counts.
+ * - By count-hist.c, with PERFORM_COUNT_HISTOGRAMMING defined, for
+ *   parse counts with cost histograms. Maintaining the histograms makes
+ *   the counting considerably slower, and nothing but debug output uses
+ *   them yet, so this instance is used only if requested by
+ *   parse_options_set_count_histograms().
+ * - By count-nulls.c, with PERFORM_NULL_COUNT_VECTORS defined, for
+ *   counting the parses with all the null counts at once.
+ * - By count-mincost.c, with PERFORM_MIN_COST defined, for finding the
+ *   cost of the best parse of each subproblem, along with the count.
+ * The functions of the instances get distinct names with COUNT_FN(),
+ * and the functions at the end of this file, which are compiled only
+ * once, dispatch to the instance with which the count context has been
+ * set up.
+ */
+
+#if defined PERFORM_COUNT_HISTOGRAMMING
+#define COUNT_FN(f) f##_hist
+#elif defined PERFORM_NULL_COUNT_VECTORS
+#define COUNT_FN(f) f##_nulls
+#elif defined PERFORM_MIN_COST
+#define COUNT_FN(f) f##_mincost
+#else
+#define COUNT_FN(f) f##_s64
+#define COUNT_DISPATCH /* Compile the dispatch functions */
+#endif
+
+#define COUNT_INSTANCE_PROTOTYPES(INSTANCE) \
+	s64 table_lookup_##INSTANCE(count_context_t *, int, int, \
+	                            Connector *, Connector *, unsigned int); \
+	s64 do_parse_##INSTANCE(Sentence, fast_matcher_t *, count_context_t *, \
+	                        int, Parse_Options); \
+	void free_count_memory_##INSTANCE(count_context_t *);
+COUNT_INSTANCE_PROTOTYPES(s64)
+COUNT_INSTANCE_PROTOTYPES(hist)
+COUNT_INSTANCE_PROTOTYPES(nulls)
+COUNT_INSTANCE_PROTOTYPES(mincost)
+
+/* The instance that the memory of a count context is of. */
+typedef enum
+{
+	COUNT_PLAIN,
+	COUNT_HIST,
+	COUNT_NULLS,
+	COUNT_MIN_COST,
+} Count_mode;
+
+#define D_COUNT 6 /* Debug level for this file. */
+
+/* The memoization table of do_count().
+ *
+ * By default, an open-addressing hash table is used: the key is packed
+ * into a compact fixed-width record, the records are stored in one
+ * contiguous array, and a parallel array of 16-bit control words
+ * holds a generation stamp and a 7-bit hash tag per slot.  A lookup
+ * thus scans a few consecutive control words and then compares the key
+ * of (usually) a single record, i.e. it touches one or two cache lines.
+ *
+ * The original chained hash table can be selected by compiling with
+ * -DCOUNT_TABLE_CHAINED, e.g. for A/B benchmarking with the
+ * data/en/corpus-*.batch files.
+ */
+//#define COUNT_TABLE_CHAINED
+
+/* Parallel counting (see parallel_count()) needs POSIX threads, GCC-style
+ * atomic builtins, and the open-addressing table. */
+#if defined HAVE_PTHREAD && defined __GNUC__ && !defined COUNT_TABLE_CHAINED
+#define USE_PARALLEL_COUNT
+#include <pthread.h>
+#endif
 
 typedef struct Table_connector_s Table_connector;
+#ifdef COUNT_TABLE_CHAINED
 struct Table_connector_s
 {
 	Table_connector  *next;
@@ -33,6 +109,17 @@ struct Table_connector_s
 	short            lw, rw;
 	unsigned short   null_count;
 };
+#else
+struct Table_connector_s
+{
+	Connector        *le, *re;
+	uint32_t         key;       /* lw, rw and null_count, see table_key() */
+	Count_bin        count;
+};
+#endif /* COUNT_TABLE_CHAINED */
+
+typedef struct Parallel_count_s Parallel_count;
+typedef struct Count_frame_s Count_frame;
 
 struct count_context_s
 {
@@ -42,51 +129,68 @@ struct count_context_s
 	bool    islands_ok;
 	bool    null_links;
 	bool    exhausted;
+	bool    table_sized;      /* init_table() was done for this sentence */
+	Count_mode mode;          /* The instance that the memory is of */
+	bool    null_counts_done; /* null_counts[] is valid for this sentence */
+	bool    null_counts_failed; /* Count overflow with COUNT_NULLS */
+	s64     null_counts[NULL_COUNT_VECTOR_SIZE-1]; /* By sentence null count */
 	unsigned int checktimer;  /* Avoid excess system calls */
-	int     table_size;
+	unsigned int table_size;
 	int     log2_table_size;
+#ifdef COUNT_TABLE_CHAINED
 	Table_connector ** table;
+	Pool_desc * tc_pool;      /* The table entries are allocated from here */
+#else
+	Table_connector * table;  /* The table entries */
+	uint16_t * table_ctrl;    /* Slot control words: generation, hash tag */
+	uint16_t table_gen;       /* Slots of other generations are empty */
+	unsigned int table_count; /* Number of slots in use */
+	unsigned int table_grow_count;
+	/* While growing: The previous table, migrated incrementally. */
+	Table_connector * old_table;
+	uint16_t * old_table_ctrl;
+	unsigned int old_table_size;
+	unsigned int old_table_pos; /* Next slot to migrate */
+#endif /* COUNT_TABLE_CHAINED */
+	Count_frame * stack;      /* The do_count() stack, see count_run() */
+	size_t stack_size;
+	size_t stack_depth;
+#ifdef USE_PARALLEL_COUNT
+	Parallel_count *par;      /* Set only in parallel counting workers */
+	Table_connector *dummy;   /* Returned by a worker after an abort */
+#endif /* USE_PARALLEL_COUNT */
 	Resources current_resources;
 };
 
+#ifdef COUNT_TABLE_CHAINED
+/* The number of table entries in each memory pool block. */
+#define TC_POOL_BLOCK_ELEMENTS 8192
+
+/**
+ * Free the hash table. The entries themselves are allocated from
+ * ctxt->tc_pool, and are reclaimed all at once by the caller, so
+ * there is no need to walk the bucket chains.
+ */
 static void free_table(count_context_t *ctxt)
 {
-	int i;
-	Table_connector *t, *x;
-
-	for (i=0; i<ctxt->table_size; i++)
-	{
-		for(t = ctxt->table[i]; t!= NULL; t=x)
-		{
-			x = t->next;
-			xfree((void *) t, sizeof(Table_connector));
-		}
-	}
 	xfree(ctxt->table, ctxt->table_size * sizeof(Table_connector*));
 	ctxt->table = NULL;
 	ctxt->table_size = 0;
 }
 
-static void init_table(count_context_t *ctxt, size_t sent_len)
+static void alloc_table(count_context_t *ctxt, unsigned int shift)
 {
-	unsigned int shift;
-	/* A piecewise exponential function determines the size of the
-	 * hash table. Probably should make use of the actual number of
-	 * disjuncts, rather than just the number of words.
-	 */
-	if (ctxt->table) free_table(ctxt);
-
-	if (sent_len >= 10)
+	if (ctxt->table)
 	{
-		shift = 12 + (sent_len) / 4 ;
+		free_table(ctxt);
+		pool_reuse(ctxt->tc_pool);
 	}
-	else
+	else if (NULL == ctxt->tc_pool)
 	{
-		shift = 12;
+		ctxt->tc_pool = pool_new("Table_connector", TC_POOL_BLOCK_ELEMENTS,
+		                         sizeof(Table_connector), /*zero_out*/false);
 	}
 
-	/* Clamp at max 4*(1<<24) == 64 MBytes */
-	if (24 < shift) shift = 24;
 	ctxt->table_size = (1U << shift);
 	ctxt->log2_table_size = shift;
 	ctxt->table = (Table_connector**)
@@ -94,19 +198,34 @@ static void init_table(count_context_t *ctxt, size_t sent_len)
 	memset(ctxt->table, 0, ctxt->table_size*sizeof(Table_connector*));
 }
 
+static void clear_table(count_context_t *ctxt)
+{
+	memset(ctxt->table, 0, ctxt->table_size*sizeof(Table_connector*));
+	pool_reuse(ctxt->tc_pool);
+}
+
+static void delete_table(count_context_t *ctxt)
+{
+	if (verbosity_level(D_COUNT)) pool_print_stats(ctxt->tc_pool, __func__);
+	free_table(ctxt);
+	pool_delete(ctxt->tc_pool);
+}
+
 /**
  * Stores the value in the table.  Assumes it's not already there.
  */
 static Table_connector * table_store(count_context_t *ctxt,
                                      int lw, int rw,
                                      Connector *le, Connector *re,
-                                     unsigned int null_count)
+                                     unsigned int null_count,
+                                     Count_bin count)
 {
 	Table_connector *t, *n;
 	unsigned int h;
 
-	n = (Table_connector *) xalloc(sizeof(Table_connector));
+	n = pool_alloc(ctxt->tc_pool);
 	n->lw = lw; n->rw = rw; n->le = le; n->re = re; n->null_count = null_count;
+	n->count = count;
 	h = pair_hash(ctxt->table_size, lw, rw, le, re, null_count);
 	t = ctxt->table[h];
 	n->next = t;
@@ -115,12 +234,11 @@ static Table_connector * table_store(count_context_t *ctxt,
 	return n;
 }
 
-/** returns the pointer to this info, NULL if not there */
 static Table_connector *
-find_table_pointer(count_context_t *ctxt,
-                   int lw, int rw,
-                   Connector *le, Connector *re,
-                   unsigned int null_count)
+table_find(count_context_t *ctxt,
+           int lw, int rw,
+           Connector *le, Connector *re,
+           unsigned int null_count)
 {
 	Table_connector *t;
 	unsigned int h = pair_hash(ctxt->table_size,lw, rw, le, re, null_count);
@@ -130,6 +248,338 @@ find_table_pointer(count_context_t *ctxt,
 		    && (t->le == le) && (t->re == re)
 		    && (t->null_count == null_count))  return t;
 	}
+	return NULL;
+}
+
+#else /* !COUNT_TABLE_CHAINED */
+
+/* Grow the table when it gets more than 3/4 full. */
+#define TABLE_MAX_LOAD(size) ((size) - (size)/4)
+
+/* The number of old-table slots that are migrated to the new table on
+ * each store while the table is being resized. It must be more than 2,
+ * so the migration always completes before the new table is itself
+ * 3/4 full (see table_grow()). */
+#define TABLE_MIGRATE_SLOTS 8
+
+/**
+ * Pack lw, rw and null_count into 32 bits.  The word numbers fit into
+ * 8 bits each (lw may be -1, and MAX_SENTENCE is 254).
+ */
+static inline uint32_t table_key(int lw, int rw, unsigned int null_count)
+{
+	return ((uint32_t)(uint8_t)(lw + 1)) | (((uint32_t)rw) << 8) |
+	       (((uint32_t)null_count) << 16);
+}
+
+/**
+ * Hash the full key. Unlike pair_hash(), the connector addresses are
+ * mixed with a multiplicative hash, so their (always zero) low bits
+ * and their common high bits do not degrade the distribution.
+ */
+static inline uint64_t table_hash(uint32_t key,
+                                  const Connector *le, const Connector *re)
+{
+	uint64_t h = key;
+	h = (h ^ (uint64_t)(uintptr_t)le) * 0x9E3779B97F4A7C15ULL;
+	h = (h ^ (uint64_t)(uintptr_t)re) * 0xC2B2AE3D27D4EB4FULL;
+	return h ^ (h >> 32);
+}
+
+/* The control word of a used slot holds the table generation in its
+ * high byte and a 7-bit hash tag in its low byte. A slot whose
+ * generation is not the current one is empty, so the table can be
+ * cleared in O(1) by advancing the generation (see clear_table()). */
+#define TABLE_MAX_GEN 0xff
+#define TABLE_CTRL(gen, h) ((uint16_t)(((gen) << 8) | 0x80 | ((h) & 0x7f)))
+#define TABLE_SLOT_USED(gen, c) (((c) >> 8) == (gen))
+
+#ifdef USE_PARALLEL_COUNT
+/* A slot that is being written by a parallel counting worker. As it
+ * doesn't have a tag bit, it doesn't match any lookup. */
+#define TABLE_CTRL_BUSY(gen) ((uint16_t)(((gen) << 8) | 0x01))
+#define TABLE_CTRL_LOAD(p) __atomic_load_n(p, __ATOMIC_ACQUIRE)
+#else
+#define TABLE_CTRL_LOAD(p) (*(p))
+#endif /* USE_PARALLEL_COUNT */
+#define TABLE_SLOT(size, h) ((unsigned int)((h) >> 7) & ((size)-1))
+
+static void free_old_table(count_context_t *ctxt)
+{
+	xfree(ctxt->old_table, ctxt->old_table_size * sizeof(Table_connector));
+	xfree(ctxt->old_table_ctrl, ctxt->old_table_size * sizeof(uint16_t));
+	ctxt->old_table = NULL;
+	ctxt->old_table_ctrl = NULL;
+	ctxt->old_table_size = 0;
+	ctxt->old_table_pos = 0;
+}
+
+static void free_table(count_context_t *ctxt)
+{
+	if (NULL != ctxt->old_table) free_old_table(ctxt);
+	xfree(ctxt->table, ctxt->table_size * sizeof(Table_connector));
+	xfree(ctxt->table_ctrl, ctxt->table_size * sizeof(uint16_t));
+	ctxt->table = NULL;
+	ctxt->table_ctrl = NULL;
+	ctxt->table_size = 0;
+	ctxt->table_count = 0;
+}
+
+static void alloc_table(count_context_t *ctxt, unsigned int shift)
+{
+	if (ctxt->table) free_table(ctxt);
+
+	ctxt->table_size = (1U << shift);
+	ctxt->log2_table_size = shift;
+	ctxt->table_count = 0;
+	ctxt->table = xalloc(ctxt->table_size * sizeof(Table_connector));
+	ctxt->table_ctrl = xalloc(ctxt->table_size * sizeof(uint16_t));
+	memset(ctxt->table_ctrl, 0, ctxt->table_size * sizeof(uint16_t));
+	ctxt->table_gen = 1;
+}
+
+/**
+ * Remove all the entries. Instead of zeroing the control words, just
+ * advance the generation, unless it wraps around.
+ */
+static void clear_table(count_context_t *ctxt)
+{
+	if (NULL != ctxt->old_table) free_old_table(ctxt);
+
+	ctxt->table_count = 0;
+	if (TABLE_MAX_GEN == ctxt->table_gen)
+	{
+		memset(ctxt->table_ctrl, 0, ctxt->table_size * sizeof(uint16_t));
+		ctxt->table_gen = 1;
+	}
+	else
+	{
+		ctxt->table_gen++;
+	}
+}
+
+static void delete_table(count_context_t *ctxt)
+{
+	lgdebug(+D_COUNT, "%u entries (%.1f%% full), grown %u times\n",
+	        ctxt->table_count, 100.0 * ctxt->table_count / ctxt->table_size,
+	        ctxt->table_grow_count);
+	free_table(ctxt);
+}
+
+/**
+ * Return the slot at which the given key is to be inserted.
+ * Assumes it's not already there.
+ */
+static inline unsigned int table_free_slot(count_context_t *ctxt, uint64_t h)
+{
+	unsigned int mask = ctxt->table_size - 1;
+	unsigned int i = TABLE_SLOT(ctxt->table_size, h);
+
+	while (TABLE_SLOT_USED(ctxt->table_gen, ctxt->table_ctrl[i]))
+		i = (i + 1) & mask;
+	return i;
+}
+
+/**
+ * Move up to num_slots slots of the old table (the one before the
+ * last table_grow()) to the current table. Free the old table when
+ * all of its slots have been moved.
+ */
+static void table_migrate(count_context_t *ctxt, unsigned int num_slots)
+{
+	unsigned int end = ctxt->old_table_pos + num_slots;
+	if (end > ctxt->old_table_size) end = ctxt->old_table_size;
+
+	for (unsigned int o = ctxt->old_table_pos; o < end; o++)
+	{
+		if (!TABLE_SLOT_USED(ctxt->table_gen, ctxt->old_table_ctrl[o])) continue;
+		Table_connector *ot = &ctxt->old_table[o];
+		uint64_t h = table_hash(ot->key, ot->le, ot->re);
+		unsigned int i = table_free_slot(ctxt, h);
+
+		ctxt->table_ctrl[i] = TABLE_CTRL(ctxt->table_gen, h);
+		ctxt->table[i] = *ot;
+		ctxt->table_count++;
+	}
+	ctxt->old_table_pos = end;
+
+	if (end == ctxt->old_table_size) free_old_table(ctxt);
+}
+
+/**
+ * Double the table size.
+ *
+ * Rehashing all the entries at once would stall do_count() for a time
+ * proportional to the table size, and would also need the old and new
+ * tables to be walked together in a cache-unfriendly way.  Instead,
+ * the full table is kept as a read-only "old table", and its entries
+ * are moved to the new table a few slots at a time by the following
+ * table_store() calls (incremental rehashing).  table_find() looks in
+ * both tables until the old one is freed.
+ *
+ * The new table starts with at most 3/4 of its half filled, i.e. 3/8
+ * full. The old table is fully migrated after old_size/TABLE_MIGRATE_SLOTS
+ * stores, so the new table cannot get 3/4 full before that.
+ */
+static void table_grow(count_context_t *ctxt)
+{
+	assert(NULL == ctxt->old_table, "Count table: Previous grow not done");
+
+	ctxt->old_table = ctxt->table;
+	ctxt->old_table_ctrl = ctxt->table_ctrl;
+	ctxt->old_table_size = ctxt->table_size;
+	ctxt->old_table_pos = 0;
+
+	uint16_t gen = ctxt->table_gen;
+	ctxt->table = NULL;
+	alloc_table(ctxt, ctxt->log2_table_size + 1);
+	ctxt->table_gen = gen;
+	ctxt->table_grow_count++;
+
+	lgdebug(+D_COUNT, "Growing to %u entries\n", ctxt->table_size);
+}
+
+#ifdef USE_PARALLEL_COUNT
+static Table_connector * table_store_concurrent(count_context_t *,
+                                                uint32_t, Connector *,
+                                                Connector *, Count_bin);
+#endif /* USE_PARALLEL_COUNT */
+
+/**
+ * Stores the value in the table.  Assumes it's not already there.
+ * The returned pointer is valid only until the next table_store().
+ */
+static Table_connector * table_store(count_context_t *ctxt,
+                                     int lw, int rw,
+                                     Connector *le, Connector *re,
+                                     unsigned int null_count,
+                                     Count_bin count)
+{
+#ifdef USE_PARALLEL_COUNT
+	if (NULL != ctxt->par)
+	{
+		return table_store_concurrent(ctxt, table_key(lw, rw, null_count),
+		                              le, re, count);
+	}
+#endif /* USE_PARALLEL_COUNT */
+
+	if (NULL != ctxt->old_table)
+		table_migrate(ctxt, TABLE_MIGRATE_SLOTS);
+	else if (ctxt->table_count >= TABLE_MAX_LOAD(ctxt->table_size))
+		table_grow(ctxt);
+
+	uint32_t key = table_key(lw, rw, null_count);
+	uint64_t h = table_hash(key, le, re);
+	unsigned int i = table_free_slot(ctxt, h);
+	Table_connector *n = &ctxt->table[i];
+
+	ctxt->table_ctrl[i] = TABLE_CTRL(ctxt->table_gen, h);
+	ctxt->table_count++;
+	n->le = le; n->re = re; n->key = key;
+	n->count = count;
+
+	return n;
+}
+
+static inline Table_connector *
+table_probe(Table_connector *table, const uint16_t *ctrl, unsigned int size,
+            uint16_t gen, uint32_t key, uint64_t h,
+            Connector *le, Connector *re)
+{
+	uint16_t tag = TABLE_CTRL(gen, h);
+	unsigned int mask = size - 1;
+	uint16_t c;
+
+	for (unsigned int i = TABLE_SLOT(size, h);
+	     TABLE_SLOT_USED(gen, c = TABLE_CTRL_LOAD(&ctrl[i]));
+	     i = (i + 1) & mask)
+	{
+		if (c != tag) continue;
+		Table_connector *t = &table[i];
+		if ((t->key == key) && (t->le == le) && (t->re == re)) return t;
+	}
+	return NULL;
+}
+
+static Table_connector *
+table_find(count_context_t *ctxt,
+           int lw, int rw,
+           Connector *le, Connector *re,
+           unsigned int null_count)
+{
+	uint32_t key = table_key(lw, rw, null_count);
+	uint64_t h = table_hash(key, le, re);
+
+	Table_connector *t = table_probe(ctxt->table, ctxt->table_ctrl,
+	                                 ctxt->table_size, ctxt->table_gen,
+	                                 key, h, le, re);
+	if ((NULL != t) || (NULL == ctxt->old_table)) return t;
+
+	/* Not migrated yet? */
+	return table_probe(ctxt->old_table, ctxt->old_table_ctrl,
+	                   ctxt->old_table_size, ctxt->table_gen, key, h, le, re);
+}
+#endif /* COUNT_TABLE_CHAINED */
+
+/**
+ * Estimate the number of table entries of the sentence.
+ *
+ * The number of do_count() calls that get memoized depends mostly on
+ * the number of connectors that remain after pruning, and much less on
+ * the sentence length. Empirically (data/en/corpus-*.batch), the number
+ * of table entries is roughly num_connectors * sqrt(sent->length) / 2,
+ * and less than that for 90% of the sentences. Sentences that have
+ * more entries make the open-addressing table grow.
+ */
+static size_t table_entries_estimate(Sentence sent)
+{
+	return (size_t)(0.5 * sent->num_connectors * sqrt((double)sent->length));
+}
+
+/**
+ * Size the table according to the expected number of entries.
+ */
+static void init_table(count_context_t *ctxt, Sentence sent)
+{
+	size_t est = table_entries_estimate(sent);
+	unsigned int shift;
+
+#ifdef COUNT_TABLE_CHAINED
+	/* Aim at a bucket per entry. */
+	size_t size = est;
+	const unsigned int max_shift = 24; /* 4*(1<<24) == 64 MBytes */
+#else
+	size_t size = est * 4 / 3 + 1; /* Max. 3/4 full */
+	/* The table grows as needed. Clamp its initial size at 2^22 entries
+	 * (128 MBytes on 64-bit machines). */
+	const unsigned int max_shift = 22;
+#endif /* COUNT_TABLE_CHAINED */
+
+	for (shift = 10; (shift < max_shift) && (((size_t)1 << shift) < size);
+	     shift++)
+		;
+
+	lgdebug(+D_COUNT, "%zu disjuncts, %zu connectors: Table size 2^%u\n",
+	        sent->num_disjuncts, sent->num_connectors, shift);
+
+	/* A table that is kept from a previous sentence is reused if it is
+	 * big enough. */
+	if ((NULL != ctxt->table) && ((unsigned int)ctxt->log2_table_size >= shift))
+		clear_table(ctxt);
+	else
+		alloc_table(ctxt, shift);
+	ctxt->table_sized = true;
+}
+
+/** returns the pointer to this info, NULL if not there */
+static Table_connector *
+find_table_pointer(count_context_t *ctxt,
+                   int lw, int rw,
+                   Connector *le, Connector *re,
+                   unsigned int null_count)
+{
+	Table_connector *t = table_find(ctxt, lw, rw, le, re, null_count);
+	if (NULL != t) return t;
 
 	/* Create a new connector only if resources are exhausted.
 	 * (???) Huh? I guess we're in panic parse mode in that case.
@@ -143,28 +593,57 @@ find_table_pointer(count_context_t *ctxt,
 	                       resources_exhausted(ctxt->current_resources)))
 	{
 		ctxt->exhausted = true;
-		t = table_store(ctxt, lw, rw, le, re, null_count);
-		t->count = hist_zero();
-		return t;
+		return table_store(ctxt, lw, rw, le, re, null_count, hist_zero());
 	}
 	else return NULL;
 }
 
-/** returns the count for this quintuple if there, -1 otherwise */
-Count_bin* table_lookup(count_context_t * ctxt,
+/**
+ * Returns the total count for this quintuple if there, 0 otherwise.
+ */
+s64 COUNT_FN(table_lookup)(count_context_t * ctxt,
+                           int lw, int rw, Connector *le, Connector *re,
+                           unsigned int null_count)
+{
+#ifdef PERFORM_NULL_COUNT_VECTORS
+	/* The counts of all the null counts are in the same entry. */
+	if (null_count >= NULL_COUNT_VECTOR_SIZE) return 0;
+	Table_connector *t = find_table_pointer(ctxt, lw, rw, le, re, 0);
+
+	if (t == NULL) return 0; else return t->count.c[null_count];
+#else
+	Table_connector *t = find_table_pointer(ctxt, lw, rw, le, re, null_count);
+
+	if (t == NULL) return 0; else return hist_total(&t->count);
+#endif /* PERFORM_NULL_COUNT_VECTORS */
+}
+
+#ifdef PERFORM_MIN_COST
+/**
+ * Get the cost of the best linkage of this quintuple.
+ * Return false if it has no linkages, or if it is not in the table.
+ */
+bool table_lookup_cost(count_context_t * ctxt,
                        int lw, int rw, Connector *le, Connector *re,
-                       unsigned int null_count)
+                       unsigned int null_count, Linkage_cost *cost)
 {
 	Table_connector *t = find_table_pointer(ctxt, lw, rw, le, re, null_count);
 
-	if (t == NULL) return NULL; else return &t->count;
+	if ((t == NULL) || (0 == t->count.total)) return false;
+	*cost = t->count.best;
+	return true;
 }
+#endif /* PERFORM_MIN_COST */
 
 #define NO_COUNT -1
-#ifdef PERFORM_COUNT_HISTOGRAMMING
-Count_bin count_unknown = {.total = NO_COUNT};
+#if defined PERFORM_COUNT_HISTOGRAMMING
+static Count_bin count_unknown = {.total = NO_COUNT};
+#elif defined PERFORM_NULL_COUNT_VECTORS
+static Count_bin count_unknown = {{NO_COUNT}};
+#elif defined PERFORM_MIN_COST
+static Count_bin count_unknown = {.total = NO_COUNT};
 #else
-Count_bin count_unknown = NO_COUNT;
+static Count_bin count_unknown = NO_COUNT;
 #endif
 
 /**
@@ -183,9 +662,9 @@ static Count_bin pseudocount(count_context_t * ctxt,
                        int lw, int rw, Connector *le, Connector *re,
                        unsigned int null_count)
 {
-	Count_bin * count = table_lookup(ctxt, lw, rw, le, re, null_count);
-	if (NULL == count) return count_unknown;
-	return *count;
+	Table_connector *t = find_table_pointer(ctxt, lw, rw, le, re, null_count);
+	if (NULL == t) return count_unknown;
+	return t->count;
 }
 
 /**
@@ -201,359 +680,910 @@ static int num_optional_words(count_context_t *ctxt, int w1, int w2)
 	return n;
 }
 
-#ifdef DEBUG
-#define DO_COUNT_TRACE
-#endif
+#ifdef PERFORM_NULL_COUNT_VECTORS
+/**
+ * Add to *total the terms of *sub shifted by one null word, and also
+ * unshifted if optional is true. The term of 0 null words is not
+ * changed.
+ */
+static void null_count_accum(Count_bin *total, const Count_bin *sub,
+                             bool optional)
+{
+	for (int n = 1; n < NULL_COUNT_VECTOR_SIZE; n++)
+	{
+		s64 c = total->c[n] + sub->c[n-1];
+		if (optional) c += sub->c[n];
+		total->c[n] = null_count_saturate(c);
+	}
+}
 
-#ifdef DO_COUNT_TRACE
-#define V(c) (!c?"(nil)":c->string)
-static Count_bin do_count1(int lineno, count_context_t *ctxt,
-                          int lw, int rw,
-                          Connector *le, Connector *re,
-                          int null_count);
+/**
+ * Return true if a term of *count is more than INT_MAX. The terms
+ * saturate (see hist_muladd()) instead of overflowing.
+ */
+static bool null_count_overflow(const Count_bin *count)
+{
+	for (int n = 0; n < NULL_COUNT_VECTOR_SIZE; n++)
+	{
+		if (INT_MAX < count->c[n]) return true;
+	}
+	return false;
+}
+#endif /* PERFORM_NULL_COUNT_VECTORS */
 
-static Count_bin do_count(int lineno, count_context_t *ctxt,
-                          int lw, int rw,
-                          Connector *le, Connector *re,
-                          int null_count)
+/* The counting engine.
+ *
+ * do_count() is a memoized recursion over the subproblems (lw, rw, le,
+ * re, null_count). Its recursion depth is proportional to the number
+ * of connectors that can get linked in a sentence, and each level has a
+ * large stack frame, so long sentences need a large thread stack. This
+ * matters mostly for the parallel counting threads, and for library
+ * users that parse in threads of their own.
+ *
+ * Hence the recursion is done here with an explicit stack of
+ * Count_frame elements, which grows on the heap as needed. Each frame
+ * holds the arguments and the local variables of one do_count()
+ * invocation, and the point at which to resume it when the subproblem
+ * it is waiting for has been counted. The code below is otherwise
+ * written like the recursive algorithm it implements: COUNT_CALL()
+ * stands for a recursive call, and RETURN_COUNT() for a return.
+ *
+ * The subproblems are computed in exactly the same order as by a
+ * recursive implementation, so the counts, and also the set of entries
+ * that are in the table when counting stops early (due to an overflow
+ * or a timeout), are the same. This is important, because the linkage
+ * extraction depends on them.
+ */
+
+/* Resume points. */
+enum
 {
-	static int level;
+	C_START,     /* A new subproblem */
+	C_SPLIT,     /* Only a single iteration of the main loop */
+	C_ISLAND_D,
+	C_ISLAND_NULL,
+	C_L_BNR,
+	C_R_BNL,
+	C_L_ANY,
+	C_L_CMULTI,
+	C_L_DMULTI,
+	C_L_DCMULTI,
+	C_L_BNR_COUNT,
+	C_R_ANY,
+	C_R_CMULTI,
+	C_R_DMULTI,
+	C_R_DCMULTI,
+	C_R_BNL_COUNT,
+};
 
-	if (!verbosity_level(8))
-		return do_count1(lineno, ctxt, lw, rw, le, re, null_count);
+struct Count_frame_s
+{
+	/* The subproblem. */
+	int lw, rw;
+	Connector *le, *re;
+	int null_count;
+	bool split_only;     /* Count only the split at w, don't store it */
+
+	int resume;          /* Where to continue (C_*) */
+	Count_bin ret;       /* The count of the last called subproblem */
+	Count_bin total;
 
-	Table_connector *t = find_table_pointer(ctxt, lw, rw, le, re, null_count);
+	/* Local variables. */
+	int w, end_word;
+	int opt;
+	Disjunct *d;
+	size_t mlb, mle;
+	int lnull_cnt, rnull_cnt;
+	bool leftpcount, rightpcount;
+	Count_bin l_any, l_cmulti, l_dmulti, l_dcmulti, l_bnr;
+	Count_bin r_any, r_cmulti, r_dmulti, r_dcmulti, r_bnl;
+	Count_bin leftcount, rightcount;
+#ifdef VERIFY_MATCH_LIST
+	int id;
+#endif
+};
 
-	level++;
-	prt_error("%*sdo_count%.*s:%d lw=%d rw=%d le=%s re=%s null_count=%d\n\\",
-		level*2, "", (!t)*3, "(R)", lineno, lw, rw, V(le), V(re), null_count);
-	Count_bin r = do_count1(lineno, ctxt, lw, rw, le, re, null_count);
-	prt_error("%*sreturn%.*s:%d=%lld\n", level*2, "", (!!t)*3, "(M)", lineno, r);
-	level--;
+#define COUNT_STACK_INITIAL_SIZE 256
+
+static Count_frame *count_stack_push(count_context_t *ctxt)
+{
+	if (ctxt->stack_depth == ctxt->stack_size)
+	{
+		size_t new_size = (0 == ctxt->stack_size) ?
+			COUNT_STACK_INITIAL_SIZE : 2 * ctxt->stack_size;
+		Count_frame *new_stack = xalloc(new_size * sizeof(Count_frame));
+
+		if (NULL != ctxt->stack)
+		{
+			memcpy(new_stack, ctxt->stack, ctxt->stack_depth * sizeof(Count_frame));
+			xfree(ctxt->stack, ctxt->stack_size * sizeof(Count_frame));
+		}
+		ctxt->stack = new_stack;
+		ctxt->stack_size = new_size;
+	}
 
-	return r;
+	return &ctxt->stack[ctxt->stack_depth++];
 }
 
-static Count_bin do_count1(int lineno,
-#define do_count(...) do_count(__LINE__, __VA_ARGS__)
-#else
-static Count_bin do_count(
-#endif
-                          count_context_t *ctxt,
-                          int lw, int rw,
-                          Connector *le, Connector *re,
-                          int null_count)
+static void free_count_stack(count_context_t *ctxt)
 {
-	Count_bin zero = hist_zero();
-	Count_bin total;
-	int start_word, end_word, w;
-	Table_connector *t;
-
-	assert (0 <= null_count, "Bad null count");
+	if (NULL == ctxt->stack) return;
+	xfree(ctxt->stack, ctxt->stack_size * sizeof(Count_frame));
+	ctxt->stack = NULL;
+	ctxt->stack_size = 0;
+}
 
-	t = find_table_pointer(ctxt, lw, rw, le, re, null_count);
+#ifdef DEBUG
+#define DO_COUNT_TRACE
+#endif
 
-	if (t) return t->count;
+#ifdef DO_COUNT_TRACE
+#define V(c) (!c?"(nil)":connector_get_string(c))
+#define TRACE_CALL(ctxt, lw, rw, le, re, null_count, t) \
+	if (verbosity_level(8)) \
+		prt_error("%*sdo_count%.*s lw=%d rw=%d le=%s re=%s null_count=%d\n\\", \
+			(int)(ctxt)->stack_depth*2+2, "", (!(t))*3, "(R)", \
+			lw, rw, V(le), V(re), null_count)
+#define TRACE_RETURN(ctxt, c, memo) \
+	if (verbosity_level(8)) \
+		prt_error("%*sreturn%.*s=%lld\n", (int)(ctxt)->stack_depth*2+2, "", \
+			(memo)*3, "(M)", (long long)hist_total(&(c)))
+#else
+#define TRACE_CALL(...)
+#define TRACE_RETURN(...)
+#endif /* DO_COUNT_TRACE */
 
-	/* Create the table entry with a tentative null count of 0.
-	 * This count must be updated before we return. */
-	t = table_store(ctxt, lw, rw, le, re, null_count);
+/**
+ * Start counting the given subproblem: If its count is already known,
+ * return false, with the count in *count. Else push a frame for it and
+ * return true.
+ */
+static bool count_call(count_context_t *ctxt,
+                       int lw, int rw,
+                       Connector *le, Connector *re,
+                       int null_count, Count_bin *count)
+{
+	assert (0 <= null_count, "Bad null count");
 
-	int unparseable_len = rw-lw-1;
+	Table_connector *t = find_table_pointer(ctxt, lw, rw, le, re, null_count);
 
-#if 1
-	/* This check is not necessary for correctness, as it is handled in
-	 * the general case below. It looks like it should be slightly faster. */
-	if (unparseable_len == 0)
+	TRACE_CALL(ctxt, lw, rw, le, re, null_count, t);
+	if (t)
 	{
-		/* lw and rw are neighboring words */
-		/* You can't have a linkage here with null_count > 0 */
-		if ((le == NULL) && (re == NULL) && (null_count == 0))
-		{
-			t->count = hist_one();
-		}
-		else
-		{
-			t->count = zero;
-		}
-		return t->count;
+		*count = t->count;
+		TRACE_RETURN(ctxt, *count, true);
+		return false;
 	}
-#endif
 
-	/* The left and right connectors are null, but the two words are
-	 * NOT next to each-other. */
-	if ((le == NULL) && (re == NULL))
+	Count_frame *f = count_stack_push(ctxt);
+	f->lw = lw;
+	f->rw = rw;
+	f->le = le;
+	f->re = re;
+	f->null_count = null_count;
+	f->split_only = false;
+	f->resume = C_START;
+
+	return true;
+}
+
+/**
+ * Run the frames at the top of the stack, down to (and including) the
+ * frame at stack depth base, and return the count of the latter.
+ */
+static Count_bin count_run(count_context_t *ctxt, size_t base)
+{
+	Count_bin zero = hist_zero();
+	Count_bin result;
+	fast_matcher_t *mchxt = ctxt->mchxt;
+	Count_frame *f;
+
+/* Count the given subproblem, and then continue at the resume point.
+ * Its count is then in f->ret. */
+#define COUNT_CALL(RESUME, lw, rw, le, re, null_count) \
+	f->resume = RESUME; \
+	if (count_call(ctxt, lw, rw, le, re, null_count, &f->ret)) goto next_frame; \
+	case RESUME:
+
+/* The table entry is created only when the count is known, because
+ * the table may get resized while counting the subproblems. */
+#define RETURN_COUNT(c) { result = (c); goto frame_done; }
+
+next_frame:
+	f = &ctxt->stack[ctxt->stack_depth - 1];
+	switch (f->resume)
+	{
+	case C_START:
 	{
-		int nopt_words = num_optional_words(ctxt, lw, rw);
+		int unparseable_len = f->rw - f->lw - 1;
 
-		if ((null_count == 0) || (!ctxt->islands_ok && (lw != -1)) )
+#if 1
+		/* This check is not necessary for correctness, as it is handled in
+		 * the general case below. It looks like it should be slightly faster. */
+		if (unparseable_len == 0)
 		{
-			/* The null_count of skipping n words is just n.
-			 * In case the unparsable range contains optional words, we
-			 * don't know here how many of them are actually skipped, because
-			 * they may belong to different alternatives and essentially just
-			 * be ignored.  Hence the inequality - sane_linkage_morphism()
-			 * will discard the linkages with extra null words. */
-			if ((null_count <= unparseable_len) &&
-			    (null_count >= unparseable_len - nopt_words))
-
+			/* lw and rw are neighboring words */
+			/* You can't have a linkage here with null_count > 0 */
+			if ((f->le == NULL) && (f->re == NULL) && (f->null_count == 0))
 			{
-				t->count = hist_one();
+				RETURN_COUNT(hist_one());
 			}
 			else
 			{
-				t->count = zero;
+				RETURN_COUNT(zero);
 			}
-			return t->count;
 		}
+#endif
 
-		/* Here null_count != 0 and we allow islands (a set of words
-		 * linked together but separate from the rest of the sentence).
-		 * Because we don't know here if an optional word is just
-		 * skipped or is a real null-word (see the comment above) we
-		 * try both possibilities: If a real null is encountered, the
-		 * rest of the sentence must contain one less null-word. Else
-		 * the rest of the sentence still contains the required number
-		 * of null words. */
-		t->count = zero;
-		w = lw + 1;
-		for (int opt = 0; opt <= !!ctxt->local_sent[w].optional; opt++)
+		/* The left and right connectors are null, but the two words are
+		 * NOT next to each-other. */
+#ifdef PERFORM_NULL_COUNT_VECTORS
+		if ((f->le == NULL) && (f->re == NULL))
 		{
-			null_count += opt;
-			for (Disjunct *d = ctxt->local_sent[w].d; d != NULL; d = d->next)
+			int nopt_words = num_optional_words(ctxt, f->lw, f->rw);
+			bool islands = ctxt->islands_ok || (f->lw == -1);
+
+			/* This is the same as the other version below, but for all the
+			 * null counts at once. Without islands, the only way is to skip
+			 * all the words. */
+			f->total = zero;
+			for (int n = 0; n < (islands ? 1 : NULL_COUNT_VECTOR_SIZE); n++)
+			{
+				if ((n <= unparseable_len) && (n >= unparseable_len - nopt_words))
+					f->total.c[n] = 1;
+			}
+			if (!islands) RETURN_COUNT(f->total);
+
+			/* With islands, the terms of 1 or more null words are those of the
+			 * rest of the sentence with one less null word, and, if word w is
+			 * optional, also with the same number of null words. */
+			f->w = f->lw + 1;
+			for (f->d = ctxt->local_sent[f->w].d; f->d != NULL; f->d = f->d->next)
 			{
-				if (d->left == NULL)
+				if (f->d->left == NULL)
 				{
-					hist_accumv(&t->count, d->cost,
-						do_count(ctxt, w, rw, d->right, NULL, null_count-1));
+					COUNT_CALL(C_ISLAND_D, f->w, f->rw, f->d->right, NULL, 0);
+					null_count_accum(&f->total, &f->ret,
+					                 ctxt->local_sent[f->w].optional);
 				}
 			}
-			hist_accumv(&t->count, 0.0,
-				do_count(ctxt, w, rw, NULL, NULL, null_count-1));
+			COUNT_CALL(C_ISLAND_NULL, f->w, f->rw, NULL, NULL, 0);
+			null_count_accum(&f->total, &f->ret, ctxt->local_sent[f->w].optional);
+			RETURN_COUNT(f->total);
 		}
-		return t->count;
-	}
+#else
+		if ((f->le == NULL) && (f->re == NULL))
+		{
+			int nopt_words = num_optional_words(ctxt, f->lw, f->rw);
 
-	if (le == NULL)
-	{
-		start_word = lw+1;
-	}
-	else
-	{
-		start_word = le->nearest_word;
-	}
+			if ((f->null_count == 0) || (!ctxt->islands_ok && (f->lw != -1)) )
+			{
+				/* The null_count of skipping n words is just n.
+				 * In case the unparsable range contains optional words, we
+				 * don't know here how many of them are actually skipped, because
+				 * they may belong to different alternatives and essentially just
+				 * be ignored.  Hence the inequality - sane_linkage_morphism()
+				 * will discard the linkages with extra null words. */
+				if ((f->null_count <= unparseable_len) &&
+				    (f->null_count >= unparseable_len - nopt_words))
 
-	if (re == NULL)
-	{
-		end_word = rw;
-	}
-	else
-	{
-		end_word = re->nearest_word +1;
-	}
+				{
+					RETURN_COUNT(hist_one());
+				}
+				else
+				{
+					RETURN_COUNT(zero);
+				}
+			}
 
-	total = zero;
-	fast_matcher_t *mchxt = ctxt->mchxt;
+			/* Here null_count != 0 and we allow islands (a set of words
+			 * linked together but separate from the rest of the sentence).
+			 * Because we don't know here if an optional word is just
+			 * skipped or is a real null-word (see the comment above) we
+			 * try both possibilities: If a real null is encountered, the
+			 * rest of the sentence must contain one less null-word. Else
+			 * the rest of the sentence still contains the required number
+			 * of null words. */
+			f->total = zero;
+			f->w = f->lw + 1;
+			for (f->opt = 0; f->opt <= !!ctxt->local_sent[f->w].optional; f->opt++)
+			{
+				for (f->d = ctxt->local_sent[f->w].d; f->d != NULL; f->d = f->d->next)
+				{
+					if (f->d->left == NULL)
+					{
+						COUNT_CALL(C_ISLAND_D, f->w, f->rw, f->d->right, NULL,
+						           f->null_count + f->opt - 1);
+						hist_accumv(&f->total, f->d->cost, f->ret);
+					}
+				}
+				COUNT_CALL(C_ISLAND_NULL, f->w, f->rw, NULL, NULL,
+				           f->null_count + f->opt - 1);
+				hist_accumv(&f->total, 0.0, f->ret);
+			}
+			RETURN_COUNT(f->total);
+		}
+#endif /* PERFORM_NULL_COUNT_VECTORS */
 
-	for (w = start_word; w < end_word; w++)
-	{
-		size_t mlb = form_match_list(mchxt, w, le, lw, re, rw);
+		if (f->le == NULL)
+		{
+			f->w = f->lw+1;
+		}
+		else
+		{
+			f->w = f->le->nearest_word;
+		}
+
+		if (f->re == NULL)
+		{
+			f->end_word = f->rw;
+		}
+		else
+		{
+			f->end_word = f->re->nearest_word +1;
+		}
+
+		f->total = zero;
+	}
+
+		/* The main loop. Each iteration adds the number of linkages of the
+		 * range (lw, rw) in which le and/or re connect to word w. An
+		 * iteration is also a unit of work in parallel counting, which
+		 * starts a frame at C_SPLIT (see do_count_split()). */
+		for (; f->w < f->end_word; f->w++)
+		{
+	case C_SPLIT:
+			f->mlb = form_match_list(mchxt, f->w, f->le, f->lw, f->re, f->rw);
 #ifdef VERIFY_MATCH_LIST
-		int id = get_match_list_element(mchxt, mlb) ?
-		            get_match_list_element(mchxt, mlb)->match_id : 0;
+			f->id = get_match_list_element(mchxt, f->mlb) ?
+			   mchxt->match_id[disjunct_index(mchxt, get_match_list_element(mchxt, f->mlb))] : 0;
 #endif
-		for (size_t mle = mlb; get_match_list_element(mchxt, mle) != NULL; mle++)
-		{
-			int lnull_cnt, rnull_cnt;
-			Disjunct *d = get_match_list_element(mchxt, mle);
-			bool Lmatch = d->match_left;
-			bool Rmatch = d->match_right;
+			for (f->mle = f->mlb; get_match_list_element(mchxt, f->mle) != NULL; f->mle++)
+			{
+				f->d = get_match_list_element(mchxt, f->mle);
 
 #ifdef VERIFY_MATCH_LIST
-			assert(id == d->match_id, "Modified id (%d!=%d)", id, d->match_id);
+				assert(f->id == mchxt->match_id[disjunct_index(mchxt, f->d)], "Modified id (%d!=%d)",
+				       f->id, mchxt->match_id[disjunct_index(mchxt, f->d)]);
 #endif
 
-			for (lnull_cnt = 0; lnull_cnt <= null_count; lnull_cnt++)
-			{
-				bool leftpcount = false;
-				bool rightpcount = false;
-
-				PRAGMA_MAYBE_UNINITIALIZED /* For old GCC versions */
-				Count_bin l_any;           /* Used only when leftpcount==true */
-				Count_bin r_any;           /* Used only when rightpcount==true */
-				PRAGMA_END
-				Count_bin l_cmulti = NO_COUNT;
-				Count_bin l_dmulti = NO_COUNT;
-				Count_bin l_dcmulti = NO_COUNT;
-				Count_bin l_bnr = NO_COUNT;
-				Count_bin r_cmulti = NO_COUNT;
-				Count_bin r_dmulti = NO_COUNT;
-				Count_bin r_dcmulti = NO_COUNT;
-				Count_bin r_bnl = NO_COUNT;
-
-				rnull_cnt = null_count - lnull_cnt;
-				/* Now lnull_cnt and rnull_cnt are the costs we're assigning
-				 * to those parts respectively */
-
-				/* Now, we determine if (based on table only) we can see that
-				   the current range is not parsable. */
-
-				/* The result count is a sum of multiplications of
-				 * LHS and RHS counts. If one of them is zero, we can skip
-				 * calculating the other one.
-				 *
-				 * So, first perform pseudocounting as an optimization. If
-				 * the pseudocount is zero, then we know that the true
-				 * count will be zero.
-				 *
-				 * Cache the result in the l_* and r_* variables, so a table
-				 * lookup can be skipped in cases we cannot skip the actual
-				 * calculation and a table entry exists. */
-				if (Lmatch)
+				for (f->lnull_cnt = 0; f->lnull_cnt <= f->null_count; f->lnull_cnt++)
 				{
-					l_any = pseudocount(ctxt, lw, w, le->next, d->left->next, lnull_cnt);
-					leftpcount = (hist_total(&l_any) != 0);
-					if (!leftpcount && le->multi)
 					{
-						l_cmulti =
-							pseudocount(ctxt, lw, w, le, d->left->next, lnull_cnt);
-						leftpcount |= (hist_total(&l_cmulti) != 0);
+						/* These don't need to be kept in the frame. */
+						uint8_t match_flags = get_match_flags(mchxt, f->mle);
+						bool Lmatch = match_flags & MATCH_LEFT;
+						bool Rmatch = match_flags & MATCH_RIGHT;
+						Connector *le = f->le, *re = f->re;
+						Disjunct *d = f->d;
+						int lw = f->lw, rw = f->rw, w = f->w;
+
+						f->leftpcount = false;
+						f->rightpcount = false;
+						f->l_cmulti = count_unknown;
+						f->l_dmulti = count_unknown;
+						f->l_dcmulti = count_unknown;
+						f->l_bnr = count_unknown;
+						f->r_cmulti = count_unknown;
+						f->r_dmulti = count_unknown;
+						f->r_dcmulti = count_unknown;
+						f->r_bnl = count_unknown;
+
+						f->rnull_cnt = f->null_count - f->lnull_cnt;
+						/* Now lnull_cnt and rnull_cnt are the costs we're assigning
+						 * to those parts respectively */
+
+						/* Now, we determine if (based on table only) we can see that
+						   the current range is not parsable. */
+
+						/* The result count is a sum of multiplications of
+						 * LHS and RHS counts. If one of them is zero, we can skip
+						 * calculating the other one.
+						 *
+						 * So, first perform pseudocounting as an optimization. If
+						 * the pseudocount is zero, then we know that the true
+						 * count will be zero.
+						 *
+						 * Cache the result in the l_* and r_* variables, so a table
+						 * lookup can be skipped in cases we cannot skip the actual
+						 * calculation and a table entry exists. */
+						if (Lmatch)
+						{
+							f->l_any = pseudocount(ctxt, lw, w, connector_next(le), connector_next(d->left), f->lnull_cnt);
+							f->leftpcount = (hist_total(&f->l_any) != 0);
+							if (!f->leftpcount && le->multi)
+							{
+								f->l_cmulti =
+									pseudocount(ctxt, lw, w, le, connector_next(d->left), f->lnull_cnt);
+								f->leftpcount |= (hist_total(&f->l_cmulti) != 0);
+							}
+							if (!f->leftpcount && d->left->multi)
+							{
+								f->l_dmulti =
+									pseudocount(ctxt, lw, w, connector_next(le), d->left, f->lnull_cnt);
+								f->leftpcount |= (hist_total(&f->l_dmulti) != 0);
+							}
+							if (!f->leftpcount && le->multi && d->left->multi)
+							{
+								f->l_dcmulti =
+									pseudocount(ctxt, lw, w, le, d->left, f->lnull_cnt);
+								f->leftpcount |= (hist_total(&f->l_dcmulti) != 0);
+							}
+						}
+
+						if (Rmatch && (f->leftpcount || (le == NULL)))
+						{
+							f->r_any = pseudocount(ctxt, w, rw, connector_next(d->right), connector_next(re), f->rnull_cnt);
+							f->rightpcount = (hist_total(&f->r_any) != 0);
+							if (!f->rightpcount && re->multi)
+							{
+								f->r_cmulti =
+									pseudocount(ctxt, w, rw, connector_next(d->right), re, f->rnull_cnt);
+								f->rightpcount |= (hist_total(&f->r_cmulti) != 0);
+							}
+							if (!f->rightpcount && d->right->multi)
+							{
+								f->r_dmulti =
+									pseudocount(ctxt, w,rw, d->right, connector_next(re), f->rnull_cnt);
+								f->rightpcount |= (hist_total(&f->r_dmulti) != 0);
+							}
+							if (!f->rightpcount && d->right->multi && re->multi)
+							{
+								f->r_dcmulti =
+									pseudocount(ctxt, w, rw, d->right, re, f->rnull_cnt);
+								f->rightpcount |= (hist_total(&f->r_dcmulti) != 0);
+							}
+						}
 					}
-					if (!leftpcount && d->left->multi)
+
+					if (!f->leftpcount && !f->rightpcount) continue;
+
+					if (!(f->leftpcount && f->rightpcount))
 					{
-						l_dmulti =
-							pseudocount(ctxt, lw, w, le->next, d->left, lnull_cnt);
-						leftpcount |= (hist_total(&l_dmulti) != 0);
+						if (f->leftpcount)
+						{
+							/* Evaluate using the left match, but not the right. */
+							COUNT_CALL(C_L_BNR, f->w, f->rw, f->d->right, f->re, f->rnull_cnt);
+							f->l_bnr = f->ret;
+						}
+						else if (f->le == NULL)
+						{
+							/* Evaluate using the right match, but not the left. */
+							COUNT_CALL(C_R_BNL, f->lw, f->w, f->le, f->d->left, f->lnull_cnt);
+							f->r_bnl = f->ret;
+						}
 					}
-					if (!leftpcount && le->multi && d->left->multi)
+
+/* Use the cached count c, if known, else count the subproblem. The
+ * count is then in f->ret. */
+#define CACHE_COUNT(RESUME, c, how_to_count, lw, rw, le, re, null_count) \
+	if (hist_total(&c) == NO_COUNT) \
+	{ \
+		COUNT_CALL(RESUME, lw, rw, le, re, null_count); \
+	} \
+	else f->ret = c; \
+	how_to_count;
+
+				 /* If the pseudocounting above indicates one of the terms
+				 * in the count multiplication is zero,
+				 * we know that the true total is zero. So we don't
+				 * bother counting the other term at all, in that case. */
+					f->leftcount = zero;
+					f->rightcount = zero;
+					if (f->leftpcount &&
+					    (f->rightpcount || (0 != hist_total(&f->l_bnr))))
 					{
-						l_dcmulti =
-							pseudocount(ctxt, lw, w, le, d->left, lnull_cnt);
-						leftpcount |= (hist_total(&l_dcmulti) != 0);
+						CACHE_COUNT(C_L_ANY, f->l_any, f->leftcount = f->ret,
+							f->lw, f->w, connector_next(f->le), connector_next(f->d->left), f->lnull_cnt);
+						if (f->le->multi)
+						{
+							CACHE_COUNT(C_L_CMULTI, f->l_cmulti,
+								hist_accumv(&f->leftcount, 0.0, f->ret),
+								f->lw, f->w, f->le, connector_next(f->d->left), f->lnull_cnt);
+						}
+						if (f->d->left->multi)
+						{
+							CACHE_COUNT(C_L_DMULTI, f->l_dmulti,
+								hist_accumv(&f->leftcount, 0.0, f->ret),
+								f->lw, f->w, connector_next(f->le), f->d->left, f->lnull_cnt);
+						}
+						if (f->d->left->multi && f->le->multi)
+						{
+							CACHE_COUNT(C_L_DCMULTI, f->l_dcmulti,
+								hist_accumv(&f->leftcount, 0.0, f->ret),
+								f->lw, f->w, f->le, f->d->left, f->lnull_cnt);
+						}
+						hist_link_cost(&f->leftcount, f->w - f->lw);
+
+						if (0 < hist_total(&f->leftcount))
+						{
+							/* Evaluate using the left match, but not the right */
+							CACHE_COUNT(C_L_BNR_COUNT, f->l_bnr,
+								hist_muladdv(&f->total, &f->leftcount, f->d->cost, f->ret),
+								f->w, f->rw, f->d->right, f->re, f->rnull_cnt);
+						}
 					}
-				}
 
-				if (Rmatch && (leftpcount || (le == NULL)))
-				{
-					r_any = pseudocount(ctxt, w, rw, d->right->next, re->next, rnull_cnt);
-					rightpcount = (hist_total(&r_any) != 0);
-					if (!rightpcount && re->multi)
+					if (f->rightpcount &&
+					    ((0 < hist_total(&f->leftcount)) || (0 != hist_total(&f->r_bnl))))
 					{
-						r_cmulti =
-							pseudocount(ctxt, w, rw, d->right->next, re, rnull_cnt);
-						rightpcount |= (hist_total(&r_cmulti) != 0);
+						CACHE_COUNT(C_R_ANY, f->r_any, f->rightcount = f->ret,
+							f->w, f->rw, connector_next(f->d->right), connector_next(f->re), f->rnull_cnt);
+						if (f->re->multi)
+						{
+							CACHE_COUNT(C_R_CMULTI, f->r_cmulti,
+								hist_accumv(&f->rightcount, 0.0, f->ret),
+								f->w, f->rw, connector_next(f->d->right), f->re, f->rnull_cnt);
+						}
+						if (f->d->right->multi)
+						{
+							CACHE_COUNT(C_R_DMULTI, f->r_dmulti,
+								hist_accumv(&f->rightcount, 0.0, f->ret),
+								f->w, f->rw, f->d->right, connector_next(f->re), f->rnull_cnt);
+						}
+						if (f->d->right->multi && f->re->multi)
+						{
+							CACHE_COUNT(C_R_DCMULTI, f->r_dcmulti,
+								hist_accumv(&f->rightcount, 0.0, f->ret),
+								f->w, f->rw, f->d->right, f->re, f->rnull_cnt);
+						}
+						hist_link_cost(&f->rightcount, f->rw - f->w);
+
+						if (0 < hist_total(&f->rightcount))
+						{
+							/* Total number where links are used on both sides */
+							hist_muladd(&f->total, &f->leftcount, f->d->cost, &f->rightcount);
+
+							/* Evaluate using the right match, but not the left */
+							if (f->le == NULL)
+							{
+								CACHE_COUNT(C_R_BNL_COUNT, f->r_bnl,
+									hist_muladdv(&f->total, &f->rightcount, f->d->cost, f->ret),
+									f->lw, f->w, f->le, f->d->left, f->lnull_cnt);
+							}
+						}
 					}
-					if (!rightpcount && d->right->multi)
+#undef CACHE_COUNT
+
+					/* Sigh. Overflows can and do occur, esp for the ANY language. */
+#ifdef PERFORM_NULL_COUNT_VECTORS
+					/* The caller then counts each null count separately, in
+					 * order to get the same results as without null count
+					 * vectors. So just stop counting. */
+					if (null_count_overflow(&f->total))
 					{
-						r_dmulti =
-							pseudocount(ctxt, w,rw, d->right, re->next, rnull_cnt);
-						rightpcount |= (hist_total(&r_dmulti) != 0);
+						ctxt->null_counts_failed = true;
+						ctxt->exhausted = true;
+						pop_match_list(mchxt, f->mlb);
+						RETURN_COUNT(f->total);
 					}
-					if (!rightpcount && d->right->multi && re->multi)
+#elif defined PERFORM_MIN_COST
+					/* The counts saturate (see hist_muladd()), and counting
+					 * must go on in order to find the best parse. */
+#else
+					if (INT_MAX < hist_total(&f->total))
 					{
-						r_dcmulti =
-							pseudocount(ctxt, w, rw, d->right, re, rnull_cnt);
-						rightpcount |= (hist_total(&r_dcmulti) != 0);
+#ifdef PERFORM_COUNT_HISTOGRAMMING
+						f->total.total = INT_MAX;
+#else
+						f->total = INT_MAX;
+#endif /* PERFORM_COUNT_HISTOGRAMMING */
+						pop_match_list(mchxt, f->mlb);
+						RETURN_COUNT(f->total);
 					}
+#endif /* PERFORM_NULL_COUNT_VECTORS */
 				}
+			}
+			pop_match_list(mchxt, f->mlb);
+		}
+		RETURN_COUNT(f->total);
 
-				if (!leftpcount && !rightpcount) continue;
+	default:
+		assert(0, "Bad resume point %d", f->resume);
+		RETURN_COUNT(zero);
+	}
+#undef COUNT_CALL
+#undef RETURN_COUNT
+
+frame_done:
+	if (!f->split_only)
+		result = table_store(ctxt, f->lw, f->rw, f->le, f->re, f->null_count,
+		                     result)->count;
+	ctxt->stack_depth--;
+	TRACE_RETURN(ctxt, result, false);
+	if (ctxt->stack_depth == base) return result;
+
+	f = &ctxt->stack[ctxt->stack_depth - 1];
+	f->ret = result;
+	goto next_frame;
+}
 
-				if (!(leftpcount && rightpcount))
-				{
-					if (leftpcount)
-					{
-						/* Evaluate using the left match, but not the right. */
-						l_bnr = do_count(ctxt, w, rw, d->right, re, rnull_cnt);
-					}
-					else if (le == NULL)
-					{
-						/* Evaluate using the right match, but not the left. */
-						r_bnl = do_count(ctxt, lw, w, le, d->left, lnull_cnt);
-					}
-				}
+/**
+ * Return the number of linkages of the range (lw, rw), where le and re
+ * are the connectors that must link to words inside it (NULL if none),
+ * with null_count null words.
+ */
+static Count_bin do_count(count_context_t *ctxt,
+                          int lw, int rw,
+                          Connector *le, Connector *re,
+                          int null_count)
+{
+	Count_bin count;
+	size_t base = ctxt->stack_depth;
 
-#define CACHE_COUNT(c, how_to_count, do_count) \
-{ \
-	Count_bin count = (hist_total(&c) == NO_COUNT) ? do_count : hist_total(&c); \
-	how_to_count; \
-}
-			 /* If the pseudocounting above indicates one of the terms
-			 * in the count multiplication is zero,
-			 * we know that the true total is zero. So we don't
-			 * bother counting the other term at all, in that case. */
-				Count_bin leftcount = zero;
-				Count_bin rightcount = zero;
-				if (leftpcount &&
-				    (rightpcount || (0 != hist_total(&l_bnr))))
-				{
-					CACHE_COUNT(l_any, leftcount = count,
-						do_count(ctxt, lw, w, le->next, d->left->next, lnull_cnt));
-					if (le->multi)
-						CACHE_COUNT(l_cmulti, hist_accumv(&leftcount, d->cost, count),
-							do_count(ctxt, lw, w, le, d->left->next, lnull_cnt));
-					if (d->left->multi)
-						CACHE_COUNT(l_dmulti, hist_accumv(&leftcount, d->cost, count),
-							do_count(ctxt, lw, w, le->next, d->left, lnull_cnt));
-					if (d->left->multi && le->multi)
-						CACHE_COUNT(l_dcmulti, hist_accumv(&leftcount, d->cost, count),
-							do_count(ctxt, lw, w, le, d->left, lnull_cnt));
-
-					if (0 < hist_total(&leftcount))
-					{
-						/* Evaluate using the left match, but not the right */
-						CACHE_COUNT(l_bnr, hist_muladdv(&total, &leftcount, d->cost, count),
-							do_count(ctxt, w, rw, d->right, re, rnull_cnt));
-					}
-				}
+	if (!count_call(ctxt, lw, rw, le, re, null_count, &count))
+		return count;
 
-				if (rightpcount &&
-				    ((0 < hist_total(&leftcount)) || (0 != hist_total(&r_bnl))))
-				{
-					CACHE_COUNT(r_any, rightcount = count,
-						do_count(ctxt, w, rw, d->right->next, re->next, rnull_cnt));
-					if (re->multi)
-						CACHE_COUNT(r_cmulti, hist_accumv(&rightcount, d->cost, count),
-							do_count(ctxt, w, rw, d->right->next, re, rnull_cnt));
-					if (d->right->multi)
-						CACHE_COUNT(r_dmulti, hist_accumv(&rightcount, d->cost, count),
-							do_count(ctxt, w, rw, d->right, re->next, rnull_cnt));
-					if (d->right->multi && re->multi)
-						CACHE_COUNT(r_dcmulti, hist_accumv(&rightcount, d->cost, count),
-							do_count(ctxt, w, rw, d->right, re, rnull_cnt));
-
-					if (0 < hist_total(&rightcount))
-					{
-						/* Total number where links are used on both sides */
-						hist_muladd(&total, &leftcount, 0.0, &rightcount);
+	return count_run(ctxt, base);
+}
 
-						/* Evaluate using the right match, but not the left */
-						if (le == NULL)
-							CACHE_COUNT(r_bnl, hist_muladdv(&total, &rightcount, d->cost, count),
-								do_count(ctxt, lw, w, le, d->left, lnull_cnt));
-					}
-				}
+#ifdef USE_PARALLEL_COUNT
+/**
+ * Count the linkages of the range (lw, rw) in which le and/or re connect
+ * to word w, i.e. one iteration of the main loop of counting (lw, rw,
+ * le, re, null_count). The subproblems get into the table, but the
+ * result is not stored, as it is only a part of the count of (lw, rw,
+ * le, re, null_count).
+ */
+static void do_count_split(count_context_t *ctxt,
+                           int lw, int rw,
+                           Connector *le, Connector *re,
+                           int null_count, int w)
+{
+	size_t base = ctxt->stack_depth;
+	Count_frame *f = count_stack_push(ctxt);
+
+	f->lw = lw;
+	f->rw = rw;
+	f->le = le;
+	f->re = re;
+	f->null_count = null_count;
+	f->split_only = true;
+	f->resume = C_SPLIT;
+	f->w = w;
+	f->end_word = w + 1;
+	f->total = hist_zero();
+
+	count_run(ctxt, base);
+}
+#endif /* USE_PARALLEL_COUNT */
 
-				/* Sigh. Overflows can and do occur, esp for the ANY language. */
-				if (INT_MAX < hist_total(&total))
-				{
-#ifdef PERFORM_COUNT_HISTOGRAMMING
-					total.total = INT_MAX;
+#ifdef USE_PARALLEL_COUNT
+/* Parallel counting.
+ *
+ * Before the (serial) top-level do_count() call, the splits of its
+ * main subproblems, i.e. the iterations of the loop in do_count() for
+ * lw == 0 and each right connector of the first word, are handed out as
+ * tasks to opts->threads worker threads. The workers share the count
+ * table, which is filled by them concurrently. Then the serial
+ * do_count() call finds most of its subproblems already in the table.
+ *
+ * Each table entry is computed by the same code, in the same order,
+ * no matter which thread computes it, so the counts (and the linkages)
+ * are identical to those of serial counting. Two threads may happen to
+ * compute the same entry at the same time; then both of them store it,
+ * which is harmless, as the two entries are identical.
+ *
+ * The tasks are handed out dynamically, in order of increasing split
+ * word, so a thread that finishes its task takes the next one. Each
+ * worker has its own fast-matcher clone (for its match-list stack and
+ * match flags), and its own copy of the count context.
+ *
+ * The table cannot grow while the workers run. If it gets too full, or
+ * if the resources get exhausted, the workers abort: they stop storing
+ * entries, and return zero counts to get out quickly. Entries that got
+ * stored before the abort are valid, so the serial pass just computes
+ * what is missing.
+ */
+
+/* Don't bother with short sentences. */
+#define PARALLEL_COUNT_MIN_LENGTH 12
+
+typedef struct
+{
+	Connector *le;
+	int null_count;
+	int w;
+} Count_task;
+
+struct Parallel_count_s
+{
+	Count_task *task;
+	size_t num_tasks;
+	size_t next_task;           /* Atomic */
+	unsigned int table_count;   /* Atomic */
+	unsigned int max_count;     /* Abort when table_count gets above it */
+	bool abort;                 /* Atomic */
+	int rw;
+};
+
+/**
+ * Store an entry in a table that is shared by the parallel counting
+ * workers. Slots are claimed by a compare-and-swap of their control
+ * word, and the entry is published by setting its final control word.
+ */
+static Table_connector * table_store_concurrent(count_context_t *ctxt,
+                                                uint32_t key,
+                                                Connector *le, Connector *re,
+                                                Count_bin count)
+{
+	Parallel_count *par = ctxt->par;
+
+	if (ctxt->exhausted)
+	{
+		/* The resources got exhausted (see find_table_pointer()). */
+		__atomic_store_n(&par->abort, true, __ATOMIC_RELAXED);
+	}
+	else if (__atomic_load_n(&par->abort, __ATOMIC_RELAXED))
+	{
+		ctxt->exhausted = true;
+	}
+	else if (__atomic_add_fetch(&par->table_count, 1, __ATOMIC_RELAXED) >
+	         par->max_count)
+	{
+		/* The table is too full. */
+		__atomic_sub_fetch(&par->table_count, 1, __ATOMIC_RELAXED);
+		__atomic_store_n(&par->abort, true, __ATOMIC_RELAXED);
+		ctxt->exhausted = true;
+	}
+
+	if (ctxt->exhausted)
+	{
+		/* Once set, ctxt->exhausted remains set in this worker, so the
+		 * dummy counts never get into the table. */
+		ctxt->dummy->count = hist_zero();
+		return ctxt->dummy;
+	}
+
+	uint64_t h = table_hash(key, le, re);
+	uint16_t gen = ctxt->table_gen;
+	unsigned int mask = ctxt->table_size - 1;
+	unsigned int i = TABLE_SLOT(ctxt->table_size, h);
+
+	for (;; i = (i + 1) & mask)
+	{
+		uint16_t c = TABLE_CTRL_LOAD(&ctxt->table_ctrl[i]);
+		if (TABLE_SLOT_USED(gen, c)) continue;
+		if (__atomic_compare_exchange_n(&ctxt->table_ctrl[i], &c,
+		                                TABLE_CTRL_BUSY(gen), false,
+		                                __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+			break;
+	}
+
+	Table_connector *n = &ctxt->table[i];
+	n->le = le; n->re = re; n->key = key;
+	n->count = count;
+	__atomic_store_n(&ctxt->table_ctrl[i], TABLE_CTRL(gen, h), __ATOMIC_RELEASE);
+
+	return n;
+}
+
+static void *count_worker(void *arg)
+{
+	count_context_t *ctxt = arg;
+	Parallel_count *par = ctxt->par;
+
+	for (;;)
+	{
+		size_t i = __atomic_fetch_add(&par->next_task, 1, __ATOMIC_RELAXED);
+		if (i >= par->num_tasks) break;
+		if (__atomic_load_n(&par->abort, __ATOMIC_RELAXED)) break;
+
+		Count_task *t = &par->task[i];
+		do_count_split(ctxt, 0, par->rw, t->le, NULL, t->null_count, t->w);
+	}
+
+	return NULL;
+}
+
+/**
+ * Fill the count table in parallel with the subproblems of
+ * do_count(ctxt, -1, sent->length, NULL, NULL, null_count+1).
+ * See the comments at the start of this section.
+ */
+static void parallel_count(count_context_t *ctxt, Sentence sent,
+                           int null_count, int num_threads)
+{
+	int rw = (int)sent->length;
+	Word *w0 = &ctxt->local_sent[0];
+	Parallel_count par;
+	size_t max_tasks = 0;
+
+	memset(&par, 0, sizeof(par));
+	par.rw = rw;
+
+	/* The top-level do_count() calls do_count(0, rw, d->right, NULL, nc)
+	 * for each disjunct of word 0 that has no left connectors, where nc
+	 * is null_count, and also null_count+1 if word 0 is optional. */
+#ifdef PERFORM_NULL_COUNT_VECTORS
+	const int max_opt = 0; /* A single call, for all the null counts */
 #else
-					total = INT_MAX;
-#endif /* PERFORM_COUNT_HISTOGRAMMING */
-					t->count = total;
-					pop_match_list(mchxt, mlb);
-					return total;
-				}
+	const int max_opt = !!w0->optional;
+#endif /* PERFORM_NULL_COUNT_VECTORS */
+	for (Disjunct *d = w0->d; d != NULL; d = d->next)
+		if ((NULL == d->left) && (NULL != d->right)) max_tasks++;
+	max_tasks *= (1 + max_opt) * rw;
+	if (0 == max_tasks) return;
+
+	par.task = xalloc(max_tasks * sizeof(Count_task));
+	for (int w = 1; w < rw; w++)
+	{
+		for (int opt = 0; opt <= max_opt; opt++)
+		{
+			for (Disjunct *d = w0->d; d != NULL; d = d->next)
+			{
+				if ((NULL != d->left) || (NULL == d->right)) continue;
+				if (d->right->nearest_word > w) continue;
+				Count_task *t = &par.task[par.num_tasks++];
+				t->le = d->right;
+				t->null_count = null_count + opt;
+				t->w = w;
 			}
 		}
-		pop_match_list(mchxt, mlb);
 	}
-	t->count = total;
-	return total;
-}
 
+	/* Workers cannot grow the table, so make room in advance. */
+	while (NULL != ctxt->old_table)
+		table_migrate(ctxt, ctxt->old_table_size);
+	size_t estimate = ctxt->table_count + table_entries_estimate(sent);
+	while (TABLE_MAX_LOAD(ctxt->table_size) < estimate)
+	{
+		table_grow(ctxt);
+		table_migrate(ctxt, ctxt->old_table_size);
+	}
+	par.table_count = ctxt->table_count;
+	par.max_count = TABLE_MAX_LOAD(ctxt->table_size);
+
+	count_context_t *wctxt = xalloc(num_threads * sizeof(count_context_t));
+	pthread_t *thread = xalloc(num_threads * sizeof(pthread_t));
+	Table_connector *dummy = xalloc(num_threads * sizeof(Table_connector));
+	int num_started = 0;
+
+	for (int i = 0; i < num_threads; i++)
+	{
+		wctxt[i] = *ctxt;
+		wctxt[i].par = &par;
+		wctxt[i].mchxt = clone_fast_matcher(ctxt->mchxt);
+		wctxt[i].exhausted = false;
+		wctxt[i].checktimer = 0;
+		wctxt[i].stack = NULL;
+		wctxt[i].stack_size = 0;
+		wctxt[i].stack_depth = 0;
+		wctxt[i].dummy = &dummy[i];
+		/* Only the calling thread checks the resources. */
+		if (0 != i) wctxt[i].current_resources = NULL;
+	}
+
+	for (int i = 1; i < num_threads; i++)
+	{
+		if (0 != pthread_create(&thread[i], NULL, count_worker, &wctxt[i]))
+			break;
+		num_started++;
+	}
+	count_worker(&wctxt[0]);
+	for (int i = 1; i <= num_started; i++)
+		pthread_join(thread[i], NULL);
+
+	ctxt->table_count = par.table_count;
+	if (wctxt[0].exhausted && (NULL != ctxt->current_resources) &&
+	    resources_exhausted(ctxt->current_resources))
+		ctxt->exhausted = true;
+
+	lgdebug(+D_COUNT, "%d threads, %zu tasks%s, %u entries\n",
+	        num_started + 1, par.num_tasks, par.abort ? " (aborted)" : "",
+	        ctxt->table_count);
+
+	for (int i = 0; i < num_threads; i++)
+	{
+		free_fast_matcher(wctxt[i].mchxt);
+		free_count_stack(&wctxt[i]);
+	}
+	xfree(thread, num_threads * sizeof(pthread_t));
+	xfree(dummy, num_threads * sizeof(Table_connector));
+	xfree(wctxt, num_threads * sizeof(count_context_t));
+	xfree(par.task, max_tasks * sizeof(Count_task));
+}
+#endif /* USE_PARALLEL_COUNT */
 
 /**
  * Returns the number of ways the sentence can be parsed with the
@@ -578,18 +1608,23 @@ static Count_bin do_count(
  * The count returned here is meant to be completely accurate; it is
  * not an approximation!
  *
- * Currently, the code has been designed to maintain a histogram of
- * the cost of each of the parses. The number and width of the bins
- * is adjustable in histogram.c. At this time, the histogram is not
- * used anywhere, and a 3-5% speedup is available if it is avoided.
- * We plan to use this histogram, later ....
+ * The histogram instance of this function also maintains a histogram
+ * of the cost of each of the parses. The number and width of the bins
+ * is adjustable in histogram.c. At this time, the histogram is only
+ * printed (at verbosity D_COUNT), but we plan to use it later ....
  */
-Count_bin do_parse(Sentence sent,
-                   fast_matcher_t *mchxt,
-                   count_context_t *ctxt,
-                   int null_count, Parse_Options opts)
+s64 COUNT_FN(do_parse)(Sentence sent,
+                       fast_matcher_t *mchxt,
+                       count_context_t *ctxt,
+                       int null_count, Parse_Options opts)
 {
 	Count_bin hist;
+#ifdef PERFORM_NULL_COUNT_VECTORS
+	/* All the null counts are counted at once, and the sentence null
+	 * count just selects the result. */
+	int sent_null_count = null_count;
+	null_count = -1;
+#endif /* PERFORM_NULL_COUNT_VECTORS */
 
 	ctxt->current_resources = opts->resources;
 	ctxt->exhausted = false;
@@ -601,27 +1636,223 @@ Count_bin do_parse(Sentence sent,
 	/* ctxt->null_block = 1; */
 	ctxt->islands_ok = opts->islands_ok;
 	ctxt->mchxt = mchxt;
+	if (!ctxt->table_sized) init_table(ctxt, sent);
+
+#ifdef USE_PARALLEL_COUNT
+	bool parallel = (1 < opts->threads) &&
+	                (PARALLEL_COUNT_MIN_LENGTH <= sent->length);
+	if (parallel) parallel_count(ctxt, sent, MAX(null_count, 0), opts->threads);
+#endif /* USE_PARALLEL_COUNT */
 
 	hist = do_count(ctxt, -1, sent->length, NULL, NULL, null_count+1);
 
+#ifdef USE_PARALLEL_COUNT
+	/* On a count overflow, do_count() returns early, before computing
+	 * all of the subproblems. The linkage extraction then considers only
+	 * the subproblems that are in the table, which after parallel
+	 * counting may be more than after serial counting. So, in order for
+	 * the linkages to be the same, recount serially. */
+#ifndef PERFORM_MIN_COST
+	if (parallel && !ctxt->exhausted &&
+	    ((INT_MAX <= hist_total(&hist)) || (0 > hist_total(&hist))))
+	{
+		lgdebug(+D_COUNT, "Count overflow - recounting serially\n");
+		clear_table(ctxt);
+		hist = do_count(ctxt, -1, sent->length, NULL, NULL, null_count+1);
+	}
+#endif /* !PERFORM_MIN_COST */
+#endif /* USE_PARALLEL_COUNT */
+
+#ifdef PERFORM_NULL_COUNT_VECTORS
+	if (null_count_overflow(&hist)) ctxt->null_counts_failed = true;
+	for (int n = 0; n < NULL_COUNT_VECTOR_SIZE-1; n++)
+		ctxt->null_counts[n] = hist.c[n+1];
+	ctxt->null_counts_done = true;
+	s64 total = ctxt->null_counts[sent_null_count];
+#else
+	s64 total = hist_total(&hist);
+#endif /* PERFORM_NULL_COUNT_VECTORS */
+
+#ifdef PERFORM_COUNT_HISTOGRAMMING
+	if (verbosity_level(+D_COUNT))
+	{
+		prt_error("Debug: Cost histogram (base %d, overrun %lld):",
+		          hist.base, hist.overrun);
+		for (int i = 0; i < NUM_BINS; i++)
+			prt_error(" %lld", hist.bin[i]);
+		prt_error("\n");
+	}
+#endif /* PERFORM_COUNT_HISTOGRAMMING */
+
 	ctxt->local_sent = NULL;
 	ctxt->current_resources = NULL;
 	ctxt->checktimer = 0;
-	return hist;
+	return total;
+}
+
+/**
+ * Free the memory that is specific to this instance.
+ */
+void COUNT_FN(free_count_memory)(count_context_t *ctxt)
+{
+	if (NULL != ctxt->table)
+	{
+		lgdebug(+D_COUNT, "Table size %u (2^%d)\n",
+		        ctxt->table_size, ctxt->log2_table_size);
+		delete_table(ctxt);
+	}
+	free_count_stack(ctxt);
+	ctxt->table_sized = false;
+}
+
+#ifdef COUNT_DISPATCH
+/* ============================================================= */
+/* The functions below are compiled only once. They dispatch to the
+ * instance that the count context is set up for. */
+
+/**
+ * Set up the given context for the given instance. The table and stack
+ * memory of one instance cannot be used by another one, so it is freed
+ * if the instance changes.
+ */
+static void set_count_mode(count_context_t *ctxt, Count_mode mode)
+{
+	if (ctxt->mode == mode) return;
+
+	switch (ctxt->mode)
+	{
+		case COUNT_HIST:
+			free_count_memory_hist(ctxt);
+			break;
+		case COUNT_NULLS:
+			free_count_memory_nulls(ctxt);
+			break;
+		case COUNT_MIN_COST:
+			free_count_memory_mincost(ctxt);
+			break;
+		case COUNT_PLAIN:
+			free_count_memory_s64(ctxt);
+			break;
+	}
+	ctxt->mode = mode;
+	ctxt->null_counts_done = false;
+}
+
+s64 table_lookup(count_context_t *ctxt,
+                 int lw, int rw, Connector *le, Connector *re,
+                 unsigned int null_count)
+{
+	switch (ctxt->mode)
+	{
+		case COUNT_HIST:
+			return table_lookup_hist(ctxt, lw, rw, le, re, null_count);
+		case COUNT_NULLS:
+			return table_lookup_nulls(ctxt, lw, rw, le, re, null_count);
+		case COUNT_MIN_COST:
+			return table_lookup_mincost(ctxt, lw, rw, le, re, null_count);
+		case COUNT_PLAIN:
+			break;
+	}
+
+	return table_lookup_s64(ctxt, lw, rw, le, re, null_count);
+}
+
+/**
+ * Return the number of parses of the sentence with the given null count.
+ * See do_parse_s64() for the details.
+ *
+ * When parsing with null words, the parses with all the null counts
+ * (up to NULL_COUNT_VECTOR_SIZE-2) are counted at once, so the calls for
+ * the next null counts of the same sentence just return their result.
+ * This is not done for null_count==0, because most sentences have
+ * complete parses, and then the other null counts are not needed. It
+ * is also not done if a count overflows, because then the results
+ * (which parses are extracted) may be different than when counting each
+ * null count separately.
+ */
+s64 do_parse(Sentence sent,
+             fast_matcher_t *mchxt,
+             count_context_t *ctxt,
+             int null_count, Parse_Options opts)
+{
+	Count_mode mode = COUNT_PLAIN;
+	s64 total;
+
+	if (opts->count_histograms)
+		mode = COUNT_HIST;
+	else if ((0 < null_count) && (null_count < NULL_COUNT_VECTOR_SIZE-1) &&
+	         !ctxt->null_counts_failed)
+		mode = COUNT_NULLS;
+
+	if ((COUNT_NULLS == mode) && (COUNT_NULLS == ctxt->mode) &&
+	    ctxt->null_counts_done)
+		return ctxt->null_counts[null_count];
+
+	set_count_mode(ctxt, mode);
+	switch (mode)
+	{
+		case COUNT_HIST:
+			return do_parse_hist(sent, mchxt, ctxt, null_count, opts);
+		case COUNT_NULLS:
+			total = do_parse_nulls(sent, mchxt, ctxt, null_count, opts);
+			if (!ctxt->null_counts_failed) return total;
+
+			lgdebug(+D_COUNT, "Count overflow - counting null count %d alone\n",
+			        null_count);
+			set_count_mode(ctxt, COUNT_PLAIN);
+			break;
+		case COUNT_MIN_COST:
+			assert(0, "do_parse(): Use do_parse_best() for COUNT_MIN_COST");
+			break;
+		case COUNT_PLAIN:
+			break;
+	}
+
+	return do_parse_s64(sent, mchxt, ctxt, null_count, opts);
 }
 
-/* sent_length is used only as a hint for the hash table size ... */
-count_context_t * alloc_count_context(size_t sent_length)
+/**
+ * Like do_parse(), but also find the cost of the best parse of each
+ * subproblem, for build_best_parse_set(). The count is exact only up to
+ * INT_MAX, but unlike do_parse(), it doesn't stop on a count overflow.
+ */
+s64 do_parse_best(Sentence sent,
+                  fast_matcher_t *mchxt,
+                  count_context_t *ctxt,
+                  int null_count, Parse_Options opts)
+{
+	set_count_mode(ctxt, COUNT_MIN_COST);
+	return do_parse_mincost(sent, mchxt, ctxt, null_count, opts);
+}
+
+/**
+ * The table is allocated by the first do_parse() call, as its size
+ * depends on the number of disjuncts that remain after pruning.
+ */
+count_context_t * alloc_count_context(void)
 {
 	count_context_t *ctxt = (count_context_t *) xalloc (sizeof(count_context_t));
 	memset(ctxt, 0, sizeof(count_context_t));
 
-	init_table(ctxt, sent_length);
 	return ctxt;
 }
 
+/**
+ * Prepare the given context for parsing another sentence.
+ * The memory of its table is kept, and the table is cleared (in O(1),
+ * for the open-addressing table) by the first do_parse() call.
+ */
+void reset_count_context(count_context_t *ctxt)
+{
+	ctxt->table_sized = false;
+	ctxt->null_counts_done = false;
+	ctxt->null_counts_failed = false;
+}
+
 void free_count_context(count_context_t *ctxt)
 {
-	free_table(ctxt);
+	set_count_mode(ctxt, COUNT_PLAIN);
+	free_count_memory_s64(ctxt);
 	xfree(ctxt, sizeof(count_context_t));
 }
+#endif /* COUNT_DISPATCH */
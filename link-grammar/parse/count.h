@@ -18,9 +18,14 @@
 
 typedef struct count_context_s count_context_t;
 
-Count_bin* table_lookup(count_context_t *, int, int, Connector *, Connector *, unsigned int);
-Count_bin do_parse(Sentence, fast_matcher_t*, count_context_t*, int null_count, Parse_Options);
+s64 table_lookup(count_context_t *, int, int, Connector *, Connector *, unsigned int);
+s64 do_parse(Sentence, fast_matcher_t*, count_context_t*, int null_count, Parse_Options);
 
-count_context_t* alloc_count_context(size_t);
+s64 do_parse_best(Sentence, fast_matcher_t*, count_context_t*, int null_count, Parse_Options);
+bool table_lookup_cost(count_context_t *, int, int, Connector *, Connector *,
+                       unsigned int, Linkage_cost *);
+
+count_context_t* alloc_count_context(void);
+void reset_count_context(count_context_t*);
 void free_count_context(count_context_t*);
 #endif /* _COUNT_H */
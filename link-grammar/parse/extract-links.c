@@ -12,6 +12,7 @@
 /*************************************************************************/
 
 #include <limits.h>  /* For UINT_MAX */
+#include <stdint.h>
 
 #include "connectors.h"
 #include "count.h"
@@ -23,25 +24,41 @@
 
 //#define RECOUNT
 
+/* The parse sets and the parse choices are kept in arenas, and refer to
+ * each other by 32-bit indices into them (see Forest_arena). Index 0
+ * is not used, and means "none". */
+typedef uint32_t Pset_index;
+typedef uint32_t Pchoice_index;
+
 typedef struct Parse_choice_struct Parse_choice;
+typedef struct Kbest_struct Kbest;
 
-/* The parse_choice is used to extract links for a given parse */
+/* The parse_choice is used to extract links for a given parse.
+ * Its links are not stored: they are between the connectors of its
+ * set and of its middle disjunct md (see issue_links_for_choice()).
+ * The disjuncts of its left and right words are passed down while
+ * extracting the links, as mk_parse_set() passes them. */
 typedef struct Parse_set_struct Parse_set;
 struct Parse_choice_struct
 {
-	Parse_choice * next;
-	Parse_set * set[2];
-	Link        link[2];   /* the lc fields of these is NULL if there is no link used */
-	Disjunct *ld, *md, *rd;  /* the chosen disjuncts for the relevant three words */
+	Pchoice_index next;
+	Pset_index set[2];
+	unsigned int md : 30;    /* Index+1 of the disjunct of the middle word
+	                            in the disjunct store; 0 if none. For an
+	                            island, it is that of its first word. */
+	unsigned int link : 2;   /* The links used (CHOICE_LINK_*) */
 };
 
+#define CHOICE_LINK_LEFT  0x1 /* A link to the left word of the set */
+#define CHOICE_LINK_RIGHT 0x2 /* A link to the right word of the set */
+#define MAX_CHOICE_MD ((1U << 30) - 1)
+
 struct Parse_set_struct
 {
-	short          lw, rw; /* left and right word index */
-	unsigned short null_count; /* number of island words */
 	Connector      *le, *re; /* pending, unconnected connectors */
-
 	s64 count;      /* The number of ways to parse. */
+	short          lw, rw; /* left and right word index */
+	unsigned short null_count; /* number of island words */
 #ifdef RECOUNT
 	s64 recount;  /* Exactly the same as above, but counted at a later stage. */
 	s64 cut_count;  /* Count only low-cost parses, i.e. below the cost cutoff */
@@ -51,109 +68,162 @@ struct Parse_set_struct
 #else
 #define RECOUNT(X)  /* Make it disappear... */
 #endif
-	Parse_choice * first;
-	Parse_choice * tail;
+	Pchoice_index first;
+	Pchoice_index tail;
+	Pset_index next;          /* The next set in its x_table bucket */
 };
 
-typedef struct Pset_bucket_struct Pset_bucket;
-struct Pset_bucket_struct
+/**
+ * An arena of fixed-size elements, which are addressed by 32-bit
+ * indices. The elements are allocated in blocks of FOREST_BLOCK_SIZE,
+ * so they never move, and freeing the arena takes time proportional
+ * to the number of blocks.
+ */
+#define FOREST_BLOCK_BITS 12
+#define FOREST_BLOCK_SIZE (1U << FOREST_BLOCK_BITS)
+
+typedef struct
 {
-	Parse_set         set;
-	Pset_bucket *next;
-};
+	char **block;
+	size_t num_blocks;
+	size_t blocks_alloced;
+	size_t element_size;
+	uint32_t num_elements;    /* Including the unused element 0 */
+} Forest_arena;
 
 struct extractor_s
 {
 	unsigned int   x_table_size;
 	unsigned int   log2_x_table_size;
-	Pset_bucket ** x_table;  /* Hash table */
-	Parse_set *    parse_set;
+	Pset_index *   x_table;  /* Hash table */
+	Pset_index     parse_set;
+
+	Forest_arena   sets;     /* The Parse_set elements */
+	Forest_arena   choices;  /* The Parse_choice elements */
+	const Disjunct * disjuncts; /* The disjunct store array, for md */
+	Kbest **       kbest;    /* Per set; NULL until needed */
+	size_t         kbest_size;
 
 	/* thread-safe random number state */
 	unsigned int rand_state;
 };
 
+static void arena_init(Forest_arena *a, size_t element_size)
+{
+	memset(a, 0, sizeof(Forest_arena));
+	a->element_size = element_size;
+	a->num_elements = 1;
+}
+
+static void *arena_element(const Forest_arena *a, uint32_t i)
+{
+	return a->block[i >> FOREST_BLOCK_BITS] +
+	       (i & (FOREST_BLOCK_SIZE - 1)) * a->element_size;
+}
+
 /**
- * The first thing we do is we build a data structure to represent the
- * result of the entire parse search.  There will be a set of nodes
- * built for each call to the count() function that returned a non-zero
- * value, AND which is part of a valid linkage.  Each of these nodes
- * represents a valid continuation, and contains pointers to two other
- * sets (one for the left continuation and one for the right
- * continuation).
+ * Allocate a new element, and return its index. Its content is
+ * undefined.
  */
-
-static void free_set(Parse_set *s)
+static uint32_t arena_alloc(Forest_arena *a)
 {
-	Parse_choice *p, *xp;
-	if (s == NULL) return;
-	for (p=s->first; p != NULL; p = xp)
+	uint32_t i = a->num_elements;
+
+	assert(UINT32_MAX != i, "Parse forest arena overflow");
+	if ((i >> FOREST_BLOCK_BITS) == a->num_blocks)
 	{
-		xp = p->next;
-		xfree((void *)p, sizeof(*p));
+		if (a->num_blocks == a->blocks_alloced)
+		{
+			size_t new_alloced = (0 == a->blocks_alloced) ? 16 : 2 * a->blocks_alloced;
+			char **new_block = xalloc(new_alloced * sizeof(char *));
+			if (0 != a->blocks_alloced)
+			{
+				memcpy(new_block, a->block, a->blocks_alloced * sizeof(char *));
+				xfree(a->block, a->blocks_alloced * sizeof(char *));
+			}
+			a->block = new_block;
+			a->blocks_alloced = new_alloced;
+		}
+		a->block[a->num_blocks++] = xalloc(FOREST_BLOCK_SIZE * a->element_size);
 	}
+
+	a->num_elements++;
+	return i;
 }
 
-static Parse_choice *
-make_choice(Parse_set *lset, Connector * llc, Connector * lrc,
-            Parse_set *rset, Connector * rlc, Connector * rrc,
-            Disjunct *ld, Disjunct *md, Disjunct *rd)
+static void arena_free(Forest_arena *a)
 {
-	Parse_choice *pc;
-	pc = (Parse_choice *) xalloc(sizeof(*pc));
-	pc->next = NULL;
-	pc->set[0] = lset;
-	pc->link[0].link_name = NULL;
-	pc->link[0].lw = lset->lw;
-	pc->link[0].rw = lset->rw;
-	pc->link[0].lc = llc;
-	pc->link[0].rc = lrc;
-	pc->set[1] = rset;
-	pc->link[1].link_name = NULL;
-	pc->link[1].lw = rset->lw;
-	pc->link[1].rw = rset->rw;
-	pc->link[1].lc = rlc;
-	pc->link[1].rc = rrc;
-	pc->ld = ld;
-	pc->md = md;
-	pc->rd = rd;
-	return pc;
+	for (size_t b = 0; b < a->num_blocks; b++)
+		xfree(a->block[b], FOREST_BLOCK_SIZE * a->element_size);
+	if (0 != a->blocks_alloced)
+		xfree(a->block, a->blocks_alloced * sizeof(char *));
+	arena_init(a, a->element_size);
+}
+
+static inline Parse_set *get_set(const extractor_t *pex, Pset_index i)
+{
+	return arena_element(&pex->sets, i);
+}
+
+static inline Parse_choice *get_choice(const extractor_t *pex, Pchoice_index i)
+{
+	return arena_element(&pex->choices, i);
+}
+
+static inline Disjunct *choice_md(const extractor_t *pex, const Parse_choice *pc)
+{
+	if (0 == pc->md) return NULL;
+	return (Disjunct *)&pex->disjuncts[pc->md - 1];
 }
 
 /**
- * Put this parse_choice into a given set.  The tail pointer is always
+ * The first thing we do is we build a data structure to represent the
+ * result of the entire parse search.  There will be a set of nodes
+ * built for each call to the count() function that returned a non-zero
+ * value, AND which is part of a valid linkage.  Each of these nodes
+ * represents a valid continuation, and contains pointers to two other
+ * sets (one for the left continuation and one for the right
+ * continuation).
+ */
+
+/**
+ * Put a new parse choice into the set s. The tail index is always
  * left pointing to the end of the list.
  */
-static void put_choice_in_set(Parse_set *s, Parse_choice *pc)
+static void record_choice(extractor_t *pex, Pset_index lset, Pset_index rset,
+                          Disjunct *md, unsigned int link, Pset_index s)
 {
-	if (s->first == NULL)
+	Pchoice_index ci = arena_alloc(&pex->choices);
+	Parse_choice *pc = get_choice(pex, ci);
+	Parse_set *set = get_set(pex, s);
+
+	pc->next = 0;
+	pc->set[0] = lset;
+	pc->set[1] = rset;
+	pc->link = link;
+	if (NULL == md)
 	{
-		s->first = pc;
+		pc->md = 0;
 	}
 	else
 	{
-		s->tail->next = pc;
+		size_t md_index = md - pex->disjuncts + 1;
+		assert(md_index <= MAX_CHOICE_MD, "Disjunct index overflow");
+		pc->md = md_index;
 	}
-	s->tail = pc;
-	pc->next = NULL;
-}
 
-static void record_choice(
-    Parse_set *lset, Connector * llc, Connector * lrc,
-    Parse_set *rset, Connector * rlc, Connector * rrc,
-    Disjunct *ld, Disjunct *md, Disjunct *rd, Parse_set *s)
-{
-	put_choice_in_set(s, make_choice(lset, llc, lrc,
-	                                 rset, rlc, rrc,
-	                                 ld, md, rd));
+	if (0 == set->first)
+		set->first = ci;
+	else
+		get_choice(pex, set->tail)->next = ci;
+	set->tail = ci;
 }
 
 /**
  * Allocate the parse info struct
  *
- * A piecewise exponential function determines the size of the hash
- * table.  Probably should make use of the actual number of disjuncts,
- * rather than just the number of words.
+ * A piecewise exponential function determines the initial size of the
+ * hash table. It is doubled as the number of sets grows.
  */
 extractor_t * extractor_new(int nwords, unsigned int ranstat)
 {
@@ -163,6 +233,8 @@ extractor_t * extractor_new(int nwords, unsigned int ranstat)
 	pex = (extractor_t *) xalloc(sizeof(extractor_t));
 	memset(pex, 0, sizeof(extractor_t));
 	pex->rand_state = ranstat;
+	arena_init(&pex->sets, sizeof(Parse_set));
+	arena_init(&pex->choices, sizeof(Parse_choice));
 
 	/* Alloc the x_table */
 	if (nwords >= 10) {
@@ -176,36 +248,34 @@ extractor_t * extractor_new(int nwords, unsigned int ranstat)
 	pex->x_table_size = (1 << log2_table_size);
 
 	/*printf("Allocating x_table of size %d\n", x_table_size);*/
-	pex->x_table = (Pset_bucket**) xalloc(pex->x_table_size * sizeof(Pset_bucket*));
-	memset(pex->x_table, 0, pex->x_table_size * sizeof(Pset_bucket*));
+	pex->x_table = (Pset_index *) xalloc(pex->x_table_size * sizeof(Pset_index));
+	memset(pex->x_table, 0, pex->x_table_size * sizeof(Pset_index));
 
 	return pex;
 }
 
+static void free_kbest(Kbest *);
+
 /**
- * This is the function that should be used to free the set structure. Since
- * it's a dag, a recursive free function won't work.  Every time we create
- * a set element, we put it in the hash table, so this is OK.
+ * Free the extractor, including its parse sets. They are freed
+ * all at once, with their arenas.
  */
 void free_extractor(extractor_t * pex)
 {
-	unsigned int i;
-	Pset_bucket *t, *x;
 	if (!pex) return;
 
-	for (i=0; i<pex->x_table_size; i++)
+	if (NULL != pex->kbest)
 	{
-		for (t = pex->x_table[i]; t!= NULL; t=x)
-		{
-			x = t->next;
-			free_set(&t->set);
-			xfree((void *) t, sizeof(Pset_bucket));
-		}
+		for (size_t i = 0; i < pex->kbest_size; i++)
+			free_kbest(pex->kbest[i]);
+		xfree(pex->kbest, pex->kbest_size * sizeof(Kbest *));
 	}
-	pex->parse_set = NULL;
+	arena_free(&pex->sets);
+	arena_free(&pex->choices);
+	pex->parse_set = 0;
 
 	/*printf("Freeing x_table of size %d\n", x_table_size);*/
-	xfree((void *) pex->x_table, pex->x_table_size * sizeof(Pset_bucket*));
+	xfree((void *) pex->x_table, pex->x_table_size * sizeof(Pset_index));
 	pex->x_table_size = 0;
 	pex->x_table = NULL;
 
@@ -213,60 +283,84 @@ void free_extractor(extractor_t * pex)
 }
 
 /**
- * Returns the pointer to this info, NULL if not there.
+ * Returns the index of this info, 0 if not there.
  */
-static Pset_bucket * x_table_pointer(int lw, int rw,
+static Pset_index x_table_pointer(int lw, int rw,
                               Connector *le, Connector *re,
                               unsigned int null_count, extractor_t * pex)
 {
-	Pset_bucket *t;
-	t = pex->x_table[pair_hash(pex->x_table_size, lw, rw, le, re, null_count)];
-	for (; t != NULL; t = t->next) {
-		if ((t->set.lw == lw) && (t->set.rw == rw) &&
-		    (t->set.le == le) && (t->set.re == re) &&
-		    (t->set.null_count == null_count))  return t;
+	Pset_index si;
+	si = pex->x_table[pair_hash(pex->x_table_size, lw, rw, le, re, null_count)];
+	while (0 != si) {
+		Parse_set *t = get_set(pex, si);
+		if ((t->lw == lw) && (t->rw == rw) &&
+		    (t->le == le) && (t->re == re) &&
+		    (t->null_count == null_count))  return si;
+		si = t->next;
+	}
+	return 0;
+}
+
+/**
+ * Double the size of the x_table, and rehash its sets.
+ */
+static void x_table_grow(extractor_t * pex)
+{
+	xfree((void *) pex->x_table, pex->x_table_size * sizeof(Pset_index));
+	pex->log2_x_table_size++;
+	pex->x_table_size *= 2;
+	pex->x_table = (Pset_index *) xalloc(pex->x_table_size * sizeof(Pset_index));
+	memset(pex->x_table, 0, pex->x_table_size * sizeof(Pset_index));
+
+	for (Pset_index si = 1; si < pex->sets.num_elements; si++)
+	{
+		Parse_set *t = get_set(pex, si);
+		unsigned int h = pair_hash(pex->x_table_size, t->lw, t->rw,
+		                           t->le, t->re, t->null_count);
+		t->next = pex->x_table[h];
+		pex->x_table[h] = si;
 	}
-	return NULL;
 }
 
 /**
  * Stores the value in the x_table.  Assumes it's not already there.
  */
-static Pset_bucket * x_table_store(int lw, int rw,
-                                  Connector *le, Connector *re,
-                                  unsigned int null_count, extractor_t * pex)
+static Pset_index x_table_store(int lw, int rw,
+                                Connector *le, Connector *re,
+                                unsigned int null_count, extractor_t * pex)
 {
-	Pset_bucket *t, *n;
 	unsigned int h;
 
-	n = (Pset_bucket *) xalloc(sizeof(Pset_bucket));
-	n->set.lw = lw;
-	n->set.rw = rw;
-	n->set.null_count = null_count;
-	n->set.le = le;
-	n->set.re = re;
-	n->set.count = 0;
-	n->set.first = NULL;
-	n->set.tail = NULL;
+	if (pex->sets.num_elements > 2 * pex->x_table_size) x_table_grow(pex);
+
+	Pset_index si = arena_alloc(&pex->sets);
+	Parse_set *n = get_set(pex, si);
+	n->lw = lw;
+	n->rw = rw;
+	n->null_count = null_count;
+	n->le = le;
+	n->re = re;
+	n->count = 0;
+	n->first = 0;
+	n->tail = 0;
 
 	h = pair_hash(pex->x_table_size, lw, rw, le, re, null_count);
-	t = pex->x_table[h];
-	n->next = t;
-	pex->x_table[h] = n;
-	return n;
+	n->next = pex->x_table[h];
+	pex->x_table[h] = si;
+	return si;
 }
 
 /** Create a bogus parse set that only holds lw, rw. */
-static Parse_set* dummy_set(int lw, int rw,
+static Pset_index dummy_set(int lw, int rw,
                             unsigned int null_count, extractor_t * pex)
 {
-	Pset_bucket *dummy;
+	Pset_index dummy;
 	dummy = x_table_pointer(lw, rw, NULL, NULL, null_count, pex);
-	if (dummy) return &dummy->set;
+	if (dummy) return dummy;
 
 	dummy = x_table_store(lw, rw, NULL, NULL, null_count, pex);
-	dummy->set.count = 1;
-	return &dummy->set;
+	get_set(pex, dummy)->count = 1;
+	return dummy;
 }
 
 #ifdef FINISH_THIS_IDEA_MAYBE_LATER
@@ -321,57 +415,58 @@ static Match_node* sort_matchlist(Match_node* mlist)
  * parse structures.
  */
 static
-Parse_set * mk_parse_set(Word* words, fast_matcher_t *mchxt,
+Pset_index mk_parse_set(Word* words, fast_matcher_t *mchxt,
                  count_context_t * ctxt,
                  Disjunct *ld, Disjunct *rd, int lw, int rw,
                  Connector *le, Connector *re, unsigned int null_count,
                  extractor_t * pex, bool islands_ok)
 {
 	int start_word, end_word, w;
-	Pset_bucket *xt;
-	Count_bin * count;
+	Pset_index xi;
+	Parse_set *xt;
+	s64 count;
 
 	assert(null_count < 0x7fff, "mk_parse_set() called with null_count < 0.");
 
 	count = table_lookup(ctxt, lw, rw, le, re, null_count);
 
 	/* If there's no counter, then there's no way to parse. */
-	if (NULL == count) return NULL;
-	if (hist_total(count) == 0) return NULL;
+	if (count == 0) return 0;
 
-	xt = x_table_pointer(lw, rw, le, re, null_count, pex);
+	xi = x_table_pointer(lw, rw, le, re, null_count, pex);
 
 	/* Perhaps we've already computed it; if so, return it. */
-	if (xt != NULL) return &xt->set;
+	if (xi != 0) return xi;
 
 	/* Start it out with the empty set of parse choices. */
 	/* This entry must be updated before we return. */
-	xt = x_table_store(lw, rw, le, re, null_count, pex);
+	xi = x_table_store(lw, rw, le, re, null_count, pex);
+	xt = get_set(pex, xi); /* The arena elements never move */
 
 	/* The count we previously computed; its non-zero. */
-	xt->set.count = hist_total(count);
+	xt->count = count;
 
 #define NUM_PARSES 4
-	// xt->set.cost_cutoff = hist_cost_cutoff(count, NUM_PARSES);
-	// xt->set.cut_count = hist_cut_total(count, NUM_PARSES);
+	// xt->cost_cutoff = hist_cost_cutoff(count, NUM_PARSES);
+	// xt->cut_count = hist_cut_total(count, NUM_PARSES);
 
-	RECOUNT({xt->set.recount = 1;})
+	RECOUNT({xt->recount = 1;})
 
 	/* If the two words are next to each other, the count == 1 */
-	if (lw + 1 == rw) return &xt->set;
+	if (lw + 1 == rw) return xi;
 
 	/* The left and right connectors are null, but the two words are
 	 * NOT next to each-other.  */
 	if ((le == NULL) && (re == NULL))
 	{
-		Parse_set* pset;
-		Parse_set* dummy;
+		Pset_index pset;
+		Pset_index dummy;
 		Disjunct* dis;
 
-		if (!islands_ok && (lw != -1)) return &xt->set;
-		if (null_count == 0) return &xt->set;
+		if (!islands_ok && (lw != -1)) return xi;
+		if (null_count == 0) return xi;
 
-		RECOUNT({xt->set.recount = 0;})
+		RECOUNT({xt->recount = 0;})
 
 		w = lw + 1;
 		for (int opt = 0; opt <= !!words[w].optional; opt++)
@@ -384,27 +479,23 @@ Parse_set * mk_parse_set(Word* words, fast_matcher_t *mchxt,
 					pset = mk_parse_set(words, mchxt, ctxt,
 											  dis, NULL, w, rw, dis->right, NULL,
 											  null_count-1, pex, islands_ok);
-					if (pset == NULL) continue;
+					if (pset == 0) continue;
 					dummy = dummy_set(lw, w, null_count-1, pex);
-					record_choice(dummy, NULL, NULL,
-									  pset,  NULL, NULL,
-									  NULL, NULL, NULL, &xt->set);
-					RECOUNT({xt->set.recount += pset->recount;})
+					record_choice(pex, dummy, pset, dis, 0, xi);
+					RECOUNT({xt->recount += get_set(pex, pset)->recount;})
 				}
 			}
 			pset = mk_parse_set(words, mchxt, ctxt,
 									  NULL, NULL, w, rw, NULL, NULL,
 									  null_count-1, pex, islands_ok);
-			if (pset != NULL)
+			if (pset != 0)
 			{
 				dummy = dummy_set(lw, w, null_count-1, pex);
-				record_choice(dummy, NULL, NULL,
-								  pset,  NULL, NULL,
-								  NULL, NULL, NULL, &xt->set);
-				RECOUNT({xt->set.recount += pset->recount;})
+				record_choice(pex, dummy, pset, NULL, 0, xi);
+				RECOUNT({xt->recount += get_set(pex, pset)->recount;})
 			}
 		}
-		return &xt->set;
+		return xi;
 	}
 
 	if (le == NULL)
@@ -429,9 +520,9 @@ Parse_set * mk_parse_set(Word* words, fast_matcher_t *mchxt,
 	 * will be able to optimize the loop over "null_count".  Without
 	 * this check, GCC thinks this loop may be an infinite loop and
 	 * it may omit some optimizations. */
-	if (UINT_MAX == null_count) return NULL;
+	if (UINT_MAX == null_count) return 0;
 
-	RECOUNT({xt->set.recount = 0;})
+	RECOUNT({xt->recount = 0;})
 	for (w = start_word; w < end_word; w++)
 	{
 		size_t mlb, mle;
@@ -441,13 +532,14 @@ Parse_set * mk_parse_set(Word* words, fast_matcher_t *mchxt,
 		{
 			unsigned int lnull_count, rnull_count;
 			Disjunct *d = get_match_list_element(mchxt, mle);
-			bool Lmatch = d->match_left;
-			bool Rmatch = d->match_right;
+			uint8_t match_flags = get_match_flags(mchxt, mle);
+			bool Lmatch = match_flags & MATCH_LEFT;
+			bool Rmatch = match_flags & MATCH_RIGHT;
 
 			for (lnull_count = 0; lnull_count <= null_count; lnull_count++)
 			{
 				int i, j;
-				Parse_set *ls[4], *rs[4];
+				Pset_index ls[4], rs[4];
 
 				/* Here, lnull_count and rnull_count are the null_counts
 				 * we're assigning to those parts respectively. */
@@ -456,21 +548,21 @@ Parse_set * mk_parse_set(Word* words, fast_matcher_t *mchxt,
 				/* Now, we determine if (based on table only) we can see that
 				   the current range is not parsable. */
 
-				for (i=0; i<4; i++) { ls[i] = rs[i] = NULL; }
+				for (i=0; i<4; i++) { ls[i] = rs[i] = 0; }
 				if (Lmatch)
 				{
 					ls[0] = mk_parse_set(words, mchxt, ctxt,
-					             ld, d, lw, w, le->next, d->left->next,
+					             ld, d, lw, w, connector_next(le), connector_next(d->left),
 					             lnull_count, pex, islands_ok);
 
 					if (le->multi)
 						ls[1] = mk_parse_set(words, mchxt, ctxt,
-						              ld, d, lw, w, le, d->left->next,
+						              ld, d, lw, w, le, connector_next(d->left),
 						              lnull_count, pex, islands_ok);
 
 					if (d->left->multi)
 						ls[2] = mk_parse_set(words, mchxt, ctxt,
-						              ld, d, lw, w, le->next, d->left,
+						              ld, d, lw, w, connector_next(le), d->left,
 						              lnull_count, pex, islands_ok);
 
 					if (le->multi && d->left->multi)
@@ -482,17 +574,17 @@ Parse_set * mk_parse_set(Word* words, fast_matcher_t *mchxt,
 				if (Rmatch)
 				{
 					rs[0] = mk_parse_set(words, mchxt, ctxt,
-					                 d, rd, w, rw, d->right->next, re->next,
+					                 d, rd, w, rw, connector_next(d->right), connector_next(re),
 					                 rnull_count, pex, islands_ok);
 
 					if (d->right->multi)
 						rs[1] = mk_parse_set(words, mchxt, ctxt,
-					                 d, rd, w, rw, d->right, re->next,
+					                 d, rd, w, rw, d->right, connector_next(re),
 						              rnull_count, pex, islands_ok);
 
 					if (re->multi)
 						rs[2] = mk_parse_set(words, mchxt, ctxt,
-						              d, rd, w, rw, d->right->next, re,
+						              d, rd, w, rw, connector_next(d->right), re,
 						              rnull_count, pex, islands_ok);
 
 					if (d->right->multi && re->multi)
@@ -505,58 +597,51 @@ Parse_set * mk_parse_set(Word* words, fast_matcher_t *mchxt,
 				{
 					/* This ordering is probably not consistent with that
 					 * needed to use list_links. (??) */
-					if (ls[i] == NULL) continue;
+					if (ls[i] == 0) continue;
 					for (j=0; j<4; j++)
 					{
-						if (rs[j] == NULL) continue;
-						record_choice(ls[i], le, d->left,
-						              rs[j], d->right, re,
-						              ld, d, rd, &xt->set);
-						RECOUNT({xt->set.recount += ls[i]->recount * rs[j]->recount;})
+						if (rs[j] == 0) continue;
+						record_choice(pex, ls[i], rs[j], d,
+						              CHOICE_LINK_LEFT|CHOICE_LINK_RIGHT, xi);
+						RECOUNT({xt->recount += get_set(pex, ls[i])->recount * get_set(pex, rs[j])->recount;})
 					}
 				}
 
-				if (ls[0] != NULL || ls[1] != NULL || ls[2] != NULL || ls[3] != NULL)
+				if (ls[0] != 0 || ls[1] != 0 || ls[2] != 0 || ls[3] != 0)
 				{
 					/* Evaluate using the left match, but not the right */
-					Parse_set* rset = mk_parse_set(words, mchxt, ctxt,
+					Pset_index rset = mk_parse_set(words, mchxt, ctxt,
 					                        d, rd, w, rw, d->right, re,
 					                        rnull_count, pex, islands_ok);
-					if (rset != NULL)
+					if (rset != 0)
 					{
 						for (i=0; i<4; i++)
 						{
-							if (ls[i] == NULL) continue;
+							if (ls[i] == 0) continue;
 							/* this ordering is probably not consistent with
 							 * that needed to use list_links */
-							record_choice(ls[i], le, d->left,
-							              rset,  NULL /* d->right */,
-							              re,  /* the NULL indicates no link*/
-							              ld, d, rd, &xt->set);
-							RECOUNT({xt->set.recount += ls[i]->recount * rset->recount;})
+							record_choice(pex, ls[i], rset, d, CHOICE_LINK_LEFT, xi);
+							RECOUNT({xt->recount += get_set(pex, ls[i])->recount * get_set(pex, rset)->recount;})
 						}
 					}
 				}
-				if ((le == NULL) && (rs[0] != NULL ||
-				     rs[1] != NULL || rs[2] != NULL || rs[3] != NULL))
+				if ((le == NULL) && (rs[0] != 0 ||
+				     rs[1] != 0 || rs[2] != 0 || rs[3] != 0))
 				{
 					/* Evaluate using the right match, but not the left */
-					Parse_set* lset = mk_parse_set(words, mchxt, ctxt,
+					Pset_index lset = mk_parse_set(words, mchxt, ctxt,
 					                        ld, d, lw, w, le, d->left,
 					                        lnull_count, pex, islands_ok);
 
-					if (lset != NULL)
+					if (lset != 0)
 					{
 						for (j=0; j<4; j++)
 						{
-							if (rs[j] == NULL) continue;
+							if (rs[j] == 0) continue;
 							/* this ordering is probably not consistent with
 							 * that needed to use list_links */
-							record_choice(lset, NULL /* le */,
-							                    d->left,  /* NULL indicates no link */
-							              rs[j], d->right, re,
-							              ld, d, rd, &xt->set);
-							RECOUNT({xt->set.recount += lset->recount * rs[j]->recount;})
+							record_choice(pex, lset, rs[j], d, CHOICE_LINK_RIGHT, xi);
+							RECOUNT({xt->recount += get_set(pex, lset)->recount * get_set(pex, rs[j])->recount;})
 						}
 					}
 				}
@@ -564,22 +649,23 @@ Parse_set * mk_parse_set(Word* words, fast_matcher_t *mchxt,
 		}
 		pop_match_list(mchxt, mlb);
 	}
-	return &xt->set;
+	return xi;
 }
 
 /**
  * Return TRUE if and only if an overflow in the number of parses
  * occurred. Use a 64-bit int for counting.
  */
-static bool set_node_overflowed(Parse_set *set)
+static bool set_node_overflowed(extractor_t * pex, Parse_set *set)
 {
-	Parse_choice *pc;
+	Pchoice_index ci;
 	s64 n = 0;
-	if (set == NULL || set->first == NULL) return false;
+	if (set->first == 0) return false;
 
-	for (pc = set->first; pc != NULL; pc = pc->next)
+	for (ci = set->first; ci != 0; ci = get_choice(pex, ci)->next)
 	{
-		n  += pc->set[0]->count * pc->set[1]->count;
+		Parse_choice *pc = get_choice(pex, ci);
+		n  += get_set(pex, pc->set[0])->count * get_set(pex, pc->set[1])->count;
 		if (PARSE_NUM_OVERFLOW < n) return true;
 	}
 	return false;
@@ -587,16 +673,9 @@ static bool set_node_overflowed(Parse_set *set)
 
 static bool set_overflowed(extractor_t * pex)
 {
-	unsigned int i;
-
-	assert(pex->x_table != NULL, "called set_overflowed with x_table==NULL");
-	for (i=0; i<pex->x_table_size; i++)
+	for (Pset_index si = 1; si < pex->sets.num_elements; si++)
 	{
-		Pset_bucket *t;
-		for (t = pex->x_table[i]; t != NULL; t = t->next)
-		{
-			if (set_node_overflowed(&t->set)) return true;
-		}
+		if (set_node_overflowed(pex, get_set(pex, si))) return true;
 	}
 	return false;
 }
@@ -621,6 +700,7 @@ bool build_parse_set(extractor_t* pex, Sentence sent,
                     count_context_t *ctxt,
                     unsigned int null_count, Parse_Options opts)
 {
+	pex->disjuncts = sent->disjunct_store->disjunct;
 	pex->parse_set =
 		mk_parse_set(sent->word, mchxt, ctxt,
 		             NULL, NULL, -1, sent->length, NULL, NULL, null_count+1,
@@ -630,6 +710,247 @@ bool build_parse_set(extractor_t* pex, Sentence sent,
 	return set_overflowed(pex);
 }
 
+/* ============================================================= */
+/* The best linkage.
+ *
+ * When only the best linkage is needed, a parse set is built for it
+ * alone, using the costs that do_parse_best() has found: For each
+ * subproblem, only the parse choice of the least cost is made, so each
+ * set has a single choice and a count of 1. The costs of the choices
+ * are computed as in do_count(), and among choices of equal cost, the
+ * first one (in the order of mk_parse_set()) is made.
+ */
+
+/* A parse choice, see record_choice(). */
+typedef struct
+{
+	Linkage_cost cost;
+	int w;
+	Disjunct *d;
+	Connector *le[2], *re[2];      /* The left and right subproblems */
+	unsigned int null_count[2];
+	unsigned int link;             /* The links used (CHOICE_LINK_*) */
+} Best_choice;
+
+static void consider_choice(Best_choice *best, bool *found,
+                            const Best_choice *c)
+{
+	if (*found && !linkage_cost_less(&c->cost, &best->cost)) return;
+	*best = *c;
+	*found = true;
+}
+
+static void linkage_cost_sum(Linkage_cost *sum, const Linkage_cost *a,
+                             double cost, const Linkage_cost *b)
+{
+	sum->disjunct_cost = a->disjunct_cost + cost + b->disjunct_cost;
+	sum->link_cost = a->link_cost + b->link_cost;
+}
+
+/**
+ * Find the least cost way to link connector lc of word lw to connector
+ * rc of word rw, i.e. the best of the up to 4 subproblems of (lw, rw)
+ * that remain, depending on whether lc and rc are multi-connectors.
+ * The cost includes the cost of the link.
+ */
+static bool best_link(count_context_t *ctxt, int lw, int rw,
+                      Connector *lc, Connector *rc, unsigned int null_count,
+                      Linkage_cost *cost, Connector **le, Connector **re)
+{
+	bool found = false;
+
+	for (int lmulti = 0; lmulti <= lc->multi; lmulti++)
+	{
+		for (int rmulti = 0; rmulti <= rc->multi; rmulti++)
+		{
+			Connector *e1 = lmulti ? lc : connector_next(lc);
+			Connector *e2 = rmulti ? rc : connector_next(rc);
+			Linkage_cost c;
+
+			if (!table_lookup_cost(ctxt, lw, rw, e1, e2, null_count, &c))
+				continue;
+			if (found && !linkage_cost_less(&c, cost)) continue;
+			*cost = c;
+			*le = e1;
+			*re = e2;
+			found = true;
+		}
+	}
+
+	if (found) cost->link_cost += rw - lw - 1;
+	return found;
+}
+
+/**
+ * Like mk_parse_set(), but for the best linkage alone.
+ */
+static Pset_index
+mk_best_parse_set(Word* words, fast_matcher_t *mchxt,
+                  count_context_t * ctxt,
+                  Disjunct *ld, Disjunct *rd, int lw, int rw,
+                  Connector *le, Connector *re, unsigned int null_count,
+                  extractor_t * pex, bool islands_ok)
+{
+	Pset_index xi;
+	Linkage_cost cost;
+	Best_choice best, c;
+	bool found = false;
+
+	if (!table_lookup_cost(ctxt, lw, rw, le, re, null_count, &cost))
+		return 0;
+
+	xi = x_table_pointer(lw, rw, le, re, null_count, pex);
+	if (xi != 0) return xi;
+
+	xi = x_table_store(lw, rw, le, re, null_count, pex);
+	get_set(pex, xi)->count = 1;
+
+	if (lw + 1 == rw) return xi;
+
+	memset(&best, 0, sizeof(best));
+
+	if ((le == NULL) && (re == NULL))
+	{
+		if (!islands_ok && (lw != -1)) return xi;
+		if (null_count == 0) return xi;
+
+		/* Word w is either the first word of an island, or a null word. */
+		int w = lw + 1;
+		for (unsigned int opt = 0; opt <= !!words[w].optional; opt++)
+		{
+			memset(&c, 0, sizeof(c));
+			c.w = w;
+			c.null_count[0] = c.null_count[1] = null_count + opt - 1;
+			for (c.d = words[w].d; c.d != NULL; c.d = c.d->next)
+			{
+				if (c.d->left != NULL) continue;
+				if (!table_lookup_cost(ctxt, w, rw, c.d->right, NULL,
+				                       c.null_count[1], &cost))
+					continue;
+				c.le[1] = c.d->right;
+				c.cost = cost;
+				c.cost.disjunct_cost += c.d->cost;
+				consider_choice(&best, &found, &c);
+			}
+			if (table_lookup_cost(ctxt, w, rw, NULL, NULL, c.null_count[1], &c.cost))
+			{
+				c.le[1] = NULL;
+				consider_choice(&best, &found, &c);
+			}
+		}
+		if (!found) return xi;
+
+		Pset_index pset = mk_best_parse_set(words, mchxt, ctxt,
+		                                    best.d, NULL, w, rw, best.le[1], NULL,
+		                                    best.null_count[1], pex, islands_ok);
+		Pset_index dummy = dummy_set(lw, w, best.null_count[0], pex);
+		record_choice(pex, dummy, pset, best.d, 0, xi);
+		return xi;
+	}
+
+	int start_word = (le == NULL) ? lw + 1 : le->nearest_word;
+	int end_word = (re == NULL) ? rw : re->nearest_word + 1;
+
+	for (int w = start_word; w < end_word; w++)
+	{
+		size_t mlb, mle;
+		mle = mlb = form_match_list(mchxt, w, le, lw, re, rw);
+		for (; get_match_list_element(mchxt, mle) != NULL; mle++)
+		{
+			Disjunct *d = get_match_list_element(mchxt, mle);
+			uint8_t match_flags = get_match_flags(mchxt, mle);
+			bool Lmatch = match_flags & MATCH_LEFT;
+			bool Rmatch = match_flags & MATCH_RIGHT;
+
+			c.w = w;
+			c.d = d;
+			for (unsigned int lnull_count = 0; lnull_count <= null_count; lnull_count++)
+			{
+				Linkage_cost lcost, rcost;
+				Connector *lle, *lre, *rle, *rre;
+
+				c.null_count[0] = lnull_count;
+				c.null_count[1] = null_count - lnull_count;
+
+				bool lfound = Lmatch &&
+					best_link(ctxt, lw, w, le, d->left, c.null_count[0],
+					          &lcost, &lle, &lre);
+				bool rfound = Rmatch &&
+					best_link(ctxt, w, rw, d->right, re, c.null_count[1],
+					          &rcost, &rle, &rre);
+
+				if (lfound && rfound)
+				{
+					/* Links on both sides */
+					linkage_cost_sum(&c.cost, &lcost, d->cost, &rcost);
+					c.le[0] = lle; c.re[0] = lre;
+					c.le[1] = rle; c.re[1] = rre;
+					c.link = CHOICE_LINK_LEFT|CHOICE_LINK_RIGHT;
+					consider_choice(&best, &found, &c);
+				}
+
+				if (lfound &&
+				    table_lookup_cost(ctxt, w, rw, d->right, re,
+				                      c.null_count[1], &cost))
+				{
+					/* The left link, but not the right one */
+					linkage_cost_sum(&c.cost, &lcost, d->cost, &cost);
+					c.le[0] = lle; c.re[0] = lre;
+					c.le[1] = d->right; c.re[1] = re;
+					c.link = CHOICE_LINK_LEFT;
+					consider_choice(&best, &found, &c);
+				}
+
+				if (rfound && (le == NULL) &&
+				    table_lookup_cost(ctxt, lw, w, le, d->left,
+				                      c.null_count[0], &cost))
+				{
+					/* The right link, but not the left one */
+					linkage_cost_sum(&c.cost, &rcost, d->cost, &cost);
+					c.le[0] = le; c.re[0] = d->left;
+					c.le[1] = rle; c.re[1] = rre;
+					c.link = CHOICE_LINK_RIGHT;
+					consider_choice(&best, &found, &c);
+				}
+			}
+		}
+		pop_match_list(mchxt, mlb);
+	}
+	if (!found) return xi;
+
+	Pset_index lset = mk_best_parse_set(words, mchxt, ctxt,
+	                                    ld, best.d, lw, best.w,
+	                                    best.le[0], best.re[0],
+	                                    best.null_count[0], pex, islands_ok);
+	Pset_index rset = mk_best_parse_set(words, mchxt, ctxt,
+	                                    best.d, rd, best.w, rw,
+	                                    best.le[1], best.re[1],
+	                                    best.null_count[1], pex, islands_ok);
+	assert((0 != lset) && (0 != rset), "No best parse set");
+	record_choice(pex, lset, rset, best.d, best.link, xi);
+
+	return xi;
+}
+
+/**
+ * Build the parse set of the best linkage, see mk_best_parse_set().
+ * This assumes that do_parse_best() has been run. Return false if
+ * there is no linkage.
+ */
+bool build_best_parse_set(extractor_t* pex, Sentence sent,
+                          fast_matcher_t *mchxt,
+                          count_context_t *ctxt,
+                          unsigned int null_count, Parse_Options opts)
+{
+	pex->disjuncts = sent->disjunct_store->disjunct;
+	pex->parse_set =
+		mk_best_parse_set(sent->word, mchxt, ctxt,
+		                  NULL, NULL, -1, sent->length, NULL, NULL, null_count+1,
+		                  pex, opts->islands_ok);
+
+	return (0 != pex->parse_set);
+}
+
 // Cannot be static, also called by SAT-solver.
 void check_link_size(Linkage lkg)
 {
@@ -650,75 +971,355 @@ static void issue_link(Linkage lkg, Disjunct * ld, Disjunct * rd, Link * link)
 	lkg->chosen_disjuncts[link->rw] = rd;
 }
 
-static void issue_links_for_choice(Linkage lkg, Parse_choice *pc)
+/**
+ * Issue the links of the parse choice pc of the given set. ld and rd
+ * are the disjuncts of the left and right words of the set.
+ */
+static void issue_links_for_choice(const extractor_t *pex, Linkage lkg,
+                                   const Parse_set *set, const Parse_choice *pc,
+                                   Disjunct *ld, Disjunct *rd)
 {
-	if (pc->link[0].lc != NULL) { /* there is a link to generate */
-		issue_link(lkg, pc->ld, pc->md, &pc->link[0]);
+	Disjunct *md = choice_md(pex, pc);
+	int w = get_set(pex, pc->set[0])->rw;
+	Link link;
+
+	link.link_name = NULL;
+	if (pc->link & CHOICE_LINK_LEFT) { /* there is a link to generate */
+		link.lw = set->lw;
+		link.rw = w;
+		link.lc = set->le;
+		link.rc = md->left;
+		issue_link(lkg, ld, md, &link);
 	}
-	if (pc->link[1].lc != NULL) {
-		issue_link(lkg, pc->md, pc->rd, &pc->link[1]);
+	if (pc->link & CHOICE_LINK_RIGHT) {
+		link.lw = w;
+		link.rw = set->rw;
+		link.lc = md->right;
+		link.rc = set->re;
+		issue_link(lkg, md, rd, &link);
 	}
 }
 
-static void list_links(Linkage lkg, const Parse_set * set, int index)
+static void list_links(const extractor_t *pex, Linkage lkg, Pset_index si,
+                       int index, Disjunct *ld, Disjunct *rd)
 {
-	 Parse_choice *pc;
+	 const Parse_set *set = get_set(pex, si);
+	 const Parse_choice *pc = NULL;
+	 Pchoice_index ci;
 	 s64 n;
 
-	 if (set == NULL || set->first == NULL) return;
-	 for (pc = set->first; pc != NULL; pc = pc->next) {
-		  n = pc->set[0]->count * pc->set[1]->count;
+	 if (set->first == 0) return;
+	 for (ci = set->first; ci != 0; ci = pc->next) {
+		  pc = get_choice(pex, ci);
+		  n = get_set(pex, pc->set[0])->count * get_set(pex, pc->set[1])->count;
 		  if (index < n) break;
 		  index -= n;
 	 }
-	 assert(pc != NULL, "walked off the end in list_links");
-	 issue_links_for_choice(lkg, pc);
-	 list_links(lkg, pc->set[0], index % pc->set[0]->count);
-	 list_links(lkg, pc->set[1], index / pc->set[0]->count);
+	 assert(ci != 0, "walked off the end in list_links");
+	 issue_links_for_choice(pex, lkg, set, pc, ld, rd);
+
+	 Disjunct *md = choice_md(pex, pc);
+	 s64 count0 = get_set(pex, pc->set[0])->count;
+	 list_links(pex, lkg, pc->set[0], index % count0, ld, md);
+	 list_links(pex, lkg, pc->set[1], index / count0, md, rd);
 }
 
-static void list_random_links(Linkage lkg, extractor_t * pex, const Parse_set * set)
+static void list_random_links(Linkage lkg, extractor_t * pex, Pset_index si,
+                              Disjunct *ld, Disjunct *rd,
+                              unsigned int *rand_state)
 {
-	Parse_choice *pc;
+	const Parse_set *set = get_set(pex, si);
+	const Parse_choice *pc = NULL;
+	Pchoice_index ci;
 	int num_pc, new_index;
 
-	if (set == NULL || set->first == NULL) return;
+	if (set->first == 0) return;
 	num_pc = 0;
-	for (pc = set->first; pc != NULL; pc = pc->next) {
+	for (ci = set->first; ci != 0; ci = get_choice(pex, ci)->next) {
 		num_pc++;
 	}
 
-	new_index = rand_r(&pex->rand_state) % num_pc;
+	new_index = rand_r(rand_state) % num_pc;
 
 	num_pc = 0;
-	for (pc = set->first; pc != NULL; pc = pc->next) {
+	for (ci = set->first; ci != 0; ci = pc->next) {
+		pc = get_choice(pex, ci);
 		if (new_index == num_pc) break;
 		num_pc++;
 	}
 
-	assert(pc != NULL, "Couldn't get a random parse choice");
-	issue_links_for_choice(lkg, pc);
-	list_random_links(lkg, pex, pc->set[0]);
-	list_random_links(lkg, pex, pc->set[1]);
+	assert(ci != 0, "Couldn't get a random parse choice");
+	issue_links_for_choice(pex, lkg, set, pc, ld, rd);
+
+	Disjunct *md = choice_md(pex, pc);
+	list_random_links(lkg, pex, pc->set[0], ld, md, rand_state);
+	list_random_links(lkg, pex, pc->set[1], md, rd, rand_state);
 }
 
 /**
  * Generate the list of all links of the index'th parsing of the
  * sentence.  For this to work, you must have already called parse, and
  * already built the whole_set.
+ *
+ * With a repeatable random state (0), a random linkage depends only on
+ * its index, and the extractor is only read, so the linkages can be
+ * extracted concurrently.
  */
 void extract_links(extractor_t * pex, Linkage lkg)
 {
 	int index = lkg->lifo.index;
+	if (0 == pex->parse_set) return;
 	if (index < 0)
 	{
-		bool repeatable = false;
-		if (0 == pex->rand_state) repeatable = true;
-		if (repeatable) pex->rand_state = index;
-		list_random_links(lkg, pex, pex->parse_set);
-		if (repeatable) pex->rand_state = 0;
+		if (0 == pex->rand_state)
+		{
+			unsigned int rand_state = index;
+			list_random_links(lkg, pex, pex->parse_set, NULL, NULL, &rand_state);
+		}
+		else
+		{
+			list_random_links(lkg, pex, pex->parse_set, NULL, NULL, &pex->rand_state);
+		}
 	}
 	else {
-		list_links(lkg, pex->parse_set, index);
+		list_links(pex, lkg, pex->parse_set, index, NULL, NULL);
 	}
 }
+
+/* ============================================================= */
+/* The k best linkages.
+ *
+ * The parse set is a shared forest (a hypergraph): each parse choice
+ * combines one derivation of set[0] with one of set[1]. The linkages
+ * are enumerated in the order of their cost (Linkage_cost) lazily, as
+ * in "Better k-best parsing" (Huang and Chiang, 2005, algorithm 3):
+ * The best derivations of each set are computed only as far as they
+ * are needed, from a heap of candidates. A candidate is a parse choice
+ * with the index of a derivation of each of its two sets. When the
+ * j'th derivation of a set is taken from its heap, its successors
+ * (the same choice with the next derivation of either set) become
+ * candidates. So finding the k best linkages takes time that depends
+ * on k and on the size of the parse set, but not on the number of
+ * linkages, which may even overflow.
+ */
+
+/* A derivation of a set: a parse choice and the indices of the
+ * derivations of its sets. The derivation of a set that has no parse
+ * choices has pc == 0. */
+typedef struct
+{
+	Linkage_cost cost;
+	Pchoice_index pc;
+	unsigned int j[2];
+} Kbest_deriv;
+
+struct Kbest_struct
+{
+	Kbest_deriv *deriv;       /* The best derivations, in cost order */
+	size_t num_deriv;
+	size_t deriv_alloced;
+	Kbest_deriv *cand;        /* The candidates (a binary min-heap) */
+	size_t num_cand;
+	size_t cand_alloced;
+};
+
+static void free_kbest(Kbest *kb)
+{
+	if (NULL == kb) return;
+	xfree(kb->deriv, kb->deriv_alloced * sizeof(Kbest_deriv));
+	xfree(kb->cand, kb->cand_alloced * sizeof(Kbest_deriv));
+	xfree(kb, sizeof(Kbest));
+}
+
+static void kbest_grow(Kbest_deriv **a, size_t *alloced)
+{
+	size_t new_alloced = (0 == *alloced) ? 4 : 2 * *alloced;
+	Kbest_deriv *na = xalloc(new_alloced * sizeof(Kbest_deriv));
+
+	if (0 != *alloced)
+	{
+		memcpy(na, *a, *alloced * sizeof(Kbest_deriv));
+		xfree(*a, *alloced * sizeof(Kbest_deriv));
+	}
+	*a = na;
+	*alloced = new_alloced;
+}
+
+static void cand_push(Kbest *kb, const Kbest_deriv *c)
+{
+	if (kb->num_cand == kb->cand_alloced)
+		kbest_grow(&kb->cand, &kb->cand_alloced);
+
+	size_t i = kb->num_cand++;
+	while (0 < i)
+	{
+		size_t parent = (i - 1) / 2;
+		if (!linkage_cost_less(&c->cost, &kb->cand[parent].cost)) break;
+		kb->cand[i] = kb->cand[parent];
+		i = parent;
+	}
+	kb->cand[i] = *c;
+}
+
+static void cand_pop(Kbest *kb, Kbest_deriv *top)
+{
+	*top = kb->cand[0];
+
+	Kbest_deriv last = kb->cand[--kb->num_cand];
+	size_t n = kb->num_cand;
+	size_t i = 0;
+	while (true)
+	{
+		size_t child = 2 * i + 1;
+		if (child >= n) break;
+		if ((child + 1 < n) &&
+		    linkage_cost_less(&kb->cand[child + 1].cost, &kb->cand[child].cost))
+			child++;
+		if (!linkage_cost_less(&kb->cand[child].cost, &last.cost)) break;
+		kb->cand[i] = kb->cand[child];
+		i = child;
+	}
+	if (0 < n) kb->cand[i] = last;
+}
+
+/**
+ * The cost that the parse choice pc of the given set itself adds to
+ * the cost of the derivations of its sets: the cost of the disjunct of
+ * its middle word, and the costs of its links, as in linkage_score().
+ */
+static void choice_cost(const extractor_t *pex, const Parse_set *set,
+                        const Parse_choice *pc, Linkage_cost *cost)
+{
+	Disjunct *md = choice_md(pex, pc);
+	int w = get_set(pex, pc->set[0])->rw;
+
+	cost->disjunct_cost = (NULL == md) ? 0.0 : md->cost;
+	cost->link_cost = 0;
+	if (pc->link & CHOICE_LINK_LEFT)
+		cost->link_cost += w - set->lw - 1;
+	if (pc->link & CHOICE_LINK_RIGHT)
+		cost->link_cost += set->rw - w - 1;
+}
+
+static const Kbest_deriv *kth_best(extractor_t *, Pset_index, size_t);
+
+/**
+ * Make a candidate of the parse choice ci of the set with the given
+ * derivations of its sets, if they exist.
+ */
+static void push_candidate(extractor_t *pex, Kbest *kb, const Parse_set *set,
+                           Pchoice_index ci, unsigned int j0, unsigned int j1)
+{
+	const Parse_choice *pc = get_choice(pex, ci);
+
+	const Kbest_deriv *d0 = kth_best(pex, pc->set[0], j0);
+	if (NULL == d0) return;
+	Linkage_cost cost0 = d0->cost;
+
+	const Kbest_deriv *d1 = kth_best(pex, pc->set[1], j1);
+	if (NULL == d1) return;
+
+	Kbest_deriv c;
+	choice_cost(pex, set, pc, &c.cost);
+	c.cost.disjunct_cost += cost0.disjunct_cost + d1->cost.disjunct_cost;
+	c.cost.link_cost += cost0.link_cost + d1->cost.link_cost;
+	c.pc = ci;
+	c.j[0] = j0;
+	c.j[1] = j1;
+	cand_push(kb, &c);
+}
+
+/**
+ * Return the k'th best derivation of the set si, or NULL if it has
+ * fewer derivations.
+ *
+ * The sets of a parse choice span fewer words than the set of the
+ * choice, so the recursion ends, and the derivations of the set are not
+ * reallocated by it.
+ */
+static const Kbest_deriv *kth_best(extractor_t *pex, Pset_index si, size_t k)
+{
+	const Parse_set *set = get_set(pex, si);
+
+	if (NULL == pex->kbest)
+	{
+		/* The parse set is complete, so its size is known. */
+		pex->kbest_size = pex->sets.num_elements;
+		pex->kbest = xalloc(pex->kbest_size * sizeof(Kbest *));
+		memset(pex->kbest, 0, pex->kbest_size * sizeof(Kbest *));
+	}
+
+	Kbest *kb = pex->kbest[si];
+	if (NULL == kb)
+	{
+		kb = pex->kbest[si] = xalloc(sizeof(Kbest));
+		memset(kb, 0, sizeof(Kbest));
+
+		if (0 == set->first)
+		{
+			kbest_grow(&kb->deriv, &kb->deriv_alloced);
+			memset(&kb->deriv[0], 0, sizeof(Kbest_deriv));
+			kb->num_deriv = 1;
+		}
+		else
+		{
+			for (Pchoice_index ci = set->first; ci != 0;
+			     ci = get_choice(pex, ci)->next)
+				push_candidate(pex, kb, set, ci, 0, 0);
+		}
+	}
+
+	while (kb->num_deriv <= k)
+	{
+		if (0 < kb->num_deriv)
+		{
+			/* The successors of the last derivation. Each pair of
+			 * indices has a single predecessor, so there are no
+			 * duplicate candidates. */
+			Kbest_deriv last = kb->deriv[kb->num_deriv - 1];
+			if (0 != last.pc)
+			{
+				if (0 == last.j[1])
+					push_candidate(pex, kb, set, last.pc, last.j[0] + 1, 0);
+				push_candidate(pex, kb, set, last.pc, last.j[0], last.j[1] + 1);
+			}
+		}
+		if (0 == kb->num_cand) break;
+
+		if (kb->num_deriv == kb->deriv_alloced)
+			kbest_grow(&kb->deriv, &kb->deriv_alloced);
+		cand_pop(kb, &kb->deriv[kb->num_deriv++]);
+	}
+
+	return (k < kb->num_deriv) ? &kb->deriv[k] : NULL;
+}
+
+static void list_kbest_links(extractor_t *pex, Linkage lkg, Pset_index si,
+                             size_t k, Disjunct *ld, Disjunct *rd)
+{
+	const Kbest_deriv *d = kth_best(pex, si, k);
+
+	assert(NULL != d, "No derivation %zu in list_kbest_links", k);
+	if (0 == d->pc) return;
+
+	const Parse_choice *pc = get_choice(pex, d->pc);
+	unsigned int j0 = d->j[0], j1 = d->j[1];
+	Disjunct *md = choice_md(pex, pc);
+	issue_links_for_choice(pex, lkg, get_set(pex, si), pc, ld, rd);
+	list_kbest_links(pex, lkg, pc->set[0], j0, ld, md);
+	list_kbest_links(pex, lkg, pc->set[1], j1, md, rd);
+}
+
+/**
+ * Generate the links of the lkg->lifo.index'th best linkage, in cost
+ * order (see kth_best()). Return false if there is no such linkage.
+ */
+bool extract_kbest_links(extractor_t * pex, Linkage lkg)
+{
+	if (0 == pex->parse_set) return false;
+
+	size_t k = lkg->lifo.index;
+	if (NULL == kth_best(pex, pex->parse_set, k)) return false;
+	list_kbest_links(pex, lkg, pex->parse_set, k, NULL, NULL);
+	return true;
+}
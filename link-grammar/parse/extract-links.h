@@ -24,7 +24,11 @@ void free_extractor(extractor_t*);
 bool build_parse_set(extractor_t*, Sentence,
                      fast_matcher_t*, count_context_t*,
                      unsigned int null_count, Parse_Options);
+bool build_best_parse_set(extractor_t*, Sentence,
+                          fast_matcher_t*, count_context_t*,
+                          unsigned int null_count, Parse_Options);
 
 void extract_links(extractor_t*, Linkage);
+bool extract_kbest_links(extractor_t*, Linkage);
 
 #endif /* _EXTRACT_LINKS_H */
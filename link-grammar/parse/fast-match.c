@@ -29,8 +29,12 @@
  * The lookup is fast, because it uses a precomputed lookup table to
  * find the match candidates.  The lookup table is stocked by looking
  * at all disjuncts on all words, and sorting them into bins organized
- * by connectors they could potentially connect to.  The lookup table
- * is created by calling the alloc_fast_matcher() function.
+ * by connectors they could potentially connect to.  Each bin is an
+ * array sorted by the nearest_word of the connectors, so the candidates
+ * that are too far away can be cut off by a binary search.  The lookup
+ * table is created by calling the alloc_fast_matcher() function, and
+ * can be rebuilt for new disjuncts (e.g. of another sentence) by calling
+ * reset_fast_matcher(), which reuses its memory.
  *
  * free_fast_matcher() is used to free the matcher.
  * form_match_list() manages its memory as a "stack" - match-lists are
@@ -38,10 +42,19 @@
  * for long and/or complex sentences.
  * pop_match_list() releases the memory that form_match_list() returned
  * by unwinding this stack.
+ *
+ * Optionally, the match lists are also cached by (w, lc, rc), since
+ * the same match lists are formed again for different null counts and
+ * for different ranges with a NULL lc, and again when the linkages are
+ * extracted. The cached match lists are kept at the bottom of the
+ * stack, and are never popped. When the cache gets too large, no more
+ * match lists are cached, and the rest are handled as a stack above it.
  */
 
 #define MATCH_LIST_SIZE_INIT 4096 /* the initial size of the match-list stack */
 #define MATCH_LIST_SIZE_INC 2     /* match-list stack increase size factor */
+#define ML_CACHE_SIZE_INIT 1024   /* the initial number of cache entries */
+#define ML_CACHE_MAX_ELEMENTS (1<<22) /* cached match-list elements limit */
 
 /**
  * Returns the number of disjuncts in the list that have non-null
@@ -76,299 +89,404 @@ static void push_match_list_element(fast_matcher_t *ctxt, Disjunct *d)
 		/* XXX the realloc clobbers xalloc count */
 		ctxt->match_list = realloc(ctxt->match_list,
 		                      ctxt->match_list_size * sizeof(*ctxt->match_list));
+		ctxt->match_list_flags = realloc(ctxt->match_list_flags,
+		                      ctxt->match_list_size * sizeof(uint8_t));
 	}
 
 	ctxt->match_list[ctxt->match_list_end++] = d;
 }
 
-static void free_match_list(Match_node * t)
+static void free_match_flags(fast_matcher_t *ctxt)
 {
-	Match_node *xt;
-	for (; t!=NULL; t=xt) {
-		xt = t->next;
-		xfree((char *)t, sizeof(Match_node));
-	}
+	xfree(ctxt->match_flags, ctxt->num_disjuncts * sizeof(uint8_t));
+#ifdef VERIFY_MATCH_LIST
+	xfree(ctxt->match_id, ctxt->num_disjuncts * sizeof(int));
+#endif
+	ctxt->match_flags = NULL;
+	ctxt->num_disjuncts = 0;
 }
 
-/**
- * Free all of the hash tables and Match_nodes
- */
-void free_fast_matcher(fast_matcher_t *mchxt)
+static void alloc_match_flags(fast_matcher_t *ctxt, size_t num_disjuncts)
 {
-	size_t w;
-	unsigned int i;
+	if (num_disjuncts <= ctxt->num_disjuncts) return;
 
-	if (NULL == mchxt) return;
-	for (w = 0; w < mchxt->size; w++)
-	{
-		for (i = 0; i < mchxt->l_table_size[w]; i++)
-		{
-			free_match_list(mchxt->l_table[w][i]);
-		}
-		xfree((char *)mchxt->l_table[w], mchxt->l_table_size[w] * sizeof (Match_node *));
-		for (i = 0; i < mchxt->r_table_size[w]; i++)
-		{
-			free_match_list(mchxt->r_table[w][i]);
-		}
-		xfree((char *)mchxt->r_table[w], mchxt->r_table_size[w] * sizeof (Match_node *));
-	}
+	free_match_flags(ctxt);
+	ctxt->num_disjuncts = num_disjuncts;
+	ctxt->match_flags = xalloc(num_disjuncts * sizeof(uint8_t));
+#ifdef VERIFY_MATCH_LIST
+	ctxt->match_id = xalloc(num_disjuncts * sizeof(int));
+#endif
+}
 
-	free(mchxt->match_list);
-	lgdebug(6, "Sentence size %zu, match_list_size %zu\n",
-	        mchxt->size, mchxt->match_list_size);
+static void alloc_match_list(fast_matcher_t *ctxt)
+{
+	ctxt->match_list_size = MATCH_LIST_SIZE_INIT;
+	ctxt->match_list = xalloc(ctxt->match_list_size * sizeof(*ctxt->match_list));
+	ctxt->match_list_flags = xalloc(ctxt->match_list_size * sizeof(uint8_t));
+	ctxt->match_list_end = 0;
+}
 
-	xfree(mchxt->l_table_size, mchxt->size * sizeof(unsigned int));
-	xfree(mchxt->l_table, mchxt->size * sizeof(Match_node **));
-	xfree(mchxt, sizeof(fast_matcher_t));
+static void ml_cache_clear(fast_matcher_t *ctxt)
+{
+	if (NULL == ctxt->ml_cache) return;
+
+	if (0 != ctxt->ml_cache_hits + ctxt->ml_cache_misses)
+		lgdebug(6, "Match-list cache: %zu hits, %zu misses, %zu entries, "
+		        "%zu elements\n", ctxt->ml_cache_hits, ctxt->ml_cache_misses,
+		        ctxt->ml_cache_count, ctxt->ml_cache_end);
+
+	for (size_t i = 0; i < ctxt->ml_cache_size; i++)
+		ctxt->ml_cache[i].w = -1;
+	ctxt->ml_cache_count = 0;
+	ctxt->ml_cache_end = 0;
+	ctxt->ml_cache_hits = 0;
+	ctxt->ml_cache_misses = 0;
 }
 
-/**
- * Adds the match node m to the sorted list of match nodes l.
- * The parameter dir determines the order of the sorting to be used.
- * Makes the list sorted from smallest to largest.
- */
-static Match_node * add_to_right_table_list(Match_node * m, Match_node * l)
+static void alloc_ml_cache(fast_matcher_t *ctxt)
 {
-	Match_node *p, *prev;
+	ctxt->ml_cache_size = ML_CACHE_SIZE_INIT;
+	ctxt->ml_cache =
+		xalloc(ctxt->ml_cache_size * sizeof(Match_list_cache_entry));
+	ml_cache_clear(ctxt);
+}
 
-	if (l == NULL) return m;
+static void free_ml_cache(fast_matcher_t *ctxt)
+{
+	ml_cache_clear(ctxt);
+	xfree(ctxt->ml_cache, ctxt->ml_cache_size * sizeof(Match_list_cache_entry));
+	ctxt->ml_cache = NULL;
+}
 
-	/* Insert m at head of list */
-	if ((m->d->right->nearest_word) <= (l->d->right->nearest_word))
-	{
-		m->next = l;
-		return m;
-	}
+static Match_list_cache_entry *
+ml_cache_lookup(Match_list_cache_entry *t, size_t size,
+                int w, const Connector *le, const Connector *re)
+{
+	size_t h = pair_hash(size, w, 0, le, re, 0);
 
-	/* Walk list to insertion point */
-	prev = l;
-	p = prev->next;
-	while (p != NULL && ((m->d->right->nearest_word) > (p->d->right->nearest_word)))
+	while ((-1 != t[h].w) &&
+	       ((t[h].w != w) || (t[h].le != le) || (t[h].re != re)))
 	{
-		prev = p;
-		p = p->next;
+		h = (h + 1) & (size-1);
 	}
+	return &t[h];
+}
 
-	m->next = p;
-	prev->next = m;
+static void ml_cache_grow(fast_matcher_t *ctxt)
+{
+	size_t old_size = ctxt->ml_cache_size;
+	Match_list_cache_entry *old = ctxt->ml_cache;
+
+	ctxt->ml_cache_size *= 2;
+	ctxt->ml_cache =
+		xalloc(ctxt->ml_cache_size * sizeof(Match_list_cache_entry));
+	for (size_t i = 0; i < ctxt->ml_cache_size; i++)
+		ctxt->ml_cache[i].w = -1;
 
-	return l;  /* return pointer to original head */
+	for (size_t i = 0; i < old_size; i++)
+	{
+		if (-1 == old[i].w) continue;
+		*ml_cache_lookup(ctxt->ml_cache, ctxt->ml_cache_size,
+		                 old[i].w, old[i].le, old[i].re) = old[i];
+	}
+	xfree(old, old_size * sizeof(Match_list_cache_entry));
 }
 
 /**
- * Adds the match node m to the sorted list of match nodes l.
- * The parameter dir determines the order of the sorting to be used.
- * Makes the list sorted from largest to smallest
+ * Free all of the hash tables and buckets
  */
-static Match_node * add_to_left_table_list(Match_node * m, Match_node * l)
+void free_fast_matcher(fast_matcher_t *mchxt)
 {
-	Match_node *p, *prev;
-
-	if (l == NULL) return m;
+	if (NULL == mchxt) return;
 
-	/* Insert m at head of list */
-	if ((m->d->left->nearest_word) >= (l->d->left->nearest_word))
+	free(mchxt->match_list);
+	free(mchxt->match_list_flags);
+	lgdebug(6, "Sentence size %zu, match_list_size %zu\n",
+	        mchxt->size, mchxt->match_list_size);
+	free_match_flags(mchxt);
+	xfree(mchxt->lc_match, mchxt->lc_match_size * sizeof(uint8_t));
+	if (NULL != mchxt->ml_cache) free_ml_cache(mchxt);
+	if (NULL != mchxt->shared)
 	{
-		m->next = l;
-		return m;
+		/* A clone - the tables belong to the original matcher. */
+		xfree(mchxt, sizeof(fast_matcher_t));
+		return;
 	}
 
-	/* Walk list to insertion point */
-	prev = l;
-	p = prev->next;
-	while (p != NULL && ((m->d->left->nearest_word) < (p->d->left->nearest_word)))
-	{
-		prev = p;
-		p = p->next;
-	}
+	xfree(mchxt->bucket_buf, mchxt->bucket_buf_size * sizeof(Disjunct *));
+	xfree(mchxt->bucket_lc, mchxt->bucket_buf_size * sizeof(lc_enc_t));
+	xfree(mchxt->bucket_lc_mask, mchxt->bucket_buf_size * sizeof(lc_enc_t));
+	xfree(mchxt->table_buf, mchxt->table_buf_size * sizeof(Match_bucket));
+	xfree(mchxt->l_table_size, 2 * mchxt->words_alloced * sizeof(unsigned int));
+	xfree(mchxt->l_table, 2 * mchxt->words_alloced * sizeof(Match_bucket *));
+	xfree(mchxt, sizeof(fast_matcher_t));
+}
+
+/**
+ * Return the bucket of connectors with the upper-case part of c,
+ * which is unused if there are no such connectors.
+ * Every bucket MUST have a unique upper-case part, since later on,
+ * we only compare the lower-case parts, assuming upper-case parts
+ * are already equal.
+ */
+static Match_bucket *get_match_table_entry(unsigned int size, Match_bucket *t,
+                                           Connector * c)
+{
+	unsigned int h = connector_hash(c) & (size-1);
 
-	m->next = p;
-	prev->next = m;
+	/* The table cannot be full - it has a slot for each disjunct. */
+	while ((0 != t[h].size) && (t[h].uc_num != c->desc->uc_num))
+		h = (h + 1) & (size-1);
 
-	return l;  /* return pointer to original head */
+	return &t[h];
 }
 
 /**
- * Compare only the uppercase part of two connectors.
- * Return true if they are the same, else false.
- * FIXME: Use connector enumeration.
+ * Sort the buckets of the right tables from the smallest nearest_word
+ * to the largest, and the ones of the left tables from the largest to
+ * the smallest. Disjuncts with the same nearest_word are sorted in
+ * reverse disjunct-store order (this is the order in which the
+ * disjunct lists used to be built, which we keep, so the linkages are
+ * issued in the same order).
  */
-static bool con_uc_eq(const Connector *c1, const Connector *c2)
+static int right_bucket_compare(const void *a, const void *b)
 {
-	if (string_set_cmp(c1->string, c2->string)) return true;
-	if (c1->hash != c2->hash) return false;
-	if (c1->uc_length != c2->uc_length) return false;
-
-	/* We arrive here for less than 50% of the cases for "en" and
-	 * less then 20% of the cases for "ru", and, in practice, the
-	 * two strings are always equal, because there is almost never
-	 * a hash collision that would lead to a miscompare, because
-	 * we are hashing, at most, a few dozen connectors into a
-	 * 16-bit hash space (65536 slots).
-	 */
-	const char *uc1 = &c1->string[c1->uc_start];
-	const char *uc2 = &c2->string[c2->uc_start];
-	if (0 == strncmp(uc1, uc2, c1->uc_length)) return true;
-
-	return false;
+	const Disjunct *da = *(const Disjunct **)a;
+	const Disjunct *db = *(const Disjunct **)b;
+
+	if (da->right->nearest_word != db->right->nearest_word)
+		return da->right->nearest_word - db->right->nearest_word;
+	return (da < db) - (da > db);
 }
 
-static Match_node **get_match_table_entry(unsigned int size, Match_node **t,
-                                          Connector * c, int dir)
+static int left_bucket_compare(const void *a, const void *b)
 {
-	unsigned int h, s;
+	const Disjunct *da = *(const Disjunct **)a;
+	const Disjunct *db = *(const Disjunct **)b;
 
-	s = h = connector_hash(c) & (size-1);
+	if (da->left->nearest_word != db->left->nearest_word)
+		return db->left->nearest_word - da->left->nearest_word;
+	return (da < db) - (da > db);
+}
 
-	if (dir == 1) {
-		while (NULL != t[h])
-		{
-			if (con_uc_eq(t[h]->d->right, c)) break;
-
-			/* Increment and try again. Every hash bucket MUST have
-			 * a unique upper-case part, since later on, we only
-			 * compare the lower-case parts, assuming upper-case
-			 * parts are already equal. So just look for the next
-			 * unused hash bucket.
-			 */
-			h = (h + 1) & (size-1);
-			if (NULL == t[h]) break;
-			if (h == s) return NULL;
-		}
-	}
-	else
-	{
-		while (NULL != t[h])
-		{
-			if (con_uc_eq(t[h]->d->left, c)) break;
-			h = (h + 1) & (size-1);
-			if (NULL == t[h]) break;
-			if (h == s) return NULL;
-		}
-	}
+/**
+ * Allocate the lc_match array of the given matcher, for its largest
+ * bucket.
+ */
+static void alloc_lc_match(fast_matcher_t *ctxt, unsigned int size)
+{
+	if (size <= ctxt->lc_match_size) return;
 
-	return &t[h];
+	xfree(ctxt->lc_match, ctxt->lc_match_size * sizeof(uint8_t));
+	ctxt->lc_match_size = size;
+	ctxt->lc_match = xalloc(size * sizeof(uint8_t));
 }
 
 /**
- * The disjunct d (whose left or right pointer points to c) is put
- * into the appropriate hash table
- * dir =  1, we're putting this into a right table.
- * dir = -1, we're putting this into a left table.
+ * Build the hash table t of the given word side (dir = 1 for the right
+ * connectors, -1 for the left ones). The buckets are carved out of
+ * ctxt->bucket_buf starting at *bucket_next, which is advanced
+ * accordingly.
  */
-static void put_into_match_table(unsigned int size, Match_node ** t,
-                                 Disjunct * d, Connector * c, int dir )
+static void fill_match_table(fast_matcher_t *ctxt, unsigned int size,
+                             Match_bucket *t, Disjunct *dlist, int dir,
+                             size_t *bucket_next)
 {
-	Match_node *m, **xl;
+	Disjunct *d;
+	Match_bucket *b;
 
-	m = (Match_node *) xalloc (sizeof(Match_node));
-	m->next = NULL;
-	m->d = d;
+	/* Count the disjuncts of each bucket. */
+	for (d = dlist; d != NULL; d = d->next)
+	{
+		Connector *c = (dir == 1) ? d->right : d->left;
+		if (NULL == c) continue;
 
-	xl = get_match_table_entry(size, t, c, dir);
-	assert(NULL != xl, "get_match_table_entry: Overflow");
-	if (dir == 1) {
-		*xl = add_to_right_table_list(m, *xl);
+		b = get_match_table_entry(size, t, c);
+		b->uc_num = c->desc->uc_num;
+		b->size++;
 	}
-	else
+
+	/* Allocate the buckets, and fill them. */
+	for (b = t; b < t + size; b++)
+	{
+		if (0 == b->size) continue;
+		b->d = &ctxt->bucket_buf[*bucket_next];
+		*bucket_next += b->size;
+		if (b->size > ctxt->max_bucket_size) ctxt->max_bucket_size = b->size;
+		b->size = 0;
+	}
+	for (d = dlist; d != NULL; d = d->next)
 	{
-		*xl = add_to_left_table_list(m, *xl);
+		Connector *c = (dir == 1) ? d->right : d->left;
+		if (NULL == c) continue;
+
+		b = get_match_table_entry(size, t, c);
+		b->d[b->size++] = d;
+	}
+
+	for (b = t; b < t + size; b++)
+	{
+		if (0 == b->size) continue;
+		if (b->size > 1)
+		{
+			qsort(b->d, b->size, sizeof(Disjunct *),
+			      (dir == 1) ? right_bucket_compare : left_bucket_compare);
+		}
+
+		size_t bi = b->d - ctxt->bucket_buf;
+		for (unsigned int i = 0; i < b->size; i++)
+		{
+			Connector *c = (dir == 1) ? b->d[i]->right : b->d[i]->left;
+			lc_enc_t lc = c->desc->lc_letters;
+
+			ctxt->bucket_lc[bi + i] = lc;
+			ctxt->bucket_lc_mask[bi + i] =
+				(LC_UNENCODED == lc) ? 0 : lc_nonzero_mask(lc);
+		}
 	}
 }
 
-fast_matcher_t* alloc_fast_matcher(const Sentence sent)
+/**
+ * Build the lookup tables for the disjuncts of the given sentence.
+ * The memory of the previous tables (if any) is reused: all the hash
+ * tables are carved out of one buffer, and all their buckets out of
+ * another one.
+ */
+static void fast_matcher_fill(fast_matcher_t *ctxt, const Sentence sent)
 {
-	unsigned int size;
 	size_t w;
-	int len;
-	Match_node ** t;
-	Disjunct * d;
-	fast_matcher_t *ctxt;
+	size_t total_size = 0;
+	size_t num_connectors = 0;
+	Match_bucket * t;
+	size_t bucket_next = 0;
 
-	ctxt = (fast_matcher_t *) xalloc(sizeof(fast_matcher_t));
+	assert(NULL == ctxt->shared, "Cannot fill a fast-matcher clone");
+
+	if (sent->length > ctxt->words_alloced)
+	{
+		xfree(ctxt->l_table_size, 2 * ctxt->words_alloced * sizeof(unsigned int));
+		xfree(ctxt->l_table, 2 * ctxt->words_alloced * sizeof(Match_bucket *));
+		ctxt->words_alloced = sent->length;
+		ctxt->l_table_size = xalloc(2 * sent->length * sizeof(unsigned int));
+		ctxt->l_table = xalloc(2 * sent->length * sizeof(Match_bucket *));
+	}
 	ctxt->size = sent->length;
-	ctxt->l_table_size = xalloc(2 * sent->length * sizeof(unsigned int));
+	ctxt->gword_sets = sent->gword_sets;
 	ctxt->r_table_size = ctxt->l_table_size + sent->length;
-	ctxt->l_table = xalloc(2 * sent->length * sizeof(Match_node **));
 	ctxt->r_table = ctxt->l_table + sent->length;
-	memset(ctxt->l_table, 0, 2 * sent->length * sizeof(Match_node **));
 
-	ctxt->match_list_size = MATCH_LIST_SIZE_INIT;
-	ctxt->match_list = xalloc(ctxt->match_list_size * sizeof(*ctxt->match_list));
+	for (w=0; w<sent->length; w++)
+	{
+		unsigned int llen = left_disjunct_list_length(sent->word[w].d);
+		unsigned int rlen = right_disjunct_list_length(sent->word[w].d);
+
+		/* Keep a free slot, for an unsuccessful lookup to end at. */
+		ctxt->l_table_size[w] = next_power_of_two_up(llen + 1);
+		ctxt->r_table_size[w] = next_power_of_two_up(rlen + 1);
+		total_size += ctxt->l_table_size[w] + ctxt->r_table_size[w];
+		num_connectors += llen + rlen;
+	}
+	ctxt->disjuncts = sent->disjunct_store->disjunct;
+	alloc_match_flags(ctxt, sent->disjunct_store->num_disjuncts);
+
+	if (total_size > ctxt->table_buf_size)
+	{
+		xfree(ctxt->table_buf, ctxt->table_buf_size * sizeof(Match_bucket));
+		ctxt->table_buf_size = total_size;
+		ctxt->table_buf = xalloc(total_size * sizeof(Match_bucket));
+	}
+	memset(ctxt->table_buf, 0, total_size * sizeof(Match_bucket));
+	if (num_connectors > ctxt->bucket_buf_size)
+	{
+		xfree(ctxt->bucket_buf, ctxt->bucket_buf_size * sizeof(Disjunct *));
+		xfree(ctxt->bucket_lc, ctxt->bucket_buf_size * sizeof(lc_enc_t));
+		xfree(ctxt->bucket_lc_mask, ctxt->bucket_buf_size * sizeof(lc_enc_t));
+		ctxt->bucket_buf_size = num_connectors;
+		ctxt->bucket_buf = xalloc(num_connectors * sizeof(Disjunct *));
+		ctxt->bucket_lc = xalloc(num_connectors * sizeof(lc_enc_t));
+		ctxt->bucket_lc_mask = xalloc(num_connectors * sizeof(lc_enc_t));
+	}
+	ctxt->max_bucket_size = 0;
+	ml_cache_clear(ctxt);
 	ctxt->match_list_end = 0;
 
+	t = ctxt->table_buf;
 	for (w=0; w<sent->length; w++)
 	{
-		len = left_disjunct_list_length(sent->word[w].d);
-		size = next_power_of_two_up(len);
-		ctxt->l_table_size[w] = size;
-		t = ctxt->l_table[w] = (Match_node **) xalloc(size * sizeof(Match_node *));
-		memset(t, 0, size * sizeof(Match_node *));
+		ctxt->l_table[w] = t;
+		fill_match_table(ctxt, ctxt->l_table_size[w], t, sent->word[w].d, -1,
+		                 &bucket_next);
+		t += ctxt->l_table_size[w];
+
+		ctxt->r_table[w] = t;
+		fill_match_table(ctxt, ctxt->r_table_size[w], t, sent->word[w].d, 1,
+		                 &bucket_next);
+		t += ctxt->r_table_size[w];
+	}
+	alloc_lc_match(ctxt, ctxt->max_bucket_size);
+}
 
-		for (d = sent->word[w].d; d != NULL; d = d->next)
-		{
-			if (d->left != NULL)
-			{
-				put_into_match_table(size, t, d, d->left, -1);
-			}
-		}
+/**
+ * Allocate a fast matcher for the disjuncts of the given sentence.
+ * If cache is true, the match lists are cached (see above).
+ */
+fast_matcher_t* alloc_fast_matcher(const Sentence sent, bool cache)
+{
+	fast_matcher_t *ctxt;
 
-		len = right_disjunct_list_length(sent->word[w].d);
-		size = next_power_of_two_up(len);
-		ctxt->r_table_size[w] = size;
-		t = ctxt->r_table[w] = (Match_node **) xalloc(size * sizeof(Match_node *));
-		memset(t, 0, size * sizeof(Match_node *));
+	ctxt = (fast_matcher_t *) xalloc(sizeof(fast_matcher_t));
+	memset(ctxt, 0, sizeof(fast_matcher_t));
 
-		for (d = sent->word[w].d; d != NULL; d = d->next)
-		{
-			if (d->right != NULL)
-			{
-				put_into_match_table(size, t, d, d->right, 1);
-			}
-		}
-	}
+	alloc_match_list(ctxt);
+	if (cache) alloc_ml_cache(ctxt);
 
+	fast_matcher_fill(ctxt, sent);
 	return ctxt;
 }
 
-#if 0
 /**
- * Print statistics on various connector matching aspects.
- * A summary can be found by the shell commands:
- * link-parser < file.batch | grep match_stats: | sort | uniq -c
+ * Rebuild the lookup tables for the (possibly different) disjuncts
+ * of the given sentence, reusing the memory of the given matcher.
+ * The match-list cache is cleared, and allocated or freed according
+ * to cache.
  */
-static void match_stats(Connector *c1, Connector *c2)
+void reset_fast_matcher(fast_matcher_t *ctxt, const Sentence sent, bool cache)
 {
-	if (NULL == c1) printf("match_stats: cache\n");
-	if (NULL == c2) return;
-	if ((1 == c1->uc_start) && (1 == c2->uc_start) &&
-	    (c1->string[0] == c2->string[0]))
-	{
-		printf("match_stats: h/d mismatch\n");
-	}
+	if (cache && (NULL == ctxt->ml_cache)) alloc_ml_cache(ctxt);
+	if (!cache && (NULL != ctxt->ml_cache)) free_ml_cache(ctxt);
+	fast_matcher_fill(ctxt, sent);
+}
 
-	if (0 == c1->lc_start) printf("match_stats: no lc (c1)\n");
-	if (0 == c2->lc_start) printf("match_stats: no lc (c2)\n");
+/**
+ * Return a matcher that shares the lookup tables of the given one,
+ * but has its own match-list stack, match flags and match-list cache,
+ * so the two can be used concurrently. The clone must be freed (by free_fast_matcher())
+ * before the original matcher is freed or reset.
+ */
+fast_matcher_t* clone_fast_matcher(const fast_matcher_t *mchxt)
+{
+	fast_matcher_t *ctxt = (fast_matcher_t *) xalloc(sizeof(fast_matcher_t));
 
-	if (string_set_cmp(c1->string, c2->string)) printf("match_stats: same\n");
+	*ctxt = *mchxt;
+	ctxt->shared = mchxt;
+	ctxt->match_flags = NULL;
+#ifdef VERIFY_MATCH_LIST
+	ctxt->match_id = NULL;
+#endif
+	ctxt->num_disjuncts = 0;
+	alloc_match_flags(ctxt, mchxt->num_disjuncts);
+	ctxt->lc_match = NULL;
+	ctxt->lc_match_size = 0;
+	alloc_lc_match(ctxt, mchxt->max_bucket_size);
+	alloc_match_list(ctxt);
+	if (NULL != mchxt->ml_cache) alloc_ml_cache(ctxt);
 
-	const char *a = &c1->string[c1->lc_start];
-	const char *b = &c2->string[c2->lc_start];
-	do
-	{
-		if (*a != *b && (*a != '*') && (*b != '*')) printf("match_stats: lc false\n");
-		a++;
-		b++;
-	} while (*a != '\0' && *b != '\0');
-	printf("match_stats: lc true\n");
+	return ctxt;
 }
-#else
-#define match_stats(a, b)
-#endif
 
 #ifdef DEBUG
 #undef N
-#define N(c) (c?c->string:"")
+#define N(c) (c?connector_get_string(c):"")
 
 /**
  * Print the match list, including connector match indications.
@@ -386,16 +504,15 @@ static void print_match_list(fast_matcher_t *ctxt, int id, size_t mlb, int w,
                              Connector *rc, int rw)
 {
 	if (!verbosity_level(9)) return;
-	Disjunct **m = &ctxt->match_list[mlb];
 
-	for (; NULL != *m; m++)
+	for (size_t mli = mlb; NULL != ctxt->match_list[mli]; mli++)
 	{
-		Disjunct *d = *m;
+		Disjunct *d = ctxt->match_list[mli];
 
 		printf("MATCH_NODE %5d: %02d>%-9s %c %9s<%02d>%-9s %c %9s<%02d\n",
-		       id, lw , N(lc), d->match_left ? '=': ' ',
+		       id, lw , N(lc), (get_match_flags(ctxt, mli) & MATCH_LEFT) ? '=': ' ',
 		       N(d->left), w, N(d->right),
-		       d->match_right? '=' : ' ', N(rc), rw);
+		       (get_match_flags(ctxt, mli) & MATCH_RIGHT) ? '=' : ' ', N(rc), rw);
 	}
 }
 #else
@@ -403,90 +520,38 @@ static void print_match_list(fast_matcher_t *ctxt, int id, size_t mlb, int w,
 #endif
 
 /**
- * Compare only the lower-case parts of two connectors. When this
- * function is called, it is assumed that the upper-case parts are
- * equal, and thus do not need to be checked again.
+ * Set ctxt->lc_match[i] for the first n disjuncts of the bucket b, to
+ * indicate whether the lower-case part of their connector matches that
+ * of c (see lc_easy_match_batch()).
  *
- * We know that the uc parts of the connectors are the same,
- * because we fetch the matching lists according to the uc part or the
- * connectors to be matched. So the uc parts are not checked here. The
- * head/dependent indicators are in the caller function, and only when
- * connectors match here, to save CPU when the connectors don't match
- * otherwise. This is because h/d mismatch is rare.
- * FIXME: Use connector enumeration.
+ * We know that the uc parts of the connectors are the same, because
+ * the bucket is fetched according to the uc part of c. The
+ * head/dependent indicators are checked by the caller, and only when
+ * the connectors match here, because h/d mismatch is rare.
  */
-static bool match_lower_case(Connector *c1, Connector *c2)
+static void bucket_lc_match(fast_matcher_t *ctxt, const Match_bucket *b,
+                            unsigned int n, const Connector *c)
 {
-	match_stats(c1, c2);
-
-	/* If the connectors are identical, they match. */
-	if (string_set_cmp(c1->string, c2->string)) return true;
-
-	/* If any of the connectors doesn't have a lc part, they match */
-	if ((0 == c2->lc_start) || (0 == c1->lc_start)) return true;
-
-	/* Compare the lc parts according to the connector matching rules. */
-	const char *a = &c1->string[c1->lc_start];
-	const char *b = &c2->string[c2->lc_start];
-	do
-	{
-		if (*a != *b && (*a != '*') && (*b != '*')) return false;
-		a++;
-		b++;
-	} while (*a != '\0' && *b != '\0');
+	size_t bi = b->d - ctxt->bucket_buf;
 
-	return true;
+	lc_easy_match_batch(&ctxt->bucket_lc[bi], &ctxt->bucket_lc_mask[bi], n,
+	                    c, ctxt->lc_match);
 }
 
 /**
- * Return false if the connectors cannot match due to identical
- * head/dependent parts. Else return true.
+ * Complete the match check of the connectors c1 and c2, whose
+ * lower-case parts have been found matching by bucket_lc_match().
  */
-static bool match_hd(Connector *c1, Connector *c2)
-{
-	if ((1 == c1->uc_start) && (1 == c2->uc_start) &&
-	    (c1->string[0] == c2->string[0]))
-	{
-		return false;
-	}
-	return true;
-}
-
-typedef struct
+static bool match_rest(const Connector *c1, const Connector *c2)
 {
-	const char *string;
-	bool match;
-} match_cache;
+	const condesc_t *a = c1->desc;
+	const condesc_t *b = c2->desc;
 
-/**
- * Match the lower-case parts of connectors, and the head-dependent,
- * using a cache of the most recent compare.  Due to the way disjuncts
- * are written, we are often asked to compare to the same connector
- * 3 or 4 times in a row. So if we already did that compare, just use
- * the cached result. (i.e. the caching here is almost trivial, but it
- * works well).
- */
-static bool do_match_with_cache(Connector *a, Connector *b, match_cache *c_con)
-{
-	/* The following uses a string-set compare - string_set_cmp() cannot
-	 * be used here because c_con->string may be NULL. */
-	match_stats(c_con->string == a->string ? NULL : a, NULL);
-	if (c_con->string == a->string)
+	if ((LC_UNENCODED == a->lc_letters) || (LC_UNENCODED == b->lc_letters))
 	{
-		/* The match_cache string field is initialized to NULL, and this is
-		 * enough for not using uninitialized c_con->match because the
-		 * connector desc filed cannot be NULL, as it actually fetched a
-		 * non-empty match list. */
-		PRAGMA_MAYBE_UNINITIALIZED
-		return c_con->match;
-		PRAGMA_END
+		if (!lc_easy_match(a, b)) return false;
 	}
-
-	/* No cache exists. Check if the connectors match and cache the result. */
-	c_con->match = match_lower_case(a, b) && match_hd(a, b);
-	c_con->string = a->string;
-
-	return c_con->match;
+	return hd_easy_match(a, b);
 }
 
 typedef struct
@@ -496,9 +561,10 @@ typedef struct
 } gword_cache;
 
 /**
- * Return true iff c1 and c2 are from the same alternative.
+ * Return true iff connectors whose originating gword sets are gs1 and
+ * gs2 are from the same alternative.
  * An optimization for English checks if one of the connectors belongs
- * to an original sentence word (c2 is checked first for an inline
+ * to an original sentence word (gs2 is checked first for an inline
  * optimization opportunity).
  * If a wordgraph word of the checked connector is the same
  * as of the previously checked one, use the cached result.
@@ -507,7 +573,8 @@ typedef struct
  */
 #define ALT_CONNECTION_POSSIBLE
 #define OPTIMIZE_EN
-static bool alt_connection_possible(Connector *c1, Connector *c2,
+static bool alt_connection_possible(const gword_set *gs1,
+                                    const gword_set *gs2,
                                     gword_cache *c_con)
 {
 #ifdef ALT_CONNECTION_POSSIBLE
@@ -515,19 +582,19 @@ static bool alt_connection_possible(Connector *c1, Connector *c2,
 
 #ifdef OPTIMIZE_EN
 	/* Try a shortcut first. */
-	if ((c2->originating_gword->o_gword->hier_depth == 0) ||
-	    (c1->originating_gword->o_gword->hier_depth == 0))
+	if ((gs2->o_gword->hier_depth == 0) ||
+	    (gs1->o_gword->hier_depth == 0))
 	{
 			return true;
 	}
 #endif /* OPTIMIZE_EN */
 
-	if (c1->originating_gword->o_gword == c_con->gword)
+	if (gs1->o_gword == c_con->gword)
 		return c_con->same_alternative;
 
 	/* Each of the loops is of one iteration most of the times. */
-	for (const gword_set *ga = c1->originating_gword; NULL != ga; ga = ga->next) {
-		for (const gword_set *gb = c2->originating_gword; NULL != gb; gb = gb->next) {
+	for (const gword_set *ga = gs1; NULL != ga; ga = ga->next) {
+		for (const gword_set *gb = gs2; NULL != gb; gb = gb->next) {
 			if (in_same_alternative(ga->o_gword, gb->o_gword)) {
 				 same_alternative = true;
 				 break;
@@ -537,7 +604,7 @@ static bool alt_connection_possible(Connector *c1, Connector *c2,
 	}
 
 	c_con->same_alternative = same_alternative;
-	c_con->gword = c1->originating_gword->o_gword;
+	c_con->gword = gs1->o_gword;
 
 
 	return same_alternative;
@@ -546,79 +613,122 @@ static bool alt_connection_possible(Connector *c1, Connector *c2,
 #endif /* ALT_CONNECTION_POSSIBLE */
 }
 
+/**
+ * Return the number of the leading disjuncts of the right-table bucket
+ * b whose right connector can reach the word rw (a binary search,
+ * as the bucket is sorted by ascending nearest_word).
+ */
+static unsigned int right_bucket_end(const Match_bucket *b, int rw)
+{
+	unsigned int lo = 0, hi = b->size;
+
+	while (lo < hi)
+	{
+		unsigned int mid = (lo + hi) / 2;
+		if (b->d[mid]->right->nearest_word > rw)
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+	return lo;
+}
+
+/**
+ * The same for the left-table bucket b, which is sorted by descending
+ * nearest_word, and the word lw.
+ */
+static unsigned int left_bucket_end(const Match_bucket *b, int lw)
+{
+	unsigned int lo = 0, hi = b->size;
+
+	while (lo < hi)
+	{
+		unsigned int mid = (lo + hi) / 2;
+		if (b->d[mid]->left->nearest_word < lw)
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+	return lo;
+}
+
 /**
  * Forms and returns a list of disjuncts coming from word w, that
  * actually matches lc or rc or both. The lw and rw are the words from
  * which lc and rc came respectively.
  *
- * The list is returned in an array of Match_nodes.  This list
+ * The list is returned in an array of disjuncts.  This list
  * contains no duplicates, because when processing the ml list, only
- * elements whose match_left is true are included, and such elements are
- * not included again when processing the mr list.
+ * elements whose MATCH_LEFT flag is set are included, and such elements
+ * are not included again when processing the mr list.
  *
  * Note that if both lc and rc match the corresponding connectors of w,
- * match_left is set to true when the ml list is processed and the
- * disjunct is then added to the result list, and match_right of the
- * same disjunct is set to true when the mr list is processed, and this
- * disjunct is not added again.
+ * MATCH_LEFT is set when the ml list is processed and the disjunct is
+ * then added to the result list, and MATCH_RIGHT of the same disjunct
+ * is set when the mr list is processed, and this disjunct is not added
+ * again. The flags are retrieved by get_match_flags().
  */
-size_t
-form_match_list(fast_matcher_t *ctxt, int w,
-                Connector *lc, int lw,
-                Connector *rc, int rw)
+static size_t
+build_match_list(fast_matcher_t *ctxt, int w,
+                 Connector *lc, int lw,
+                 Connector *rc, int rw)
 {
-	Match_node *mx, *mr_end, **mxp;
+	Match_bucket *bl = NULL, *br = NULL;
+	Disjunct **ml = NULL, **mr = NULL;
+	unsigned int ml_end = 0, mr_end = 0;
+	unsigned int i;
 	size_t front = ctxt->match_list_end;
-	Match_node *ml = NULL, *mr = NULL;
-	match_cache mc;
+	uint8_t *flags = ctxt->match_flags;
+	const uint8_t *lc_match = ctxt->lc_match;
 	gword_cache gc;
 
 	gc.same_alternative = false;
 
 #ifdef VERIFY_MATCH_LIST
-	static int id = 0;
+	static TLS int id = 0;
 	int lid = ++id; /* A local copy, for multi-threading support. */
 #endif
 
 	/* Get the lists of candidate matching disjuncts of word w for lc and
 	 * rc.  Consider each of these lists only if the length_limit of lc
 	 * rc and also w, is not greater then the distance between their word
-	 * and the word w. */
+	 * and the word w. Only the disjuncts whose connectors can reach
+	 * lw and rw are considered. */
 	if ((lc != NULL) && ((w - lw) <= lc->length_limit))
 	{
-		mxp = get_match_table_entry(ctxt->l_table_size[w], ctxt->l_table[w], lc, -1);
-		if (NULL != mxp) ml = *mxp;
+		bl = get_match_table_entry(ctxt->l_table_size[w], ctxt->l_table[w], lc);
+		ml = bl->d;
+		ml_end = left_bucket_end(bl, lw);
 	}
 	if ((rc != NULL) && ((rw - w) <= rc->length_limit))
 	{
-		mxp = get_match_table_entry(ctxt->r_table_size[w], ctxt->r_table[w], rc, 1);
-		if (NULL != mxp) mr = *mxp;
+		br = get_match_table_entry(ctxt->r_table_size[w], ctxt->r_table[w], rc);
+		mr = br->d;
+		mr_end = right_bucket_end(br, rw);
 	}
 
-	for (mx = mr; mx != NULL; mx = mx->next)
-	{
-		if (mx->d->right->nearest_word > rw) break;
-		mx->d->match_left = false;
-	}
-	mr_end = mx;
+	for (i = 0; i < mr_end; i++)
+		flags[disjunct_index(ctxt, mr[i])] = 0;
 
 	/* Construct the list of things that could match the left. */
-	mc.string = NULL;
+	if (0 < ml_end) bucket_lc_match(ctxt, bl, ml_end, lc);
+	const gword_set *lc_gs = (NULL == lc) ? NULL : ctxt->gword_sets[lc->gword_set_id];
 	gc.gword = NULL;
-	for (mx = ml; mx != NULL; mx = mx->next)
+	for (i = 0; i < ml_end; i++)
 	{
-		if (mx->d->left->nearest_word < lw) break;
-		if ((w - lw) > mx->d->left->length_limit) continue;
+		Disjunct *d = ml[i];
+		if ((w - lw) > d->left->length_limit) continue;
 
-		mx->d->match_left = do_match_with_cache(mx->d->left, lc, &mc) &&
-		                    alt_connection_possible(mx->d->left, lc, &gc);
-		if (!mx->d->match_left) continue;
-		mx->d->match_right = false;
+		bool match_left = lc_match[i] && match_rest(d->left, lc) &&
+		                  alt_connection_possible(d->originating_gword,
+		                                          lc_gs, &gc);
+		flags[disjunct_index(ctxt, d)] = match_left ? MATCH_LEFT : 0;
+		if (!match_left) continue;
 
 #ifdef VERIFY_MATCH_LIST
-		mx->d->match_id = lid;
+		ctxt->match_id[disjunct_index(ctxt, d)] = lid;
 #endif
-		push_match_list_element(ctxt, mx->d);
+		push_match_list_element(ctxt, d);
 	}
 
 	/* Append the list of things that could match the right.
@@ -626,23 +736,84 @@ form_match_list(fast_matcher_t *ctxt, int w,
 	 * if we are going to skip this element here because its match_left
 	 * is true, since then it means it is already included in the match
 	 * list. */
-	mc.string = NULL;
+	if (0 < mr_end) bucket_lc_match(ctxt, br, mr_end, rc);
+	const gword_set *rc_gs = (NULL == rc) ? NULL : ctxt->gword_sets[rc->gword_set_id];
 	gc.gword = NULL;
-	for (mx = mr; mx != mr_end; mx = mx->next)
+	for (i = 0; i < mr_end; i++)
 	{
-		if ((rw - w) > mx->d->right->length_limit) continue;
-
-		mx->d->match_right = do_match_with_cache(mx->d->right, rc, &mc) &&
-			                  alt_connection_possible(mx->d->right, rc, &gc);
-		if (!mx->d->match_right || mx->d->match_left) continue;
+		Disjunct *d = mr[i];
+		if ((rw - w) > d->right->length_limit) continue;
+
+		bool match_right = lc_match[i] && match_rest(d->right, rc) &&
+		                   alt_connection_possible(d->originating_gword,
+		                                           rc_gs, &gc);
+		uint8_t *f = &flags[disjunct_index(ctxt, d)];
+		if (match_right)
+			*f |= MATCH_RIGHT;
+		else
+			*f &= ~MATCH_RIGHT;
+		if (!match_right || (*f & MATCH_LEFT)) continue;
 
 #ifdef VERIFY_MATCH_LIST
-		mx->d->match_id = lid;
+		ctxt->match_id[disjunct_index(ctxt, d)] = lid;
 #endif
-		push_match_list_element(ctxt, mx->d);
+		push_match_list_element(ctxt, d);
 	}
 
 	push_match_list_element(ctxt, NULL);
+	for (size_t mli = front; NULL != ctxt->match_list[mli]; mli++)
+		ctxt->match_list_flags[mli] = flags[disjunct_index(ctxt, ctxt->match_list[mli])];
+
 	print_match_list(ctxt, lid, front, w, lc, lw, rc, rw);
 	return front;
 }
+
+/**
+ * Return the start index of the match list of word w, lc and rc (see
+ * build_match_list()), from the match-list cache if it is used and
+ * the match list is already there.
+ */
+size_t
+form_match_list(fast_matcher_t *ctxt, int w,
+                Connector *lc, int lw,
+                Connector *rc, int rw)
+{
+	Match_list_cache_entry *ce;
+	size_t mlb;
+
+	/* The connectors determine lw and rw, so they are not in the key. */
+	if (NULL == ctxt->ml_cache)
+		return build_match_list(ctxt, w, lc, lw, rc, rw);
+
+	ce = ml_cache_lookup(ctxt->ml_cache, ctxt->ml_cache_size, w, lc, rc);
+	if (-1 != ce->w)
+	{
+		ctxt->ml_cache_hits++;
+#ifdef VERIFY_MATCH_LIST
+		static TLS int id = 0;
+		int lid = --id; /* Distinct from the ids of build_match_list() */
+		for (size_t mli = ce->mlb; NULL != ctxt->match_list[mli]; mli++)
+			ctxt->match_id[disjunct_index(ctxt, ctxt->match_list[mli])] = lid;
+#endif
+		return ce->mlb;
+	}
+	ctxt->ml_cache_misses++;
+
+	mlb = build_match_list(ctxt, w, lc, lw, rc, rw);
+
+	/* Cache it only if it is just above the cached match lists,
+	 * and there is still room. */
+	if ((mlb == ctxt->ml_cache_end) &&
+	    (ctxt->match_list_end <= ML_CACHE_MAX_ELEMENTS))
+	{
+		ce->w = w;
+		ce->le = lc;
+		ce->re = rc;
+		ce->mlb = mlb;
+		ctxt->ml_cache_end = ctxt->match_list_end;
+		if (2 * ++ctxt->ml_cache_count > ctxt->ml_cache_size)
+			ml_cache_grow(ctxt);
+	}
+
+	return mlb;
+}
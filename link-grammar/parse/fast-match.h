@@ -14,15 +14,31 @@
 #define _FAST_MATCH_H_
 
 #include <stddef.h> // for size_t
+#include <stdint.h> // for uint8_t
 #include "api-types.h"
+#include "connectors.h"
+#include "disjunct-utils.h"
 #include "link-includes.h" // for Sentence
 
-typedef struct Match_node_struct Match_node;
-struct Match_node_struct
+/**
+ * A bucket of the match tables: the disjuncts of a word whose left (or
+ * right) connector has the given upper-case part. They are kept in a
+ * contiguous array, sorted by the nearest_word of that connector.
+ */
+typedef struct
 {
-	Match_node * next;
-	Disjunct * d;
-};
+	int uc_num;                  /* The upper-case part of the connectors */
+	unsigned int size;           /* Number of disjuncts; 0 if unused */
+	Disjunct ** d;
+} Match_bucket;
+
+/* An entry of the match-list cache. */
+typedef struct
+{
+	const Connector *le, *re;
+	int w;                       /* -1 if unused */
+	size_t mlb;                  /* The match-list start */
+} Match_list_cache_entry;
 
 typedef struct fast_matcher_s fast_matcher_t;
 struct fast_matcher_s
@@ -32,21 +48,76 @@ struct fast_matcher_s
 	unsigned int *r_table_size;
 
 	/* the beginnings of the hash tables */
-	Match_node *** l_table;
-	Match_node *** r_table;
+	Match_bucket ** l_table;
+	Match_bucket ** r_table;
+
+	size_t words_alloced;        /* Allocated size of the above arrays */
+	Match_bucket * table_buf;    /* The storage of all the hash tables */
+	size_t table_buf_size;       /* Number of Match_buckets in it */
+	Disjunct ** bucket_buf;      /* The storage of all the buckets */
+	size_t bucket_buf_size;      /* Number of Disjunct pointers in it */
+
+	/* The lower-case parts of the bucket connectors, parallel to
+	 * bucket_buf, for lc_easy_match_batch(). */
+	lc_enc_t * bucket_lc;        /* Their encodings */
+	lc_enc_t * bucket_lc_mask;   /* Their lc_nonzero_mask(); 0 if unencoded */
+	unsigned int max_bucket_size;
+	const gword_set ** gword_sets; /* Of the sentence, for the connectors */
+
+	/* The above tables are shared (read-only) by its clones, which have
+	 * their own match-list stack and flags, for use by other threads. */
+	const fast_matcher_t *shared; /* The owner of the tables, for a clone */
 
 	/* I'll pedantically maintain my own array of these cells */
 	Disjunct ** match_list;      /* match-list stack */
+	uint8_t * match_list_flags;  /* The match flags of its elements */
 	size_t match_list_end;       /* index to the match-list stack end */
 	size_t match_list_size;      /* number of allocated elements */
+
+	/* The match-list cache. The cached match lists are kept at the
+	 * bottom of the match-list stack, and are never popped. */
+	Match_list_cache_entry * ml_cache; /* Hash table; NULL if not used */
+	size_t ml_cache_size;        /* Number of entries (a power of 2) */
+	size_t ml_cache_count;       /* Number of used entries */
+	size_t ml_cache_end;         /* The end of the cached match lists */
+	size_t ml_cache_hits;
+	size_t ml_cache_misses;
+
+	/* The match indications of the disjuncts of the match list being
+	 * built, indexed by disjunct_index(). They are kept here, and not
+	 * in the disjuncts, so the clones can be used concurrently. */
+	const Disjunct * disjuncts;  /* The disjunct store array */
+	uint8_t * match_flags;
+	size_t num_disjuncts;        /* Allocated number of match_flags */
+	uint8_t * lc_match;          /* Batch match results, per bucket element */
+	unsigned int lc_match_size;  /* Allocated number of lc_match */
+#ifdef VERIFY_MATCH_LIST
+	int * match_id;              /* verify the match list integrity */
+#endif
 };
 
+/* Match-list element flags */
+#define MATCH_LEFT  0x1 /* The left connector of the disjunct matches */
+#define MATCH_RIGHT 0x2 /* The right connector of the disjunct matches */
+
 /* See the source file for documentation. */
-fast_matcher_t* alloc_fast_matcher(const Sentence);
+fast_matcher_t* alloc_fast_matcher(const Sentence, bool cache);
+void reset_fast_matcher(fast_matcher_t*, const Sentence, bool cache);
+fast_matcher_t* clone_fast_matcher(const fast_matcher_t*);
 void free_fast_matcher(fast_matcher_t*);
 
 size_t form_match_list(fast_matcher_t *, int, Connector *, int, Connector *, int);
 
+/**
+ * Return the index of the given disjunct in the disjunct store, for
+ * the per-disjunct side arrays.
+ */
+static inline size_t disjunct_index(const fast_matcher_t *ctxt,
+                                    const Disjunct *d)
+{
+	return d - ctxt->disjuncts;
+}
+
 /**
  * Return the match-list element at the given index.
  */
@@ -56,10 +127,20 @@ static inline Disjunct *get_match_list_element(fast_matcher_t *ctxt, size_t mli)
 }
 
 /**
- * Pop up the match-list stack
+ * Return the match flags (MATCH_LEFT, MATCH_RIGHT) of the match-list
+ * element at the given index.
+ */
+static inline uint8_t get_match_flags(fast_matcher_t *ctxt, size_t mli)
+{
+	return ctxt->match_list_flags[mli];
+}
+
+/**
+ * Pop up the match-list stack. The cached match lists are not popped.
  */
 static inline void pop_match_list(fast_matcher_t *ctxt, size_t match_list_last)
 {
+	if (match_list_last < ctxt->ml_cache_end) return;
 	ctxt->match_list_end = match_list_last;
 }
 
@@ -10,6 +10,8 @@
 /*************************************************************************/
 
 #include <math.h>
+
+#define PERFORM_COUNT_HISTOGRAMMING 1 /* For count-hist.c */
 #include "histogram.h"
 
 #ifdef PERFORM_COUNT_HISTOGRAMMING
@@ -12,6 +12,9 @@
 #ifndef _HISTOGRAM_H_
 #define _HISTOGRAM_H_
 
+#include <limits.h>
+#include <stdbool.h>
+
 #ifndef _MSC_VER
 typedef long long s64; /* signed 64-bit integer, even on 32-bit cpus */
 #define PARSE_NUM_OVERFLOW (1LL<<24)
@@ -22,11 +25,36 @@ typedef signed __int64 s64; /* signed 64-bit integer, even on 32-bit cpus */
 #endif
 
 
+/* The number of null counts (0 to NULL_COUNT_VECTOR_SIZE-1) that are
+ * counted at once when PERFORM_NULL_COUNT_VECTORS is defined. */
+#define NULL_COUNT_VECTOR_SIZE 8
+
+/* The cost by which the linkages are compared when looking for the best
+ * one (see count-mincost.c): The disjunct cost, and then the link cost,
+ * as in VDAL_compare_parse(). */
+typedef struct
+{
+	double disjunct_cost;
+	int link_cost;
+} Linkage_cost;
+
+/* Disjunct costs that differ by less than this are considered equal,
+ * because they are summed up in a different order than in linkage_score(). */
+#define LINKAGE_COST_EPSILON 1e-4
+
+static inline bool linkage_cost_less(const Linkage_cost *a, const Linkage_cost *b)
+{
+	if (a->disjunct_cost < b->disjunct_cost - LINKAGE_COST_EPSILON) return true;
+	if (a->disjunct_cost > b->disjunct_cost + LINKAGE_COST_EPSILON) return false;
+	return a->link_cost < b->link_cost;
+}
+
 /*
  * Count Histogramming is currently not required for anything, and the
- * code runs about 6% faster when it is disabled.
- *
-#define PERFORM_COUNT_HISTOGRAMMING 1
+ * code runs about 6% faster when it is disabled. Hence it is done only
+ * in a separate instance of the counting code, which is compiled with
+ * PERFORM_COUNT_HISTOGRAMMING defined (see count-hist.c), and is used
+ * only when requested by parse_options_set_count_histograms().
  */
 #ifdef PERFORM_COUNT_HISTOGRAMMING
 
@@ -64,8 +92,124 @@ void hist_muladdv(Count_bin* prod, const Count_bin*, double, const Count_bin);
 static inline s64 hist_total(Count_bin* tot) { return tot->total; }
 s64 hist_cut_total(Count_bin* tot, int min_total);
 
+static inline void hist_link_cost(Count_bin* tot, int length) {}
+
 double hist_cost_cutoff(Count_bin*, int count);
 
+#elif defined PERFORM_NULL_COUNT_VECTORS
+
+/**
+ * The parse counts for all the null counts at once, as a polynomial in
+ * the number of null words, truncated to NULL_COUNT_VECTOR_SIZE terms:
+ * c[n] is the number of parses with n null words. The product of two
+ * counts is then the product of the polynomials. The total is the sum
+ * of the terms, which is all that is needed to tell whether the count
+ * is zero.
+ * The terms saturate at NULL_COUNT_SATURATED, which is more than INT_MAX
+ * (so a count overflow is still detected), but small enough for the
+ * product of two terms, plus a term, not to overflow.
+ */
+typedef struct
+{
+	s64 c[NULL_COUNT_VECTOR_SIZE];
+} Count_bin;
+
+#define NULL_COUNT_SATURATED ((s64)INT_MAX + 1)
+
+static inline s64 null_count_saturate(s64 c)
+	{ return (NULL_COUNT_SATURATED < c) ? NULL_COUNT_SATURATED : c; }
+
+static inline Count_bin hist_zero(void)
+	{ Count_bin z = {{0}}; return z; }
+static inline Count_bin hist_one(void)
+	{ Count_bin o = {{1}}; return o; }
+
+static inline void hist_accum(Count_bin* sum, double cost, const Count_bin* a)
+{
+	for (int i = 0; i < NULL_COUNT_VECTOR_SIZE; i++)
+		sum->c[i] = null_count_saturate(sum->c[i] + a->c[i]);
+}
+static inline void hist_accumv(Count_bin* sum, double cost, const Count_bin a)
+	{ hist_accum(sum, cost, &a); }
+static inline void hist_muladd(Count_bin* prod, const Count_bin* a, double cost,
+                               const Count_bin* b)
+{
+	for (int i = 0; i < NULL_COUNT_VECTOR_SIZE; i++)
+	{
+		if (0 == a->c[i]) continue;
+		for (int j = 0; i + j < NULL_COUNT_VECTOR_SIZE; j++)
+			prod->c[i+j] = null_count_saturate(prod->c[i+j] + a->c[i] * b->c[j]);
+	}
+}
+static inline void hist_muladdv(Count_bin* prod, const Count_bin* a, double cost,
+                                const Count_bin b)
+	{ hist_muladd(prod, a, cost, &b); }
+
+static inline s64 hist_total(const Count_bin* tot)
+{
+	s64 total = 0;
+	for (int i = 0; i < NULL_COUNT_VECTOR_SIZE; i++)
+		total += tot->c[i];
+	return total;
+}
+
+static inline void hist_link_cost(Count_bin* tot, int length) {}
+
+#elif defined PERFORM_MIN_COST
+
+/**
+ * The parse count, along with the cost of the best parse. For the
+ * costs, this is the "tropical semiring": The sum of two counts takes
+ * the minimum of their costs, and their product adds up the costs.
+ * The counts saturate at INT_MAX instead of overflowing, so the best
+ * parse is found even when there are too many parses to count.
+ */
+typedef struct
+{
+	s64 total;
+	Linkage_cost best;
+} Count_bin;
+
+static inline Count_bin hist_zero(void)
+	{ Count_bin z = {0, {0.0, 0}}; return z; }
+static inline Count_bin hist_one(void)
+	{ Count_bin o = {1, {0.0, 0}}; return o; }
+
+static inline void hist_min(Count_bin* sum, s64 count, const Linkage_cost* cost)
+{
+	if (0 == count) return;
+	if ((0 == sum->total) || linkage_cost_less(cost, &sum->best))
+		sum->best = *cost;
+	sum->total += count;
+	if (INT_MAX < sum->total) sum->total = INT_MAX;
+}
+
+static inline void hist_accum(Count_bin* sum, double cost, const Count_bin* a)
+{
+	Linkage_cost c = a->best;
+	c.disjunct_cost += cost;
+	hist_min(sum, a->total, &c);
+}
+static inline void hist_accumv(Count_bin* sum, double cost, const Count_bin a)
+	{ hist_accum(sum, cost, &a); }
+static inline void hist_muladd(Count_bin* prod, const Count_bin* a, double cost,
+                               const Count_bin* b)
+{
+	Linkage_cost c;
+	c.disjunct_cost = a->best.disjunct_cost + cost + b->best.disjunct_cost;
+	c.link_cost = a->best.link_cost + b->best.link_cost;
+	hist_min(prod, a->total * b->total, &c);
+}
+static inline void hist_muladdv(Count_bin* prod, const Count_bin* a, double cost,
+                                const Count_bin b)
+	{ hist_muladd(prod, a, cost, &b); }
+
+static inline s64 hist_total(const Count_bin* tot) { return tot->total; }
+
+/* Add the cost of a link of the given length, see linkage_score(). */
+static inline void hist_link_cost(Count_bin* tot, int length)
+	{ tot->best.link_cost += length - 1; }
+
 #else
 
 typedef s64 Count_bin;
@@ -87,6 +231,8 @@ static inline void hist_muladdv(Count_bin* prod, Count_bin* a, double cost, Coun
 static inline s64 hist_total(Count_bin* tot) { return *tot; }
 static inline s64 hist_cut_total(Count_bin* tot, int min_total) { return *tot; }
 
+static inline void hist_link_cost(Count_bin* tot, int length) {}
+
 static inline double hist_cost_cutoff(Count_bin* tot, int count) { return 1.0e38; }
 
 #endif /* PERFORM_COUNT_HISTOGRAMMING */
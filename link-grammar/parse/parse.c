@@ -27,10 +27,54 @@
 #include "preparation.h"
 #include "prune.h"
 #include "resources.h"
+#include "string-set.h"
 #include "tokenize/word-structures.h"  // For Word_struct
 
 #define D_PARSE 5 /* Debug level for this file. */
 
+/* Parallel linkage processing (see process_linkages_parallel()) needs
+ * POSIX threads. */
+#if defined HAVE_PTHREAD
+#define USE_PARALLEL_LINKAGES
+#include <pthread.h>
+#endif
+
+/* The parse contexts that are kept, per thread, for parsing the next
+ * sentence when opts->reuse_parse_memory is set. This saves allocating
+ * (and zeroing) the count table and the fast-matcher tables for each
+ * sentence. They are released by a parse with reuse_parse_memory unset
+ * on the same thread, or by dictionary_delete() on that thread.
+ * Without TLS they would be shared by all the threads, so then they are
+ * not kept at all. */
+static TLS count_context_t *saved_count_context;
+static TLS fast_matcher_t *saved_fast_matcher;
+
+static bool reuse_parse_memory(Parse_Options opts)
+{
+#ifdef TLS_UNAVAILABLE
+	return false;
+#else
+	return opts->reuse_parse_memory;
+#endif
+}
+
+/**
+ * Free the parse contexts that are kept for the calling thread.
+ */
+void free_saved_parse_contexts(void)
+{
+	if (NULL != saved_count_context)
+	{
+		free_count_context(saved_count_context);
+		saved_count_context = NULL;
+	}
+	if (NULL != saved_fast_matcher)
+	{
+		free_fast_matcher(saved_fast_matcher);
+		saved_fast_matcher = NULL;
+	}
+}
+
 static Linkage linkage_array_new(int num_to_alloc)
 {
 	Linkage lkgs = (Linkage) malloc(num_to_alloc * sizeof(struct Linkage_s));
@@ -38,10 +82,14 @@ static Linkage linkage_array_new(int num_to_alloc)
 	return lkgs;
 }
 
-static bool setup_linkages(Sentence sent, extractor_t* pex,
-                          fast_matcher_t* mchxt,
-                          count_context_t* ctxt,
-                          Parse_Options opts)
+/**
+ * Build the parse set of the linkages which have been counted.
+ * Return true if the count overflowed.
+ */
+static bool make_parse_set(Sentence sent, extractor_t* pex,
+                           fast_matcher_t* mchxt,
+                           count_context_t* ctxt,
+                           Parse_Options opts)
 {
 	bool overflowed = build_parse_set(pex, sent, mchxt, ctxt, sent->null_count, opts);
 	print_time(opts, "Built parse set");
@@ -50,10 +98,21 @@ static bool setup_linkages(Sentence sent, extractor_t* pex,
 	{
 		err_ctxt ec = { sent };
 		err_msgc(&ec, lg_Warn, "Count overflow.\n"
-			"Considering a random subset of %zu of an unknown and large number of linkages\n",
+			"Considering %s %zu of an unknown and large number of linkages\n",
+			opts->kbest_linkages ? "the best" : "a random subset of",
 			opts->linkage_limit);
 	}
 
+	return overflowed;
+}
+
+static bool setup_linkages(Sentence sent, extractor_t* pex,
+                          fast_matcher_t* mchxt,
+                          count_context_t* ctxt,
+                          Parse_Options opts)
+{
+	bool overflowed = make_parse_set(sent, pex, mchxt, ctxt, opts);
+
 	if (sent->num_linkages_found == 0)
 	{
 		sent->num_linkages_alloced = 0;
@@ -107,26 +166,12 @@ static void print_chosen_disjuncts_words(const Linkage lkg, bool prt_optword)
 
 #define D_PL 7
 /**
- * This fills the linkage array with morphologically-acceptable
- * linkages.
+ * The number of linkages to try in order to find num_wanted
+ * morphologically-acceptable ones.
  */
-static void process_linkages(Sentence sent, extractor_t* pex,
-                             bool overflowed, Parse_Options opts)
+static size_t max_linkage_tries(Sentence sent, size_t num_wanted,
+                                bool pick_randomly, Parse_Options opts)
 {
-	if (0 == sent->num_linkages_found) return;
-	if (0 == sent->num_linkages_alloced) return; /* Avoid a later crash. */
-
-	/* Pick random linkages if we get more than what was asked for. */
-	bool pick_randomly = overflowed ||
-	    (sent->num_linkages_found > (int) sent->num_linkages_alloced);
-
-	sent->num_valid_linkages = 0;
-	size_t N_invalid_morphism = 0;
-
-	size_t itry = 0;
-	size_t in = 0;
-	size_t maxtries;
-
 	/* In the case of overflow, which will happen for some long
 	 * sentences, but is particularly common for the amy/ady random
 	 * splitters, we want to find as many morpho-acceptable linkages
@@ -141,51 +186,297 @@ static void process_linkages(Sentence sent, extractor_t* pex,
 	 */
 #define MAX_TRIES 250000
 
-	if (pick_randomly)
+	if (pick_randomly || opts->kbest_linkages)
 	{
 		/* Try picking many more linkages, but not more than possible. */
-		maxtries = MIN((int) sent->num_linkages_alloced + MAX_TRIES,
-		               sent->num_linkages_found);
+		return MIN((int) num_wanted + MAX_TRIES, sent->num_linkages_found);
+	}
+
+	return num_wanted;
+}
+
+/**
+ * Extract the links of linkage number itry into lkg, which has been
+ * initialized. With opts->kbest_linkages, they are extracted in cost
+ * order (see extract_kbest_links()), else by index or at random.
+ * The link names are not computed (see compute_link_names()).
+ * Return false if there are no more linkages to extract.
+ */
+static bool extract_linkage(Sentence sent, extractor_t* pex, Linkage lkg,
+                            size_t itry, bool pick_randomly,
+                            Parse_Options opts)
+{
+	/* Negative values tell extract-links to pick randomly; for
+	 * reproducible-rand, the actual value is the rand seed. */
+	lkg->lifo.index = pick_randomly ? -(itry+1) : itry;
+
+	if (opts->kbest_linkages)
+	{
+		if (!extract_kbest_links(pex, lkg)) return false;
 	}
 	else
 	{
-		maxtries = sent->num_linkages_alloced;
+		extract_links(pex, lkg);
 	}
 
-	bool need_init = true;
-	for (itry=0; itry<maxtries; itry++)
+	return true;
+}
+
+/**
+ * Check the morphology of the extracted linkage lkg. If it is
+ * acceptable, remove its empty words and return true. Else clear it,
+ * so it can be used for the next try, and return false.
+ */
+static bool sane_linkage(Sentence sent, Linkage lkg, Parse_Options opts)
+{
+	if (verbosity_level(+D_PL))
 	{
-		Linkage lkg = &sent->lnkages[in];
-		Linkage_info * lifo = &lkg->lifo;
+		err_msg(lg_Debug, "chosen_disjuncts before:\n\\");
+		print_chosen_disjuncts_words(lkg, /*prt_opt*/true);
+	}
 
-		/* Negative values tell extract-links to pick randomly; for
-		 * reproducible-rand, the actual value is the rand seed. */
-		lifo->index = pick_randomly ? -(itry+1) : itry;
+	if (sane_linkage_morphism(sent, lkg, opts))
+	{
+		remove_empty_words(lkg);
 
-		if (need_init)
+		if (verbosity_level(+D_PL))
 		{
-			partial_init_linkage(sent, lkg, sent->length);
-			need_init = false;
+			err_msg(lg_Debug, "chosen_disjuncts after:\n\\");
+			print_chosen_disjuncts_words(lkg, /*prt_opt*/false);
 		}
-		extract_links(pex, lkg);
-		compute_link_names(lkg, sent->string_set);
+		return true;
+	}
 
-		if (verbosity_level(+D_PL))
+	lkg->num_links = 0;
+	lkg->num_words = sent->length;
+	// memset(lkg->link_array, 0, lkg->lasz * sizeof(Link));
+	memset(lkg->chosen_disjuncts, 0, sent->length * sizeof(Disjunct *));
+	return false;
+}
+
+#ifdef USE_PARALLEL_LINKAGES
+/* Parallel linkage processing.
+ *
+ * The linkages are extracted and checked independently of each other,
+ * once the parse set is built. So with opts->threads > 1, when many
+ * linkages are wanted, they are tried in batches of consecutive tries,
+ * and each batch is divided among threads. The batch is then merged in
+ * the order of the tries, so the resulting linkages are the same as
+ * with serial processing. Linkages that are extracted in cost order, or
+ * at random with a non-repeatable random state, depend on the previous
+ * ones; they are extracted by the calling thread, and only checked by
+ * the threads. The link names, which the check needs, are computed by
+ * each thread into a string set of its own, and are moved to the string
+ * set of the sentence in the merge.
+ */
+#define PARALLEL_LINKAGES_MIN 64
+
+typedef struct
+{
+	Sentence sent;
+	extractor_t *pex;
+	Parse_Options opts;
+	Linkage lkgs;              /* The linkages of the batch */
+	bool *sane;                /* Their morphology check results */
+	size_t first_try;          /* The try number of lkgs[0] */
+	size_t from, to;           /* The part of the batch of this thread */
+	bool pick_randomly;
+	bool extracted;            /* They have been extracted already */
+	String_set *string_set;    /* For the link names */
+	pthread_t thread;
+} linkage_worker;
+
+static void *linkage_worker_run(void *arg)
+{
+	linkage_worker *lw = arg;
+
+	for (size_t i = lw->from; i < lw->to; i++)
+	{
+		Linkage lkg = &lw->lkgs[i];
+
+		if (!lw->extracted)
 		{
-			err_msg(lg_Debug, "chosen_disjuncts before:\n\\");
-			print_chosen_disjuncts_words(lkg, /*prt_opt*/true);
+			partial_init_linkage(lw->sent, lkg, lw->sent->length);
+			extract_linkage(lw->sent, lw->pex, lkg, lw->first_try + i,
+			                lw->pick_randomly, lw->opts);
 		}
+		compute_link_names(lkg, lw->string_set);
+		lw->sane[i] = sane_linkage(lw->sent, lkg, lw->opts);
+	}
+
+	return NULL;
+}
+
+/**
+ * Move the link names of the linkage that are in the string set of a
+ * thread to the string set of the sentence. The other ones are the
+ * connector strings, which are kept as is.
+ */
+static void move_link_names(Linkage lkg, String_set *from, String_set *sset)
+{
+	for (size_t i = 0; i < lkg->num_links; i++)
+	{
+		const char *name = lkg->link_array[i].link_name;
+
+		if (name != string_set_lookup(name, from)) continue;
+		lkg->link_array[i].link_name = string_set_add(name, sset);
+	}
+}
+
+/**
+ * Like process_linkages(), with several threads.
+ * Return false if it should be done serially.
+ */
+static bool process_linkages_parallel(Sentence sent, extractor_t* pex,
+                                      bool pick_randomly, Parse_Options opts)
+{
+	size_t N_wanted = sent->num_linkages_alloced;
+	size_t num_threads = N_wanted / (PARALLEL_LINKAGES_MIN / 2);
+
+	if ((size_t)opts->threads < num_threads) num_threads = opts->threads;
+	if ((num_threads <= 1) || (N_wanted < PARALLEL_LINKAGES_MIN)) return false;
+
+	bool serial_extract = opts->kbest_linkages ||
+	                      (pick_randomly && (0 != sent->rand_state));
+	size_t maxtries = max_linkage_tries(sent, N_wanted, pick_randomly, opts);
+	size_t N_invalid_morphism = 0;
+	size_t itry = 0;
+	size_t in = 0;
+	bool more = true;
 
-		if (sane_linkage_morphism(sent, lkg, opts))
+	linkage_worker *lw = alloca(num_threads * sizeof(linkage_worker));
+	bool *started = alloca(num_threads * sizeof(bool));
+	for (size_t t = 0; t < num_threads; t++)
+		lw[t].string_set = string_set_create();
+	Linkage lkgs = NULL;
+	bool *sane = NULL;
+	size_t batch_alloced = 0;
+
+	while (more && (in < N_wanted) && (itry < maxtries))
+	{
+		size_t n = MAX(N_wanted - in, PARALLEL_LINKAGES_MIN);
+		n = MIN(n, maxtries - itry);
+
+		if (batch_alloced < n)
+		{
+			free(lkgs);
+			free(sane);
+			lkgs = malloc(n * sizeof(struct Linkage_s));
+			sane = malloc(n * sizeof(bool));
+			batch_alloced = n;
+		}
+		memset(lkgs, 0, n * sizeof(struct Linkage_s));
+
+		if (serial_extract)
+		{
+			for (size_t i = 0; i < n; i++)
+			{
+				partial_init_linkage(sent, &lkgs[i], sent->length);
+				if (!extract_linkage(sent, pex, &lkgs[i], itry + i,
+				                     pick_randomly, opts))
+				{
+					free_linkage(&lkgs[i]);
+					n = i;
+					more = false;
+					break;
+				}
+			}
+		}
+
+		for (size_t t = 0; t < num_threads; t++)
+		{
+			lw[t].sent = sent;
+			lw[t].pex = pex;
+			lw[t].opts = opts;
+			lw[t].lkgs = lkgs;
+			lw[t].sane = sane;
+			lw[t].first_try = itry;
+			lw[t].from = n * t / num_threads;
+			lw[t].to = n * (t + 1) / num_threads;
+			lw[t].pick_randomly = pick_randomly;
+			lw[t].extracted = serial_extract;
+		}
+		for (size_t t = 1; t < num_threads; t++)
+			started[t] = (0 == pthread_create(&lw[t].thread, NULL,
+			                                  linkage_worker_run, &lw[t]));
+		linkage_worker_run(&lw[0]);
+		for (size_t t = 1; t < num_threads; t++)
 		{
-			remove_empty_words(lkg);
+			if (started[t])
+				pthread_join(lw[t].thread, NULL);
+			else
+				linkage_worker_run(&lw[t]);
+		}
 
-			if (verbosity_level(+D_PL))
+		/* Merge, in the order of the tries. */
+		size_t t = 0;
+		for (size_t i = 0; i < n; i++)
+		{
+			while (i >= lw[t].to) t++;
+			if ((in < N_wanted) && sane[i])
 			{
-				err_msg(lg_Debug, "chosen_disjuncts after:\n\\");
-				print_chosen_disjuncts_words(lkg, /*prt_opt*/false);
+				move_link_names(&lkgs[i], lw[t].string_set, sent->string_set);
+				sent->lnkages[in++] = lkgs[i];
+				continue;
 			}
+			if (in < N_wanted) N_invalid_morphism++;
+			free_linkage(&lkgs[i]);
+		}
+		itry += n;
+	}
+
+	for (size_t t = 0; t < num_threads; t++)
+		string_set_delete(lw[t].string_set);
+	free(lkgs);
+	free(sane);
 
+	sent->num_valid_linkages = in;
+	sent->num_linkages_alloced = sent->num_valid_linkages;
+
+	lgdebug(D_PARSE, "Info: sane_morphism(): %zu of %zu linkages had "
+	        "invalid morphology construction\n", N_invalid_morphism,
+	        in + N_invalid_morphism);
+	return true;
+}
+#endif /* USE_PARALLEL_LINKAGES */
+
+/**
+ * This fills the linkage array with morphologically-acceptable
+ * linkages.
+ */
+static void process_linkages(Sentence sent, extractor_t* pex,
+                             bool pick_randomly, Parse_Options opts)
+{
+	if (0 == sent->num_linkages_found) return;
+	if (0 == sent->num_linkages_alloced) return; /* Avoid a later crash. */
+
+#ifdef USE_PARALLEL_LINKAGES
+	if (process_linkages_parallel(sent, pex, pick_randomly, opts)) return;
+#endif
+
+	sent->num_valid_linkages = 0;
+	size_t N_invalid_morphism = 0;
+
+	size_t itry = 0;
+	size_t in = 0;
+	size_t maxtries = max_linkage_tries(sent, sent->num_linkages_alloced,
+	                                    pick_randomly, opts);
+
+	bool need_init = true;
+	for (itry=0; itry<maxtries; itry++)
+	{
+		Linkage lkg = &sent->lnkages[in];
+
+		if (need_init)
+		{
+			partial_init_linkage(sent, lkg, sent->length);
+			need_init = false;
+		}
+		if (!extract_linkage(sent, pex, lkg, itry, pick_randomly, opts)) break;
+		compute_link_names(lkg, sent->string_set);
+
+		if (sane_linkage(sent, lkg, opts))
+		{
 			need_init = true;
 			in++;
 			if (in >= sent->num_linkages_alloced) break;
@@ -193,10 +484,6 @@ static void process_linkages(Sentence sent, extractor_t* pex,
 		else
 		{
 			N_invalid_morphism++;
-			lkg->num_links = 0;
-			lkg->num_words = sent->length;
-			// memset(lkg->link_array, 0, lkg->lasz * sizeof(Link));
-			memset(lkg->chosen_disjuncts, 0, sent->length * sizeof(Disjunct *));
 		}
 	}
 
@@ -247,6 +534,202 @@ static void sort_linkages(Sentence sent, Parse_Options opts)
 	print_time(opts, "Sorted all linkages");
 }
 
+/**
+ * Count the linkages with sent->null_count null words, and return their
+ * number, clamped to INT_MAX.
+ */
+static s64 count_linkages(Sentence sent, fast_matcher_t *mchxt,
+                          count_context_t *ctxt, Parse_Options opts)
+{
+	s64 total = do_parse(sent, mchxt, ctxt, sent->null_count, opts);
+
+	lgdebug(D_PARSE, "Info: Total count with %zu null links:   %lld\n",
+	        sent->null_count, total);
+
+	/* total is 64-bit, num_linkages_found is 32-bit. Clamp */
+	total = (total > INT_MAX) ? INT_MAX : total;
+	total = (total < 0) ? INT_MAX : total;
+
+	sent->num_linkages_found = (int) total;
+	print_time(opts, "Counted parses");
+
+	return total;
+}
+
+/**
+ * Count the linkages with sent->null_count null words, and extract and
+ * post-process up to opts->linkage_limit of them.
+ * Return the number of linkages.
+ */
+static s64 parse_linkages(Sentence sent, fast_matcher_t *mchxt,
+                          count_context_t *ctxt, Parse_Options opts)
+{
+	s64 total = count_linkages(sent, mchxt, ctxt, opts);
+
+	extractor_t * pex = extractor_new(sent->length, sent->rand_state);
+	bool ovfl = setup_linkages(sent, pex, mchxt, ctxt, opts);
+	/* Pick random linkages if we get more than what was asked for,
+	 * unless they are extracted in cost order. */
+	bool pick_randomly = !opts->kbest_linkages && (ovfl ||
+	    (sent->num_linkages_found > (int) sent->num_linkages_alloced));
+	process_linkages(sent, pex, pick_randomly, opts);
+	free_extractor(pex);
+
+	post_process_lkgs(sent, opts);
+
+	return total;
+}
+
+/**
+ * Like parse_linkages(), but extract only the best linkage (see
+ * build_best_parse_set()). The linkages are still counted, but only up
+ * to INT_MAX.
+ */
+static s64 parse_best_linkage(Sentence sent, fast_matcher_t *mchxt,
+                              count_context_t *ctxt, Parse_Options opts)
+{
+	s64 total = do_parse_best(sent, mchxt, ctxt, sent->null_count, opts);
+
+	lgdebug(D_PARSE, "Info: Total count with %zu null links:   %lld\n",
+	        sent->null_count, total);
+
+	sent->num_linkages_found = (int) total;
+	print_time(opts, "Counted parses and found the best one");
+	if (0 == total) return 0;
+
+	extractor_t * pex = extractor_new(sent->length, sent->rand_state);
+	if (build_best_parse_set(pex, sent, mchxt, ctxt, sent->null_count, opts))
+	{
+		sent->num_linkages_alloced = 1;
+		sent->lnkages = linkage_array_new(1);
+		process_linkages(sent, pex, /*pick_randomly*/false, opts);
+	}
+	free_extractor(pex);
+	print_time(opts, "Extracted the best linkage");
+
+	post_process_lkgs(sent, opts);
+
+	return total;
+}
+
+/* The state of a parse, which is kept while the null counts are tried
+ * one after the other (see classic_parse()). */
+typedef struct
+{
+	Sentence sent;
+	Parse_Options opts;
+	fast_matcher_t *mchxt;
+	count_context_t *ctxt;   /* NULL if the parse has not been started */
+	bool pp_and_power_prune_done;
+	bool is_null_count_0;
+	int max_null_count;
+} parse_state_t;
+
+/**
+ * Build the disjuncts of the sentence, and get the parse contexts.
+ * Return false if the resources have been exhausted.
+ */
+static bool parse_start(parse_state_t *ps, Sentence sent, Parse_Options opts)
+{
+	memset(ps, 0, sizeof(parse_state_t));
+	ps->sent = sent;
+	ps->opts = opts;
+	ps->is_null_count_0 = (0 == opts->min_null_count);
+	ps->max_null_count = MIN((int)sent->length, opts->max_null_count);
+
+	/* Build lists of disjuncts */
+	prepare_to_parse(sent, opts);
+	if (resources_exhausted(opts->resources)) return false;
+
+	if (reuse_parse_memory(opts) && (NULL != saved_count_context))
+	{
+		ps->ctxt = saved_count_context;
+		ps->mchxt = saved_fast_matcher;
+		saved_count_context = NULL;
+		saved_fast_matcher = NULL;
+		reset_count_context(ps->ctxt);
+	}
+	else
+	{
+		free_saved_parse_contexts();
+		ps->ctxt = alloc_count_context();
+	}
+
+	if (ps->is_null_count_0 && (0 < ps->max_null_count))
+	{
+		/* Save the disjuncts in case we need to parse with null_count>0. */
+		save_disjuncts(sent);
+	}
+
+	return true;
+}
+
+/**
+ * Prune the disjuncts for parsing with null_count nl, if needed, and
+ * set up the fast matcher for them.
+ * Return false if the resources have been exhausted.
+ */
+static bool parse_prepare_null_count(parse_state_t *ps, int nl)
+{
+	Sentence sent = ps->sent;
+	Parse_Options opts = ps->opts;
+
+	if (!ps->pp_and_power_prune_done)
+	{
+		if (0 != nl)
+		{
+			ps->pp_and_power_prune_done = true;
+			if (ps->is_null_count_0)
+				opts->min_null_count = 1; /* Don't optimize for null_count==0. */
+
+			/* We are parsing now with null_count>0, when previously we
+			 * parsed with null_count==0. Restore the saved disjuncts.
+			 * Their connectors are the same ones as before, so the
+			 * counts memoized for them are not valid anymore. */
+			if (NULL != sent->disjuncts_snapshot)
+			{
+				restore_disjuncts(sent);
+				reset_count_context(ps->ctxt);
+			}
+		}
+		pp_and_power_prune(sent, opts);
+		if (ps->is_null_count_0) opts->min_null_count = 0;
+		if (resources_exhausted(opts->resources)) return false;
+
+		bool ml_cache = test_enabled("match-list-cache");
+		if (NULL == ps->mchxt)
+			ps->mchxt = alloc_fast_matcher(sent, ml_cache);
+		else
+			reset_fast_matcher(ps->mchxt, sent, ml_cache);
+		print_time(opts, "Initialized fast matcher");
+	}
+
+	return !resources_exhausted(opts->resources);
+}
+
+/**
+ * Release the saved disjuncts, and keep or free the parse contexts.
+ */
+static void parse_finish(parse_state_t *ps)
+{
+	if (NULL == ps->ctxt) return;
+
+	free_saved_disjuncts(ps->sent);
+
+	if (reuse_parse_memory(ps->opts))
+	{
+		saved_count_context = ps->ctxt;
+		saved_fast_matcher = ps->mchxt;
+	}
+	else
+	{
+		free_count_context(ps->ctxt);
+		free_fast_matcher(ps->mchxt);
+	}
+	ps->ctxt = NULL;
+	ps->mchxt = NULL;
+}
+
 /**
  * classic_parse() -- parse the given sentence.
  * Perform parsing, using the original link-grammar parsing algorithm
@@ -271,89 +754,50 @@ static void sort_linkages(Sentence sent, Parse_Options opts)
  * disjuncts which are not appropriate to continue do_parse() tries with
  * null_count>0. To solve that, we need to restore the original
  * disjuncts of the sentence and call pp_and_power_prune() once again.
+ * For that, save_disjuncts() takes a flat snapshot of the disjunct
+ * store: A copy of its Disjunct array and of the disjunct count of each
+ * word, and the nearest_word field of all of its connectors (the
+ * connectors themselves are not copied, since pruning doesn't change
+ * anything else in them). This costs a memcpy() of the disjunct array
+ * and a pass over the connectors, both when saving and when restoring.
+ * The snapshot is taken only if parsing with null_count==0 may be
+ * followed by parsing with null words.
  */
 void classic_parse(Sentence sent, Parse_Options opts)
 {
-	fast_matcher_t * mchxt = NULL;
-	count_context_t * ctxt;
-	bool pp_and_power_prune_done = false;
-	Disjunct **disjuncts_copy = NULL;
-	bool is_null_count_0 = (0 == opts->min_null_count);
-	int max_null_count = MIN((int)sent->length, opts->max_null_count);
-
-	/* Build lists of disjuncts */
-	prepare_to_parse(sent, opts);
-	if (resources_exhausted(opts->resources)) return;
-	ctxt = alloc_count_context(sent->length);
+	parse_state_t ps;
 
-	if (is_null_count_0 && (0 < max_null_count))
-	{
-		/* Save the disjuncts in case we need to parse with null_count>0. */
-		disjuncts_copy = alloca(sent->length * sizeof(Disjunct *));
-		for (size_t i = 0; i < sent->length; i++)
-			disjuncts_copy[i] = disjuncts_dup(sent->word[i].d);
-	}
+	if (!parse_start(&ps, sent, opts)) return;
 
-	for (int nl = opts->min_null_count; nl <= max_null_count; nl++)
+	for (int nl = opts->min_null_count; nl <= ps.max_null_count; nl++)
 	{
-		Count_bin hist;
 		s64 total;
 
-		if (!pp_and_power_prune_done)
-		{
-			if (0 != nl)
-			{
-				pp_and_power_prune_done = true;
-				if (is_null_count_0)
-					opts->min_null_count = 1; /* Don't optimize for null_count==0. */
-
-				/* We are parsing now with null_count>0, when previously we
-				 * parsed with null_count==0. Restore the save disjuncts. */
-				if (NULL != disjuncts_copy)
-				{
-					for (size_t i = 0; i < sent->length; i++)
-					{
-						free_disjuncts(sent->word[i].d);
-						sent->word[i].d = disjuncts_copy[i];
-					}
-					disjuncts_copy = NULL;
-				}
-			}
-			pp_and_power_prune(sent, opts);
-			if (is_null_count_0) opts->min_null_count = 0;
-			if (resources_exhausted(opts->resources)) break;
-
-			free_fast_matcher(mchxt);
-			mchxt = alloc_fast_matcher(sent);
-			print_time(opts, "Initialized fast matcher");
-		}
-
-		if (resources_exhausted(opts->resources)) break;
+		if (!parse_prepare_null_count(&ps, nl)) break;
 		free_linkages(sent);
 
 		sent->null_count = nl;
-		hist = do_parse(sent, mchxt, ctxt, sent->null_count, opts);
-		total = hist_total(&hist);
-
-		lgdebug(D_PARSE, "Info: Total count with %zu null links:   %lld\n",
-		        sent->null_count, total);
-
-		/* total is 64-bit, num_linkages_found is 32-bit. Clamp */
-		total = (total > INT_MAX) ? INT_MAX : total;
-		total = (total < 0) ? INT_MAX : total;
-
-		sent->num_linkages_found = (int) total;
-		print_time(opts, "Counted parses");
-
-		extractor_t * pex = extractor_new(sent->length, sent->rand_state);
-		bool ovfl = setup_linkages(sent, pex, mchxt, ctxt, opts);
-		process_linkages(sent, pex, ovfl, opts);
-		free_extractor(pex);
+		if (opts->best_linkage_only)
+		{
+			total = parse_best_linkage(sent, ps.mchxt, ps.ctxt, opts);
+			if (sent->num_valid_linkages > 0) break;
 
-		post_process_lkgs(sent, opts);
+			/* The best linkage is not valid. Look for valid ones among
+			 * the other linkages, as usual. */
+			if (0 != total)
+			{
+				lgdebug(D_PARSE, "Info: The best linkage is not valid\n");
+				free_linkages(sent);
+				total = parse_linkages(sent, ps.mchxt, ps.ctxt, opts);
+			}
+		}
+		else
+		{
+			total = parse_linkages(sent, ps.mchxt, ps.ctxt, opts);
+		}
 
 		if (sent->num_valid_linkages > 0) break;
-		if ((0 == nl) && (0 < max_null_count) && verbosity > 0)
+		if ((0 == nl) && (0 < ps.max_null_count) && verbosity > 0)
 			prt_error("No complete linkages found.\n");
 
 		/* If we are here, then no valid linkages were found.
@@ -363,11 +807,177 @@ void classic_parse(Sentence sent, Parse_Options opts)
 	}
 	sort_linkages(sent, opts);
 
-	if (NULL != disjuncts_copy)
+	parse_finish(&ps);
+}
+
+/**
+ * A linkage iterator (see sentence_linkage_iter_new()).
+ *
+ * It does what classic_parse() does, but lazily: The linkages of each
+ * null count are extracted, checked and post-processed one at a time,
+ * and only the valid ones are returned. As in classic_parse(), up to
+ * opts->linkage_limit morphologically-acceptable linkages are tried
+ * per null count, and the next null count is tried only if none of
+ * them is valid.
+ */
+struct Linkage_iter_s
+{
+	parse_state_t ps;
+	bool done;
+	int null_count;
+	s64 total;                /* The number of linkages at null_count */
+	extractor_t *pex;         /* NULL until null_count has been counted */
+	bool pick_randomly;
+	size_t itry, maxtries;
+	size_t num_sane;          /* Morphologically-acceptable ones so far */
+	size_t max_sane;
+	size_t num_valid;         /* The ones returned so far */
+	bool need_init;           /* lkg is not allocated */
+	struct Linkage_s lkg;     /* The current linkage */
+};
+
+Linkage_iter linkage_iter_new(Sentence sent, Parse_Options opts)
+{
+	Linkage_iter iter = (Linkage_iter) malloc(sizeof(struct Linkage_iter_s));
+	memset(iter, 0, sizeof(struct Linkage_iter_s));
+	iter->need_init = true;
+
+	free_linkages(sent);
+	post_process_reset(sent->postprocessor);
+
+	if (!parse_start(&iter->ps, sent, opts)) iter->done = true;
+	iter->null_count = opts->min_null_count;
+
+	return iter;
+}
+
+/**
+ * Count the linkages at iter->null_count, and build their parse set.
+ * Return false if there are no more null counts to try.
+ */
+static bool linkage_iter_count(Linkage_iter iter)
+{
+	parse_state_t *ps = &iter->ps;
+	Sentence sent = ps->sent;
+	Parse_Options opts = ps->opts;
+
+	if (iter->null_count > ps->max_null_count) return false;
+	if (!parse_prepare_null_count(ps, iter->null_count)) return false;
+
+	sent->null_count = iter->null_count;
+	iter->total = count_linkages(sent, ps->mchxt, ps->ctxt, opts);
+
+	iter->pex = extractor_new(sent->length, sent->rand_state);
+	bool ovfl = make_parse_set(sent, iter->pex, ps->mchxt, ps->ctxt, opts);
+
+	iter->max_sane = MIN(sent->num_linkages_found, (int) opts->linkage_limit);
+	iter->pick_randomly = !opts->kbest_linkages && (ovfl ||
+	    (sent->num_linkages_found > (int) iter->max_sane));
+	iter->maxtries = max_linkage_tries(sent, iter->max_sane,
+	                                   iter->pick_randomly, opts);
+	iter->itry = 0;
+	iter->num_sane = 0;
+	iter->num_valid = 0;
+
+	return true;
+}
+
+/**
+ * Done with the linkages at iter->null_count.
+ * Return false if no more null counts should be tried.
+ */
+static bool linkage_iter_next_null_count(Linkage_iter iter)
+{
+	free_extractor(iter->pex);
+	iter->pex = NULL;
+
+	if (iter->num_valid > 0) return false;
+	if ((0 == iter->null_count) && (0 < iter->ps.max_null_count) && verbosity > 0)
+		prt_error("No complete linkages found.\n");
+
+	/* If there was a parse overflow, give up now. */
+	if (PARSE_NUM_OVERFLOW < iter->total) return false;
+
+	iter->null_count++;
+	return true;
+}
+
+static void linkage_iter_free_linkage(Linkage_iter iter)
+{
+	if (iter->need_init) return;
+	free_linkage(&iter->lkg);
+	memset(&iter->lkg, 0, sizeof(struct Linkage_s));
+	iter->need_init = true;
+}
+
+Linkage linkage_iter_next(Linkage_iter iter)
+{
+	Sentence sent = iter->ps.sent;
+	Parse_Options opts = iter->ps.opts;
+	Linkage lkg = &iter->lkg;
+
+	/* The previously returned linkage is not valid anymore. */
+	linkage_iter_free_linkage(iter);
+
+	while (!iter->done)
 	{
-		for (size_t i = 0; i < sent->length; i++)
-			free_disjuncts(disjuncts_copy[i]);
+		if (NULL == iter->pex)
+		{
+			if (!linkage_iter_count(iter)) iter->done = true;
+			continue;
+		}
+
+		if (resources_exhausted(opts->resources))
+		{
+			iter->done = true;
+			break;
+		}
+
+		if ((iter->itry >= iter->maxtries) || (iter->num_sane >= iter->max_sane))
+		{
+			linkage_iter_free_linkage(iter);
+			if (!linkage_iter_next_null_count(iter)) iter->done = true;
+			continue;
+		}
+
+		if (iter->need_init)
+		{
+			partial_init_linkage(sent, lkg, sent->length);
+			iter->need_init = false;
+		}
+		if (!extract_linkage(sent, iter->pex, lkg, iter->itry++,
+		                     iter->pick_randomly, opts))
+		{
+			iter->maxtries = iter->itry;
+			continue;
+		}
+		compute_link_names(lkg, sent->string_set);
+		if (!sane_linkage(sent, lkg, opts)) continue;
+		iter->num_sane++;
+
+		if (!post_process_linkage(sent, lkg, opts))
+		{
+			linkage_iter_free_linkage(iter);
+			continue;
+		}
+		iter->num_valid++;
+
+		/* Perform the remaining initialization, as linkage_create() does. */
+		compute_chosen_words(sent, lkg, opts);
+		lkg->is_sent_long = (lkg->num_words >= opts->twopass_length);
+
+		return lkg;
 	}
-	free_count_context(ctxt);
-	free_fast_matcher(mchxt);
+
+	return NULL;
+}
+
+void linkage_iter_free(Linkage_iter iter)
+{
+	if (NULL == iter) return;
+
+	linkage_iter_free_linkage(iter);
+	free_extractor(iter->pex);
+	parse_finish(&iter->ps);
+	free(iter);
 }
@@ -1,3 +1,8 @@
 
 
 void classic_parse(Sentence, Parse_Options);
+void free_saved_parse_contexts(void);
+
+Linkage_iter linkage_iter_new(Sentence, Parse_Options);
+Linkage linkage_iter_next(Linkage_iter);
+void linkage_iter_free(Linkage_iter);
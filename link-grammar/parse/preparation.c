@@ -10,6 +10,8 @@
 /*                                                                       */
 /*************************************************************************/
 
+#include <string.h>
+
 #include "api-structures.h"
 #include "prepare/build-disjuncts.h"
 #include "connectors.h"
@@ -22,6 +24,7 @@
 #include "resources.h"
 #include "string-set.h"
 #include "tokenize/word-structures.h" // for Word_struct
+#include "utilities.h"
 
 static void
 set_connector_list_length_limit(Connector *c,
@@ -30,9 +33,9 @@ set_connector_list_length_limit(Connector *c,
                                 bool all_short,
                                 const char * ZZZ)
 {
-	for (; c!=NULL; c=c->next)
+	for (; c!=NULL; c=connector_next(c))
 	{
-		if (string_set_cmp (ZZZ, c->string))
+		if (string_set_cmp (ZZZ, connector_get_string(c)))
 		{
 			c->length_limit = 1;
 		}
@@ -85,7 +88,7 @@ static int set_dist_fields(Connector * c, size_t w, int delta)
 {
 	int i;
 	if (c == NULL) return (int) w;
-	i = set_dist_fields(c->next, w, delta) + delta;
+	i = set_dist_fields(connector_next(c), w, delta) + delta;
 	c->nearest_word = i;
 	return i;
 }
@@ -124,19 +127,70 @@ static void setup_connectors(Sentence sent)
 /**
  * Record the wordgraph word in each of its connectors.
  * It is used for checking alternatives consistency.
+ *
+ * The connectors are too small for a pointer, so the distinct gword
+ * sets are collected in sent->gword_sets, and the connectors get their
+ * index there. A hash table (keyed by the set address) is used for
+ * finding the index of the set of each disjunct.
  */
 static void gword_record_in_connector(Sentence sent)
 {
+	size_t num_disjuncts = 0;
+	size_t num_sets = 0;
+
+	for (size_t w = 0; w < sent->length; w++)
+		num_disjuncts += count_disjuncts(sent->word[w].d);
+
+	size_t size = next_power_of_two_up(2 * num_disjuncts + 1);
+	uint32_t *id_table = malloc(size * sizeof(uint32_t));
+	memset(id_table, 0xff, size * sizeof(uint32_t)); /* (uint32_t)-1: unused */
+
+	free(sent->gword_sets);
+	sent->gword_sets = malloc((num_disjuncts + 1) * sizeof(gword_set *));
+
 	for (size_t w = 0; w < sent->length; w++)
 	{
 		for (Disjunct *d = sent->word[w].d; d != NULL; d = d->next)
 		{
-			for (Connector *c = d->right; NULL != c; c = c->next)
-				c->originating_gword = d->originating_gword;
-			for (Connector *c = d->left; NULL != c; c = c->next)
-				c->originating_gword = d->originating_gword;
+			const gword_set *gs = d->originating_gword;
+			size_t h = ((uintptr_t)gs >> 4) & (size-1);
+
+			while (((uint32_t)-1 != id_table[h]) &&
+			       (sent->gword_sets[id_table[h]] != gs))
+				h = (h + 1) & (size-1);
+			if ((uint32_t)-1 == id_table[h])
+			{
+				id_table[h] = num_sets;
+				sent->gword_sets[num_sets++] = gs;
+			}
+
+			for (Connector *c = d->right; NULL != c; c = connector_next(c))
+				c->gword_set_id = id_table[h];
+			for (Connector *c = d->left; NULL != c; c = connector_next(c))
+				c->gword_set_id = id_table[h];
 		}
 	}
+
+	free(id_table);
+}
+
+/**
+ * Move the disjuncts of the sentence to a disjunct store, so the
+ * parsing stages, which repeatedly go over all of them, walk contiguous
+ * memory.
+ */
+static void store_sentence_disjuncts(Sentence sent)
+{
+	Disjunct **dlist = alloca(sent->length * sizeof(Disjunct *));
+
+	for (size_t w = 0; w < sent->length; w++)
+		dlist[w] = sent->word[w].d;
+
+	disjunct_store_delete(sent->disjunct_store);
+	sent->disjunct_store = disjunct_store_new(dlist, sent->length);
+
+	for (size_t w = 0; w < sent->length; w++)
+		sent->word[w].d = dlist[w];
 }
 
 /**
@@ -148,17 +202,22 @@ static void build_sentence_disjuncts(Sentence sent, double cost_cutoff)
 	Disjunct * d;
 	X_node * x;
 	size_t w;
+	Clause_pools *cp = clause_pools_new();
+
 	for (w = 0; w < sent->length; w++)
 	{
 		d = NULL;
 		for (x = sent->word[w].x; x != NULL; x = x->next)
 		{
-			Disjunct *dx = build_disjuncts_for_exp(x->exp, x->string, cost_cutoff);
+			Disjunct *dx = build_disjuncts_for_exp(cp, x->exp, x->string,
+			                                       sent->dict->contable,
+			                                       cost_cutoff);
 			word_record_in_disjunct(x->word, dx);
 			d = catenate_disjuncts(dx, d);
 		}
 		sent->word[w].d = d;
 	}
+	clause_pools_delete(cp);
 }
 
 /**
@@ -195,4 +254,5 @@ void prepare_to_parse(Sentence sent, Parse_Options opts)
 	gword_record_in_connector(sent);
 	set_connector_length_limits(sent, opts);
 	setup_connectors(sent);
+	store_sentence_disjuncts(sent);
 }
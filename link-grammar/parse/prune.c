@@ -11,8 +11,12 @@
 /*                                                                       */
 /*************************************************************************/
 
+#include <limits.h>
+#include <string.h>
+
 #include "api-structures.h"
 #include "connectors.h"
+#include "dict-common/dict-common.h" // for Dictionary_s
 #include "disjunct-utils.h"
 #include "post-process/post-process.h"
 #include "post-process/pp-structures.h"
@@ -34,43 +38,64 @@
 
 #define D_PRUNE 5
 
+/* Parallel power pruning (see power_prune_word()) needs POSIX threads. */
+#if defined HAVE_PTHREAD
+#define USE_PARALLEL_PRUNE
+#include <pthread.h>
+#endif
+
 #define CONTABSZ 8192
 typedef Connector * connector_table;
 
 /* Indicator that this connector cannot be used -- that its "obsolete".  */
 #define BAD_WORD (MAX_SENTENCE+1)
 
-typedef struct c_list_s C_list;
-struct c_list_s
+/* The power tables contain groups of connectors that possible_connection()
+ * cannot tell apart, except by their nearest_word field: those of the
+ * same word and direction, with the same descriptor, depth (shallow or
+ * not), "last", "multi" and length_limit. Only the least restrictive
+ * nearest_word of a group matters for the table search (the smallest one
+ * for right-pointing connectors, and the largest one for left-pointing
+ * ones). It is kept in the nearest_word of the group's representative
+ * connector, which is updated by clean_table(). A table is always
+ * cleaned after the nearest_word fields of its connectors may have
+ * changed, and before it is searched. */
+typedef struct
 {
-	C_list * next;
-	Connector * c;
+	Connector rep;           /* Representative of the group */
 	bool shallow;
-};
+	unsigned int next;       /* Next group in the bucket (index+1); 0: none */
+	unsigned int start;      /* Its connectors are member[start] ... */
+	unsigned int count;      /* ... member[start+count-1]; 0 if none left */
+} C_group;
+
+typedef struct
+{
+	unsigned int size;       /* Number of hash buckets (a power of 2) */
+	unsigned int *bucket;    /* First group (index+1) of each bucket; 0: none */
+	C_group *group;
+	unsigned int num_groups;
+	Connector **member;      /* The connectors of the groups */
+	unsigned int num_members;
+
+	/* The connector classes (upper-case parts) that are in the table,
+	 * as a bitset of uc_bitset_size words over a sentence-local
+	 * enumeration of the classes (see power_table). NULL if not used. */
+	uint64_t *uc;
+} C_table;
 
 typedef struct power_table_s power_table;
 struct power_table_s
 {
 	unsigned int power_table_size;
-	unsigned int *l_table_size;  /* the sizes of the hash tables */
-	unsigned int *r_table_size;
-	C_list *** l_table;
-	C_list *** r_table;
-};
-
-typedef struct cms_struct Cms;
-struct cms_struct
-{
-	Cms * next;
-	const char * name;
-	int count; /* the number of times this is in the multiset */
-};
-
-#define CMS_SIZE (2<<10)
-typedef struct multiset_table_s multiset_table;
-struct multiset_table_s
-{
-	Cms * cms_table[CMS_SIZE];
+	C_table *l_table;
+	C_table *r_table;
+	bool grouped;            /* false: one group per connector */
+
+	unsigned int *uc_id;     /* Class enumeration, indexed by uc_num */
+	size_t uc_id_size;
+	size_t uc_bitset_size;
+	uint64_t *uc_buf;        /* The storage of all the class bitsets */
 };
 
 typedef struct prune_context_s prune_context;
@@ -180,155 +205,259 @@ struct prune_context_s
    deletable, this is equivalent to RUTHLESS.   --DS, 7/97
 */
 
-static void free_C_list(C_list * t)
+static void c_table_delete(C_table *t)
 {
-	C_list *xt;
-	for (; t!=NULL; t=xt) {
-		xt = t->next;
-		xfree((char *)t, sizeof(C_list));
-	}
+	xfree(t->bucket, t->size * sizeof(unsigned int));
+	xfree(t->group, t->num_members * sizeof(C_group));
+	xfree(t->member, t->num_members * sizeof(Connector *));
 }
 
 /**
- * free all of the hash tables and C_lists
+ * free all of the hash tables
  */
 static void power_table_delete(power_table *pt)
 {
 	unsigned int w;
-	unsigned int i;
 
 	for (w = 0; w < pt->power_table_size; w++)
 	{
-		for (i = 0; i < pt->l_table_size[w]; i++)
-		{
-			free_C_list(pt->l_table[w][i]);
-		}
-		xfree((char *)pt->l_table[w], pt->l_table_size[w] * sizeof (C_list *));
-
-		for (i = 0; i < pt->r_table_size[w]; i++)
-		{
-			free_C_list(pt->r_table[w][i]);
-		}
-		xfree((char *)pt->r_table[w], pt->r_table_size[w] * sizeof (C_list *));
+		c_table_delete(&pt->l_table[w]);
+		c_table_delete(&pt->r_table[w]);
+	}
+	xfree(pt->l_table, 2 * pt->power_table_size * sizeof(C_table));
+	if (NULL != pt->uc_id)
+	{
+		xfree(pt->uc_id, pt->uc_id_size * sizeof(unsigned int));
+		xfree(pt->uc_buf, 2 * pt->power_table_size * pt->uc_bitset_size *
+		                  sizeof(uint64_t));
 	}
-	xfree(pt->l_table_size, 2 * pt->power_table_size * sizeof(unsigned int));
-	xfree(pt->l_table, 2 * pt->power_table_size * sizeof(C_list **));
 	xfree(pt, sizeof(power_table));
 }
 
+static inline void uc_bitset_add(const power_table *pt, uint64_t *bs,
+                                 const Connector *c)
+{
+	unsigned int id = pt->uc_id[c->desc->uc_num];
+	bs[id / 64] |= (uint64_t)1 << (id % 64);
+}
+
+static inline bool uc_bitset_test(const power_table *pt, const uint64_t *bs,
+                                  const Connector *c)
+{
+	unsigned int id = pt->uc_id[c->desc->uc_num];
+	return 0 != (bs[id / 64] & ((uint64_t)1 << (id % 64)));
+}
+
 /**
- * The disjunct d (whose left or right pointer points to c) is put
- * into the appropriate hash table
+ * Enumerate the connector classes of the sentence, and allocate the
+ * class bitsets of the power tables.
  */
-static void put_into_power_table(unsigned int size, C_list ** t, Connector * c, bool shal)
+static void power_table_alloc_uc(power_table *pt, Sentence sent)
+{
+	Disjunct_store *ds = sent->disjunct_store;
+	int max_uc_num = -1;
+	unsigned int num_uc = 0;
+
+	for (size_t i = 0; i < ds->num_connectors; i++)
+	{
+		if (ds->connector[i].desc->uc_num > max_uc_num)
+			max_uc_num = ds->connector[i].desc->uc_num;
+	}
+
+	pt->uc_id_size = max_uc_num + 1;
+	pt->uc_id = xalloc(pt->uc_id_size * sizeof(unsigned int));
+	memset(pt->uc_id, 0xff, pt->uc_id_size * sizeof(unsigned int));
+	for (size_t i = 0; i < ds->num_connectors; i++)
+	{
+		unsigned int *id = &pt->uc_id[ds->connector[i].desc->uc_num];
+		if (UINT_MAX == *id) *id = num_uc++;
+	}
+
+	pt->uc_bitset_size = (num_uc + 63) / 64;
+	size_t bs_size = 2 * sent->length * pt->uc_bitset_size * sizeof(uint64_t);
+	pt->uc_buf = xalloc(bs_size);
+	memset(pt->uc_buf, 0, bs_size);
+}
+
+static bool same_group(const C_group *g, const Connector *c, bool shallow)
 {
-	unsigned int h;
-	C_list * m;
-	h = connector_hash(c) & (size-1);
-	m = (C_list *) xalloc (sizeof(C_list));
-	m->next = t[h];
-	t[h] = m;
-	m->c = c;
-	m->shallow = shal;
+	return (g->rep.desc == c->desc) && (g->shallow == shallow) &&
+	       (g->rep.last == c->last) && (g->rep.multi == c->multi) &&
+	       (g->rep.length_limit == c->length_limit);
 }
 
 /**
- * Allocates and builds the initial power hash tables
+ * This runs through all the groups in this table, and eliminates the
+ * connectors that are obsolete.  The word fields of an obsolete one has
+ * been set to BAD_WORD. The nearest_word of the group representatives,
+ * and the class bitset of the table (if used), are recomputed from the
+ * remaining ones. left tells if the table is of left-pointing connectors.
  */
-static power_table * power_table_new(Sentence sent)
+static void clean_table(const power_table *pt, C_table *t, bool left)
 {
-	power_table *pt;
-	size_t w, len;
-	unsigned int i, size;
-	C_list ** t;
-	Disjunct * d;
-	Connector * c;
+	if (NULL != t->uc) memset(t->uc, 0, pt->uc_bitset_size * sizeof(uint64_t));
 
-	pt = (power_table *) xalloc (sizeof(power_table));
-	pt->power_table_size = sent->length;
-	pt->l_table_size = xalloc (2 * sent->length * sizeof(unsigned int));
-	pt->r_table_size = pt->l_table_size + sent->length;
-	pt->l_table = xalloc (2 * sent->length * sizeof(C_list **));
-	pt->r_table = pt->l_table + sent->length;
+	for (C_group *g = t->group; g < &t->group[t->num_groups]; g++)
+	{
+		Connector **m = &t->member[g->start];
+		unsigned int n = 0;
+		uint8_t nearest_word = left ? 0 : BAD_WORD;
 
-	for (w=0; w<sent->length; w++)
+		for (unsigned int i = 0; i < g->count; i++)
+		{
+			if (m[i]->nearest_word == BAD_WORD) continue;
+			if (left ? (m[i]->nearest_word > nearest_word) :
+			           (m[i]->nearest_word < nearest_word))
+				nearest_word = m[i]->nearest_word;
+			m[n++] = m[i];
+		}
+
+		g->count = n;
+		g->rep.nearest_word = nearest_word;
+		if ((0 != n) && (NULL != t->uc)) uc_bitset_add(pt, t->uc, &g->rep);
+	}
+}
+
+/**
+ * Build the power table t of the n disjuncts dw[] of a word, for their
+ * left or right connectors.
+ */
+static void c_table_new(const power_table *pt, C_table *t,
+                        Disjunct *dw, size_t n, bool left)
+{
+	unsigned int num_members = 0;
+	unsigned int size, i;
+	unsigned int *gid;
+	Connector *c;
+
+	for (Disjunct *d = dw; d < &dw[n]; d++)
 	{
-		/* The below uses variable-sized hash tables. This seems to
-		 * provide performance that is equal or better than the best
-		 * fixed-size performance.
-		 * The best fixed-size performance seems to come at about
-		 * a 1K table size, for both English and Russian. (Both have
-		 * about 100 fixed link-types, and many thousands of auto-genned
-		 * link types (IDxxx idioms for both, LLxxx suffix links for
-		 * Russian).  Pluses and minuses:
-		 * + small fixed tables are faster to initialize.
-		 * - small fixed tables have more collisions
-		 * - variable-size tables require counting connectors.
-		 *   (and the more complex code to go with)
-		 * CPU cache-size effects ...
-		 * Strong dependence on the hashing algo!
-		 */
-		len = left_connector_count(sent->word[w].d);
-		size = next_power_of_two_up(len);
+		for (c = left ? d->left : d->right; c != NULL; c = connector_next(c))
+			num_members++;
+	}
+
+	/* The below uses variable-sized hash tables. This seems to
+	 * provide performance that is equal or better than the best
+	 * fixed-size performance.
+	 * The best fixed-size performance seems to come at about
+	 * a 1K table size, for both English and Russian. (Both have
+	 * about 100 fixed link-types, and many thousands of auto-genned
+	 * link types (IDxxx idioms for both, LLxxx suffix links for
+	 * Russian).  Pluses and minuses:
+	 * + small fixed tables are faster to initialize.
+	 * - small fixed tables have more collisions
+	 * - variable-size tables require counting connectors.
+	 *   (and the more complex code to go with)
+	 * CPU cache-size effects ...
+	 * Strong dependence on the hashing algo!
+	 */
+	size = next_power_of_two_up(num_members);
 #define TOPSZ 32768
-		if (TOPSZ < size) size = TOPSZ;
-		pt->l_table_size[w] = size;
-		t = pt->l_table[w] = (C_list **) xalloc(size * sizeof(C_list *));
-		for (i=0; i<size; i++) t[i] = NULL;
-
-		for (d=sent->word[w].d; d!=NULL; d=d->next) {
-			c = d->left;
-			if (c != NULL) {
-				put_into_power_table(size, t, c, true);
-				for (c=c->next; c!=NULL; c=c->next) {
-					put_into_power_table(size, t, c, false);
-				}
+	if (TOPSZ < size) size = TOPSZ;
+	t->size = size;
+	t->bucket = xalloc(size * sizeof(unsigned int));
+	memset(t->bucket, 0, size * sizeof(unsigned int));
+	t->num_members = num_members;
+	t->group = xalloc(num_members * sizeof(C_group));
+	t->member = xalloc(num_members * sizeof(Connector *));
+	t->num_groups = 0;
+	gid = xalloc(num_members * sizeof(unsigned int));
+
+	/* Assign the connectors to groups, and count the group members. */
+	i = 0;
+	for (Disjunct *d = dw; d < &dw[n]; d++)
+	{
+		bool shallow = true;
+
+		for (c = left ? d->left : d->right; c != NULL; c = connector_next(c))
+		{
+			unsigned int h = connector_hash(c) & (size-1);
+			unsigned int g = 0;
+
+			if (pt->grouped)
+			{
+				for (g = t->bucket[h]; 0 != g; g = t->group[g-1].next)
+					if (same_group(&t->group[g-1], c, shallow)) break;
 			}
+			if (0 == g)
+			{
+				C_group *ng = &t->group[t->num_groups++];
+				ng->rep = *c;
+				ng->shallow = shallow;
+				ng->count = 0;
+				ng->next = t->bucket[h];
+				t->bucket[h] = g = t->num_groups;
+			}
+			t->group[g-1].count++;
+			gid[i++] = g-1;
+			shallow = false;
 		}
+	}
 
-		len = right_connector_count(sent->word[w].d);
-		size = next_power_of_two_up(len);
-		if (TOPSZ < size) size = TOPSZ;
-		pt->r_table_size[w] = size;
-		t = pt->r_table[w] = (C_list **) xalloc(size * sizeof(C_list *));
-		for (i=0; i<size; i++) t[i] = NULL;
-
-		for (d=sent->word[w].d; d!=NULL; d=d->next) {
-			c = d->right;
-			if (c != NULL) {
-				put_into_power_table(size, t, c, true);
-				for (c=c->next; c!=NULL; c=c->next){
-					put_into_power_table(size, t, c, false);
-				}
-			}
+	/* Place the members of each group contiguously. */
+	i = 0;
+	for (C_group *g = t->group; g < &t->group[t->num_groups]; g++)
+	{
+		g->start = i;
+		i += g->count;
+		g->count = 0;
+	}
+	i = 0;
+	for (Disjunct *d = dw; d < &dw[n]; d++)
+	{
+		for (c = left ? d->left : d->right; c != NULL; c = connector_next(c))
+		{
+			C_group *g = &t->group[gid[i++]];
+			t->member[g->start + g->count++] = c;
 		}
 	}
+	xfree(gid, num_members * sizeof(unsigned int));
 
-	return pt;
+	clean_table(pt, t, left);
 }
 
 /**
- * This runs through all the connectors in this table, and eliminates those
- * who are obsolete.  The word fields of an obsolete one has been set to
- * BAD_WORD.
+ * Allocates and builds the initial power hash tables, and, if use_uc
+ * is true, their connector-class bitsets. If grouped is false, each
+ * connector is put in its own group.
  */
-static void clean_table(unsigned int size, C_list ** t)
+static power_table * power_table_new(Sentence sent, bool use_uc, bool grouped)
 {
-	unsigned int i;
-	C_list * m, * xm, * head;
-	for (i = 0; i < size; i++) {
-		head = NULL;
-		for (m = t[i]; m != NULL; m = xm) {
-			xm = m->next;
-			if (m->c->nearest_word != BAD_WORD) {
-				m->next = head;
-				head = m;
-			} else {
-				xfree((char *) m, sizeof(C_list));
-			}
+	Disjunct_store *ds = sent->disjunct_store;
+	power_table *pt;
+	size_t w;
+
+	pt = (power_table *) xalloc (sizeof(power_table));
+	memset(pt, 0, sizeof(power_table));
+	pt->grouped = grouped;
+#if defined(ALT_MUTUAL_CONSISTENCY) || defined(ALT_DISJUNCT_CONSISTENCY)
+	/* The gword sets of the connectors are needed. */
+	pt->grouped = false;
+#endif
+	if (use_uc) power_table_alloc_uc(pt, sent);
+	pt->power_table_size = sent->length;
+	pt->l_table = xalloc (2 * sent->length * sizeof(C_table));
+	pt->r_table = pt->l_table + sent->length;
+
+	for (w=0; w<sent->length; w++)
+	{
+		Disjunct *dw = &ds->disjunct[ds->word_start[w]];
+
+		if (use_uc)
+		{
+			pt->l_table[w].uc = &pt->uc_buf[(2 * w) * pt->uc_bitset_size];
+			pt->r_table[w].uc = &pt->uc_buf[(2 * w + 1) * pt->uc_bitset_size];
 		}
-		t[i] = head;
+		else
+		{
+			pt->l_table[w].uc = pt->r_table[w].uc = NULL;
+		}
+
+		c_table_new(pt, &pt->l_table[w], dw, ds->word_count[w], true);
+		c_table_new(pt, &pt->r_table[w], dw, ds->word_count[w], false);
 	}
+
+	return pt;
 }
 
 /**
@@ -348,7 +477,7 @@ static bool optional_gap_collapse(Sentence sent, int w1, int w2)
 
 #if defined(ALT_MUTUAL_CONSISTENCY) || defined(ALT_DISJUNCT_CONSISTENCY)
 static bool alt_consistency(prune_context *pc,
-                                Connector *lc, Connector *rc,
+                                const Connector *lc, const Connector *rc,
                                 int lword, int rword, bool lr)
 {
 	bool same_alternative = false;
@@ -356,8 +485,8 @@ static bool alt_consistency(prune_context *pc,
 #ifdef ALT_MUTUAL_CONSISTENCY
 	/* Validate that rc and lc are from the same alternative.
 	 * Each of the loops is of one iteration most of the times. */
-	for (const gword_set *ga = lc->originating_gword; NULL != ga; ga = ga->next) {
-		for (const gword_set *gb = rc->originating_gword; NULL != gb; gb = gb->next) {
+	for (const gword_set *ga = pc->sent->gword_sets[lc->gword_set_id]; NULL != ga; ga = ga->next) {
+		for (const gword_set *gb = pc->sent->gword_sets[rc->gword_set_id]; NULL != gb; gb = gb->next) {
 			if (in_same_alternative(ga->o_gword, gb->o_gword)) {
 				same_alternative = true;
 				break;
@@ -376,19 +505,19 @@ static bool alt_consistency(prune_context *pc,
 	if (same_alternative)
 	{
 		const Connector *remote_connector = lr ? lc : rc;
-		const gword_set* gword_set_c = remote_connector->originating_gword;
+		const gword_set* gword_set_c = pc->sent->gword_sets[remote_connector->gword_set_id];
 		const Connector *curr_connector = lr ? rc : lc;
 
 #if 0
 		printf("CHECK %s F%p=%s R%p=%s:", lr ? "rc" : "lc",
-		       pc->first_connector, pc->first_connector->string,
-		       remote_connector, remote_connector->string);
+		       pc->first_connector, connector_get_string(pc->first_connector),
+		       remote_connector, connector_get_string(remote_connector));
 #endif
-		for (const Connector *i = pc->first_connector; curr_connector != i; i = i->next)
+		for (const Connector *i = pc->first_connector; curr_connector != i; i = connector_next(i))
 		{
-			//printf(" I%p=%s", i, i->string);
+			//printf(" I%p=%s", i, connector_get_string(i));
 			bool alt_compatible = false;
-			for (const gword_set *gi = i->originating_gword; NULL != gi; gi = gi->next)
+			for (const gword_set *gi = pc->sent->gword_sets[i->gword_set_id]; NULL != gi; gi = gi->next)
 			{
 				for (const gword_set *gs = gword_set_c; NULL != gs; gs = gs->next)
 				{
@@ -418,8 +547,8 @@ static bool alt_consistency(prune_context *pc,
 	if (!same_alternative)
 	{
 		lgdebug(8, "w%d=%s and w%d=%s NSA\n",
-		        lword, lc->originating_gword->o_gword->subword,
-		        rword, rc->originating_gword->o_gword->subword);
+		        lword, pc->sent->gword_sets[lc->gword_set_id]->o_gword->subword,
+		        rword, pc->sent->gword_sets[rc->gword_set_id]->o_gword->subword);
 
 		return false;
 	}
@@ -434,7 +563,7 @@ static bool alt_consistency(prune_context *pc,
  * possible for these two to match based on local considerations.
  */
 static bool possible_connection(prune_context *pc,
-                                Connector *lc, Connector *rc,
+                                const Connector *lc, const Connector *rc,
                                 bool lshallow, bool rshallow,
                                 int lword, int rword, bool lr)
 {
@@ -450,7 +579,7 @@ static bool possible_connection(prune_context *pc,
 	/* Word range constraints */
 	if (1 == dist)
 	{
-		if ((lc->next != NULL) || (rc->next != NULL)) return false;
+		if (!lc->last || !rc->last) return false;
 	}
 	else
 	if (dist > lc->length_limit || dist > rc->length_limit)
@@ -459,14 +588,14 @@ static bool possible_connection(prune_context *pc,
 	}
 	/* If the words are NOT next to each other, then there must be
 	 * at least one intervening connector (i.e. cannot have both
-	 * lc->next and rc->next being null).  But we only enforce this
+	 * lc and rc being the last ones).  But we only enforce this
 	 * when we think its still possible to have a complete parse,
 	 * i.e. before well allow null-linked words.
 	 */
 	else
 	if (!pc->null_links &&
-	    (lc->next == NULL) &&
-	    (rc->next == NULL) &&
+	    lc->last &&
+	    rc->last &&
 	    (!lc->multi) && (!rc->multi) &&
 	    !optional_gap_collapse(pc->sent, lword, rword))
 	{
@@ -477,7 +606,7 @@ static bool possible_connection(prune_context *pc,
 	if (!alt_consistency(pc, lc, rc, lword, rword, lr)) return false;
 #endif
 
-	return easy_match(lc->string, rc->string);
+	return easy_match_connectors(lc, rc);
 }
 
 /**
@@ -488,15 +617,18 @@ static bool
 right_table_search(prune_context *pc, int w, Connector *c,
                    bool shallow, int word_c)
 {
-	unsigned int size, h;
-	C_list *cl;
-	power_table *pt = pc->pt;
+	const power_table *pt = pc->pt;
+	const C_table *t = &pt->r_table[w];
+	unsigned int h, g;
+
+	if ((NULL != t->uc) && !uc_bitset_test(pt, t->uc, c)) return false;
 
-	size = pt->r_table_size[w];
-	h = connector_hash(c) & (size-1);
-	for (cl = pt->r_table[w][h]; cl != NULL; cl = cl->next)
+	h = connector_hash(c) & (t->size-1);
+	for (g = t->bucket[h]; 0 != g; g = t->group[g-1].next)
 	{
-		if (possible_connection(pc, cl->c, c, cl->shallow, shallow, w, word_c, true))
+		const C_group *cg = &t->group[g-1];
+		if (0 == cg->count) continue;
+		if (possible_connection(pc, &cg->rep, c, cg->shallow, shallow, w, word_c, true))
 			return true;
 	}
 	return false;
@@ -510,15 +642,18 @@ static bool
 left_table_search(prune_context *pc, int w, Connector *c,
                   bool shallow, int word_c)
 {
-	unsigned int size, h;
-	C_list *cl;
-	power_table *pt = pc->pt;
+	const power_table *pt = pc->pt;
+	const C_table *t = &pt->l_table[w];
+	unsigned int h, g;
 
-	size = pt->l_table_size[w];
-	h = connector_hash(c) & (size-1);
-	for (cl = pt->l_table[w][h]; cl != NULL; cl = cl->next)
+	if ((NULL != t->uc) && !uc_bitset_test(pt, t->uc, c)) return false;
+
+	h = connector_hash(c) & (t->size-1);
+	for (g = t->bucket[h]; 0 != g; g = t->group[g-1].next)
 	{
-		if (possible_connection(pc, c, cl->c, shallow, cl->shallow, word_c, w, false))
+		const C_group *cg = &t->group[g-1];
+		if (0 == cg->count) continue;
+		if (possible_connection(pc, c, &cg->rep, shallow, cg->shallow, word_c, w, false))
 			return true;
 	}
 	return false;
@@ -540,7 +675,7 @@ left_connector_list_update(prune_context *pc, Connector *c,
 	bool foundmatch;
 
 	if (c == NULL) return w;
-	n = left_connector_list_update(pc, c->next, w, false) - 1;
+	n = left_connector_list_update(pc, connector_next(c), w, false) - 1;
 	if (((int) c->nearest_word) < n) n = c->nearest_word;
 
 	/* lb is now the leftmost word we need to check */
@@ -583,7 +718,7 @@ right_connector_list_update(prune_context *pc, Connector *c,
 	Sentence sent = pc->sent;
 
 	if (c == NULL) return w;
-	n = right_connector_list_update(pc, c->next, w, false) + 1;
+	n = right_connector_list_update(pc, connector_next(c), w, false) + 1;
 	if (c->nearest_word > n) n = c->nearest_word;
 
 	/* ub is now the rightmost word we need to check */
@@ -608,15 +743,304 @@ right_connector_list_update(prune_context *pc, Connector *c,
 	return (foundmatch ? n : sent->length);
 }
 
-/** The return value is the number of disjuncts deleted */
+/**
+ * Delete the disjuncts of word w whose connectors got marked with
+ * BAD_WORD. The remaining ones are moved to the start of the word's
+ * range in the disjunct store (keeping their order), and relinked.
+ */
+static void delete_bad_disjuncts(Sentence sent, size_t w)
+{
+	Disjunct_store *ds = sent->disjunct_store;
+	Disjunct *dw = &ds->disjunct[ds->word_start[w]];
+	size_t n = 0;
+
+	for (size_t i = 0; i < ds->word_count[w]; i++)
+	{
+		const Disjunct *d = &dw[i];
+
+		if ((d->left != NULL) && (d->left->nearest_word == BAD_WORD)) continue;
+		if ((d->right != NULL) && (d->right->nearest_word == BAD_WORD)) continue;
+		if (n != i) dw[n] = *d;
+		n++;
+	}
+
+	if (n == ds->word_count[w]) return;
+	ds->word_count[w] = n;
+	sent->word[w].d = disjunct_store_relink(ds, w);
+}
+
+/**
+ * Update the nearest_word fields of the connectors of the n disjuncts
+ * dw[] of word w, in a left-to-right (lr) or right-to-left pass. The
+ * connectors of the disjuncts that cannot be linked are marked with
+ * BAD_WORD, for deletion. Return the number of these disjuncts.
+ *
+ * Only the connectors of these disjuncts get modified, and the tables
+ * of the other words are only read, so distinct disjuncts of the same
+ * word can be handled concurrently (with distinct prune contexts).
+ */
+static size_t power_prune_disjuncts(prune_context *pc, size_t w, bool lr,
+                                    Disjunct *dw, size_t n)
+{
+	size_t N_deleted = 0;
+	Connector *c;
+
+	for (Disjunct *d = dw; d < &dw[n]; d++)
+	{
+		c = lr ? d->left : d->right;
+		if (c == NULL) continue;
+#ifdef ALT_DISJUNCT_CONSISTENCY
+		pc->first_connector = c;
+#endif
+		if (lr)
+		{
+			if (left_connector_list_update(pc, c, w, true) >= 0) continue;
+		}
+		else
+		{
+			if (right_connector_list_update(pc, c, w, true) < pc->sent->length)
+				continue;
+		}
+
+		for (c=d->left;  c != NULL; c = connector_next(c)) c->nearest_word = BAD_WORD;
+		for (c=d->right; c != NULL; c = connector_next(c)) c->nearest_word = BAD_WORD;
+		N_deleted++;
+	}
+
+	return N_deleted;
+}
+
+#ifdef USE_PARALLEL_PRUNE
+/* Parallel power pruning.
+ *
+ * The words of a pass depend on each other, since each word is handled
+ * with the tables of the words that precede it in the pass, as they
+ * are after they got handled. But the disjuncts of a word are
+ * independent (see power_prune_disjuncts()). So with opts->threads > 1,
+ * the disjuncts of the words that have many of them are divided among
+ * threads. The passes are the same as with serial pruning, so the
+ * result is the same too.
+ */
+#define PARALLEL_PRUNE_MIN_DISJUNCTS 512
+
+typedef struct prune_pool_s prune_pool;
+
+typedef struct
+{
+	prune_pool *pool;
+	int i;                   /* Thread index */
+	prune_context pc;
+	size_t N_deleted;
+} prune_worker;
+
+struct prune_pool_s
+{
+	pthread_mutex_t mutex;
+	pthread_cond_t start;    /* A new job, or quit */
+	pthread_cond_t done;     /* All the workers have finished the job */
+	unsigned int job;        /* Incremented for each job */
+	int pending;             /* The number of workers still on the job */
+	bool quit;
+
+	/* The job: the disjuncts dw[0..n-1] of word w, and the direction. */
+	size_t w;
+	bool lr;
+	Disjunct *dw;
+	size_t n;
+
+	int num_threads;         /* Including the calling thread (index 0) */
+	int num_alloced;         /* Allocated size of the arrays below */
+	prune_worker *worker;
+	pthread_t *thread;
+};
+
+static void prune_pool_do_slice(prune_pool *pool, int i)
+{
+	prune_worker *pw = &pool->worker[i];
+	size_t from = pool->n * i / pool->num_threads;
+	size_t to = pool->n * (i + 1) / pool->num_threads;
+
+	pw->N_deleted = power_prune_disjuncts(&pw->pc, pool->w, pool->lr,
+	                                      &pool->dw[from], to - from);
+}
+
+static void *prune_pool_worker(void *arg)
+{
+	prune_worker *pw = arg;
+	prune_pool *pool = pw->pool;
+	unsigned int job = 0;
+
+	while (true)
+	{
+		pthread_mutex_lock(&pool->mutex);
+		while (!pool->quit && (job == pool->job))
+			pthread_cond_wait(&pool->start, &pool->mutex);
+		if (pool->quit)
+		{
+			pthread_mutex_unlock(&pool->mutex);
+			return NULL;
+		}
+		job = pool->job;
+		pthread_mutex_unlock(&pool->mutex);
+
+		prune_pool_do_slice(pool, pw->i);
+
+		pthread_mutex_lock(&pool->mutex);
+		if (0 == --pool->pending) pthread_cond_signal(&pool->done);
+		pthread_mutex_unlock(&pool->mutex);
+	}
+}
+
+static void prune_pool_delete(prune_pool *pool)
+{
+	if (NULL == pool) return;
+
+	pthread_mutex_lock(&pool->mutex);
+	pool->quit = true;
+	pthread_cond_broadcast(&pool->start);
+	pthread_mutex_unlock(&pool->mutex);
+	for (int i = 1; i < pool->num_threads; i++)
+		pthread_join(pool->thread[i], NULL);
+
+	pthread_cond_destroy(&pool->start);
+	pthread_cond_destroy(&pool->done);
+	pthread_mutex_destroy(&pool->mutex);
+	xfree(pool->worker, pool->num_alloced * sizeof(prune_worker));
+	xfree(pool->thread, pool->num_alloced * sizeof(pthread_t));
+	xfree(pool, sizeof(prune_pool));
+}
+
+/**
+ * Start num_threads-1 worker threads. Return NULL if none could be
+ * started.
+ */
+static prune_pool *prune_pool_new(int num_threads)
+{
+	prune_pool *pool = xalloc(sizeof(prune_pool));
+
+	memset(pool, 0, sizeof(prune_pool));
+	pthread_mutex_init(&pool->mutex, NULL);
+	pthread_cond_init(&pool->start, NULL);
+	pthread_cond_init(&pool->done, NULL);
+	pool->num_alloced = num_threads;
+	pool->worker = xalloc(num_threads * sizeof(prune_worker));
+	pool->thread = xalloc(num_threads * sizeof(pthread_t));
+
+	pool->num_threads = 1;
+	for (int i = 1; i < num_threads; i++)
+	{
+		pool->worker[i].pool = pool;
+		pool->worker[i].i = i;
+		if (0 != pthread_create(&pool->thread[i], NULL, prune_pool_worker,
+		                        &pool->worker[i]))
+			break;
+		pool->num_threads++;
+	}
+
+	if (1 == pool->num_threads)
+	{
+		prune_pool_delete(pool);
+		return NULL;
+	}
+
+	return pool;
+}
+#else
+typedef void prune_pool;
+#endif /* USE_PARALLEL_PRUNE */
+
+/**
+ * Do power_prune_disjuncts() for all the disjuncts of word w, with the
+ * given worker pool if it is not NULL.
+ */
+static size_t power_prune_word(prune_pool *pool, prune_context *pc,
+                               size_t w, bool lr)
+{
+	Disjunct_store *ds = pc->sent->disjunct_store;
+	Disjunct *dw = &ds->disjunct[ds->word_start[w]];
+	size_t n = ds->word_count[w];
+
+#ifdef USE_PARALLEL_PRUNE
+	if ((NULL != pool) && (n >= PARALLEL_PRUNE_MIN_DISJUNCTS))
+	{
+		size_t N_deleted = 0;
+
+		for (int i = 0; i < pool->num_threads; i++)
+		{
+			pool->worker[i].pc = *pc;
+			pool->worker[i].pc.N_changed = 0;
+			pool->worker[i].pc.power_cost = 0;
+		}
+
+		pthread_mutex_lock(&pool->mutex);
+		pool->w = w;
+		pool->lr = lr;
+		pool->dw = dw;
+		pool->n = n;
+		pool->pending = pool->num_threads - 1;
+		pool->job++;
+		pthread_cond_broadcast(&pool->start);
+		pthread_mutex_unlock(&pool->mutex);
+
+		prune_pool_do_slice(pool, 0);
+
+		pthread_mutex_lock(&pool->mutex);
+		while (0 != pool->pending)
+			pthread_cond_wait(&pool->done, &pool->mutex);
+		pthread_mutex_unlock(&pool->mutex);
+
+		for (int i = 0; i < pool->num_threads; i++)
+		{
+			pc->N_changed += pool->worker[i].pc.N_changed;
+			pc->power_cost += pool->worker[i].pc.power_cost;
+			N_deleted += pool->worker[i].N_deleted;
+		}
+		return N_deleted;
+	}
+#endif /* USE_PARALLEL_PRUNE */
+
+	return power_prune_disjuncts(pc, w, lr, dw, n);
+}
+
+/**
+ * Return a worker pool for the pruning of the given sentence, or NULL
+ * if it should be pruned by the calling thread only.
+ */
+static prune_pool *power_prune_pool(Sentence sent, Parse_Options opts)
+{
+#ifdef USE_PARALLEL_PRUNE
+	Disjunct_store *ds = sent->disjunct_store;
+
+	if (opts->threads <= 1) return NULL;
+	for (size_t w = 0; w < sent->length; w++)
+	{
+		if (ds->word_count[w] >= PARALLEL_PRUNE_MIN_DISJUNCTS)
+			return prune_pool_new(opts->threads);
+	}
+#endif /* USE_PARALLEL_PRUNE */
+	return NULL;
+}
+
+/**
+ * The return value is the number of disjuncts deleted.
+ *
+ * By default, the connectors of the tables are grouped (see C_group),
+ * the table searches are skipped for the words that don't have the
+ * connector class of the searched connector (see C_table),
+ * and the words with many disjuncts may be handled by several threads
+ * (see power_prune_word()). None of these change the result.
+ * "!test=power-prune-classic" disables them, for benchmarking.
+ */
 int power_prune(Sentence sent, Parse_Options opts)
 {
 	power_table *pt;
 	prune_context *pc;
-	Disjunct *d, *free_later, *dx, *nd;
-	Connector *c;
+	prune_pool *pool = NULL;
+	Disjunct_store *ds;
 	size_t N_deleted, total_deleted;
 	size_t w;
+	bool reversed = false;
+	bool classic = test_enabled("power-prune-classic");
 
 	pc = (prune_context *) xalloc (sizeof(prune_context));
 	pc->power_cost = 0;
@@ -624,11 +1048,12 @@ int power_prune(Sentence sent, Parse_Options opts)
 	pc->N_changed = 1;  /* forces it always to make at least two passes */
 
 	pc->sent = sent;
+	ds = sent->disjunct_store;
 
-	pt = power_table_new(sent);
+	pt = power_table_new(sent, !classic, !classic);
 	pc->pt = pt;
+	if (!classic) pool = power_prune_pool(sent, opts);
 
-	free_later = NULL;
 	N_deleted = 0;
 
 	total_deleted = 0;
@@ -637,33 +1062,12 @@ int power_prune(Sentence sent, Parse_Options opts)
 	{
 		/* left-to-right pass */
 		for (w = 0; w < sent->length; w++) {
-			for (d = sent->word[w].d; d != NULL; d = d->next) {
-				if (d->left == NULL) continue;
-#ifdef ALT_DISJUNCT_CONSISTENCY
-				pc->first_connector = d->left;
-#endif
-				if (left_connector_list_update(pc, d->left, w, true) < 0) {
-					for (c=d->left;  c != NULL; c = c->next) c->nearest_word = BAD_WORD;
-					for (c=d->right; c != NULL; c = c->next) c->nearest_word = BAD_WORD;
-					N_deleted++;
-					total_deleted++;
-				}
-			}
-
-			clean_table(pt->r_table_size[w], pt->r_table[w]);
-			nd = NULL;
-			for (d = sent->word[w].d; d != NULL; d = dx) {
-				dx = d->next;
-				if ((d->left != NULL) && (d->left->nearest_word == BAD_WORD)) {
-					d->next = free_later;
-					free_later = d;
-				} else {
-					d->next = nd;
-					nd = d;
-				}
-			}
-			sent->word[w].d = nd;
+			N_deleted += power_prune_word(pool, pc, w, true);
+			clean_table(pt, &pt->r_table[w], false);
+			delete_bad_disjuncts(sent, w);
 		}
+		total_deleted += N_deleted;
+		reversed = !reversed;
 		lgdebug(D_PRUNE, "Debug: l->r pass changed %d and deleted %zu\n",
 		        pc->N_changed, N_deleted);
 
@@ -673,32 +1077,12 @@ int power_prune(Sentence sent, Parse_Options opts)
 		/* right-to-left pass */
 
 		for (w = sent->length-1; w != (size_t) -1; w--) {
-			for (d = sent->word[w].d; d != NULL; d = d->next) {
-				if (d->right == NULL) continue;
-#ifdef ALT_DISJUNCT_CONSISTENCY
-				pc->first_connector = d->right;
-#endif
-				if (right_connector_list_update(pc, d->right, w, true) >= sent->length) {
-					for (c=d->right; c != NULL; c = c->next) c->nearest_word = BAD_WORD;
-					for (c=d->left;  c != NULL; c = c->next) c->nearest_word = BAD_WORD;
-					N_deleted++;
-					total_deleted++;
-				}
-			}
-			clean_table(pt->l_table_size[w], pt->l_table[w]);
-			nd = NULL;
-			for (d = sent->word[w].d; d != NULL; d = dx) {
-				dx = d->next;
-				if ((d->right != NULL) && (d->right->nearest_word == BAD_WORD)) {
-					d->next = free_later;
-					free_later = d;
-				} else {
-					d->next = nd;
-					nd = d;
-				}
-			}
-			sent->word[w].d = nd;
+			N_deleted += power_prune_word(pool, pc, w, false);
+			clean_table(pt, &pt->l_table[w], true);
+			delete_bad_disjuncts(sent, w);
 		}
+		total_deleted += N_deleted;
+		reversed = !reversed;
 
 		lgdebug(D_PRUNE, "Debug: r->l pass changed %d and deleted %zu\n",
 		        pc->N_changed, N_deleted);
@@ -706,7 +1090,19 @@ int power_prune(Sentence sent, Parse_Options opts)
 		if (pc->N_changed == 0) break;
 		pc->N_changed = N_deleted = 0;
 	}
-	free_disjuncts(free_later);
+
+	/* Each pass used to relink the disjunct lists in reverse order, and
+	 * the order of the linkages depends on the order of the disjuncts,
+	 * so it is kept. */
+	if (reversed)
+	{
+		for (w = 0; w < sent->length; w++)
+			sent->word[w].d = disjunct_store_reverse(ds, w);
+	}
+
+#ifdef USE_PARALLEL_PRUNE
+	prune_pool_delete(pool);
+#endif /* USE_PARALLEL_PRUNE */
 	power_table_delete(pt);
 	pt = NULL;
 	pc->pt = NULL;
@@ -769,231 +1165,396 @@ int power_prune(Sentence sent, Parse_Options opts)
    the rule.  If none can match, then we can delete the disjunct
    containing C.
 
-   Here's how we're going to implement this.  We'll maintain a multiset
-   of connector names.  We'll represent them in a hash table, where the
-   hash function uses only the upper case letters of the connector name.
-   We'll insert all the connectors into the multiset.  The multiset will
-   support the operation of deletion (probably simplest to just
-   decrement the count).  Here's the algorithm.
-
-   Insert all the connectors into M.
+   Here's how we're going to implement this.  The rules are compiled
+   when the dictionary is read (see pp_prune_rules_new()).  The
+   connector names of the dictionary that match the criterion patterns
+   (like "Xa##" above) get a dense criterion number, and each pattern
+   becomes a bitset of the criterion numbers of the connector names
+   that match it.  Each connector name also gets the list of the rules
+   for which it is a trigger.  For a sentence, we make a bitset of the
+   criterion numbers of its connectors, and then a criterion link can
+   be satisfied iff each of its pattern bitsets intersects it.  Here's
+   the algorithm.
+
+   Make the criterion set M of the sentence connectors.
+
+   For each connector C do
+	  For each rule R for which C is a trigger do
+		 if the criterion links of R cannot be satisfied by M, Then:
+			We delete C's disjunct.
+
+   The set M is not updated when disjuncts get deleted, so whether a
+   rule can be satisfied doesn't change during the pruning.  Hence it
+   is computed at most once per rule, and one pass is enough.
+  */
 
-   While the previous pass caused a count to go to 0 do:
-	  For each connector C do
-		 For each rule R do
-			if C is a trigger for R and the criterion links
-			of the rule cannot be satisfied by the connectors in
-			M, Then:
-			   We delete C's disjunct.  But before we do,
-			   we remove all the connectors of this disjunct
-			   from the multiset.  Keep tabs on whether or not
-			   any of the counts went to 0.
+/* The contains-one rules of a dictionary, compiled for pp_prune(). */
+struct pp_prune_rules_s
+{
+	size_t num_con;              /* The connector names, by con_num */
+	int *crit_id;                /* Their criterion number, or -1 */
+	size_t num_crit;             /* Number of criterion numbers */
+	size_t bitset_size;          /* Number of words of a criterion bitset */
+
+	/* The rules for which connector name con_num is a trigger are
+	 * trigger[trigger_start[con_num] ... trigger_start[con_num+1]-1],
+	 * in the order of the rules. */
+	unsigned int *trigger_start;
+	unsigned int *trigger;
+	size_t num_triggers;
+
+	/* The criterion links of rule r are link_start[r] ...
+	 * link_start[r+1]-1, and the patterns of criterion link l are
+	 * the bitsets pattern_start[l] ... pattern_start[l+1]-1. */
+	size_t num_rules;
+	unsigned int *link_start;
+	size_t num_links;
+	unsigned int *pattern_start;
+	size_t num_patterns;
+	uint64_t *pattern;
+};
 
+/* The connector names of the dictionary, grouped by their uc_num. */
+typedef struct
+{
+	const Connector_table *ct;
+	const condesc_t **desc;      /* Sorted by uc_num */
+	size_t *uc_start;            /* The start of each uc_num in desc[] */
+} pp_prune_compile_context;
 
+#define PP_PATTERN_SIZE 20
 
-	Efficiency hacks to be added later:
-		Note for a given rule can become less and less satisfiable.
-		That is, rule_satisfiable(r) for a given rule r can change from
-		TRUE to FALSE, but not vice versa.  So once it's FALSE, we can just
-		remember that.
+/**
+ * Put into pattern[] the patterns that need to be matched by the
+ * connectors of the sentence so that the given criterion link can be
+ * satisfied (see above). Return their number.
+ */
+static size_t criterion_patterns(const char *link,
+                                 char pattern[][PP_PATTERN_SIZE])
+{
+	char name[PP_PATTERN_SIZE], *s;
+	const char *t;
+	size_t n = 0;
+
+	strncpy(name, link, sizeof(name)-1);
+	name[sizeof(name)-1] = '\0';
+
+	s = name;
+	if (islower((int)*s)) s++; /* skip head-dependent indicator */
+	for (; isupper((int)*s); s++) {}
+	for (;*s != '\0'; s++) if (*s != '*') *s = '#';
+
+	s = name;
+	t = link;
+	if (islower((int)*s)) s++; /* skip head-dependent indicator */
+	if (islower((int)*t)) t++; /* skip head-dependent indicator */
+	for (; isupper((int) *s); s++, t++) {}
+
+	/* s and t remain in lockstep */
+	for (;*s != '\0'; s++, t++) {
+		if (*s == '*') continue;
+		/* after the upper case part, and is not a * so must be a regular subscript */
+		*s = *t;
+		strcpy(pattern[n++], name);
+		*s = '#';
+	}
 
-		Consider the effect of a pass p on the set of rules that are
-		satisfiable.  Suppose this set does not change.  Then pass p+1
-		will do nothing.  This is true even if pass p caused some
-		disjuncts to be deleted.  (This observation will only obviate
-		the need for the last pass.)
+	/* the special case which occurs if there were 0 subscripts */
+	if (n == 0) strcpy(pattern[n++], name);
 
-  */
+	return n;
+}
 
-static multiset_table * cms_table_new(void)
+/**
+ * Call the given function for each connector name C of the dictionary
+ * such that post_process_match(s, C) is TRUE.
+ */
+static void foreach_pp_match(const pp_prune_compile_context *cc,
+                             const char *s,
+                             void (*f)(pp_prune_rules *, const condesc_t *, void *),
+                             pp_prune_rules *pr, void *arg)
 {
-	multiset_table *mt;
-	int i;
+	size_t length;
+	int uc_num;
 
-	mt = (multiset_table *) xalloc(sizeof(multiset_table));
+	/* A symbol with a head-dependent indicator matches nothing. */
+	for (length = 0; isupper((int)s[length]); length++) {}
+	if (0 == length) return;
+	uc_num = connector_table_uc_num(cc->ct, s, length);
+	if (0 > uc_num) return;
 
-	for (i=0; i<CMS_SIZE; i++) {
-		mt->cms_table[i] = NULL;
+	for (size_t i = cc->uc_start[uc_num]; i < cc->uc_start[uc_num+1]; i++)
+	{
+		if (post_process_match(s, cc->desc[i]->string))
+			f(pr, cc->desc[i], arg);
 	}
-	return mt;
 }
 
-static void cms_table_delete(multiset_table *mt)
+static void assign_crit_id(pp_prune_rules *pr, const condesc_t *desc, void *arg)
 {
-	Cms * cms, *xcms;
-	int i;
-	for (i=0; i<CMS_SIZE; i++)
-	{
-		for (cms = mt->cms_table[i]; cms != NULL; cms = xcms)
-		{
-			xcms = cms->next;
-			xfree(cms, sizeof(Cms));
-		}
-	}
-	xfree(mt, sizeof(multiset_table));
+	if (0 > pr->crit_id[desc->con_num])
+		pr->crit_id[desc->con_num] = pr->num_crit++;
 }
 
-static unsigned int cms_hash(const char * s)
+static void set_crit_bit(pp_prune_rules *pr, const condesc_t *desc, void *arg)
 {
-	unsigned int i = 5381;
-	if (islower((int) *s)) s++; /* skip head-dependent indicator */
-	while (isupper((int) *s))
-	{
-		i = ((i << 5) + i) + *s;
-		s++;
-	}
-	return (i & (CMS_SIZE-1));
+	uint64_t *bs = arg;
+	int id = pr->crit_id[desc->con_num];
+
+	bs[id / 64] |= (uint64_t)1 << (id % 64);
+}
+
+static void count_trigger(pp_prune_rules *pr, const condesc_t *desc, void *arg)
+{
+	pr->trigger_start[desc->con_num+1]++;
+	pr->num_triggers++;
+}
+
+typedef struct
+{
+	unsigned int *next;          /* The next trigger[] slot of each con_num */
+	unsigned int rule;
+} trigger_arg;
+
+static void add_trigger(pp_prune_rules *pr, const condesc_t *desc, void *arg)
+{
+	trigger_arg *ta = arg;
+
+	pr->trigger[ta->next[desc->con_num]++] = ta->rule;
 }
 
 /**
- * This returns TRUE if there is a connector name C in the table
- * such that post_process_match(pp_match_name, C) is TRUE
+ * Go over the contains-one rules. If fill is false, count the links,
+ * patterns and triggers, and assign the criterion numbers. Else, fill
+ * in the tables, which should be already allocated.
  */
-static bool match_in_cms_table(multiset_table *cmt, const char * pp_match_name)
+static void compile_contains_one_rules(const pp_prune_compile_context *cc,
+                                       pp_prune_rules *pr,
+                                       const pp_knowledge *knowledge,
+                                       unsigned int *next_trigger, bool fill)
 {
-	Cms * cms;
-	for (cms = cmt->cms_table[cms_hash(pp_match_name)]; cms != NULL; cms = cms->next)
+	trigger_arg ta = { .next = next_trigger };
+	char pattern[PP_PATTERN_SIZE][PP_PATTERN_SIZE];
+	size_t l = 0, p = 0;
+
+	for (size_t r = 0; r < knowledge->n_contains_one_rules; r++)
 	{
-		if (post_process_match(pp_match_name, cms->name)) return true;
+		const pp_rule *rule = &knowledge->contains_one_rules[r];
+		const pp_linkset *ls = rule->link_set;
+
+		if (fill) pr->link_start[r] = l;
+		if (strchr(rule->selector, '*') != NULL) continue;  /* If it has a * forget it */
+
+		if (fill)
+		{
+			ta.rule = r;
+			foreach_pp_match(cc, rule->selector, add_trigger, pr, &ta);
+		}
+		else
+		{
+			foreach_pp_match(cc, rule->selector, count_trigger, pr, NULL);
+		}
+
+		for (unsigned int h = 0; h < ls->hash_table_size; h++)
+		{
+			for (pp_linkset_node *n = ls->hash_table[h]; n != NULL; n = n->next)
+			{
+				size_t np = criterion_patterns(n->str, pattern);
+
+				if (fill) pr->pattern_start[l] = p;
+				for (size_t i = 0; i < np; i++)
+				{
+					if (fill)
+					{
+						foreach_pp_match(cc, pattern[i], set_crit_bit, pr,
+						                 &pr->pattern[(p + i) * pr->bitset_size]);
+					}
+					else
+					{
+						foreach_pp_match(cc, pattern[i], assign_crit_id, pr, NULL);
+					}
+				}
+				p += np;
+				l++;
+			}
+		}
 	}
-	return false;
-}
 
-static Cms * lookup_in_cms_table(multiset_table *cmt, const char * str)
-{
-	Cms * cms;
-	for (cms = cmt->cms_table[cms_hash(str)]; cms != NULL; cms = cms->next)
+	if (fill)
 	{
-		if (string_set_cmp(str, cms->name)) return cms;
+		pr->link_start[knowledge->n_contains_one_rules] = l;
+		pr->pattern_start[l] = p;
 	}
-	return NULL;
-}
-
-static void insert_in_cms_table(multiset_table *cmt, const char * str)
-{
-	Cms * cms;
-	unsigned int h;
-	cms = lookup_in_cms_table(cmt, str);
-	if (cms != NULL) {
-		cms->count++;
-	} else {
-		cms = (Cms *) xalloc(sizeof(Cms));
-		cms->name = str;  /* don't copy the string...just keep a pointer to it.
-							 we won't free these later */
-		cms->count = 1;
-		h = cms_hash(str);
-		cms->next = cmt->cms_table[h];
-		cmt->cms_table[h] = cms;
+	else
+	{
+		pr->num_links = l;
+		pr->num_patterns = p;
 	}
 }
 
 /**
- * Delete the given string from the table.  Return TRUE if
- * this caused a count to go to 0, return FALSE otherwise.
+ * Compile the contains-one rules of the given post-processing knowledge
+ * for pp_prune(), over the connector names of the given table.
  */
-static bool delete_from_cms_table(multiset_table *cmt, const char * str)
+pp_prune_rules *pp_prune_rules_new(const pp_knowledge *knowledge,
+                                   const Connector_table *ct)
 {
-	Cms * cms = lookup_in_cms_table(cmt, str);
-	if (cms != NULL && cms->count > 0)
+	pp_prune_rules *pr = xalloc(sizeof(pp_prune_rules));
+	pp_prune_compile_context cc;
+	const condesc_t **desc;
+	unsigned int *next_trigger;
+	size_t num_uc = 0;
+
+	memset(pr, 0, sizeof(pp_prune_rules));
+	pr->num_con = connector_table_num_con(ct);
+	pr->num_rules = knowledge->n_contains_one_rules;
+
+	/* Group the connector names by their uc_num. */
+	desc = xalloc(pr->num_con * sizeof(const condesc_t *));
+	connector_table_get_desc(ct, desc);
+	for (size_t i = 0; i < pr->num_con; i++)
 	{
-		cms->count--;
-		return (cms->count == 0);
+		if ((size_t)desc[i]->uc_num >= num_uc) num_uc = desc[i]->uc_num + 1;
 	}
-	return false;
+	cc.ct = ct;
+	cc.uc_start = xalloc((num_uc + 1) * sizeof(size_t));
+	memset(cc.uc_start, 0, (num_uc + 1) * sizeof(size_t));
+	for (size_t i = 0; i < pr->num_con; i++)
+		cc.uc_start[desc[i]->uc_num + 1]++;
+	for (size_t u = 0; u < num_uc; u++)
+		cc.uc_start[u + 1] += cc.uc_start[u];
+	cc.desc = xalloc(pr->num_con * sizeof(const condesc_t *));
+	for (size_t i = 0; i < pr->num_con; i++)
+		cc.desc[cc.uc_start[desc[i]->uc_num]++] = desc[i];
+	for (size_t u = num_uc; u > 0; u--)
+		cc.uc_start[u] = cc.uc_start[u - 1];
+	cc.uc_start[0] = 0;
+	xfree(desc, pr->num_con * sizeof(const condesc_t *));
+
+	pr->crit_id = xalloc(pr->num_con * sizeof(int));
+	memset(pr->crit_id, -1, pr->num_con * sizeof(int));
+	pr->trigger_start = xalloc((pr->num_con + 1) * sizeof(unsigned int));
+	memset(pr->trigger_start, 0, (pr->num_con + 1) * sizeof(unsigned int));
+
+	compile_contains_one_rules(&cc, pr, knowledge, NULL, false);
+
+	pr->bitset_size = (pr->num_crit + 63) / 64;
+	for (size_t i = 0; i < pr->num_con; i++)
+		pr->trigger_start[i + 1] += pr->trigger_start[i];
+	pr->trigger = xalloc(pr->num_triggers * sizeof(unsigned int));
+	pr->link_start = xalloc((pr->num_rules + 1) * sizeof(unsigned int));
+	pr->pattern_start = xalloc((pr->num_links + 1) * sizeof(unsigned int));
+	size_t pattern_size = pr->num_patterns * pr->bitset_size * sizeof(uint64_t);
+	pr->pattern = xalloc(pattern_size);
+	memset(pr->pattern, 0, pattern_size);
+
+	next_trigger = xalloc(pr->num_con * sizeof(unsigned int));
+	memcpy(next_trigger, pr->trigger_start, pr->num_con * sizeof(unsigned int));
+	compile_contains_one_rules(&cc, pr, knowledge, next_trigger, true);
+	xfree(next_trigger, pr->num_con * sizeof(unsigned int));
+
+	xfree(cc.desc, pr->num_con * sizeof(const condesc_t *));
+	xfree(cc.uc_start, (num_uc + 1) * sizeof(size_t));
+
+	return pr;
 }
 
-static bool rule_satisfiable(multiset_table *cmt, pp_linkset *ls)
+void pp_prune_rules_delete(pp_prune_rules *pr)
 {
-	unsigned int hashval;
-	const char * t;
-	char name[20], *s;
-	pp_linkset_node *p;
-	int bad, n_subscripts;
+	if (NULL == pr) return;
+
+	xfree(pr->crit_id, pr->num_con * sizeof(int));
+	xfree(pr->trigger_start, (pr->num_con + 1) * sizeof(unsigned int));
+	xfree(pr->trigger, pr->num_triggers * sizeof(unsigned int));
+	xfree(pr->link_start, (pr->num_rules + 1) * sizeof(unsigned int));
+	xfree(pr->pattern_start, (pr->num_links + 1) * sizeof(unsigned int));
+	xfree(pr->pattern, pr->num_patterns * pr->bitset_size * sizeof(uint64_t));
+	xfree(pr, sizeof(pp_prune_rules));
+}
 
-	for (hashval = 0; hashval < ls->hash_table_size; hashval++)
+/**
+ * Return TRUE if the criterion links of rule r can be satisfied by the
+ * connectors whose criterion numbers are in the bitset crit.
+ */
+static bool rule_satisfiable(const pp_prune_rules *pr, size_t r,
+                             const uint64_t *crit)
+{
+	for (size_t l = pr->link_start[r]; l < pr->link_start[r+1]; l++)
 	{
-		for (p = ls->hash_table[hashval]; p!=NULL; p=p->next)
-		{
-			/* ok, we've got our hands on one of the criterion links */
-			strncpy(name, p->str, sizeof(name)-1);
-			/* could actually use the string in place because we change it back */
-			name[sizeof(name)-1] = '\0';
-			/* now we want to see if we can satisfy this criterion link */
-			/* with a collection of the links in the cms table */
-
-			s = name;
-			if (islower((int)*s)) s++; /* skip head-dependent indicator */
-			for (; isupper((int)*s); s++) {}
-			for (;*s != '\0'; s++) if (*s != '*') *s = '#';
-
-			s = name;
-			t = p->str;
-			if (islower((int)*s)) s++; /* skip head-dependent indicator */
-			if (islower((int)*t)) t++; /* skip head-dependent indicator */
-			for (; isupper((int) *s); s++, t++) {}
-
-			/* s and t remain in lockstep */
-			bad = 0;
-			n_subscripts = 0;
-			for (;*s != '\0' && bad==0; s++, t++) {
-				if (*s == '*') continue;
-				n_subscripts++;
-				/* after the upper case part, and is not a * so must be a regular subscript */
-				*s = *t;
-				if (!match_in_cms_table(cmt, name)) bad++;
-				*s = '#';
-			}
-
-			if (n_subscripts == 0) {
-				/* now we handle the special case which occurs if there
-				   were 0 subscripts */
-				if (!match_in_cms_table(cmt, name)) bad++;
-			}
+		size_t p;
 
-			/* now if bad==0 this criterion link does the job
-			   to satisfy the needs of the trigger link */
+		for (p = pr->pattern_start[l]; p < pr->pattern_start[l+1]; p++)
+		{
+			const uint64_t *bs = &pr->pattern[p * pr->bitset_size];
+			size_t i;
 
-			if (bad == 0) return true;
+			for (i = 0; i < pr->bitset_size; i++)
+				if (0 != (bs[i] & crit[i])) break;
+			if (i == pr->bitset_size) break; /* This pattern has no match */
 		}
+
+		/* If all the patterns matched, this criterion link does the job
+		   to satisfy the needs of the trigger link */
+		if (p == pr->pattern_start[l+1]) return true;
 	}
 	return false;
 }
 
-static void delete_unmarked_disjuncts(Sentence sent)
+/**
+ * Delete the disjuncts that are not marked in the given side array,
+ * which is indexed by the disjunct store index.
+ */
+static void delete_unmarked_disjuncts(Sentence sent, const bool *marked)
 {
-	size_t w;
-	Disjunct *d_head, *d, *dx;
-
-	for (w=0; w<sent->length; w++) {
-		d_head = NULL;
-		for (d=sent->word[w].d; d != NULL; d=dx) {
-			dx = d->next;
-			if (d->marked) {
-				d->next = d_head;
-				d_head = d;
-			} else {
-				d->next = NULL;
-				free_disjuncts(d);
-			}
+	Disjunct_store *ds = sent->disjunct_store;
+
+	for (size_t w = 0; w < sent->length; w++)
+	{
+		Disjunct *dw = &ds->disjunct[ds->word_start[w]];
+		const bool *mw = &marked[ds->word_start[w]];
+		size_t n = 0;
+
+		for (size_t i = 0; i < ds->word_count[w]; i++)
+		{
+			if (!mw[i]) continue;
+			if (n != i) dw[n] = dw[i];
+			n++;
 		}
-		sent->word[w].d = d_head;
+
+		/* Reversed, as in power_prune(). */
+		ds->word_count[w] = n;
+		sent->word[w].d = disjunct_store_reverse(ds, w);
 	}
 }
 
+/* The values of the rule_status side array of pp_prune(). */
+#define RULE_UNKNOWN 0
+#define RULE_SATISFIABLE 1
+#define RULE_UNSATISFIABLE 2
+
 static int pp_prune(Sentence sent, Parse_Options opts)
 {
 	pp_knowledge * knowledge;
-	size_t i, w;
-	int total_deleted, N_deleted;
-	bool change, deleteme;
-	multiset_table *cmt;
+	const pp_prune_rules *pr;
+	size_t w;
+	int N_deleted = 0;
+	bool deleteme;
 
 	if (sent->postprocessor == NULL) return 0;
 	if (!opts->perform_pp_prune) return 0;
 
 	knowledge = sent->postprocessor->knowledge;
+	pr = sent->dict->pp_prune_rules;
+	if (pr == NULL) return 0;
+
+	/* Unmarked disjuncts get deleted. */
+	Disjunct_store *ds = sent->disjunct_store;
+	bool *marked = xalloc(ds->num_disjuncts * sizeof(bool));
+	uint64_t *crit = xalloc(pr->bitset_size * sizeof(uint64_t));
+	char *rule_status = xalloc(pr->num_rules);
 
-	cmt = cms_table_new();
+	memset(crit, 0, pr->bitset_size * sizeof(uint64_t));
+	memset(rule_status, RULE_UNKNOWN, pr->num_rules);
 
 	for (w = 0; w < sent->length; w++)
 	{
@@ -1001,88 +1562,74 @@ static int pp_prune(Sentence sent, Parse_Options opts)
 		for (d = sent->word[w].d; d != NULL; d = d->next)
 		{
 			char dir;
-			d->marked = true;
+			marked[d - ds->disjunct] = true;
 			for (dir=0; dir < 2; dir++)
 			{
 				Connector *c;
-				for (c = ((dir) ? (d->left) : (d->right)); c != NULL; c = c->next)
+				for (c = ((dir) ? (d->left) : (d->right)); c != NULL; c = connector_next(c))
 				{
-					insert_in_cms_table(cmt, c->string);
+					unsigned int con_num = c->desc->con_num;
+
+					/* A connector name that was added to the dictionary
+					 * after the rules were compiled. Don't prune. */
+					if (con_num >= pr->num_con) goto done;
+
+					int id = pr->crit_id[con_num];
+					if (id >= 0) crit[id / 64] |= (uint64_t)1 << (id % 64);
 				}
 			}
 		}
 	}
 
-	total_deleted = 0;
-	change = true;
-	while (change)
+	for (w = 0; w < sent->length; w++)
 	{
-		char dir;
-
-		change = false;
-		N_deleted = 0;
-		for (w = 0; w < sent->length; w++)
+		Disjunct *d;
+		for (d = sent->word[w].d; d != NULL; d = d->next)
 		{
-			Disjunct *d;
-			for (d = sent->word[w].d; d != NULL; d = d->next)
+			char dir;
+
+			deleteme = false;
+			for (dir = 0; dir < 2; dir++)
 			{
-				if (!d->marked) continue;
-				deleteme = false;
-				for (dir = 0; dir < 2; dir++)
+				Connector *c;
+				for (c = ((dir) ? (d->left) : (d->right)); c != NULL; c = connector_next(c))
 				{
-					Connector *c;
-					for (c = ((dir) ? (d->left) : (d->right)); c != NULL; c = c->next)
-					{
-						for (i = 0; i < knowledge->n_contains_one_rules; i++)
-						{
-							pp_rule* rule = &knowledge->contains_one_rules[i]; /* the ith rule */
-							const char * selector = rule->selector;  /* selector string for this rule */
-							pp_linkset * link_set = rule->link_set;  /* the set of criterion links */
-
-							if (strchr(selector, '*') != NULL) continue;  /* If it has a * forget it */
+					unsigned int con_num = c->desc->con_num;
 
-							if (!post_process_match(selector, c->string)) continue;
-
-							/*
-							printf("pp_prune: trigger ok.  selector = %s  c->string = %s\n", selector, c->string);
-							*/
-
-							/* We know c matches the trigger link of the rule. */
-							/* Now check the criterion links */
+					for (size_t t = pr->trigger_start[con_num];
+					     t < pr->trigger_start[con_num+1]; t++)
+					{
+						/* We know c matches the trigger link of the rule. */
+						/* Now check the criterion links */
+						size_t r = pr->trigger[t];
 
-							if (!rule_satisfiable(cmt, link_set))
-							{
-								deleteme = true;
-								rule->use_count++;
-							}
-							if (deleteme) break;
+						if (RULE_UNKNOWN == rule_status[r])
+						{
+							rule_status[r] = rule_satisfiable(pr, r, crit) ?
+								RULE_SATISFIABLE : RULE_UNSATISFIABLE;
 						}
-						if (deleteme) break;
-					}
-					if (deleteme) break;
-				}
-
-				if (deleteme)         /* now we delete this disjunct */
-				{
-					N_deleted++;
-					total_deleted++;
-					d->marked = false; /* mark for deletion later */
-					for (dir=0; dir < 2; dir++)
-					{
-						Connector *c;
-						for (c = ((dir) ? (d->left) : (d->right)); c != NULL; c = c->next)
+						if (RULE_UNSATISFIABLE == rule_status[r])
 						{
-							change |= delete_from_cms_table(cmt, c->string);
+							deleteme = true;
+							knowledge->contains_one_rules[r].use_count++;
+							break;
 						}
 					}
+					if (deleteme) break;
 				}
+				if (deleteme) break;
 			}
-		}
 
-		lgdebug(D_PRUNE, "Debug: pp_prune pass deleted %d\n", N_deleted);
+			if (deleteme)         /* now we delete this disjunct */
+			{
+				N_deleted++;
+				marked[d - ds->disjunct] = false; /* mark for deletion later */
+			}
+		}
 	}
-	delete_unmarked_disjuncts(sent);
-	cms_table_delete(cmt);
+
+	lgdebug(D_PRUNE, "Debug: pp_prune pass deleted %d\n", N_deleted);
+	delete_unmarked_disjuncts(sent, marked);
 
 	if ((0 != N_deleted) && verbosity_level(D_PRUNE))
 	{
@@ -1093,10 +1640,36 @@ static int pp_prune(Sentence sent, Parse_Options opts)
 
 	print_time(opts, "pp pruning");
 
-	return total_deleted;
+done:
+	xfree(marked, ds->num_disjuncts * sizeof(bool));
+	xfree(crit, pr->bitset_size * sizeof(uint64_t));
+	xfree(rule_status, pr->num_rules);
+	return N_deleted;
 }
 
 
+/**
+ * Record the number of disjuncts and connectors that remain in the
+ * sentence, for sizing the parse data structures.
+ */
+static void count_sentence_disjuncts(Sentence sent)
+{
+	size_t dcnt = 0, ccnt = 0;
+
+	for (size_t w = 0; w < sent->length; w++)
+	{
+		for (Disjunct *d = sent->word[w].d; d != NULL; d = d->next)
+		{
+			dcnt++;
+			for (Connector *c = d->left; c != NULL; c = connector_next(c)) ccnt++;
+			for (Connector *c = d->right; c != NULL; c = connector_next(c)) ccnt++;
+		}
+	}
+
+	sent->num_disjuncts = dcnt;
+	sent->num_connectors = ccnt;
+}
+
 /**
  * Do the following pruning steps until nothing happens:
  * power pp power pp power pp....
@@ -1106,6 +1679,7 @@ void pp_and_power_prune(Sentence sent, Parse_Options opts)
 {
 	power_prune(sent, opts);
 	pp_prune(sent, opts);
+	count_sentence_disjuncts(sent);
 
 	return;
 
@@ -1120,3 +1694,82 @@ void pp_and_power_prune(Sentence sent, Parse_Options opts)
 	}
 #endif
 }
+
+/* ============================================================= */
+/* Pruning rollback.
+ *
+ * The pruning for null_count==0 is more aggressive than the pruning for
+ * parsing with null words (see classic_parse()), so if no complete
+ * parse is found, the disjuncts of the sentence must be restored to
+ * their state before it. Pruning only moves disjuncts within the
+ * disjunct store, and changes the nearest_word field of connectors, so
+ * the disjunct array, the disjunct count of each word and these fields
+ * are saved.
+ */
+struct disjuncts_snapshot_s
+{
+	Disjunct *disjunct;      /* A copy of the store disjunct array */
+	size_t *word_count;      /* Number of disjuncts of each word */
+	uint8_t *nearest_word;   /* Of all the store connectors */
+	size_t num_disjuncts;
+	size_t num_connectors;
+	size_t num_words;
+};
+
+/**
+ * Save the disjuncts of the sentence, so restore_disjuncts() can
+ * restore them after pruning.
+ */
+void save_disjuncts(Sentence sent)
+{
+	Disjunct_store *dst = sent->disjunct_store;
+	struct disjuncts_snapshot_s *ds = xalloc(sizeof(*ds));
+
+	ds->num_disjuncts = dst->num_disjuncts;
+	ds->num_connectors = dst->num_connectors;
+	ds->num_words = dst->num_words;
+	ds->disjunct = xalloc(ds->num_disjuncts * sizeof(Disjunct));
+	ds->word_count = xalloc(ds->num_words * sizeof(size_t));
+	ds->nearest_word = xalloc(ds->num_connectors * sizeof(uint8_t));
+
+	memcpy(ds->disjunct, dst->disjunct, ds->num_disjuncts * sizeof(Disjunct));
+	memcpy(ds->word_count, dst->word_count, ds->num_words * sizeof(size_t));
+	for (size_t i = 0; i < ds->num_connectors; i++)
+		ds->nearest_word[i] = dst->connector[i].nearest_word;
+
+	sent->disjuncts_snapshot = ds;
+}
+
+/**
+ * Restore the disjuncts of the sentence to their state when
+ * save_disjuncts() was called. The snapshot remains valid.
+ */
+void restore_disjuncts(Sentence sent)
+{
+	Disjunct_store *dst = sent->disjunct_store;
+	struct disjuncts_snapshot_s *ds = sent->disjuncts_snapshot;
+
+	memcpy(dst->disjunct, ds->disjunct, ds->num_disjuncts * sizeof(Disjunct));
+	memcpy(dst->word_count, ds->word_count, ds->num_words * sizeof(size_t));
+	for (size_t i = 0; i < ds->num_connectors; i++)
+		dst->connector[i].nearest_word = ds->nearest_word[i];
+
+	for (size_t w = 0; w < sent->length; w++)
+		sent->word[w].d = disjunct_store_relink(dst, w);
+}
+
+/**
+ * Free the snapshot.
+ */
+void free_saved_disjuncts(Sentence sent)
+{
+	struct disjuncts_snapshot_s *ds = sent->disjuncts_snapshot;
+
+	if (NULL == ds) return;
+
+	xfree(ds->disjunct, ds->num_disjuncts * sizeof(Disjunct));
+	xfree(ds->word_count, ds->num_words * sizeof(size_t));
+	xfree(ds->nearest_word, ds->num_connectors * sizeof(uint8_t));
+	xfree(ds, sizeof(*ds));
+	sent->disjuncts_snapshot = NULL;
+}
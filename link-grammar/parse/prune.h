@@ -13,9 +13,17 @@
 #ifndef _PRUNE_H
 #define _PRUNE_H
 
+#include "api-types.h"
 #include "link-includes.h"
 
 int        power_prune(Sentence, Parse_Options);
 void       pp_and_power_prune(Sentence, Parse_Options);
 
+pp_prune_rules * pp_prune_rules_new(const pp_knowledge *, const Connector_table *);
+void       pp_prune_rules_delete(pp_prune_rules *);
+
+void       save_disjuncts(Sentence);
+void       restore_disjuncts(Sentence);
+void       free_saved_disjuncts(Sentence);
+
 #endif /* _PRUNE_H */
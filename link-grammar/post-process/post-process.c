@@ -30,6 +30,22 @@
 
 #define PP_MAX_DOMAINS 128
 
+/* Parallel post-processing (see post_process_parallel()) needs POSIX
+ * threads. */
+#if defined HAVE_PTHREAD
+#define USE_PARALLEL_POST_PROCESS
+#include <pthread.h>
+#endif
+
+/* Count a use of the rule r. The rules are shared by the threads of
+ * the parallel post-processing, so their use counts are updated
+ * atomically. */
+#ifdef USE_PARALLEL_POST_PROCESS
+#define RULE_USED(r) __atomic_add_fetch(&(r)->use_count, 1, __ATOMIC_RELAXED)
+#else
+#define RULE_USED(r) ((r)->use_count++)
+#endif /* USE_PARALLEL_POST_PROCESS */
+
 /**
  * post_process_match -- compare two link-types.
  *
@@ -67,34 +83,140 @@ bool post_process_match(const char *s, const char *t)
 
 /***************** utility routines (not exported) ***********************/
 
-/**
- * Returns false if the string s does not match anything in
- * the array. The array elements are post-processing symbols.
- */
-static int string_in_list(const char * s, const char * a[])
-{
-	int i;
-	for (i=0; a[i] != NULL; i++)
-		if (post_process_match(a[i], s)) return true;
-	return false;
-}
-
 /**
  * Return the name of the domain associated with the provided starting
  * link. Return -1 if link isn't associated with a domain.
  */
-static size_t find_domain_name(Postprocessor *pp, const char *link)
+static int find_domain_name(const pp_knowledge *kno, const char *link)
 {
-	size_t i, domain;
-	StartingLinkAndDomain *sllt = pp->knowledge->starting_link_lookup_table;
+	size_t i;
+	int domain;
+	StartingLinkAndDomain *sllt = kno->starting_link_lookup_table;
 	for (i=0;;i++)
 	{
 		domain = sllt[i].domain;
-		if (domain == SIZE_MAX) return SIZE_MAX;  /* hit the end-of-list sentinel */
+		if (domain == -1) return -1;  /* hit the end-of-list sentinel */
 		if (post_process_match(sllt[i].starting_link, link)) return domain;
 	}
 }
 
+/************************ link names *************************************/
+
+#define PP_NAME_TABLE_INITLEN 64 /* A power of 2 */
+
+static size_t name_hash(const char *s)
+{
+	size_t h = 0;
+	for (; *s != '\0'; s++)
+		h = *s + 31*h;
+	return h;
+}
+
+static void name_table_grow(PP_data *pp_data)
+{
+	PP_name **old_table = pp_data->name_table;
+	size_t old_size = pp_data->name_table_size;
+
+	pp_data->name_table_size *= 2;
+	pp_data->name_table =
+		calloc(pp_data->name_table_size, sizeof(PP_name *));
+
+	size_t mask = pp_data->name_table_size - 1;
+	for (size_t n = 0; n < old_size; n++)
+	{
+		if (NULL == old_table[n]) continue;
+		size_t i = name_hash(old_table[n]->str) & mask;
+		while (NULL != pp_data->name_table[i]) i = (i + 1) & mask;
+		pp_data->name_table[i] = old_table[n];
+	}
+	free(old_table);
+}
+
+/**
+ * Intern the link name. The first time that a link name is seen, find
+ * everything that the rules need to know about it: the domain type that
+ * it starts, the link sets of the knowledge file that it is in, and the
+ * rule patterns that it matches.
+ */
+static const PP_name *pp_name_intern(PP_data *pp_data, const char *str)
+{
+	const pp_knowledge *kno = pp_data->knowledge;
+	size_t mask = pp_data->name_table_size - 1;
+	size_t i;
+
+	for (i = name_hash(str) & mask; NULL != pp_data->name_table[i];
+	     i = (i + 1) & mask)
+	{
+		const char *s = pp_data->name_table[i]->str;
+		if ((s == str) || (0 == strcmp(s, str)))
+			return pp_data->name_table[i];
+	}
+
+	PP_name *n =
+		malloc(sizeof(PP_name) + pp_data->patset_len * sizeof(pp_patset));
+	n->str = str;
+	n->domain = find_domain_name(kno, str);
+
+	n->links = 0;
+	if (pp_linkset_match(kno->ignore_these_links, str))
+		n->links |= PP_IGNORE_LINK;
+	if (pp_linkset_match(kno->domain_starter_links, str))
+		n->links |= PP_DOMAIN_STARTER_LINK;
+	if (pp_linkset_match(kno->urfl_domain_starter_links, str))
+		n->links |= PP_URFL_DOMAIN_STARTER_LINK;
+	if (pp_linkset_match(kno->urfl_only_domain_starter_links, str))
+		n->links |= PP_URFL_ONLY_DOMAIN_STARTER_LINK;
+	if (pp_linkset_match(kno->left_domain_starter_links, str))
+		n->links |= PP_LEFT_DOMAIN_STARTER_LINK;
+	if (pp_linkset_match(kno->domain_contains_links, str))
+		n->links |= PP_DOMAIN_CONTAINS_LINK;
+	if (pp_linkset_match(kno->restricted_links, str))
+		n->links |= PP_RESTRICTED_LINK;
+
+	memset(n->patterns, 0, pp_data->patset_len * sizeof(pp_patset));
+	for (size_t p = 0; p < kno->n_rule_patterns; p++)
+	{
+		if (post_process_match(kno->rule_pattern[p], str))
+			pp_patset_add(n->patterns, p);
+	}
+
+	pp_data->name_table[i] = n;
+	pp_data->num_names++;
+	if (2 * pp_data->num_names > pp_data->name_table_size)
+		name_table_grow(pp_data);
+
+	return n;
+}
+
+/**
+ * Intern the link names of the linkage, and find the rule patterns that
+ * its links match.
+ */
+static void intern_link_names(PP_data *pp_data, Linkage sublinkage)
+{
+	if (pp_data->lnlen < sublinkage->num_links)
+	{
+		pp_data->lnlen = sublinkage->num_links;
+		pp_data->link_name = realloc(pp_data->link_name,
+		                             pp_data->lnlen * sizeof(PP_name *));
+	}
+	memset(pp_data->linkage_patterns, 0,
+	       pp_data->patset_len * sizeof(pp_patset));
+
+	for (size_t link = 0; link < sublinkage->num_links; link++)
+	{
+		const char *s = sublinkage->link_array[link].link_name;
+		const PP_name *n = (NULL == s) ? NULL : pp_name_intern(pp_data, s);
+
+		pp_data->link_name[link] = n;
+		if (NULL != n)
+		{
+			pp_patset_union(pp_data->linkage_patterns, n->patterns,
+			                pp_data->patset_len);
+		}
+	}
+}
+
 /** Returns true if domain d1 is contained in domain d2 */
 static int contained_in(const Domain * d1, const Domain * d2,
                         const Linkage sublinkage)
@@ -258,7 +380,7 @@ static bool apply_rules(PP_data *pp_data,
 	{
 		if (!applyfn(pp_data, sublinkage, &(rule_array[i])))
 		{
-			rule_array[i].use_count ++;
+			RULE_USED(&rule_array[i]);
 			return false;
 		}
 	}
@@ -278,7 +400,7 @@ apply_relevant_rules(Postprocessor *pp,
 
 	/* If we didn't accumulate link names for this sentence, we need
 	 *  to apply all rules. */
-	if (pp_linkset_population(pp->set_of_links_of_sentence) == 0) {
+	if (!pp->q_scanned_links) {
 		return apply_rules(pp_data, applyfn, sublinkage, rule_array, msg);
 	}
 
@@ -293,37 +415,22 @@ apply_relevant_rules(Postprocessor *pp,
 
 /**
  * returns true if and only if all groups containing the specified link
- * contain at least one from the required list. (as determined by exact
- * string matching)
+ * contain at least one from the required list. (The patterns that the
+ * links of each group match are in domain_patterns.)
  */
 static bool
 apply_contains_one(PP_data *pp_data, Linkage sublinkage, pp_rule *rule)
 {
-	DTreeLeaf * dtl;
-	size_t d, count;
+	size_t d;
 
 	for (d=0; d<pp_data->N_domains; d++)
 	{
-		for (dtl = pp_data->domain_array[d].child;
-		     dtl != NULL &&
-		        !post_process_match(rule->selector,
-		           sublinkage->link_array[dtl->link].link_name);
-		     dtl = dtl->next) {}
-		if (dtl != NULL)
-		{
-			/* selector link of rule appears in this domain */
-			count=0;
-			for (dtl = pp_data->domain_array[d].child; dtl != NULL; dtl = dtl->next)
-			{
-				if (string_in_list(sublinkage->link_array[dtl->link].link_name,
-				                   rule->link_array))
-				{
-					count=1;
-					break;
-				}
-			}
-			if (count == 0) return false;
-		}
+		const pp_patset *group = &pp_data->domain_patterns[d * pp_data->patset_len];
+
+		/* selector link of rule appears in this domain */
+		if (pp_patset_has(group, rule->selector_num) &&
+		    !pp_patset_intersects(group, rule->patset, pp_data->patset_len))
+			return false;
 	}
 	return true;
 }
@@ -332,7 +439,7 @@ apply_contains_one(PP_data *pp_data, Linkage sublinkage, pp_rule *rule)
 /**
  * Returns true if and only if:
  * all groups containing the selector link do not contain anything
- * from the link_array contained in the rule. Uses exact string matching.
+ * from the link_array contained in the rule.
  */
 static bool
 apply_contains_none(PP_data *pp_data, Linkage sublinkage, pp_rule *rule)
@@ -341,22 +448,12 @@ apply_contains_none(PP_data *pp_data, Linkage sublinkage, pp_rule *rule)
 
 	for (d=0; d<pp_data->N_domains; d++)
 	{
-		DTreeLeaf * dtl;
-		for (dtl = pp_data->domain_array[d].child;
-		     dtl != NULL &&
-		         !post_process_match(rule->selector,
-		                  sublinkage->link_array[dtl->link].link_name);
-		     dtl = dtl->next) {}
-		if (dtl != NULL)
-		{
-			/* selector link of rule appears in this domain */
-			for (dtl = pp_data->domain_array[d].child; dtl != NULL; dtl = dtl->next)
-			{
-				if (string_in_list(sublinkage->link_array[dtl->link].link_name,
-				                   rule->link_array))
-					return false;
-			}
-		}
+		const pp_patset *group = &pp_data->domain_patterns[d * pp_data->patset_len];
+
+		/* selector link of rule appears in this domain */
+		if (pp_patset_has(group, rule->selector_num) &&
+		    pp_patset_intersects(group, rule->patset, pp_data->patset_len))
+			return false;
 	}
 	return true;
 }
@@ -369,26 +466,12 @@ apply_contains_none(PP_data *pp_data, Linkage sublinkage, pp_rule *rule)
 static bool
 apply_contains_one_globally(PP_data *pp_data, Linkage sublinkage, pp_rule *rule)
 {
-	size_t i, j, count;
-	for (i = 0; i < sublinkage->num_links; i++)
-	{
-		assert(sublinkage->link_array[i].lw != SIZE_MAX);
-		if (post_process_match(rule->selector, sublinkage->link_array[i].link_name)) break;
-	}
-	if (i == sublinkage->num_links) return true;
+	if (!pp_patset_has(pp_data->linkage_patterns, rule->selector_num))
+		return true;
 
 	/* selector link of rule appears in sentence */
-	count = 0;
-	for (j = 0; j < sublinkage->num_links && count == 0; j++)
-	{
-		assert(sublinkage->link_array[j].lw != SIZE_MAX);
-		if (string_in_list(sublinkage->link_array[j].link_name, rule->link_array))
-		{
-			count = 1;
-			break;
-		}
-	}
-	if (count == 0) return false; else return true;
+	return pp_patset_intersects(pp_data->linkage_patterns, rule->patset,
+	                            pp_data->patset_len);
 }
 
 /**
@@ -435,7 +518,8 @@ apply_must_form_a_cycle(PP_data *pp_data, Linkage sublinkage, pp_rule *rule)
 		for (lol = pp_data->word_links[w]; lol != NULL; lol = lol->next)
 		{
 			if (w > lol->word) continue; /* only consider each edge once */
-			if (!pp_linkset_match(rule->link_set, sublinkage->link_array[lol->link].link_name)) continue;
+			if (!pp_patset_intersects(pp_data->link_name[lol->link]->patterns,
+			                          rule->patset, pp_data->patset_len)) continue;
 
 			clear_visited(pp_data);
 			reachable_without_dfs(pp_data, sublinkage, w, lol->word, w);
@@ -447,7 +531,8 @@ apply_must_form_a_cycle(PP_data *pp_data, Linkage sublinkage, pp_rule *rule)
 	{
 		w = sublinkage->link_array[lol->link].lw;
 		/* (w, lol->word) are the left and right ends of the edge we're considering */
-		if (!pp_linkset_match(rule->link_set, sublinkage->link_array[lol->link].link_name)) continue;
+		if (!pp_patset_intersects(pp_data->link_name[lol->link]->patterns,
+		                          rule->patset, pp_data->patset_len)) continue;
 
 		clear_visited(pp_data);
 		reachable_without_dfs(pp_data, sublinkage, w, lol->word, w);
@@ -508,9 +593,8 @@ static void build_graph(Postprocessor *pp, Linkage sublinkage)
 	for (link = 0; link < sublinkage->num_links; link++)
 	{
 		assert (sublinkage->link_array[link].lw != SIZE_MAX);
-		if (NULL == sublinkage->link_array[link].link_name) continue;
-		if (pp_linkset_match(pp->knowledge->ignore_these_links,
-		                     sublinkage->link_array[link].link_name))
+		if (NULL == pp_data->link_name[link]) continue;
+		if (pp_data->link_name[link]->links & PP_IGNORE_LINK)
 		{
 			lol = (List_o_links *) malloc(sizeof(List_o_links));
 			lol->next = pp_data->links_to_ignore;
@@ -592,8 +676,7 @@ static void depth_first_search(Postprocessor *pp, Linkage sublinkage,
 	{
 		if (!pp_data->visited[lol->word] && (lol->word != root) &&
 		       !(lol->word < root && lol->word < w &&
-		       pp_linkset_match(pp->knowledge->restricted_links,
-		                sublinkage->link_array[lol->link].link_name)))
+		       (pp_data->link_name[lol->link]->links & PP_RESTRICTED_LINK)))
 		{
 			depth_first_search(pp, sublinkage, lol->word, root, start_link);
 		}
@@ -620,8 +703,7 @@ static void bad_depth_first_search(Postprocessor *pp, Linkage sublinkage,
 		assert(lol->word < pp_data->num_words, "Bad word index");
 		if ((!pp_data->visited[lol->word]) && !(w == root && lol->word < w) &&
 		     !(lol->word < root && lol->word < w &&
-		          pp_linkset_match(pp->knowledge->restricted_links,
-		                sublinkage->link_array[lol->link].link_name)))
+		          (pp_data->link_name[lol->link]->links & PP_RESTRICTED_LINK)))
 		{
 			bad_depth_first_search(pp, sublinkage, lol->word, root, start_link);
 		}
@@ -649,8 +731,7 @@ static void d_depth_first_search(Postprocessor *pp, Linkage sublinkage,
 		if (!pp_data->visited[lol->word] && !(w == root && lol->word >= right) &&
 		    !(w == root && lol->word < root) &&
 		       !(lol->word < root && lol->word < w &&
-		          pp_linkset_match(pp->knowledge->restricted_links,
-		                   sublinkage->link_array[lol->link].link_name)))
+		          (pp_data->link_name[lol->link]->links & PP_RESTRICTED_LINK)))
 		{
 			d_depth_first_search(pp,sublinkage,lol->word,root,right,start_link);
 		}
@@ -689,7 +770,7 @@ static int domain_compare(const Domain * d1, const Domain * d2)
 
 static void build_domains(Postprocessor *pp, Linkage sublinkage)
 {
-	size_t link, i, d;
+	size_t link, d;
 	const char *s;
 	PP_data *pp_data = &pp->pp_data;
 
@@ -697,15 +778,17 @@ static void build_domains(Postprocessor *pp, Linkage sublinkage)
 
 	for (link = 0; link<sublinkage->num_links; link++)
 	{
+		const PP_name *n = pp_data->link_name[link];
+
 		assert (sublinkage->link_array[link].lw != SIZE_MAX);
-		if (NULL == sublinkage->link_array[link].link_name) continue;
+		if (NULL == n) continue;
 		s = sublinkage->link_array[link].link_name;
 
-		if (pp_linkset_match(pp->knowledge->ignore_these_links, s)) continue;
-		if (pp_linkset_match(pp->knowledge->domain_starter_links, s))
+		if (n->links & PP_IGNORE_LINK) continue;
+		if (n->links & PP_DOMAIN_STARTER_LINK)
 		{
 			setup_domain_array(pp, s, link);
-			if (pp_linkset_match(pp->knowledge->domain_contains_links, s))
+			if (n->links & PP_DOMAIN_CONTAINS_LINK)
 				add_link_to_domain(pp_data, link);
 
 			clear_visited(pp_data);
@@ -713,7 +796,7 @@ static void build_domains(Postprocessor *pp, Linkage sublinkage)
 			                   sublinkage->link_array[link].lw, link);
 		}
 		else
-		if (pp_linkset_match(pp->knowledge->urfl_domain_starter_links, s))
+		if (n->links & PP_URFL_DOMAIN_STARTER_LINK)
 		{
 			setup_domain_array(pp, s, link);
 			/* always add the starter link to its urfl domain */
@@ -724,7 +807,7 @@ static void build_domains(Postprocessor *pp, Linkage sublinkage)
 			                       sublinkage->link_array[link].lw, link);
 		}
 		else
-		if (pp_linkset_match(pp->knowledge->urfl_only_domain_starter_links, s))
+		if (n->links & PP_URFL_ONLY_DOMAIN_STARTER_LINK)
 		{
 			setup_domain_array(pp, s, link);
 			/* do not add the starter link to its urfl_only domain */
@@ -734,7 +817,7 @@ static void build_domains(Postprocessor *pp, Linkage sublinkage)
 			                     sublinkage->link_array[link].rw, link);
 		}
 		else
-		if (pp_linkset_match(pp->knowledge->left_domain_starter_links, s))
+		if (n->links & PP_LEFT_DOMAIN_STARTER_LINK)
 		{
 			setup_domain_array(pp, s, link);
 			/* do not add the starter link to a left domain */
@@ -753,8 +836,8 @@ static void build_domains(Postprocessor *pp, Linkage sublinkage)
 	/* sanity check: all links in all domains have a legal domain name */
 	for (d = 0; d < pp_data->N_domains; d++)
 	{
-		i = find_domain_name(pp, pp_data->domain_array[d].string);
-		if (i == SIZE_MAX)
+		int i = pp_data->link_name[pp_data->domain_array[d].start_link]->domain;
+		if (i == -1)
 			prt_error("Error: post_process(): Need an entry for %s in LINK_TYPE_TABLE\n",
 			          pp_data->domain_array[d].string);
 		pp_data->domain_array[d].type = i;
@@ -809,6 +892,27 @@ static void build_domain_forest(PP_data *pp_data, Linkage sublinkage)
 			}
 		}
 	}
+
+	/* The rule patterns that the links of the group of each domain
+	 * match, for the contains rules. */
+	size_t len = pp_data->patset_len;
+	if (pp_data->dplen < pp_data->N_domains)
+	{
+		pp_data->dplen = pp_data->N_domains;
+		pp_data->domain_patterns = realloc(pp_data->domain_patterns,
+		                           pp_data->dplen * len * sizeof(pp_patset));
+	}
+	memset(pp_data->domain_patterns, 0,
+	       pp_data->N_domains * len * sizeof(pp_patset));
+	for (d = 0; d < pp_data->N_domains; d++)
+	{
+		for (dtl = pp_data->domain_array[d].child; dtl != NULL; dtl = dtl->next)
+		{
+			const PP_name *n = pp_data->link_name[dtl->link];
+			if (NULL == n) continue;
+			pp_patset_union(&pp_data->domain_patterns[d * len], n->patterns, len);
+		}
+	}
 }
 
 static int
@@ -869,17 +973,16 @@ static void prune_irrelevant_rules(Postprocessor *pp)
 	int coIDX, cnIDX, rcoIDX = 0, rcnIDX = 0;
 
 	/* If we didn't scan any linkages, there's no pruning to be done. */
-	if (pp_linkset_population(pp->set_of_links_of_sentence) == 0) return;
+	if (!pp->q_scanned_links) return;
 
 	for (coIDX = 0; ; coIDX++)
 	{
 		rule = &(pp->knowledge->contains_one_rules[coIDX]);
 		if (rule->msg == NULL) break;
-		if (pp_linkset_match_bw(pp->set_of_links_of_sentence, rule->selector))
+		if (pp_patset_has(pp->sentence_patterns, rule->selector_num))
 		{
 			/* Mark rule as being relevant to this sentence */
 			pp->relevant_contains_one_rules[rcoIDX++] = coIDX;
-			pp_linkset_add(pp->set_of_links_in_an_active_rule, rule->selector);
 		}
 	}
 	pp->relevant_contains_one_rules[rcoIDX] = -1;  /* end sentinel */
@@ -888,10 +991,9 @@ static void prune_irrelevant_rules(Postprocessor *pp)
 	{
 		rule = &(pp->knowledge->contains_none_rules[cnIDX]);
 		if (rule->msg == NULL) break;
-		if (pp_linkset_match_bw(pp->set_of_links_of_sentence, rule->selector))
+		if (pp_patset_has(pp->sentence_patterns, rule->selector_num))
 		{
 			pp->relevant_contains_none_rules[rcnIDX++] = cnIDX;
-			pp_linkset_add(pp->set_of_links_in_an_active_rule, rule->selector);
 		}
 	}
 	pp->relevant_contains_none_rules[rcnIDX] = -1;
@@ -899,7 +1001,7 @@ static void prune_irrelevant_rules(Postprocessor *pp)
 	if (verbosity_level(5))
 	{
 		err_msg(lg_Debug, "PP: Saw %zd unique link names in all linkages.\n\\",
-		       pp_linkset_population(pp->set_of_links_of_sentence));
+		       pp->pp_data.num_names);
 		err_msg(lg_Debug, "PP: Using %i 'contains one' rules "
 		                  "and %i 'contains none' rules\n",
 		       rcoIDX, rcnIDX);
@@ -918,6 +1020,47 @@ static void pp_new_domain_array(PP_data *pp_data)
 	memset(pp_data->domain_array, 0, pp_data->domlen * sizeof(Domain));
 }
 
+static void pp_data_init(PP_data *pp_data, const pp_knowledge *kno)
+{
+	pp_data->vlength = PP_INITLEN;
+	pp_data->visited = (bool*) malloc(pp_data->vlength * sizeof(bool));
+	memset(pp_data->visited, 0, pp_data->vlength * sizeof(bool));
+
+	pp_data->links_to_ignore = NULL;
+	pp_new_domain_array(pp_data);
+
+	pp_data->wowlen = PP_INITLEN;
+	pp_data->word_links = (List_o_links **) malloc(pp_data->wowlen * sizeof(List_o_links*));
+	memset(pp_data->word_links, 0, pp_data->wowlen * sizeof(List_o_links *));
+
+	pp_data->knowledge = kno;
+	pp_data->patset_len = kno->patset_len;
+	pp_data->name_table_size = PP_NAME_TABLE_INITLEN;
+	pp_data->name_table = calloc(pp_data->name_table_size, sizeof(PP_name *));
+	pp_data->num_names = 0;
+
+	pp_data->link_name = NULL;
+	pp_data->lnlen = 0;
+	pp_data->linkage_patterns = malloc(pp_data->patset_len * sizeof(pp_patset));
+	pp_data->domain_patterns = NULL;
+	pp_data->dplen = 0;
+}
+
+static void pp_data_free(PP_data *pp_data)
+{
+	post_process_free_data(pp_data);
+	free(pp_data->visited);
+	free(pp_data->domain_array);
+	free(pp_data->word_links);
+
+	for (size_t i = 0; i < pp_data->name_table_size; i++)
+		free(pp_data->name_table[i]);
+	free(pp_data->name_table);
+	free(pp_data->link_name);
+	free(pp_data->linkage_patterns);
+	free(pp_data->domain_patterns);
+}
+
 /**
  * read rules from path and initialize the appropriate fields in
  * a postprocessor structure, a pointer to which is returned.
@@ -925,15 +1068,14 @@ static void pp_new_domain_array(PP_data *pp_data)
 Postprocessor * post_process_new(pp_knowledge * kno)
 {
 	Postprocessor *pp;
-	PP_data *pp_data;
 
 	if (NULL == kno) return NULL;
 
 	pp = (Postprocessor *) malloc (sizeof(Postprocessor));
 	pp->knowledge = kno;
 	pp->string_set = string_set_create();
-	pp->set_of_links_of_sentence = pp_linkset_open(1024);
-	pp->set_of_links_in_an_active_rule = pp_linkset_open(1024);
+	pp->q_scanned_links = false;
+	pp->sentence_patterns = calloc(kno->patset_len, sizeof(pp_patset));
 	pp->relevant_contains_one_rules =
 	      (int *) malloc ((pp->knowledge->n_contains_one_rules + 1)
 	                      *(sizeof pp->relevant_contains_one_rules[0]));
@@ -948,40 +1090,23 @@ Postprocessor * post_process_new(pp_knowledge * kno)
 
 	pp->q_pruned_rules = false;
 
-	pp_data = &pp->pp_data;
-	pp_data->vlength = PP_INITLEN;
-	pp_data->visited = (bool*) malloc(pp_data->vlength * sizeof(bool));
-	memset(pp_data->visited, 0, pp_data->vlength * sizeof(bool));
-
-	pp_data->links_to_ignore = NULL;
-	pp_new_domain_array(pp_data);
-
-	pp_data->wowlen = PP_INITLEN;
-	pp_data->word_links = (List_o_links **) malloc(pp_data->wowlen * sizeof(List_o_links*));
-	memset(pp_data->word_links, 0, pp_data->wowlen * sizeof(List_o_links *));
+	pp_data_init(&pp->pp_data, kno);
 
 	return pp;
 }
 
 void post_process_free(Postprocessor *pp)
 {
-	PP_data *pp_data;
-
 	/* frees up memory associated with pp, previously allocated by open */
 	if (pp == NULL) return;
 	string_set_delete(pp->string_set);
-	pp_linkset_close(pp->set_of_links_of_sentence);
-	pp_linkset_close(pp->set_of_links_in_an_active_rule);
+	free(pp->sentence_patterns);
 	free(pp->relevant_contains_one_rules);
 	free(pp->relevant_contains_none_rules);
 	pp->knowledge = NULL;
 	pp->violation = NULL;
 
-	pp_data = &pp->pp_data;
-	post_process_free_data(pp_data);
-	free(pp_data->visited);
-	free(pp_data->domain_array);
-	free(pp_data->word_links);
+	pp_data_free(&pp->pp_data);
 
 	free(pp);
 }
@@ -989,7 +1114,8 @@ void post_process_free(Postprocessor *pp)
 /**
  * During a first pass (prior to actual post-processing of the linkages
  * of a sentence), call this once for every generated linkage. Here we
- * simply maintain a set of "seen" link names for rule pruning, later on.
+ * simply maintain the set of rule patterns of the "seen" link names for
+ * rule pruning, later on.
  */
 static void post_process_scan_linkage(Postprocessor *pp, Linkage linkage)
 {
@@ -999,8 +1125,11 @@ static void post_process_scan_linkage(Postprocessor *pp, Linkage linkage)
 	{
 		assert(linkage->link_array[i].lw != SIZE_MAX);
 
-		pp_linkset_add(pp->set_of_links_of_sentence,
-			linkage->link_array[i].link_name);
+		const PP_name *n =
+			pp_name_intern(&pp->pp_data, linkage->link_array[i].link_name);
+		pp_patset_union(pp->sentence_patterns, n->patterns,
+		                pp->pp_data.patset_len);
+		pp->q_scanned_links = true;
 	}
 }
 
@@ -1088,6 +1217,8 @@ void do_post_process(Postprocessor *pp, Linkage sublinkage, bool is_long)
 	}
 	clear_visited(pp_data);
 
+	intern_link_names(pp_data, sublinkage);
+
 	/* For long sentences, we can save some time by pruning the rules
 	 * which can't possibly be used during postprocessing the linkages
 	 * of this sentence. For short sentences, this is pointless. */
@@ -1119,6 +1250,124 @@ void do_post_process(Postprocessor *pp, Linkage sublinkage, bool is_long)
 	report_pp_stats(pp);
 }
 
+#ifdef USE_PARALLEL_POST_PROCESS
+/* Parallel post-processing.
+ *
+ * The linkages are post-processed independently of each other, so with
+ * opts->threads > 1, the second pass of post_process_lkgs() is divided
+ * among threads, each with its own copy of the postprocessor. The copies
+ * share the rules and the rule pruning. The rule pruning is done before
+ * the threads are started, so they only read it, and the rules are only
+ * read too, except for their use counts (see RULE_USED()). Each copy has
+ * its own per-linkage state (PP_data and the violation). The results
+ * are then merged by post_process_lkgs() in the order of the linkages,
+ * so they are the same as with serial post-processing.
+ */
+#define PARALLEL_POST_PROCESS_MIN_LINKAGES 64
+
+/* The violation of a linkage that has not been post-processed. */
+static const char pp_not_done[] = "";
+
+typedef struct
+{
+	Sentence sent;
+	Parse_Options opts;
+	Postprocessor pp;        /* The copy of the postprocessor */
+	bool twopass;
+	const char **violation;  /* The results, per linkage */
+	size_t i;                /* Do the linkages i, i+n, i+2n, ... */
+	size_t n;
+	pthread_t thread;
+} pp_worker;
+
+static void *pp_worker_run(void *arg)
+{
+	pp_worker *pw = arg;
+	Sentence sent = pw->sent;
+	size_t N_done = 0;
+
+	for (size_t in = pw->i; in < sent->num_linkages_alloced; in += pw->n)
+	{
+		Linkage lkg = &sent->lnkages[in];
+		Linkage_info *lifo = &lkg->lifo;
+
+		if (lifo->discarded || lifo->N_violations) continue;
+
+		do_post_process(&pw->pp, lkg, pw->twopass);
+		post_process_free_data(&pw->pp.pp_data);
+		pw->violation[in] = pw->pp.violation;
+
+		if ((9 == N_done++%10) && resources_exhausted(pw->opts->resources))
+			break;
+	}
+
+	return NULL;
+}
+
+/**
+ * Post-process the linkages of the sentence with several threads, and
+ * return the violation (or NULL) of each one, pp_not_done if it was not
+ * post-processed (due to a timeout). Return NULL if it should be done
+ * serially.
+ */
+static const char **post_process_parallel(Postprocessor *pp, Sentence sent,
+                                          bool twopass, Parse_Options opts)
+{
+	size_t N_linkages_alloced = sent->num_linkages_alloced;
+	size_t n = N_linkages_alloced / (PARALLEL_POST_PROCESS_MIN_LINKAGES / 2);
+
+	if ((size_t)opts->threads < n) n = opts->threads;
+	if ((n <= 1) || (N_linkages_alloced < PARALLEL_POST_PROCESS_MIN_LINKAGES))
+		return NULL;
+
+	/* Do what do_post_process() does for the first linkage, so that
+	 * the threads only read the rule pruning. */
+	if (twopass && !pp->q_pruned_rules) prune_irrelevant_rules(pp);
+	pp->q_pruned_rules = true;
+
+	const char **violation = malloc(N_linkages_alloced * sizeof(const char *));
+	for (size_t in = 0; in < N_linkages_alloced; in++)
+		violation[in] = pp_not_done;
+
+	pp_worker *pw = alloca(n * sizeof(pp_worker));
+	bool *started = alloca(n * sizeof(bool));
+	for (size_t i = 0; i < n; i++)
+	{
+		pw[i].sent = sent;
+		pw[i].opts = opts;
+		pw[i].pp = *pp;
+		pw[i].pp.n_local_rules_firing = 0;
+		pw[i].pp.n_global_rules_firing = 0;
+		pp_data_init(&pw[i].pp.pp_data, pp->knowledge);
+		pw[i].twopass = twopass;
+		pw[i].violation = violation;
+		pw[i].i = i;
+		pw[i].n = n;
+	}
+
+	for (size_t i = 1; i < n; i++)
+		started[i] = (0 == pthread_create(&pw[i].thread, NULL, pp_worker_run, &pw[i]));
+
+	pp_worker_run(&pw[0]);
+	for (size_t i = 1; i < n; i++)
+	{
+		if (started[i])
+			pthread_join(pw[i].thread, NULL);
+		else
+			pp_worker_run(&pw[i]);
+	}
+
+	for (size_t i = 0; i < n; i++)
+	{
+		pp->n_local_rules_firing += pw[i].pp.n_local_rules_firing;
+		pp->n_global_rules_firing += pw[i].pp.n_global_rules_firing;
+		pp_data_free(&pw[i].pp.pp_data);
+	}
+
+	return violation;
+}
+#endif /* USE_PARALLEL_POST_PROCESS */
+
 /**
  * This does basic post-processing for all linkages.
  */
@@ -1168,30 +1417,48 @@ void post_process_lkgs(Sentence sent, Parse_Options opts)
 	}
 
 	/* Second pass: actually perform post-processing */
+	const char **violation = NULL; /* The results of post_process_parallel() */
+#ifdef USE_PARALLEL_POST_PROCESS
+	violation = post_process_parallel(pp, sent, twopass, opts);
+#endif
 	for (in=0; in < N_linkages_alloced; in++)
 	{
 		Linkage lkg = &sent->lnkages[in];
 		Linkage_info *lifo = &lkg->lifo;
+		const char *msg;
 
 		if (lifo->discarded || lifo->N_violations) continue;
 
-		do_post_process(pp, lkg, twopass);
-		post_process_free_data(&pp->pp_data);
+		if (NULL == violation)
+		{
+			do_post_process(pp, lkg, twopass);
+			post_process_free_data(&pp->pp_data);
+			msg = pp->violation;
+		}
+		else
+		{
+#ifdef USE_PARALLEL_POST_PROCESS
+			if (pp_not_done == violation[in]) break;
+#endif
+			msg = violation[in];
+		}
 
-		if (NULL != pp->violation)
+		if (NULL != msg)
 		{
 			N_valid_linkages--;
 			lifo->N_violations++;
 
 			/* Set the message, only if not set (e.g. by sane_morphism) */
 			if (NULL == lifo->pp_violation_msg)
-				lifo->pp_violation_msg = pp->violation;
+				lifo->pp_violation_msg = msg;
 		}
 		N_linkages_post_processed++;
 
 		linkage_score(lkg, opts);
-		if ((9 == in%10) && resources_exhausted(opts->resources)) break;
+		if ((NULL == violation) && (9 == in%10) &&
+		    resources_exhausted(opts->resources)) break;
 	}
+	free(violation);
 
 	/* If the timer expired, then we never finished post-processing.
 	 * Mark the remaining sentences as bad, as otherwise strange
@@ -1223,6 +1490,50 @@ void post_process_lkgs(Sentence sent, Parse_Options opts)
 	sent->num_valid_linkages = N_valid_linkages;
 }
 
+/**
+ * Forget the link names that were scanned for the rule pruning of
+ * post_process_lkgs(). Call this before post-processing linkages one
+ * by one with post_process_linkage(), as they are then not known in
+ * advance, and all the rules must be applied.
+ */
+void post_process_reset(Postprocessor *pp)
+{
+	if (NULL == pp) return;
+	pp->q_scanned_links = false;
+	memset(pp->sentence_patterns, 0,
+	       pp->pp_data.patset_len * sizeof(pp_patset));
+	pp->q_pruned_rules = false;
+}
+
+/**
+ * Post-process a single linkage, as the second pass of
+ * post_process_lkgs() does (but without rule pruning), and score it.
+ * Return true if it has no P.P. violations.
+ */
+bool post_process_linkage(Sentence sent, Linkage lkg, Parse_Options opts)
+{
+	Postprocessor *pp = sent->postprocessor;
+	Linkage_info *lifo = &lkg->lifo;
+	bool valid = (0 == lifo->N_violations);
+
+	if ((NULL != pp) && valid)
+	{
+		do_post_process(pp, lkg, false);
+		post_process_free_data(&pp->pp_data);
+
+		if (NULL != pp->violation)
+		{
+			valid = false;
+			lifo->N_violations++;
+			if (NULL == lifo->pp_violation_msg)
+				lifo->pp_violation_msg = pp->violation;
+		}
+	}
+
+	linkage_score(lkg, opts);
+	return valid;
+}
+
 /* ================ compute the domain names ============= */
 /*
  * The code below is used in one place only: when printing the domain
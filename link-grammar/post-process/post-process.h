@@ -20,6 +20,9 @@
        - Do for each generated linkage of a sentence:
              + call do_post_process()
        - Call post_process_free()
+   . Or, for linkages which are generated one at a time:
+       - call post_process_reset(), and then post_process_linkage()
+         for each linkage.
 ***********************************************************************/
 
 #ifndef _POSTPROCESS_H_
@@ -34,6 +37,8 @@ Postprocessor * post_process_new(pp_knowledge *);
 void post_process_free(Postprocessor *);
 
 void post_process_lkgs(Sentence, Parse_Options);
+void post_process_reset(Postprocessor *);
+bool post_process_linkage(Sentence, Linkage, Parse_Options);
 
 void     do_post_process(Postprocessor *, Linkage, bool);
 void     post_process_free_data(PP_data * ppd);
@@ -15,12 +15,64 @@
 #define _PP_STRUCTURES_H_
 
 #include <stdbool.h>
+#include <stdint.h>
 #include "api-types.h"
 #include "post-process.h"
 
 typedef struct Domain_s Domain;
 typedef struct DTreeLeaf_s DTreeLeaf;
 typedef struct List_o_links_struct List_o_links;
+typedef struct PP_name_s PP_name;
+
+/* A set of the link-name patterns of the rules of a knowledge file: a
+ * bitset of their numbers (see pp_knowledge_s.rule_pattern), of
+ * patset_len words. */
+typedef uint64_t pp_patset;
+
+static inline bool pp_patset_has(const pp_patset *s, size_t n)
+{
+	return (s[n/64] >> (n%64)) & 1;
+}
+
+static inline void pp_patset_add(pp_patset *s, size_t n)
+{
+	s[n/64] |= (pp_patset)1 << (n%64);
+}
+
+static inline bool pp_patset_intersects(const pp_patset *a,
+                                        const pp_patset *b, size_t len)
+{
+	for (size_t i = 0; i < len; i++)
+		if (a[i] & b[i]) return true;
+	return false;
+}
+
+static inline void pp_patset_union(pp_patset *a, const pp_patset *b,
+                                   size_t len)
+{
+	for (size_t i = 0; i < len; i++)
+		a[i] |= b[i];
+}
+
+/* The link sets of the knowledge file that a link name is in. */
+#define PP_IGNORE_LINK                   0x01
+#define PP_DOMAIN_STARTER_LINK           0x02
+#define PP_URFL_DOMAIN_STARTER_LINK      0x04
+#define PP_URFL_ONLY_DOMAIN_STARTER_LINK 0x08
+#define PP_LEFT_DOMAIN_STARTER_LINK      0x10
+#define PP_DOMAIN_CONTAINS_LINK          0x20
+#define PP_RESTRICTED_LINK               0x40
+
+/* A link name, as interned by the postprocessor. Everything that the
+ * rules need to know about it is found when it is interned, so that
+ * they are checked without string matching. */
+struct PP_name_s
+{
+	const char *str;        /* The link name */
+	int domain;             /* The domain type that it starts, or -1 */
+	unsigned int links;     /* The link sets that it is in (PP_*_LINK) */
+	pp_patset patterns[];   /* The rule patterns that it matches */
+};
 
 struct Domain_s
 {
@@ -53,6 +105,20 @@ struct PP_data_s
 
 	bool *visited;                  /* For the depth-first search */
 	size_t vlength;                 /* Length of visited array */
+
+	/* The interned link names (an open-addressing hash table). They
+	 * are kept for all the linkages of the sentence. */
+	const pp_knowledge *knowledge;
+	size_t patset_len;
+	PP_name **name_table;
+	size_t name_table_size;
+	size_t num_names;
+
+	const PP_name **link_name;      /* Those of the linkage, by link */
+	size_t lnlen;                   /* Allocated size of link_name */
+	pp_patset *linkage_patterns;    /* The patterns that its links match */
+	pp_patset *domain_patterns;     /* The same, for the group of each domain */
+	size_t dplen;                   /* Allocated domains of domain_patterns */
 };
 
 /* A new Postprocessor struct is alloc'ed for each sentence. It contains
@@ -63,8 +129,8 @@ struct Postprocessor_s
 	pp_knowledge  * knowledge;           /* Internal rep'n of the actual rules */
 	int n_global_rules_firing;           /* this & the next are diagnostic     */
 	int n_local_rules_firing;
-	pp_linkset *set_of_links_of_sentence;     /* seen in *any* linkage of sent */
-	pp_linkset *set_of_links_in_an_active_rule;/*used in *some* linkage of sent*/
+	bool q_scanned_links;           /* Some link names have been scanned */
+	pp_patset *sentence_patterns;   /* Matched by links in *any* linkage  */
 	int *relevant_contains_one_rules;        /* -1-terminated list of indices  */
 	int *relevant_contains_none_rules;
 	bool q_pruned_rules;       /* don't prune rules more than once in p.p. */
@@ -123,6 +189,8 @@ typedef struct pp_rule_s
 	int   link_set_size;  /* size of this set                        */
 	int   domain;         /* type of domain to which rule applies    */
 	const char  **link_array; /* array holding the spelled-out names */
+	size_t selector_num;  /* number of the selector pattern          */
+	pp_patset *patset;    /* the link set or array, compiled         */
 	const char  *msg;     /* explanation (NULL=end sentinel in array)*/
 	int use_count;        /* Number of times rule has been applied   */
 } pp_rule;
@@ -160,6 +228,14 @@ struct pp_knowledge_s
 	pp_linkset *set_of_links_starting_bounded_domain;
 	StartingLinkAndDomain *starting_link_lookup_table;
 	String_set *string_set;
+
+	/* The link-name patterns of the rules, numbered in alphabetical
+	   order. The rules are compiled to sets of these numbers (see
+	   compile_rules()), and each link name that is post-processed is
+	   matched once against all of them. */
+	size_t n_rule_patterns;
+	const char **rule_pattern;
+	size_t patset_len;    /* Number of words of a pattern set */
 };
 
 #endif
@@ -19,6 +19,7 @@
 ***********************************************************************/
 
 #include <stdlib.h>
+#include <string.h>
 
 #include "externs.h"
 #include "pp_knowledge.h"
@@ -355,10 +356,124 @@ static bool read_rules(pp_knowledge *k)
   return true;
 }
 
+static int pattern_compare(const void *a, const void *b)
+{
+  return strcmp(*(const char **)a, *(const char **)b);
+}
+
+static size_t pattern_num(pp_knowledge *k, const char *p)
+{
+  const char **found = bsearch(&p, k->rule_pattern, k->n_rule_patterns,
+                               sizeof(const char *), pattern_compare);
+  return found - k->rule_pattern;
+}
+
+static pp_patset *linkset_patset(pp_knowledge *k, pp_linkset *ls)
+{
+  pp_patset *ps = calloc(k->patset_len, sizeof(pp_patset));
+  unsigned int i;
+  pp_linkset_node *p;
+  if (NULL == ls) return ps;
+  for (i=0; i<ls->hash_table_size; i++)
+    for (p=ls->hash_table[i]; p!=NULL; p=p->next)
+      pp_patset_add(ps, pattern_num(k, p->str));
+  return ps;
+}
+
+/**
+ * Compile the rules: Number the link-name patterns that are used in the
+ * rules (in alphabetical order), and make a set of these numbers of the
+ * link set of each rule. Then the link names that are post-processed
+ * are matched once against all the patterns, and the rules are checked
+ * on the sets of patterns that they match (see post-process.c).
+ */
+static void compile_rules(pp_knowledge *k)
+{
+  size_t n = 0, max_n = 0;
+  size_t r, i;
+  unsigned int h;
+  pp_rule *rule;
+  pp_linkset_node *p;
+
+  for (r=0; r<k->n_form_a_cycle_rules; r++)
+    max_n += pp_linkset_population(k->form_a_cycle_rules[r].link_set);
+  for (r=0; r<k->n_contains_one_rules; r++)
+    max_n += 1 + k->contains_one_rules[r].link_set_size;
+  for (r=0; r<k->n_contains_none_rules; r++)
+    max_n += 1 + k->contains_none_rules[r].link_set_size;
+
+  k->rule_pattern = (const char **) malloc((max_n+1)*sizeof(const char *));
+  for (r=0; r<k->n_form_a_cycle_rules; r++)
+  {
+    pp_linkset *ls = k->form_a_cycle_rules[r].link_set;
+    if (NULL == ls) continue;
+    for (h=0; h<ls->hash_table_size; h++)
+      for (p=ls->hash_table[h]; p!=NULL; p=p->next)
+        k->rule_pattern[n++] = p->str;
+  }
+  for (r=0; r<k->n_contains_one_rules; r++)
+  {
+    rule = &(k->contains_one_rules[r]);
+    k->rule_pattern[n++] = rule->selector;
+    for (i=0; rule->link_array[i]!=NULL; i++)
+      k->rule_pattern[n++] = rule->link_array[i];
+  }
+  for (r=0; r<k->n_contains_none_rules; r++)
+  {
+    rule = &(k->contains_none_rules[r]);
+    k->rule_pattern[n++] = rule->selector;
+    for (i=0; rule->link_array[i]!=NULL; i++)
+      k->rule_pattern[n++] = rule->link_array[i];
+  }
+
+  /* Sort them, and remove the duplicates. */
+  qsort(k->rule_pattern, n, sizeof(const char *), pattern_compare);
+  k->n_rule_patterns = 0;
+  for (i=0; i<n; i++)
+  {
+    if ((0 == k->n_rule_patterns) ||
+        (0 != strcmp(k->rule_pattern[k->n_rule_patterns-1], k->rule_pattern[i])))
+      k->rule_pattern[k->n_rule_patterns++] = k->rule_pattern[i];
+  }
+  k->patset_len = (k->n_rule_patterns + 63) / 64;
+  if (0 == k->patset_len) k->patset_len = 1;
+
+  for (r=0; r<k->n_form_a_cycle_rules; r++)
+    k->form_a_cycle_rules[r].patset =
+      linkset_patset(k, k->form_a_cycle_rules[r].link_set);
+  for (r=0; r<k->n_contains_one_rules; r++)
+  {
+    rule = &(k->contains_one_rules[r]);
+    rule->selector_num = pattern_num(k, rule->selector);
+    rule->patset = linkset_patset(k, rule->link_set);
+  }
+  for (r=0; r<k->n_contains_none_rules; r++)
+  {
+    rule = &(k->contains_none_rules[r]);
+    rule->selector_num = pattern_num(k, rule->selector);
+    rule->patset = linkset_patset(k, rule->link_set);
+  }
+
+  if (verbosity_level(+D_PPK))
+    prt_error("Debug: File %s: %zu rule patterns\n", k->path, k->n_rule_patterns);
+}
+
 static void free_rules(pp_knowledge *k)
 {
   size_t r;
   pp_rule *rule;
+
+  /* The compiled link sets, if the rules have been compiled. */
+  if (NULL != k->rule_pattern)
+  {
+    for (r = 0; r < k->n_form_a_cycle_rules; r++)
+      free(k->form_a_cycle_rules[r].patset);
+    for (r = 0; r < k->n_contains_one_rules; r++)
+      free(k->contains_one_rules[r].patset);
+    for (r = 0; r < k->n_contains_none_rules; r++)
+      free(k->contains_none_rules[r].patset);
+    free(k->rule_pattern);
+  }
   if (NULL != k->contains_one_rules)
   {
     for (r=0; k->contains_one_rules[r].msg!=0; r++)
@@ -405,6 +520,7 @@ pp_knowledge *pp_knowledge_open(const char *path)
 
   if (!read_link_sets(k)) goto failure;
   if (!read_rules(k)) goto failure;
+  compile_rules(k);
   initialize_set_of_links_starting_bounded_domain(k);
 
   /* If the knowledge file was empty, do nothing at all. */
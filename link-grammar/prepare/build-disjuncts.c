@@ -19,9 +19,13 @@
 //#include "dict-common/dict-api.h"        // for print_expression
 #include "dict-common/dict-structures.h"   // for Exp_struct
 #include "disjunct-utils.h"
+#include "memory-pool.h"
 #include "utilities.h"
 
-/* Temporary connectors used while converting expressions into disjunct lists */
+/* Temporary connectors used while converting expressions into disjunct
+ * lists. The connector list of a clause is kept in reverse order, so
+ * the clauses of an AND product can share the list of their left
+ * operand as a tail (see build_clause()). */
 typedef struct Tconnector_struct Tconnector;
 struct Tconnector_struct
 {
@@ -40,90 +44,78 @@ struct clause_struct
 	Tconnector * c;
 };
 
-static void free_Tconnectors(Tconnector *e)
+/**
+ * The Clauses and Tconnectors are allocated from memory pools, and are
+ * reclaimed all at once after the disjuncts of each expression are
+ * built. The pools are kept between the expressions of a sentence.
+ */
+struct Clause_pools_s
 {
-	Tconnector * n;
-	for(;e != NULL; e=n)
-	{
-		n = e->next;
-		xfree((char *)e, sizeof(Tconnector));
-	}
-}
+	Pool_desc *Clause_pool;
+	Pool_desc *Tconnector_pool;
+};
 
-static void free_clause_list(Clause *c)
+/* The number of elements in each memory pool block. */
+#define CLAUSE_POOL_BLOCK_ELEMENTS 4096
+
+Clause_pools *clause_pools_new(void)
 {
-	Clause *c1;
-	while (c != NULL)
-	{
-		c1 = c->next;
-		free_Tconnectors(c->c);
-		xfree((char *)c, sizeof(Clause));
-		c = c1;
-	}
+	Clause_pools *cp = xalloc(sizeof(Clause_pools));
+
+	cp->Clause_pool = pool_new("Clause", CLAUSE_POOL_BLOCK_ELEMENTS,
+	                           sizeof(Clause), false);
+	cp->Tconnector_pool = pool_new("Tconnector", CLAUSE_POOL_BLOCK_ELEMENTS,
+	                               sizeof(Tconnector), false);
+	return cp;
 }
 
-/**
- * reverse the order of the list e.  destructive
- */
-static Tconnector * Treverse(Tconnector *e)
+void clause_pools_delete(Clause_pools *cp)
 {
-	Tconnector * head, *x;
-	head = NULL;
-	while (e != NULL) {
-		x = e->next;
-		e->next = head;
-		head = e;
-		e = x;
-	}
-	return head;
+	if (NULL == cp) return;
+	pool_delete(cp->Clause_pool);
+	pool_delete(cp->Tconnector_pool);
+	xfree(cp, sizeof(Clause_pools));
 }
 
-/**
- * reverse the order of the list e.  destructive
- */
-static Connector * reverse(Connector *e)
+static Clause * new_clause(Clause_pools *cp, Tconnector *c,
+                           double cost, double maxcost)
 {
-	Connector * head, *x;
-	head = NULL;
-	while (e != NULL) {
-		x = e->next;
-		e->next = head;
-		head = e;
-		e = x;
-	}
-	return head;
+	Clause *cl = pool_alloc(cp->Clause_pool);
+	cl->c = c;
+	cl->cost = cost;
+	cl->maxcost = maxcost;
+	cl->next = NULL;
+	return cl;
 }
 
 /**
- * Builds a new list of connectors that is the catenation of e1 with e2.
- * does not effect lists e1 or e2.   Order is maintained.
+ * Return the reversed catenation of e1 with e2, given the reversed
+ * lists re1 and re2. Only re2 is copied; re1 becomes the tail of the
+ * result. Neither list is changed.
  */
-static Tconnector * catenate(Tconnector * e1, Tconnector * e2)
+static Tconnector * catenate(Clause_pools *cp, Tconnector * re1,
+                             Tconnector * re2)
 {
-	Tconnector * e, * head;
-	head = NULL;
-	for (;e1 != NULL; e1 = e1->next) {
-		e = (Tconnector *) xalloc(sizeof(Tconnector));
-		*e = *e1;
-		e->next = head;
-		head = e;
-	}
-	for (;e2 != NULL; e2 = e2->next) {
-		e = (Tconnector *) xalloc(sizeof(Tconnector));
-		*e = *e2;
-		e->next = head;
-		head = e;
+	Tconnector * head = re1;
+	Tconnector ** tail = &head;
+
+	for (; re2 != NULL; re2 = re2->next)
+	{
+		Tconnector * e = pool_alloc(cp->Tconnector_pool);
+		*e = *re2;
+		*tail = e;
+		tail = &e->next;
 	}
-	return Treverse(head);
+	*tail = re1;
+	return head;
 }
 
 /**
  * build the connector for the terminal node n
  */
-static Tconnector * build_terminal(Exp * e)
+static Tconnector * build_terminal(Clause_pools *cp, Exp * e)
 {
-	Tconnector * c;
-	c = (Tconnector *) xalloc(sizeof(Tconnector));
+	Tconnector * c = pool_alloc(cp->Tconnector_pool);
 	c->string = e->u.string;
 	c->multi = e->multi;
 	c->dir = e->dir;
@@ -132,40 +124,57 @@ static Tconnector * build_terminal(Exp * e)
 }
 
 /**
- * Build the clause for the expression e.  Does not change e
+ * Return true if a clause of maxcost can only lead to disjuncts whose
+ * cost exceeds the given budget.
+ *
+ * The maxcost of a disjunct is computed from that of its clauses by
+ * fmaxf() with the other clauses of AND products and by adding the
+ * costs of the enclosing expressions, which can only keep it or
+ * increase it. The margin covers the rounding of fmaxf(); clauses that
+ * are within it are dropped later, if needed, by build_disjunct().
  */
-static Clause * build_clause(Exp *e)
+static bool over_budget(double maxcost, double budget)
+{
+	return maxcost > budget + 1e-4 * (1.0 + fabs(budget));
+}
+
+/**
+ * Build the clauses for the expression e. Does not change e.
+ * Clauses whose maxcost would exceed the budget are not built. The
+ * budget is the cost cutoff minus the costs of the enclosing
+ * expressions.
+ */
+static Clause * build_clause(Clause_pools *cp, Exp *e, double budget)
 {
 	Clause *c = NULL, *c1, *c2, *c3, *c4, *c_head;
 	E_list * e_list;
+	double child_budget = budget - e->cost;
 
 	assert(e != NULL, "build_clause called with null parameter");
 	if (e->type == AND_type)
 	{
-		c1 = (Clause *) xalloc(sizeof (Clause));
-		c1->c = NULL;
-		c1->next = NULL;
-		c1->cost = 0.0;
-		c1->maxcost = 0.0;
+		c1 = new_clause(cp, NULL, 0.0, 0.0);
 		for (e_list = e->u.l; e_list != NULL; e_list = e_list->next)
 		{
-			c2 = build_clause(e_list->e);
+			c2 = build_clause(cp, e_list->e, child_budget);
 			c_head = NULL;
 			for (c3 = c1; c3 != NULL; c3 = c3->next)
 			{
 				for (c4 = c2; c4 != NULL; c4 = c4->next)
 				{
-					c = (Clause *) xalloc(sizeof (Clause));
-					c->cost = c3->cost + c4->cost;
-					c->maxcost = fmaxf(c3->maxcost,c4->maxcost);
-					c->c = catenate(c3->c, c4->c);
+					double maxcost = fmaxf(c3->maxcost,c4->maxcost);
+
+					/* Prune the partial product as early as possible. */
+					if (over_budget(maxcost, child_budget)) continue;
+
+					c = new_clause(cp, catenate(cp, c3->c, c4->c),
+					               c3->cost + c4->cost, maxcost);
 					c->next = c_head;
 					c_head = c;
 				}
 			}
-			free_clause_list(c1);
-			free_clause_list(c2);
 			c1 = c_head;
+			if (NULL == c1) break;
 		}
 		c = c1;
 	}
@@ -175,7 +184,7 @@ static Clause * build_clause(Exp *e)
 		c = NULL;
 		for (e_list = e->u.l; e_list != NULL; e_list = e_list->next)
 		{
-			c1 = build_clause(e_list->e);
+			c1 = build_clause(cp, e_list->e, child_budget);
 			while(c1 != NULL) {
 				c3 = c1->next;
 				c1->next = c;
@@ -186,11 +195,7 @@ static Clause * build_clause(Exp *e)
 	}
 	else if (e->type == CONNECTOR_type)
 	{
-		c = (Clause *) xalloc(sizeof(Clause));
-		c->c = build_terminal(e);
-		c->cost = 0.0;
-		c->maxcost = 0.0;
-		c->next = NULL;
+		c = new_clause(cp, build_terminal(cp, e), 0.0, 0.0);
 	}
 	else
 	{
@@ -198,6 +203,7 @@ static Clause * build_clause(Exp *e)
 	}
 
 	/* c now points to the list of clauses */
+	Clause **cp1 = &c;
 	for (c1 = c; c1 != NULL; c1 = c1->next)
 	{
 		c1->cost += e->cost;
@@ -208,7 +214,12 @@ static Clause * build_clause(Exp *e)
 		 * had it right!?
 		 */
 		c1->maxcost += e->cost;
+
+		if (over_budget(c1->maxcost, budget)) continue;
+		*cp1 = c1;
+		cp1 = &c1->next;
 	}
+	*cp1 = NULL;
 	return c;
 }
 
@@ -216,6 +227,7 @@ static Clause * build_clause(Exp *e)
 #ifdef DEBUG
 /* Misc printing functions, useful for debugging */
 
+/* The connectors are printed in reverse order. */
 static void print_Tconnector_list(Tconnector * e)
 {
 	for (;e != NULL; e=e->next) {
@@ -238,10 +250,10 @@ GNUC_UNUSED static void print_clause_list(Clause * c)
 
 static void print_connector_list(Connector * e)
 {
-	for (;e != NULL; e=e->next)
+	for (;e != NULL; e=connector_next(e))
 	{
-		printf("%s", e->string);
-		if (e->next != NULL) printf(" ");
+		printf("%s", connector_get_string(e));
+		if (!e->last) printf(" ");
 	}
 }
 
@@ -259,26 +271,28 @@ GNUC_UNUSED static void print_disjunct_list(Disjunct * dj)
 #endif /* DEBUG */
 
 /**
- * Build a new list of connectors starting from the Tconnectors
- * in the list pointed to by e.  Keep only those whose strings whose
- * direction has the value c.
+ * Build the connectors of the disjunct d from the Tconnectors in the
+ * reversed list pointed to by e: its left list from those whose
+ * direction is '-', and its right list from those whose direction is
+ * '+', both in the reverse order of the clause.
  */
-static Connector * extract_connectors(Tconnector *e, int c)
+static void extract_connectors(Disjunct *d, Tconnector *e, Connector_table *ct)
 {
-	Connector *e1;
-	if (e == NULL) return NULL;
-	if (e->dir == c)
+	unsigned int nl = 0, nr = 0;
+	Tconnector *t;
+
+	for (t = e; t != NULL; t = t->next)
 	{
-		e1 = connector_new();
-		e1->next = extract_connectors(e->next,c);
-		e1->multi = e->multi;
-		e1->string = e->string;
-		e1->nearest_word = 0;
-		return e1;
+		if (t->dir == '-') nl++; else nr++;
 	}
-	else
+	disjunct_alloc_connectors(d, nl, nr);
+
+	unsigned int il = 0, ir = 0;
+	for (t = e; t != NULL; t = t->next)
 	{
-		return extract_connectors(e->next,c);
+		Connector *c = (t->dir == '-') ? &d->left[il++] : &d->right[ir++];
+		c->multi = t->multi;
+		connector_set_desc(c, condesc_add(ct, t->string));
 	}
 }
 
@@ -287,7 +301,8 @@ static Connector * extract_connectors(Tconnector *e, int c)
  * string is the print name of word that generated this disjunct.
  */
 static Disjunct *
-build_disjunct(Clause * cl, const char * string, double cost_cutoff)
+build_disjunct(Clause * cl, const char * string, Connector_table *ct,
+               double cost_cutoff)
 {
 	Disjunct *dis, *ndis;
 	dis = NULL;
@@ -296,8 +311,7 @@ build_disjunct(Clause * cl, const char * string, double cost_cutoff)
 		if (cl->maxcost <= cost_cutoff)
 		{
 			ndis = (Disjunct *) xalloc(sizeof(Disjunct));
-			ndis->left = reverse(extract_connectors(cl->c, '-'));
-			ndis->right = reverse(extract_connectors(cl->c, '+'));
+			extract_connectors(ndis, cl->c, ct);
 			ndis->word_string = string;
 			ndis->cost = cl->cost;
 			ndis->next = dis;
@@ -307,16 +321,31 @@ build_disjunct(Clause * cl, const char * string, double cost_cutoff)
 	return dis;
 }
 
-Disjunct * build_disjuncts_for_exp(Exp* exp, const char *word, double cost_cutoff)
+/**
+ * Build the disjuncts of the expression exp, of the given word.
+ * The names of their connectors are enumerated in ct.
+ * The temporary clauses are allocated from cp, which is reused for the
+ * next expression. If cp is NULL, temporary pools are used.
+ */
+Disjunct * build_disjuncts_for_exp(Clause_pools *cp, Exp* exp,
+                                   const char *word, Connector_table *ct,
+                                   double cost_cutoff)
 {
 	Clause *c ;
 	Disjunct * dis;
+	Clause_pools *tmp_cp = NULL;
+
+	if (NULL == cp) cp = tmp_cp = clause_pools_new();
+
 	// print_expression(exp);  printf("\n");
-	c = build_clause(exp);
+	c = build_clause(cp, exp, cost_cutoff);
 	// print_clause_list(c);
-	dis = build_disjunct(c, word, cost_cutoff);
+	dis = build_disjunct(c, word, ct, cost_cutoff);
 	// print_disjunct_list(dis);
-	free_clause_list(c);
+
+	pool_reuse(cp->Clause_pool);
+	pool_reuse(cp->Tconnector_pool);
+	clause_pools_delete(tmp_cp);
 	return dis;
 }
 
@@ -16,7 +16,12 @@
 
 #include "api-types.h"
 
-Disjunct * build_disjuncts_for_exp(Exp*, const char*, double cost_cutoff);
+typedef struct Clause_pools_s Clause_pools;
+
+Clause_pools *clause_pools_new(void);
+void clause_pools_delete(Clause_pools *);
+Disjunct * build_disjuncts_for_exp(Clause_pools *, Exp*, const char*,
+                                   Connector_table *, double cost_cutoff);
 
 #ifdef DEBUG
 void prt_exp(Exp *, int);
@@ -24,10 +24,11 @@
 
 /* ========================================================= */
 
-static Disjunct * build_expansion_disjuncts(Cluster *clu, const char *xstr)
+static Disjunct * build_expansion_disjuncts(Cluster *clu, const char *xstr,
+                                            Dictionary dict)
 {
 	Disjunct *dj;
-	dj = lg_cluster_get_disjuncts(clu, xstr);
+	dj = lg_cluster_get_disjuncts(clu, xstr, dict);
 	if (dj && (verbosity > 0)) prt_error("Expanded %s \n", xstr);
 	return dj;
 }
@@ -43,6 +44,16 @@ bool lg_expand_disjunct_list(Sentence sent)
 
 	Cluster *clu = lg_cluster_new();
 
+	/* The disjuncts of the last parse are in a disjunct store, which
+	 * cannot be extended. Turn them back into ordinary lists. */
+	if (NULL != sent->disjunct_store)
+	{
+		for (w = 0; w < sent->length; w++)
+			sent->word[w].d = disjuncts_dup(sent->word[w].d);
+		disjunct_store_delete(sent->disjunct_store);
+		sent->disjunct_store = NULL;
+	}
+
 	bool expanded = false;
 	for (w = 0; w < sent->length; w++)
 	{
@@ -50,7 +61,7 @@ bool lg_expand_disjunct_list(Sentence sent)
 		Disjunct * d = sent->word[w].d;
 		for (x = sent->word[w].x; x != NULL; x = x->next)
 		{
-			Disjunct *dx = build_expansion_disjuncts(clu, x->string);
+			Disjunct *dx = build_expansion_disjuncts(clu, x->string, sent->dict);
 			if (dx)
 			{
 				unsigned int cnt = count_disjuncts(d);
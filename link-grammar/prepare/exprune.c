@@ -14,6 +14,7 @@
 #include "api-structures.h"              // for Sentence_s
 #include "connectors.h"
 #include "dict-common/dict-api.h"        // expression_stringify
+#include "dict-common/dict-common.h"     // for Dictionary_s
 #include "dict-common/dict-utils.h"      // size_of_expression
 #include "print/print-util.h"            // dyn_str functions
 #include "string-set.h"
@@ -21,14 +22,19 @@
 #include "exprune.h"
 
 #define D_EXPRUNE 9
-#define CONTABSZ 8192
+
+/* Parallel expression pruning (see exprune_chunk) needs POSIX threads. */
+#if defined HAVE_PTHREAD
+#define USE_PARALLEL_EXPRUNE
+#include <pthread.h>
+#endif
 
 #ifdef DEBUG
 #define DBG(X) \
 	if (verbosity_level(+D_EXPRUNE))\
 	{\
 		char *e = expression_stringify(x->exp);\
-		err_msg(lg_Trace, X ": %s\n", e);\
+		err_msg(lg_Trace, "%s pass " X ": %s\n", lr ? "l->r" : "r->l", e);\
 		free(e);\
 	}
 #else /* !DEBUG */
@@ -43,7 +49,26 @@
 		free(e);\
 	}
 
-typedef Connector * connector_table;
+/* The connector set S. Its elements are kept in lists by the uc_num of
+ * their names (see condesc_t), since connectors can match only if their
+ * uc_num is the same, and each name is inserted only once (according to
+ * its con_num). The per-uc_num and per-con_num arrays are not cleared
+ * between the passes. Instead, their elements are stamped with the
+ * generation (gen) of the set in which they got set, and the elements
+ * with an older stamp are considered empty. */
+typedef struct
+{
+	unsigned int gen;            /* The current generation */
+	unsigned int *uc_gen;        /* The generation of each uc_head[] */
+	unsigned int *uc_head;       /* The first element (index+1), or 0 */
+	size_t uc_size;
+	unsigned int *con_gen;       /* The generation of each inserted name */
+	size_t con_size;
+	const condesc_t **desc;      /* The elements */
+	unsigned int *next;          /* The next element (index+1), or 0 */
+	size_t num_elements;
+	size_t elements_alloced;
+} connector_table;
 
 /* ================================================================= */
 /**
@@ -158,33 +183,87 @@ static Exp* purge_Exp(Exp *e)
 }
 
 /**
- * This hash function only looks at the leading upper case letters of
- * the connector string, and the label fields.  This ensures that if two
- * strings match (formally), then they must hash to the same place.
+ * Make the connector set S empty. Instead of clearing its arrays, a new
+ * generation is started, which makes all their entries stale.
  */
-static inline unsigned int hash_S(Connector * c)
+static void clear_connector_table(connector_table *ct)
+{
+	ct->num_elements = 0;
+	ct->gen++;
+	if (0 == ct->gen)
+	{
+		/* Wrapped around - the old stamps may look current. */
+		memset(ct->uc_gen, 0, ct->uc_size * sizeof(unsigned int));
+		memset(ct->con_gen, 0, ct->con_size * sizeof(unsigned int));
+		ct->gen = 1;
+	}
+}
+
+static unsigned int *grow_array(unsigned int *a, size_t old_size,
+                                 size_t new_size)
 {
-	unsigned int h = connector_hash(c);
-	return (h & (CONTABSZ-1));
+	unsigned int *n = xalloc(new_size * sizeof(unsigned int));
+
+	if (0 != old_size) memcpy(n, a, old_size * sizeof(unsigned int));
+	memset(&n[old_size], 0, (new_size - old_size) * sizeof(unsigned int));
+	xfree(a, old_size * sizeof(unsigned int));
+	return n;
 }
 
 /**
- * Returns TRUE if c can match anything in the set S (err. the connector table ct).
+ * Make room in the connector set S for the connector names that are
+ * currently in the dictionary connector table.
  */
-static inline bool matches_S(connector_table *ct, Connector * c)
+static void connector_table_resize(connector_table *ct,
+                                   const Connector_table *contable)
 {
-	Connector * e;
+	size_t uc_size = connector_table_num_uc(contable);
+	size_t con_size = connector_table_num_con(contable);
 
-	for (e = ct[hash_S(c)]; e != NULL; e = e->tableNext)
+	if (uc_size > ct->uc_size)
 	{
-		if (easy_match(e->string, c->string)) return true;
+		ct->uc_gen = grow_array(ct->uc_gen, ct->uc_size, uc_size);
+		ct->uc_head = grow_array(ct->uc_head, ct->uc_size, uc_size);
+		ct->uc_size = uc_size;
 	}
-	return false;
+	if (con_size > ct->con_size)
+	{
+		ct->con_gen = grow_array(ct->con_gen, ct->con_size, con_size);
+		ct->con_size = con_size;
+	}
+}
+
+static void connector_table_init(connector_table *ct,
+                                 const Connector_table *contable)
+{
+	memset(ct, 0, sizeof(connector_table));
+	ct->gen = 1;
+	connector_table_resize(ct, contable);
+}
+
+static void connector_table_free(connector_table *ct)
+{
+	xfree(ct->uc_gen, ct->uc_size * sizeof(unsigned int));
+	xfree(ct->uc_head, ct->uc_size * sizeof(unsigned int));
+	xfree(ct->con_gen, ct->con_size * sizeof(unsigned int));
+	xfree(ct->desc, ct->elements_alloced * sizeof(const condesc_t *));
+	xfree(ct->next, ct->elements_alloced * sizeof(unsigned int));
 }
 
-static void zero_connector_table(connector_table *ct)
+/**
+ * Returns TRUE if the connector name desc can match anything in the set
+ * S (err. the connector table ct).
+ */
+static inline bool matches_S(connector_table *ct, const condesc_t *desc)
 {
-	memset(ct, 0, sizeof(Connector *) * CONTABSZ);
+	if ((size_t)desc->uc_num >= ct->uc_size) return false;
+	if (ct->uc_gen[desc->uc_num] != ct->gen) return false;
+
+	for (unsigned int i = ct->uc_head[desc->uc_num]; 0 != i; i = ct->next[i-1])
+	{
+		if (easy_match_desc(ct->desc[i-1], desc)) return true;
+	}
+	return false;
 }
 
 /**
@@ -192,7 +271,8 @@ static void zero_connector_table(connector_table *ct)
  * in e that are not matched by anything in the current set.
  * Returns the number of connectors so marked.
  */
-static int mark_dead_connectors(connector_table *ct, Exp * e, char dir)
+static int mark_dead_connectors(connector_table *ct, Connector_table *contable,
+                                Exp * e, char dir)
 {
 	int count;
 	count = 0;
@@ -200,10 +280,7 @@ static int mark_dead_connectors(connector_table *ct, Exp * e, char dir)
 	{
 		if (e->dir == dir)
 		{
-			Connector dummy;
-			init_connector(&dummy);
-			dummy.string = e->u.string;
-			if (!matches_S(ct, &dummy))
+			if (!matches_S(ct, condesc_add(contable, e->u.string)))
 			{
 				e->u.string = NULL;
 				count++;
@@ -215,61 +292,87 @@ static int mark_dead_connectors(connector_table *ct, Exp * e, char dir)
 		E_list *l;
 		for (l = e->u.l; l != NULL; l = l->next)
 		{
-			count += mark_dead_connectors(ct, l->e, dir);
+			count += mark_dead_connectors(ct, contable, l->e, dir);
 		}
 	}
 	return count;
 }
 
 /**
- * This function puts connector c into the connector table
- * if one like it isn't already there.
+ * This function puts the connector name desc into the connector table
+ * if it isn't already there. The connector names of the sentence are
+ * enumerated before the table is allocated, so it has room for desc.
  */
-static void insert_connector(connector_table *ct, Connector * c)
+static void insert_connector(connector_table *ct, const condesc_t *desc)
 {
-	unsigned int h;
-	Connector * e;
+	unsigned int n;
 
-	h = hash_S(c);
+	if (ct->con_gen[desc->con_num] == ct->gen) return;
+	ct->con_gen[desc->con_num] = ct->gen;
+
+	if (ct->uc_gen[desc->uc_num] != ct->gen)
+	{
+		ct->uc_gen[desc->uc_num] = ct->gen;
+		ct->uc_head[desc->uc_num] = 0;
+	}
 
-	for (e = ct[h]; e != NULL; e = e->tableNext)
+	if (ct->num_elements == ct->elements_alloced)
 	{
-		if (string_set_cmp(c->string, e->string))
-			return;
+		size_t old_alloced = ct->elements_alloced;
+		const condesc_t **old_desc = ct->desc;
+		unsigned int *old_next = ct->next;
+
+		ct->elements_alloced = (0 == old_alloced) ? 256 : 2 * old_alloced;
+		ct->desc = xalloc(ct->elements_alloced * sizeof(const condesc_t *));
+		ct->next = xalloc(ct->elements_alloced * sizeof(unsigned int));
+		if (0 != old_alloced)
+		{
+			memcpy(ct->desc, old_desc, old_alloced * sizeof(const condesc_t *));
+			memcpy(ct->next, old_next, old_alloced * sizeof(unsigned int));
+		}
+		xfree(old_desc, old_alloced * sizeof(const condesc_t *));
+		xfree(old_next, old_alloced * sizeof(unsigned int));
 	}
-	c->tableNext = ct[h];
-	ct[h] = c;
+
+	n = ct->num_elements++;
+	ct->desc[n] = desc;
+	ct->next[n] = ct->uc_head[desc->uc_num];
+	ct->uc_head[desc->uc_num] = n + 1;
 }
+
 /**
  * Put into the set S all of the dir-pointing connectors still in e.
- * Return a list of allocated dummy connectors; these will need to be
- * freed.
  */
-static Connector * insert_connectors(connector_table *ct, Exp * e,
-                                     Connector *alloc_list, int dir)
+static void insert_connectors(connector_table *ct,
+                              Connector_table *contable, Exp * e, int dir)
 {
 	if (e->type == CONNECTOR_type)
 	{
 		if (e->dir == dir)
-		{
-			Connector *dummy = connector_new();
-			dummy->string = e->u.string;
-			insert_connector(ct, dummy);
-			dummy->next = alloc_list;
-			alloc_list = dummy;
-		}
+			insert_connector(ct, condesc_add(contable, e->u.string));
 	}
 	else
 	{
 		E_list *l;
 		for (l=e->u.l; l!=NULL; l=l->next)
 		{
-			alloc_list = insert_connectors(ct, l->e, alloc_list, dir);
+			insert_connectors(ct, contable, l->e, dir);
 		}
 	}
-	return alloc_list;
 }
 
+#ifdef USE_PARALLEL_EXPRUNE
+/**
+ * Add to the set S (ct) the connectors of the set src.
+ */
+static void merge_connector_table(connector_table *ct,
+                                  const connector_table *src)
+{
+	for (size_t i = 0; i < src->num_elements; i++)
+		insert_connector(ct, src->desc[i]);
+}
+#endif /* USE_PARALLEL_EXPRUNE */
+
 /**
  * This removes the expressions that are empty from the list corresponding
  * to word w of the sentence.
@@ -313,91 +416,300 @@ static char *print_expression_sizes(Sentence sent)
 	return dyn_str_take(e);
 }
 
-void expression_prune(Sentence sent)
+/**
+ * Prune the expressions of word w against the connector set S (ct),
+ * in a left-to-right (lr) or right-to-left pass, and then add the
+ * connectors of the word that point in the direction of the pass to S.
+ * Return the number of connectors that got marked as dead.
+ */
+static int expression_prune_word(connector_table *ct, Connector_table *contable,
+                                 Sentence sent, size_t w, bool lr)
 {
-	int N_deleted;
+	int N_deleted = 0;
 	X_node * x;
-	size_t w;
-	Connector *ct[CONTABSZ];
-	Connector *dummy_list = NULL;
 
-	zero_connector_table(ct);
+	/* For every expression in word */
+	for (x = sent->word[w].x; x != NULL; x = x->next)
+	{
+		DBG("before marking");
+		N_deleted += mark_dead_connectors(ct, contable, x->exp, lr ? '-' : '+');
+		DBG("after marking");
+	}
+	for (x = sent->word[w].x; x != NULL; x = x->next)
+	{
+		DBG("before purging");
+		x->exp = purge_Exp(x->exp);
+		DBG("after purging");
+	}
 
-	N_deleted = 1;  /* a lie to make it always do at least 2 passes */
+	/* gets rid of X_nodes with NULL exp */
+	clean_up_expressions(sent, w);
+	for (x = sent->word[w].x; x != NULL; x = x->next)
+	{
+		insert_connectors(ct, contable, x->exp, lr ? '+' : '-');
+	}
 
-	DBG_EXPSIZES("Initial expression sizes\n%s", e);
+	return N_deleted;
+}
 
-	while (1)
+/**
+ * Add the connector names of e to the dictionary connector table.
+ */
+static void enumerate_connectors(Connector_table *contable, Exp *e)
+{
+	if (e->type == CONNECTOR_type)
 	{
-		/* Left-to-right pass */
-		/* For every word */
-		for (w = 0; w < sent->length; w++)
-		{
-			/* For every expression in word */
-			for (x = sent->word[w].x; x != NULL; x = x->next)
-			{
-				DBG("l->r pass before marking");
-				N_deleted += mark_dead_connectors(ct, x->exp, '-');
-				DBG("l->r pass after marking");
-			}
-			for (x = sent->word[w].x; x != NULL; x = x->next)
-			{
-				DBG("l->r pass before purging");
-				x->exp = purge_Exp(x->exp);
-				DBG("l->r pass after purging");
-			}
+		condesc_add(contable, e->u.string);
+	}
+	else
+	{
+		for (E_list *l = e->u.l; l != NULL; l = l->next)
+			enumerate_connectors(contable, l->e);
+	}
+}
 
-			/* gets rid of X_nodes with NULL exp */
-			clean_up_expressions(sent, w);
-			for (x = sent->word[w].x; x != NULL; x = x->next)
-			{
-				dummy_list = insert_connectors(ct, x->exp, dummy_list, '+');
-			}
-		}
+/**
+ * Make sure that all the connector names of the sentence are in the
+ * dictionary connector table before the pruning starts. Then the table
+ * is only read by the pruning (which may use several threads), and the
+ * connector sets S can be allocated for all of its names.
+ */
+static void enumerate_sentence_connectors(Sentence sent)
+{
+	for (size_t w = 0; w < sent->length; w++)
+	{
+		for (X_node *x = sent->word[w].x; x != NULL; x = x->next)
+			enumerate_connectors(sent->dict->contable, x->exp);
+	}
+}
 
-		DBG_EXPSIZES("l->r pass removed %d\n%s", N_deleted, e);
+#ifdef USE_PARALLEL_EXPRUNE
+/* Parallel expression pruning.
+ *
+ * With opts->threads > 1, the words of long sentences are divided into
+ * chunks of consecutive words, and the chunks of each pass are pruned
+ * concurrently. The set S of a chunk starts with the connectors of the
+ * chunks that precede it in the pass, as they were at the start of the
+ * pass (the merge of their "chunk sets"), and then grows as usual with
+ * the words of the chunk. This S may have connectors that would have been
+ * deleted by the serial pass, so fewer connectors may get deleted in a
+ * pass. But only connectors that cannot match anything get deleted, so
+ * the pruning ends with the same expressions, though maybe after more
+ * passes.
+ */
+#define EXPRUNE_MIN_CHUNK_WORDS 8
 
-		/* Free the allocated dummy connectors */
-		free_connectors(dummy_list);
-		dummy_list = NULL;
-		zero_connector_table(ct);
+typedef struct exprune_chunk_s exprune_chunk;
+struct exprune_chunk_s
+{
+	Sentence sent;
+	Connector_table *contable;
+	exprune_chunk *chunk;        /* All the chunks */
+	size_t num_chunks;
+	size_t i;                    /* The index of this chunk */
+	size_t from, to;             /* Its words are from ... to-1 */
+	bool lr;                     /* The direction of the pass */
+	connector_table chunk_ct;    /* The chunk set (see above) */
+	connector_table ct;          /* The set S of the chunk */
+	int N_deleted;
+	pthread_t thread;
+};
 
-		if (N_deleted == 0) break;
+/**
+ * Set the chunk set to the connectors of the chunk that point in the
+ * direction of the pass.
+ */
+static void *exprune_chunk_set(void *arg)
+{
+	exprune_chunk *ch = arg;
+
+	clear_connector_table(&ch->chunk_ct);
+	for (size_t w = ch->from; w < ch->to; w++)
+	{
+		for (X_node *x = ch->sent->word[w].x; x != NULL; x = x->next)
+			insert_connectors(&ch->chunk_ct, ch->contable, x->exp, ch->lr ? '+' : '-');
+	}
+
+	return NULL;
+}
+
+/**
+ * Prune the words of the chunk, in the direction of the pass.
+ */
+static void *exprune_chunk_pass(void *arg)
+{
+	exprune_chunk *ch = arg;
+
+	clear_connector_table(&ch->ct);
+	for (size_t i = 0; i < ch->num_chunks; i++)
+	{
+		if (ch->lr ? (i < ch->i) : (i > ch->i))
+			merge_connector_table(&ch->ct, &ch->chunk[i].chunk_ct);
+	}
+
+	ch->N_deleted = 0;
+	if (ch->lr)
+	{
+		for (size_t w = ch->from; w < ch->to; w++)
+			ch->N_deleted += expression_prune_word(&ch->ct, ch->contable, ch->sent, w, true);
+	}
+	else
+	{
+		for (size_t w = ch->to - 1; w != ch->from - 1; w--)
+			ch->N_deleted += expression_prune_word(&ch->ct, ch->contable, ch->sent, w, false);
+	}
+
+	return NULL;
+}
+
+/**
+ * Run the given function for all the chunks, concurrently. If a thread
+ * cannot be started, its chunk is handled by the calling thread.
+ */
+static void exprune_run_chunks(exprune_chunk *chunk, size_t num_chunks,
+                               void *(*f)(void *))
+{
+	bool *started = alloca(num_chunks * sizeof(bool));
+
+	for (size_t i = 1; i < num_chunks; i++)
+		started[i] = (0 == pthread_create(&chunk[i].thread, NULL, f, &chunk[i]));
+
+	f(&chunk[0]);
+	for (size_t i = 1; i < num_chunks; i++)
+	{
+		if (started[i])
+			pthread_join(chunk[i].thread, NULL);
+		else
+			f(&chunk[i]);
+	}
+}
+
+/**
+ * Return the chunks for the pruning of the given sentence, and put their
+ * number in num_chunks. Return NULL if it should be pruned serially.
+ */
+static exprune_chunk *exprune_chunks_new(Sentence sent, Parse_Options opts,
+                                         size_t *num_chunks)
+{
+	size_t n = sent->length / EXPRUNE_MIN_CHUNK_WORDS;
+	exprune_chunk *chunk;
+
+	if ((size_t)opts->threads < n) n = opts->threads;
+	if (n <= 1) return NULL;
+	*num_chunks = n;
+
+	chunk = xalloc(n * sizeof(exprune_chunk));
+	for (size_t i = 0; i < n; i++)
+	{
+		chunk[i].sent = sent;
+		chunk[i].contable = sent->dict->contable;
+		chunk[i].chunk = chunk;
+		chunk[i].num_chunks = n;
+		chunk[i].i = i;
+		chunk[i].from = sent->length * i / n;
+		chunk[i].to = sent->length * (i + 1) / n;
+		connector_table_init(&chunk[i].chunk_ct, chunk[i].contable);
+		connector_table_init(&chunk[i].ct, chunk[i].contable);
+	}
 
-		/* Right-to-left pass */
-		N_deleted = 0;
+	return chunk;
+}
+
+static void exprune_chunks_delete(exprune_chunk *chunk, size_t num_chunks)
+{
+	if (NULL == chunk) return;
+
+	for (size_t i = 0; i < num_chunks; i++)
+	{
+		connector_table_free(&chunk[i].chunk_ct);
+		connector_table_free(&chunk[i].ct);
+	}
+	xfree(chunk, num_chunks * sizeof(exprune_chunk));
+}
+#else
+typedef void exprune_chunk;
+#endif /* USE_PARALLEL_EXPRUNE */
+
+/**
+ * Do a left-to-right (lr) or a right-to-left pass over the words, and
+ * return the number of connectors that got marked as dead.
+ */
+static int expression_prune_pass(connector_table *ct, Sentence sent,
+                                 exprune_chunk *chunk, size_t num_chunks,
+                                 bool lr)
+{
+	Connector_table *contable = sent->dict->contable;
+	int N_deleted = 0;
+	size_t w;
+
+#ifdef USE_PARALLEL_EXPRUNE
+	if (NULL != chunk)
+	{
+		for (size_t i = 0; i < num_chunks; i++)
+			chunk[i].lr = lr;
+		exprune_run_chunks(chunk, num_chunks, exprune_chunk_set);
+		exprune_run_chunks(chunk, num_chunks, exprune_chunk_pass);
+		for (size_t i = 0; i < num_chunks; i++)
+			N_deleted += chunk[i].N_deleted;
+		return N_deleted;
+	}
+#endif /* USE_PARALLEL_EXPRUNE */
+
+	clear_connector_table(ct);
+	if (lr)
+	{
+		for (w = 0; w < sent->length; w++)
+			N_deleted += expression_prune_word(ct, contable, sent, w, true);
+	}
+	else
+	{
 		for (w = sent->length-1; w != (size_t) -1; w--)
-		{
-			for (x = sent->word[w].x; x != NULL; x = x->next)
-			{
-				DBG("r->l pass before marking");
-				N_deleted += mark_dead_connectors(ct, x->exp, '+');
-				DBG("r->l pass after marking");
-			}
-			for (x = sent->word[w].x; x != NULL; x = x->next)
-			{
-				DBG("r->l pass before purging");
-				x->exp = purge_Exp(x->exp);
-				DBG("r->l pass after purging");
-			}
-			clean_up_expressions(sent, w);  /* gets rid of X_nodes with NULL exp */
-			for (x = sent->word[w].x; x != NULL; x = x->next)
-			{
-				dummy_list = insert_connectors(ct, x->exp, dummy_list, '-');
-			}
-		}
+			N_deleted += expression_prune_word(ct, contable, sent, w, false);
+	}
 
-		DBG_EXPSIZES("r->l pass removed %d\n%s", N_deleted, e);
+	return N_deleted;
+}
 
-		/* Free the allocated dummy connectors */
-		free_connectors(dummy_list);
-		dummy_list = NULL;
-		zero_connector_table(ct);
-		if (N_deleted == 0) break;
-		N_deleted = 0;
+void expression_prune(Sentence sent, Parse_Options opts)
+{
+	int N_deleted;
+	connector_table ct;
+	exprune_chunk *chunk = NULL;
+	size_t num_chunks = 1;
+	unsigned int passes = 0, zero_passes = 0;
+	bool lr;
+
+	enumerate_sentence_connectors(sent);
+#ifdef USE_PARALLEL_EXPRUNE
+	chunk = exprune_chunks_new(sent, opts, &num_chunks);
+#endif /* USE_PARALLEL_EXPRUNE */
+	connector_table_init(&ct, sent->dict->contable);
+
+	DBG_EXPSIZES("Initial expression sizes\n%s", e);
+
+	for (lr = true; ; lr = !lr)
+	{
+		N_deleted = expression_prune_pass(&ct, sent, chunk, num_chunks, lr);
+		passes++;
+
+		DBG_EXPSIZES("%s pass removed %d\n%s", lr ? "l->r" : "r->l", N_deleted, e);
+
+		/* Make at least 2 passes. Stop after a pass that didn't delete
+		 * anything. With chunks, the pass may have missed connectors that
+		 * can be deleted (see exprune_chunk), so a pass in each direction
+		 * that didn't delete anything is needed. */
+		zero_passes = (0 == N_deleted) ? zero_passes + 1 : 0;
+		if ((passes >= 2) && (zero_passes >= ((1 == num_chunks) ? 1 : 2)))
+			break;
 	}
+
+	connector_table_free(&ct);
+#ifdef USE_PARALLEL_EXPRUNE
+	exprune_chunks_delete(chunk, num_chunks);
+#endif /* USE_PARALLEL_EXPRUNE */
 }
 
+
 #if 0 // VERY_DEAD_NO_GOOD_IDEA
 
 /* ============================================================x */
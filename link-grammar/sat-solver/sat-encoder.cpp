@@ -519,12 +519,12 @@ void SATEncoder::generate_link_cw_ordinary_definition(size_t wi, int pi,
     if (dir == '+') {
       rhs.push(Lit(_variables->link_cost(wi, pi, Ci, e,
                                          (*i)->word, (*i)->position,
-                                         (*i)->connector.string,
+                                         connector_get_string(&(*i)->connector),
                                          (*i)->exp,
                                          cost + (*i)->cost)));
     } else if (dir == '-'){
       rhs.push(Lit(_variables->link((*i)->word, (*i)->position,
-                                    (*i)->connector.string,
+                                    connector_get_string(&(*i)->connector),
                                     (*i)->exp,
                                     wi, pi, Ci, e)));
     }
@@ -721,8 +721,8 @@ void SATEncoder::generate_conjunct_order_constraints(int w, Exp *e1, Exp* e2, in
         for (mw1i = mw1.begin(); mw1i != mw1.end(); mw1i++) {
           for (mw2i = mw2.begin(); mw2i != mw2.end(); mw2i++) {
             if (*mw1i >= *mw2i) {
-              clause[0] = ~Lit(_variables->link_cw(*mw1i, w, (*i)->position, (*i)->connector.string));
-              clause[1] = ~Lit(_variables->link_cw(*mw2i, w, (*j)->position, (*j)->connector.string));
+              clause[0] = ~Lit(_variables->link_cw(*mw1i, w, (*i)->position, connector_get_string(&(*i)->connector)));
+              clause[1] = ~Lit(_variables->link_cw(*mw2i, w, (*j)->position, connector_get_string(&(*j)->connector)));
               add_clause(clause);
             }
           }
@@ -766,8 +766,8 @@ void SATEncoder::generate_conjunct_order_constraints(int w, Exp *e1, Exp* e2, in
         for (mw1i = mw1.begin(); mw1i != mw1.end(); mw1i++) {
           for (mw2i = mw2.begin(); mw2i != mw2.end(); mw2i++) {
             if (*mw1i <= *mw2i) {
-              clause[0] = ~Lit(_variables->link_cw(*mw1i, w, (*i)->position, (*i)->connector.string));
-              clause[1] = ~Lit(_variables->link_cw(*mw2i, w, (*j)->position, (*j)->connector.string));
+              clause[0] = ~Lit(_variables->link_cw(*mw1i, w, (*i)->position, connector_get_string(&(*i)->connector)));
+              clause[1] = ~Lit(_variables->link_cw(*mw2i, w, (*j)->position, connector_get_string(&(*j)->connector)));
               add_clause(clause);
             }
           }
@@ -1260,8 +1260,8 @@ void SATEncoder::power_prune()
         if (!(*lci)->leading_left || (*lci)->connector.multi || (*lci)->word <= wl + 2)
           continue;
 
-        //        printf("LR: .%d. .%d. %s\n", wl, rci->position, rci->connector.string);
-        //        printf("LL: .%d. .%d. %s\n", (*lci)->word, (*lci)->position, (*lci)->connector.string);
+        //        printf("LR: .%d. .%d. %s\n", wl, rci->position, connector_get_string(&rci->connector));
+        //        printf("LL: .%d. .%d. %s\n", (*lci)->word, (*lci)->position, connector_get_string(&(*lci)->connector));
 
         vec<Lit> clause;
         for (std::vector<int>::const_iterator i = rci->eps_right.begin(); i != rci->eps_right.end(); i++) {
@@ -1275,8 +1275,8 @@ void SATEncoder::power_prune()
         add_additional_power_pruning_conditions(clause, wl, (*lci)->word);
 
         clause.push(~Lit(_variables->link(
-               wl, rci->position, rci->connector.string, rci->exp,
-               (*lci)->word, (*lci)->position, (*lci)->connector.string, (*lci)->exp)));
+               wl, rci->position, connector_get_string(&rci->connector), rci->exp,
+               (*lci)->word, (*lci)->position, connector_get_string(&(*lci)->connector), (*lci)->exp)));
         add_clause(clause);
       }
     }
@@ -1297,8 +1297,8 @@ void SATEncoder::power_prune()
       for (std::vector<PositionConnector*>::const_iterator lci = matches.begin(); lci != matches.end(); lci++) {
         if (!(*lci)->leading_left || (*lci)->word != wl + 1)
           continue;
-        int link = _variables->link(wl, rci->position, rci->connector.string,
-                                    (*lci)->word, (*lci)->position, (*lci)->connector.string);
+        int link = _variables->link(wl, rci->position, connector_get_string(&rci->connector),
+                                    (*lci)->word, (*lci)->position, connector_get_string(&(*lci)->connector));
         std::vector<int> clause(2);
         clause[0] = -link;
 
@@ -1342,8 +1342,8 @@ void SATEncoder::power_prune()
       for (j = matches.begin(); j != matches.end(); j++) {
         if (std::find(certainly_deep_left[(*j)->word].begin(), certainly_deep_left[(*j)->word].end(),
                       *j) != certainly_deep_left[(*j)->word].end()) {
-          generate_literal(-_variables->link((*i)->word, (*i)->position, (*i)->connector.string,
-                                             (*j)->word, (*j)->position, (*j)->connector.string));
+          generate_literal(-_variables->link((*i)->word, (*i)->position, connector_get_string(&(*i)->connector),
+                                             (*j)->word, (*j)->position, connector_get_string(&(*j)->connector)));
         }
       }
     }
@@ -1633,7 +1633,7 @@ void SATEncoderConjunctionFreeSentences::generate_linked_definitions()
       for (c = w1_connectors.begin(); c != w1_connectors.end(); c++) {
         assert(c->word == w1, "Connector word must match");
         if (_word_tags[w2].match_possible(c->word, c->position)) {
-          rhs.push(Lit(_variables->link_cw(w2, c->word, c->position, c->connector.string)));
+          rhs.push(Lit(_variables->link_cw(w2, c->word, c->position, connector_get_string(&c->connector))));
         }
       }
 
@@ -1752,7 +1752,7 @@ Exp* SATEncoderConjunctionFreeSentences::PositionConnector2exp(const PositionCon
     e->type = CONNECTOR_type;
     e->dir = pc->dir;
     e->multi = pc->connector.multi;
-    e->u.string = pc->connector.string;
+    e->u.string = connector_get_string(&pc->connector);
     e->cost = pc->cost;
 
     return e;
@@ -1846,7 +1846,8 @@ bool SATEncoderConjunctionFreeSentences::sat_extract_links(Linkage lkg)
       lgdebug(+0, "Warning: No expression for word %zu\n", wi);
     }
 
-    d = build_disjuncts_for_exp(de, xnode_word[wi]->string, UNLIMITED_LEN);
+    d = build_disjuncts_for_exp(NULL, de, xnode_word[wi]->string,
+                                _sent->dict->contable, UNLIMITED_LEN);
     word_record_in_disjunct(xnode_word[wi]->word, d);
     lkg->chosen_disjuncts[wi] = d;
     free_Exp(de);
@@ -37,7 +37,7 @@ void WordTag::insert_connectors(Exp* exp, int& dfs_position,
     Connector connector;
     init_connector(&connector);
     connector.multi = exp->multi;
-    connector.string = name;
+    connector_set_desc(&connector, condesc_add(_sent->dict->contable, name));
     set_connector_length_limit(&connector);
 
     switch (exp->dir) {
@@ -170,7 +170,7 @@ void WordTag::find_matches(int w, const char* C, char dir, std::vector<PositionC
   //  cout << "Look connection on: ." << _word << ". ." << w << ". " << C << dir << endl;
   Connector search_cntr;
   init_connector(&search_cntr);
-  search_cntr.string = C;
+  connector_set_desc(&search_cntr, condesc_add(_sent->dict->contable, C));
   set_connector_length_limit(&search_cntr);
 
   std::vector<PositionConnector>* connectors;
@@ -198,7 +198,7 @@ void WordTag::add_matches_with_word(WordTag& tag)
   std::vector<PositionConnector>::iterator i;
   for (i = _right_connectors.begin(); i != _right_connectors.end(); i++) {
     std::vector<PositionConnector*> connector_matches;
-    tag.find_matches(_word, (*i).connector.string, '+', connector_matches);
+    tag.find_matches(_word, connector_get_string(&(*i).connector), '+', connector_matches);
     std::vector<PositionConnector*>::iterator j;
     for (j = connector_matches.begin(); j != connector_matches.end(); j++) {
       i->matches.push_back(*j);
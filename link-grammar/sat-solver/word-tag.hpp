@@ -23,16 +23,17 @@ struct PositionConnector
       eps_right(er), eps_left(el), word_xnode(w_xnode)
   {
     // Initialize some fields in the connector struct.
-    connector.string = c->string;
+    init_connector(&connector);
+    connector.desc = c->desc;
     connector.multi = c->multi;
     connector.length_limit = c->length_limit;
 
     if (word_xnode == NULL) {
-       cerr << "Internal error: Word" << w << ": " << "; connector: '" << c->string << "'; X_node: " << (word_xnode?word_xnode->string: "(null)") << endl;
+       cerr << "Internal error: Word" << w << ": " << "; connector: '" << connector_get_string(c) << "'; X_node: " << (word_xnode?word_xnode->string: "(null)") << endl;
     }
 
     /*
-    cout << c->string << " : ." << w << ". : ." << p << ". ";
+    cout << connector_get_string(c) << " : ." << w << ". : ." << p << ". ";
     if (leading_right) {
       cout << "lr: ";
       copy(er.begin(), er.end(), ostream_iterator<int>(cout, " "));
@@ -164,7 +165,7 @@ public:
       int dist = w2 - w1;
       assert(0 < dist, "match() did not receive words in the natural order.");
       if (dist > cntr1.length_limit || dist > cntr2.length_limit) return false;
-      return easy_match(cntr1.string, cntr2.string);
+      return easy_match_connectors(&cntr1, &cntr2);
   }
 
   void insert_connectors(Exp* exp, int& dfs_position,
@@ -55,6 +55,7 @@ void *alloca (size_t);
 #define TLS __declspec(thread)
 #else
 #define TLS
+#define TLS_UNAVAILABLE /* TLS variables are shared by all the threads */
 #endif /* _MSC_VER */
 #endif /* !TLS */
 
@@ -30,6 +30,11 @@ static struct
 	int linkage_limit;
 	int islands_ok;
 	int repeatable_rand;
+	int reuse_parse_memory;
+	int threads;
+	int count_histograms;
+	int best_linkage_only;
+	int kbest_linkages;
 	int spell_guess;
 	int short_length;
 	int batch_mode;
@@ -74,6 +79,7 @@ static Switch default_switches[] =
 {
 	{"bad",        Bool, "Display of bad linkages",         &local.display_bad},
 	{"batch",      Bool, "Batch mode",                      &local.batch_mode},
+	{"best-only",  Bool, "Find the best linkage directly",  &local.best_linkage_only},
 	{"cluster",    Bool, "Use clusters to loosen parsing",  &local.use_cluster_disjuncts},
 	{"constituents", Int,  "Generate constituent output",   &local.display_constituents},
 	{"cost-model", Int,  "Cost model used for ranking",     &local.cost_model},
@@ -81,7 +87,9 @@ static Switch default_switches[] =
 	{"disjuncts",  Bool, "Display of disjuncts used",       &local.display_disjuncts},
 	{"echo",       Bool, "Echoing of input sentence",       &local.echo_on},
 	{"graphics",   Bool, "Graphical display of linkage",    &local.display_on},
+	{"histograms", Bool, "Maintain parse cost histograms",  &local.count_histograms},
 	{"islands-ok", Bool, "Use of null-linked islands",      &local.islands_ok},
+	{"kbest",      Bool, "Extract linkages in cost order",  &local.kbest_linkages},
 	{"limit",      Int,  "The maximum linkages processed",  &local.linkage_limit},
 	{"links",      Bool, "Display of complete link data",   &local.display_links},
 	{"memory",     Int,  "Max memory allowed",              &local.memory},
@@ -91,11 +99,13 @@ static Switch default_switches[] =
 	{"postscript", Bool, "Generate postscript output",      &local.display_postscript},
 	{"ps-header",  Bool, "Generate postscript header",      &local.display_ps_header},
 	{"rand",       Bool, "Use repeatable random numbers",   &local.repeatable_rand},
+	{"reuse",      Bool, "Reuse the parse memory",          &local.reuse_parse_memory},
 	{"senses",     Bool, "Display of word senses",          &local.display_senses},
 	{"short",      Int,  "Max length of short links",       &local.short_length},
 #if defined HAVE_HUNSPELL || defined HAVE_ASPELL
 	{"spell",      Int, "Up to this many spell-guesses per unknown word", &local.spell_guess},
 #endif /* HAVE_HUNSPELL */
+	{"threads",    Int,  "Number of threads for parsing",   &local.threads},
 	{"timeout",    Int,  "Abort parsing after this many seconds", &local.timeout},
 #ifdef USE_SAT_SOLVER
 	{"use-sat",    Bool, "Use Boolean SAT-based parser",    &local.use_sat_solver},
@@ -465,6 +475,11 @@ static void put_opts_in_local_vars(Command_Options* copts)
 	local.linkage_limit = parse_options_get_linkage_limit(opts);
 	local.islands_ok = parse_options_get_islands_ok(opts);
 	local.repeatable_rand = parse_options_get_repeatable_rand(opts);
+	local.reuse_parse_memory = parse_options_get_reuse_parse_memory(opts);
+	local.threads = parse_options_get_threads(opts);
+	local.count_histograms = parse_options_get_count_histograms(opts);
+	local.best_linkage_only = parse_options_get_best_linkage_only(opts);
+	local.kbest_linkages = parse_options_get_kbest_linkages(opts);
 	local.spell_guess = parse_options_get_spell_guess(opts);
 	local.short_length = parse_options_get_short_length(opts);
 	local.cost_model = parse_options_get_cost_model_type(opts);
@@ -503,6 +518,11 @@ static void put_local_vars_in_opts(Command_Options* copts)
 	parse_options_set_linkage_limit(opts, local.linkage_limit);
 	parse_options_set_islands_ok(opts, local.islands_ok);
 	parse_options_set_repeatable_rand(opts, local.repeatable_rand);
+	parse_options_set_reuse_parse_memory(opts, local.reuse_parse_memory);
+	parse_options_set_threads(opts, local.threads);
+	parse_options_set_count_histograms(opts, local.count_histograms);
+	parse_options_set_best_linkage_only(opts, local.best_linkage_only);
+	parse_options_set_kbest_linkages(opts, local.kbest_linkages);
 	parse_options_set_spell_guess(opts, local.spell_guess);
 	parse_options_set_short_length(opts, local.short_length);
 	parse_options_set_cost_model_type(opts, local.cost_model);
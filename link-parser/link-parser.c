@@ -237,12 +237,13 @@ static void print_parse_statistics(Sentence sent, Parse_Options opts)
 		if (sentence_num_linkages_found(sent) >
 			parse_options_get_linkage_limit(opts))
 		{
-			fprintf(stdout, "Found %d linkage%s (%d of %d random " \
+			fprintf(stdout, "Found %d linkage%s (%d of %d %s " \
 					"linkages had no P.P. violations)",
 					sentence_num_linkages_found(sent),
 					sentence_num_linkages_found(sent) == 1 ? "" : "s",
 					sentence_num_valid_linkages(sent),
-					sentence_num_linkages_post_processed(sent));
+					sentence_num_linkages_post_processed(sent),
+					parse_options_get_kbest_linkages(opts) ? "best" : "random");
 		}
 		else
 		{
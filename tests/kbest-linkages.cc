@@ -0,0 +1,99 @@
+/*************************************************************************/
+/* Copyright (c) 2026 link-grammar contributors                          */
+/* All rights reserved                                                   */
+/*                                                                       */
+/* Use of the link grammar parsing system is subject to the terms of the */
+/* license set forth in the LICENSE file included with this software.    */
+/* This license allows free redistribution and use in source and binary  */
+/* forms, with or without modification, subject to certain conditions.   */
+/*                                                                       */
+/*************************************************************************/
+
+// Check that with parse_options_set_kbest_linkages(), the linkages that
+// are extracted are the least-cost ones: Parse each sentence once with
+// a linkage limit that is large enough for all of its linkages, and once
+// in cost order with a small limit. The disjunct costs of the linkages
+// of the second parse must be the least ones of the first parse.
+//
+// Only the disjunct costs are compared, because the order of linkages
+// of equal disjunct cost is by a link cost that counts all the words
+// of the sentence, including the optional words that are not in the
+// linkage.
+//
+// Optionally, a batch file of sentences can be given as an argument.
+
+#include <algorithm>
+#include <math.h>
+#include "test-util.h"
+
+// Parse the sentence and return the disjunct costs of its linkages,
+// sorted. Return false if it has more linkages than the limit.
+static bool linkage_costs(Dictionary dict, Parse_Options opts,
+                          const std::string &s, std::vector<double> &costs)
+{
+	Sentence sent = sentence_create(s.c_str(), dict);
+	sentence_split(sent, opts);
+	sentence_parse(sent, opts);
+	int num_found = sentence_num_linkages_found(sent);
+	int num_linkages = sentence_num_linkages_post_processed(sent);
+
+	costs.clear();
+	for (int i = 0; i < num_linkages; i++)
+	{
+		Linkage lkg = linkage_create(i, sent, opts);
+		if (NULL == lkg) continue;
+		costs.push_back(linkage_disjunct_cost(lkg));
+		linkage_delete(lkg);
+	}
+	sentence_delete(sent);
+
+	std::sort(costs.begin(), costs.end());
+	return num_found <= (int) parse_options_get_linkage_limit(opts);
+}
+
+int main(int argc, char* argv[])
+{
+	const size_t k = 5;
+	std::vector<std::string> sents = test_sentences(argc, argv);
+	Dictionary dict = test_dictionary("en");
+	Parse_Options opts = test_parse_options(10000, 0);
+
+	int rc = 0;
+	size_t num_checked = 0;
+	for (const std::string &s : sents)
+	{
+		std::vector<double> all, best;
+
+		parse_options_set_kbest_linkages(opts, false);
+		parse_options_set_linkage_limit(opts, 10000);
+		if (!linkage_costs(dict, opts, s, all)) continue;
+
+		parse_options_set_kbest_linkages(opts, true);
+		parse_options_set_linkage_limit(opts, k);
+		linkage_costs(dict, opts, s, best);
+
+		if (all.size() > k) all.resize(k);
+		num_checked++;
+		bool same = (all.size() == best.size());
+		for (size_t i = 0; same && (i < all.size()); i++)
+			same = (fabs(all[i] - best[i]) < 1e-4);
+		if (same) continue;
+
+		fprintf(stderr, "Error: Not the %zu best linkages: %s\n", k, s.c_str());
+		for (size_t i = 0; i < std::max(all.size(), best.size()); i++)
+		{
+			fprintf(stderr, "   %zu:", i);
+			if (i < all.size())
+				fprintf(stderr, " %.3f", all[i]);
+			if (i < best.size())
+				fprintf(stderr, " k-best: %.3f", best[i]);
+			fprintf(stderr, "\n");
+		}
+		rc = 1;
+	}
+
+	printf("Checked %zu sentences\n", num_checked);
+	parse_options_delete(opts);
+	dictionary_delete(dict);
+	return rc;
+}
@@ -0,0 +1,179 @@
+/*************************************************************************/
+/* Copyright (c) 2026 link-grammar contributors                          */
+/* All rights reserved                                                   */
+/*                                                                       */
+/* Use of the link grammar parsing system is subject to the terms of the */
+/* license set forth in the LICENSE file included with this software.    */
+/* This license allows free redistribution and use in source and binary  */
+/* forms, with or without modification, subject to certain conditions.   */
+/*                                                                       */
+/*************************************************************************/
+
+// Check that the parse options that only change how the parsing is done
+// don't change its result: Parse the sentences with the default options,
+// and then with several threads, with reuse of the parse memory, and
+// with cost histograms (which count each null count separately, instead
+// of all of them in one pass). The linkage counts, and the costs,
+// violations and diagrams of the linkages, must be identical.
+// The linkage limit is large enough for the linkages to be processed
+// by several threads too.
+// This is done with linkages extracted by index or at random, and with
+// linkages extracted in cost order. Also check that with
+// best_linkage_only, the first linkage has the same cost as the first
+// one of the usual extraction.
+//
+// Optionally, a batch file of sentences can be given as an argument.
+
+#include <math.h>
+#include "test-util.h"
+
+struct Parse_result
+{
+	int null_count;
+	int num_found;
+	int num_valid;
+	std::vector<double> costs;
+	std::vector<int> violations;
+	std::vector<std::string> diagrams;
+
+	bool operator==(const Parse_result &r) const
+	{
+		return (null_count == r.null_count) && (num_found == r.num_found) &&
+		       (num_valid == r.num_valid) && (costs == r.costs) &&
+		       (violations == r.violations) && (diagrams == r.diagrams);
+	}
+};
+
+static void parse(Dictionary dict, Parse_Options opts, const std::string &s,
+                  Parse_result &r)
+{
+	Sentence sent = sentence_create(s.c_str(), dict);
+	sentence_split(sent, opts);
+
+	sentence_parse(sent, opts);
+	r.null_count = sentence_null_count(sent);
+	r.num_found = sentence_num_linkages_found(sent);
+	r.num_valid = sentence_num_valid_linkages(sent);
+	for (int i = 0; i < sentence_num_linkages_post_processed(sent); i++)
+	{
+		Linkage lkg = linkage_create(i, sent, opts);
+		r.costs.push_back(linkage_disjunct_cost(lkg));
+		r.violations.push_back(sentence_num_violations(sent, i));
+		char *diagram = linkage_print_diagram(lkg, true, 300);
+		r.diagrams.push_back(diagram);
+		linkage_free_diagram(diagram);
+		linkage_delete(lkg);
+	}
+
+	sentence_delete(sent);
+}
+
+// Parse the sentences into results, which should be empty.
+static void parse_all(Dictionary dict, Parse_Options opts,
+                      const std::vector<std::string> &sents,
+                      std::vector<Parse_result> &results)
+{
+	results.resize(sents.size());
+	for (size_t i = 0; i < sents.size(); i++)
+		parse(dict, opts, sents[i], results[i]);
+}
+
+struct Variant
+{
+	const char *name;
+	int threads;
+	bool reuse;
+	bool histograms;
+};
+
+static const Variant variants[] =
+{
+	{ "threads=4",        4, false, false },
+	{ "reuse",            1, true,  false },
+	{ "threads=4, reuse", 4, true,  false },
+	{ "histograms",       1, false, true  },
+};
+
+static void set_variant(Parse_Options opts, const Variant &v)
+{
+	parse_options_set_threads(opts, v.threads);
+	parse_options_set_reuse_parse_memory(opts, v.reuse);
+	parse_options_set_count_histograms(opts, v.histograms);
+}
+
+int main(int argc, char* argv[])
+{
+	std::vector<std::string> sents = test_sentences(argc, argv);
+	Dictionary dict = test_dictionary("en");
+	Parse_Options opts = test_parse_options(100, 250);
+
+	int rc = 0;
+	for (int kbest = 0; kbest < 2; kbest++)
+	{
+		const char *mode = kbest ? "k-best" : "default";
+		parse_options_set_kbest_linkages(opts, kbest);
+
+		set_variant(opts, { "default", 1, false, false });
+		std::vector<Parse_result> ref;
+		parse_all(dict, opts, sents, ref);
+
+		for (const Variant &v : variants)
+		{
+			set_variant(opts, v);
+			std::vector<Parse_result> res;
+			parse_all(dict, opts, sents, res);
+
+			for (size_t i = 0; i < sents.size(); i++)
+			{
+				if (res[i] == ref[i]) continue;
+
+				fprintf(stderr, "Error: %s, %s: Result mismatch: %s\n"
+				        "   nulls %d, %d found, %d valid, %zu linkages\n"
+				        "   %s: nulls %d, %d found, %d valid, %zu linkages\n",
+				        mode, v.name, sents[i].c_str(),
+				        ref[i].null_count, ref[i].num_found, ref[i].num_valid,
+				        ref[i].diagrams.size(),
+				        v.name, res[i].null_count, res[i].num_found,
+				        res[i].num_valid, res[i].diagrams.size());
+				rc = 1;
+			}
+		}
+
+		/* The first linkage with best_linkage_only is the best one, or
+		 * (when it is invalid) the first one of the usual extraction.
+		 * Without k-best, the extraction is random when there are too
+		 * many linkages, so only the other sentences are compared. */
+		set_variant(opts, { "default", 1, false, false });
+		parse_options_set_best_linkage_only(opts, true);
+		std::vector<Parse_result> best;
+		parse_all(dict, opts, sents, best);
+		parse_options_set_best_linkage_only(opts, false);
+
+		for (size_t i = 0; i < sents.size(); i++)
+		{
+			if (!kbest &&
+			    (ref[i].num_found > parse_options_get_linkage_limit(opts)))
+				continue;
+			if ((best[i].null_count == ref[i].null_count) &&
+			    (best[i].costs.empty() == ref[i].costs.empty()) &&
+			    (best[i].costs.empty() ||
+			     (fabs(best[i].costs[0] - ref[i].costs[0]) < 1e-4)))
+				continue;
+
+			fprintf(stderr, "Error: %s, best-only: Result mismatch: %s\n"
+			        "   nulls %d, first cost %.3f\n"
+			        "   best-only: nulls %d, first cost %.3f\n",
+			        mode, sents[i].c_str(),
+			        ref[i].null_count,
+			        ref[i].costs.empty() ? HUGE_VAL : ref[i].costs[0],
+			        best[i].null_count,
+			        best[i].costs.empty() ? HUGE_VAL : best[i].costs[0]);
+			rc = 1;
+		}
+	}
+
+	printf("Checked %zu sentences\n", sents.size());
+	parse_options_delete(opts);
+	dictionary_delete(dict);
+	return rc;
+}
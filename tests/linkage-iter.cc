@@ -0,0 +1,129 @@
+/*************************************************************************/
+/* Copyright (c) 2026 link-grammar contributors                          */
+/* All rights reserved                                                   */
+/*                                                                       */
+/* Use of the link grammar parsing system is subject to the terms of the */
+/* license set forth in the LICENSE file included with this software.    */
+/* This license allows free redistribution and use in source and binary  */
+/* forms, with or without modification, subject to certain conditions.   */
+/*                                                                       */
+/*************************************************************************/
+
+// Check that the linkage iterator (sentence_linkage_iter_new()) returns
+// the same valid linkages as sentence_parse(), with the same null count:
+// Parse each sentence with both, and compare the links of their valid
+// linkages. This is done with linkages extracted by index or at random,
+// and with linkages extracted in cost order, in which case the first
+// linkage of the iterator must also be one of the least cost.
+//
+// Optionally, a batch file of sentences can be given as an argument.
+
+#include <algorithm>
+#include <math.h>
+#include "test-util.h"
+
+static std::string linkage_links(Linkage lkg)
+{
+	std::string s;
+
+	for (size_t i = 0; i < linkage_get_num_links(lkg); i++)
+	{
+		s += linkage_get_word(lkg, linkage_get_link_lword(lkg, i));
+		s += " ";
+		s += linkage_get_link_label(lkg, i);
+		s += " ";
+		s += linkage_get_word(lkg, linkage_get_link_rword(lkg, i));
+		s += "; ";
+	}
+	return s;
+}
+
+struct Parse_result
+{
+	int null_count;
+	std::vector<std::string> links;  /* Of the valid linkages, sorted */
+	double min_cost;                 /* The least disjunct cost */
+	double first_cost;               /* That of the first linkage */
+};
+
+static Parse_result parse(Dictionary dict, Parse_Options opts,
+                          const std::string &s)
+{
+	Parse_result r = { 0, {}, HUGE_VAL, HUGE_VAL };
+	Sentence sent = sentence_create(s.c_str(), dict);
+	sentence_split(sent, opts);
+
+	sentence_parse(sent, opts);
+	r.null_count = sentence_null_count(sent);
+	for (int i = 0; i < sentence_num_linkages_post_processed(sent); i++)
+	{
+		if (0 != sentence_num_violations(sent, i)) continue;
+		Linkage lkg = linkage_create(i, sent, opts);
+		r.links.push_back(linkage_links(lkg));
+		r.min_cost = std::min(r.min_cost, linkage_disjunct_cost(lkg));
+		linkage_delete(lkg);
+	}
+	std::sort(r.links.begin(), r.links.end());
+
+	sentence_delete(sent);
+	return r;
+}
+
+static Parse_result parse_iter(Dictionary dict, Parse_Options opts,
+                               const std::string &s)
+{
+	Parse_result r = { 0, {}, HUGE_VAL, HUGE_VAL };
+	Sentence sent = sentence_create(s.c_str(), dict);
+	sentence_split(sent, opts);
+
+	Linkage_iter iter = sentence_linkage_iter_new(sent, opts);
+	Linkage lkg;
+	while (NULL != (lkg = sentence_linkage_iter_next(iter)))
+	{
+		if (r.links.empty()) r.first_cost = linkage_disjunct_cost(lkg);
+		r.links.push_back(linkage_links(lkg));
+		r.min_cost = std::min(r.min_cost, linkage_disjunct_cost(lkg));
+	}
+	r.null_count = sentence_null_count(sent);
+	sentence_linkage_iter_free(iter);
+	std::sort(r.links.begin(), r.links.end());
+
+	sentence_delete(sent);
+	return r;
+}
+
+int main(int argc, char* argv[])
+{
+	std::vector<std::string> sents = test_sentences(argc, argv);
+	Dictionary dict = test_dictionary("en");
+	Parse_Options opts = test_parse_options(20, 250);
+
+	int rc = 0;
+	for (int kbest = 0; kbest < 2; kbest++)
+	{
+		parse_options_set_kbest_linkages(opts, kbest);
+		for (const std::string &s : sents)
+		{
+			Parse_result all = parse(dict, opts, s);
+			Parse_result it = parse_iter(dict, opts, s);
+
+			if ((all.null_count == it.null_count) && (all.links == it.links) &&
+			    (!kbest || it.links.empty() ||
+			     (fabs(it.first_cost - all.min_cost) < 1e-4)))
+				continue;
+
+			fprintf(stderr, "Error: %s: Iterator mismatch: %s\n"
+			        "   nulls %d, %zu valid linkages, least cost %.3f\n"
+			        "   iterator: nulls %d, %zu valid linkages, first cost %.3f\n",
+			        kbest ? "k-best" : "default", s.c_str(),
+			        all.null_count, all.links.size(), all.min_cost,
+			        it.null_count, it.links.size(), it.first_cost);
+			rc = 1;
+		}
+	}
+
+	printf("Checked %zu sentences\n", sents.size());
+	parse_options_delete(opts);
+	dictionary_delete(dict);
+	return rc;
+}
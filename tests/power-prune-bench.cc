@@ -0,0 +1,91 @@
+/*************************************************************************/
+/* Copyright (c) 2026 link-grammar contributors                          */
+/* All rights reserved                                                   */
+/*                                                                       */
+/* Use of the link grammar parsing system is subject to the terms of the */
+/* license set forth in the LICENSE file included with this software.    */
+/* This license allows free redistribution and use in source and binary  */
+/* forms, with or without modification, subject to certain conditions.   */
+/*                                                                       */
+/*************************************************************************/
+
+// Benchmark of the power pruning: parse the sentences of a batch file
+// with the classic power pruning ("!test=power-prune-classic"),
+// and then with the default one (grouped connector tables, class bitsets,
+// and the given number of threads), and report the parse times. The numbers of
+// linkages must be the same.
+//
+// It is not a part of "make check". Build it with
+// "make power-prune-bench", and run it as:
+//    power-prune-bench [lang [batch-file [threads]]]
+
+#include <chrono>
+#include "test-util.h"
+
+// Parse all the sentences. Return the total time in milliseconds, and
+// put the number of linkages of each sentence in nlinkages.
+static double parse_all(Dictionary dict, Parse_Options opts,
+                        const std::vector<std::string> &sents,
+                        std::vector<int> &nlinkages)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	nlinkages.clear();
+	for (const std::string &s : sents)
+	{
+		Sentence sent = sentence_create(s.c_str(), dict);
+		sentence_split(sent, opts);
+		nlinkages.push_back(sentence_parse(sent, opts));
+		sentence_delete(sent);
+	}
+
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+int main(int argc, char* argv[])
+{
+	const char *lang = (1 < argc) ? argv[1] : "en";
+	std::string batch = (2 < argc) ? argv[2] :
+		std::string(DICTIONARY_DIR "/data/") + lang + "/corpus-fixes.batch";
+	int threads = (3 < argc) ? atoi(argv[3]) : 1;
+
+	Dictionary dict = test_dictionary(lang);
+
+	std::vector<std::string> sents = read_batch(batch.c_str());
+	if (sents.empty()) {
+		fprintf (stderr, "Fatal error: No sentences in %s\n", batch.c_str());
+		exit(1);
+	}
+
+	Parse_Options opts = test_parse_options(100, 0);
+
+	std::vector<int> nclassic, ndefault;
+
+	parse_options_set_test(opts, "power-prune-classic");
+	double tclassic = parse_all(dict, opts, sents, nclassic);
+
+	parse_options_set_test(opts, "");
+	parse_options_set_threads(opts, threads);
+	double tdefault = parse_all(dict, opts, sents, ndefault);
+
+	int rc = 0;
+	for (size_t i = 0; i < sents.size(); i++)
+	{
+		if (nclassic[i] != ndefault[i])
+		{
+			fprintf(stderr, "Error: %d != %d linkages: %s\n",
+			        nclassic[i], ndefault[i], sents[i].c_str());
+			rc = 2;
+		}
+	}
+
+	printf("%zu sentences from %s\n", sents.size(), batch.c_str());
+	printf("classic power pruning: %.0f ms\n", tclassic);
+	printf("default power pruning (%d thread%s): %.0f ms\n",
+	       threads, (1 == threads) ? "" : "s", tdefault);
+
+	parse_options_delete(opts);
+	dictionary_delete(dict);
+	return rc;
+}
@@ -0,0 +1,131 @@
+/*************************************************************************/
+/* Copyright (c) 2026 link-grammar contributors                          */
+/* All rights reserved                                                   */
+/*                                                                       */
+/* Use of the link grammar parsing system is subject to the terms of the */
+/* license set forth in the LICENSE file included with this software.    */
+/* This license allows free redistribution and use in source and binary  */
+/* forms, with or without modification, subject to certain conditions.   */
+/*                                                                       */
+/*************************************************************************/
+
+// Check a SQL dictionary whose words add many connector names while the
+// sentence is being prepared. The words of a SQL dictionary are read
+// when they are first used, so their connector names are enumerated only
+// then, and the connector descriptor table grows after the connectors of
+// the other words already point to their descriptors.
+//
+// The dictionary is the demo-sql one, plus a word "zz" whose disjunct has
+// several hundred connector names that no other word has. It is created
+// in a temporary directory.
+
+#include <unistd.h>
+#include <sqlite3.h>
+#include "test-util.h"
+
+#define NUM_ZZ_CONNECTORS 300
+
+static const char *demo_sql =
+	"CREATE TABLE Morphemes (morpheme TEXT NOT NULL,"
+	"   subscript TEXT UNIQUE NOT NULL, classname TEXT NOT NULL);"
+	"CREATE TABLE Disjuncts (classname TEXT NOT NULL,"
+	"   disjunct TEXT NOT NULL, cost REAL);"
+	"INSERT INTO Morphemes VALUES('LEFT-WALL','LEFT-WALL','LEFT-WALL');"
+	"INSERT INTO Morphemes VALUES('this','this.p','this');"
+	"INSERT INTO Morphemes VALUES('is','is.v','is');"
+	"INSERT INTO Morphemes VALUES('a','a','(article)');"
+	"INSERT INTO Morphemes VALUES('test','test.n','(noun)');"
+	"INSERT INTO Morphemes VALUES('zz','zz','zz');"
+	"INSERT INTO Disjuncts VALUES('LEFT-WALL','Wd+ & WV+',0.0);"
+	"INSERT INTO Disjuncts VALUES('this','Wd- & Ss*b+',0.1);"
+	"INSERT INTO Disjuncts VALUES('is','Ss- & WV- & O*m+',0.2);"
+	"INSERT INTO Disjuncts VALUES('(article)','Ds+',0.1);"
+	"INSERT INTO Disjuncts VALUES('(noun)','Ds- & Os-',0.0);";
+
+static bool create_db(const std::string &dbname)
+{
+	std::string zz = "INSERT INTO Disjuncts VALUES('zz','";
+	for (int i = 0; i < NUM_ZZ_CONNECTORS; i++)
+	{
+		char con[32];
+		snprintf(con, sizeof(con), "%sZQ%03d-", (0 == i) ? "" : " & ", i);
+		zz += con;
+	}
+	zz += "',0.0);";
+
+	sqlite3 *db;
+	if (SQLITE_OK != sqlite3_open(dbname.c_str(), &db))
+	{
+		fprintf(stderr, "Error: Can't create %s: %s\n",
+		        dbname.c_str(), sqlite3_errmsg(db));
+		sqlite3_close(db);
+		return false;
+	}
+
+	char *err = NULL;
+	if ((SQLITE_OK != sqlite3_exec(db, demo_sql, NULL, NULL, &err)) ||
+	    (SQLITE_OK != sqlite3_exec(db, zz.c_str(), NULL, NULL, &err)))
+	{
+		fprintf(stderr, "Error: %s: %s\n", dbname.c_str(), err);
+		sqlite3_free(err);
+		sqlite3_close(db);
+		return false;
+	}
+	sqlite3_close(db);
+	return true;
+}
+
+static const struct
+{
+	const char *sentence;
+	int null_count;
+} sentences[] =
+{
+	{ "this is a test", 0 },
+	{ "this is zz a test", 1 },
+	{ "this is a test zz", 1 },
+	{ "this is a test", 0 },
+};
+
+int main()
+{
+	char dir[] = "/tmp/lg-sql-dict-XXXXXX";
+	if (NULL == mkdtemp(dir))
+	{
+		perror("mkdtemp");
+		return 1;
+	}
+	std::string dbname = std::string(dir) + "/dict.db";
+
+	int rc = 1;
+	if (create_db(dbname))
+	{
+		Dictionary dict = test_dictionary(dir);
+		Parse_Options opts = test_parse_options(100, 5);
+
+		rc = 0;
+		for (const auto &t : sentences)
+		{
+			Sentence sent = sentence_create(t.sentence, dict);
+			sentence_split(sent, opts);
+			int num_linkages = sentence_parse(sent, opts);
+			int null_count = sentence_null_count(sent);
+			if ((0 >= num_linkages) || (t.null_count != null_count))
+			{
+				fprintf(stderr, "Error: \"%s\": %d linkages, null count %d "
+				        "(expected %d)\n",
+				        t.sentence, num_linkages, null_count, t.null_count);
+				rc = 1;
+			}
+			sentence_delete(sent);
+		}
+
+		parse_options_delete(opts);
+		dictionary_delete(dict);
+	}
+
+	unlink(dbname.c_str());
+	rmdir(dir);
+	if (0 == rc) printf("Checked the SQL dictionary %s\n", dir);
+	return rc;
+}
@@ -0,0 +1,95 @@
+/*************************************************************************/
+/* Copyright (c) 2026 link-grammar contributors                          */
+/* All rights reserved                                                   */
+/*                                                                       */
+/* Use of the link grammar parsing system is subject to the terms of the */
+/* license set forth in the LICENSE file included with this software.    */
+/* This license allows free redistribution and use in source and binary  */
+/* forms, with or without modification, subject to certain conditions.   */
+/*                                                                       */
+/*************************************************************************/
+
+// The sentences, dictionary and parse options setup that is common to
+// the parse checks (and benchmarks) in this directory.
+
+#ifndef _TEST_UTIL_H
+#define _TEST_UTIL_H
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <locale.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "link-grammar/link-includes.h"
+
+static const char *default_sentences[] =
+{
+	"This is a test.",
+	"The cat sat on the mat.",
+	"I saw the man with the telescope.",
+	"He said that he would come to the party if he could find the time.",
+	"The quick brown fox jumped over the lazy dog, and then it ran away.",
+	"Time flies like an arrow, but fruit flies like a banana.",
+	"We had a long talk about the problems that the students in the class were facing.",
+	"The committee, which had met several times during the previous year without reaching any agreement, finally decided that the proposal should be sent back to the department for further study.",
+	"this sentence is not correct the grammar",
+	"The man the dog quickly store went to yesterday the.",
+};
+
+// Read the sentences of a batch file. The "!" commands and the "%"
+// comments are skipped, and the "*" mark of the sentences that are not
+// supposed to parse is removed.
+static inline std::vector<std::string> read_batch(const char *path)
+{
+	std::vector<std::string> sents;
+	std::ifstream in(path);
+	std::string line;
+
+	while (std::getline(in, line))
+	{
+		if (line.empty() || '!' == line[0] || '%' == line[0]) continue;
+		if ('*' == line[0]) line.erase(0, 1);
+		if (line.find_first_not_of(" \t") == std::string::npos) continue;
+		sents.push_back(line);
+	}
+	return sents;
+}
+
+// The sentences of the batch file that is given as an argument, or else
+// the default ones.
+static inline std::vector<std::string> test_sentences(int argc, char *argv[])
+{
+	if (1 < argc) return read_batch(argv[1]);
+
+	return std::vector<std::string>(default_sentences, default_sentences +
+		sizeof(default_sentences)/sizeof(default_sentences[0]));
+}
+
+// Open the dictionary of the given language from the source tree.
+// Exit on failure.
+static inline Dictionary test_dictionary(const char *lang)
+{
+	setlocale(LC_ALL, "en_US.UTF-8");
+	dictionary_set_data_dir(DICTIONARY_DIR "/data");
+	Dictionary dict = dictionary_create_lang(lang);
+	if (!dict) {
+		fprintf (stderr, "Fatal error: Unable to open the dictionary\n");
+		exit(1);
+	}
+	return dict;
+}
+
+static inline Parse_Options test_parse_options(int linkage_limit,
+                                               int max_null_count)
+{
+	Parse_Options opts = parse_options_create();
+	parse_options_set_verbosity(opts, 0);
+	parse_options_set_linkage_limit(opts, linkage_limit);
+	parse_options_set_min_null_count(opts, 0);
+	parse_options_set_max_null_count(opts, max_null_count);
+	return opts;
+}
+
+#endif /* _TEST_UTIL_H */